@@ -18,13 +18,18 @@
 #include "mozilla/dom/MessageChannel.h"       // for MessageChannel
 #include "mozilla/Hal.h"
 
+#include "EmbedLitePooledViews.h"
 #include "EmbedLiteUILoop.h"
 #include "EmbedLiteSubThread.h"
+#include "EmbedLiteTaskQueue.h"
 #include "GeckoLoader.h"
 
 #include "EmbedLiteAppThreadParent.h"
 #include "EmbedLiteAppThreadChild.h"
+#include "EmbedLitePriorityManager.h"
+#include "EmbedLiteTabManager.h"
 #include "EmbedLiteView.h"
+#include "EmbedLiteViewParent.h"
 #include "EmbedLiteWindow.h"
 #include "nsXULAppAPI.h"
 #include "EmbedLiteMessagePump.h"
@@ -32,6 +37,12 @@
 
 #include "EmbedLiteCompositorBridgeParent.h"
 #include "EmbedLiteAppProcessParent.h"
+#include "EmbedLiteContentProcessManager.h"
+#include "EmbedLiteIPCTrace.h"
+#include "EmbedLiteWindowProcessParent.h"
+
+#include <algorithm>
+#include <math.h>
 
 namespace mozilla {
 namespace startup {
@@ -69,7 +80,15 @@ EmbedLiteApp::EmbedLiteApp()
   , mSubThread(nullptr)
   , mAppParent(nullptr)
   , mAppChild(nullptr)
+  , mProcessManager(nullptr)
   , mEmbedType(EMBED_INVALID)
+  , mTabManager(nullptr)
+  , mPriorityManager(nullptr)
+  , mTaskQueue(nullptr)
+  , mIdleStats()
+  , mPooledViews(nullptr)
+  , mViewPoolRefillPending(false)
+  , mLastRequestId(0)
   , mState(STOPPED)
   , mRenderType(RENDER_AUTO)
   , mProfilePath(strdup("mozembed"))
@@ -77,6 +96,20 @@ EmbedLiteApp::EmbedLiteApp()
 {
   LOGT();
   sSingleton = this;
+  mTaskQueue = new EmbedLiteTaskQueue([this](TimeDuration aDelay) {
+    if (!mUILoop) {
+      return;
+    }
+    RefPtr<Runnable> task = NewRunnableFunction("mozilla::embedlite::EmbedLiteApp::RunTasks",
+                                                &EmbedLiteApp::RunTasks, this);
+    if (aDelay > TimeDuration()) {
+      mUILoop->PostDelayedTask(task.forget(), int(ceil(aDelay.ToMilliseconds())));
+    } else {
+      mUILoop->PostTask(task.forget());
+    }
+  });
+
+  mPooledViews = new EmbedLitePooledViews();
 
   hal::Init();
 }
@@ -90,6 +123,15 @@ EmbedLiteApp::~EmbedLiteApp()
 
   hal::Shutdown();
 
+  delete mTabManager;
+  mTabManager = nullptr;
+  delete mPriorityManager;
+  mPriorityManager = nullptr;
+  delete mTaskQueue;
+  mTaskQueue = nullptr;
+  delete mPooledViews;
+  mPooledViews = nullptr;
+
   sSingleton = NULL;
   if (mProfilePath) {
     free(mProfilePath);
@@ -128,15 +170,10 @@ EmbedLiteApp::GetUILoop() {
 void*
 EmbedLiteApp::PostTask(EMBEDTaskCallback callback, void* userData, int timeout)
 {
-  RefPtr<Runnable> newTask = NewRunnableFunction("mozilla::embedlite::EmbedLiteApp::EMBEDTaskCallback",
-                                                 callback, userData);
-  if (timeout) {
-    mUILoop->PostDelayedTask(newTask.forget(), timeout);
-  } else {
-    mUILoop->PostTask(newTask.forget());
-  }
-
-  return (void*)newTask;
+  EmbedLiteTaskId id = ScheduleTask(EmbedLiteTaskPriority::Normal, [callback, userData]() {
+    callback(userData);
+  }, std::max(timeout, 0));
+  return reinterpret_cast<void*>(uintptr_t(id));
 }
 
 void*
@@ -147,8 +184,15 @@ EmbedLiteApp::PostCompositorTask(EMBEDTaskCallback callback, void* userData, int
     return nullptr;
   }
 
-  RefPtr<Runnable> newTask = NewRunnableFunction("mozilla::embedlite::EmbedLiteApp::EMBEDTaskCallback",
-                                                 callback, userData);
+  // Only tracked for CancelTask, the compositor thread runs it.
+  EmbedLiteTaskQueue* queue = mTaskQueue;
+  EmbedLiteTaskId id = queue->ReserveId();
+  RefPtr<CancelableRunnable> newTask = NS_NewCancelableRunnableFunction(
+      "mozilla::embedlite::EmbedLiteApp::EMBEDTaskCallback", [queue, id, callback, userData]() {
+    queue->Untrack(id);
+    callback(userData);
+  });
+  queue->Track(id, newTask);
   MOZ_ASSERT(mozilla::layers::CompositorThread());
 
   if (timeout) {
@@ -157,15 +201,111 @@ EmbedLiteApp::PostCompositorTask(EMBEDTaskCallback callback, void* userData, int
     mozilla::layers::CompositorThread()->Dispatch(newTask.forget());
   }
 
-  return (void*)newTask;
+  return reinterpret_cast<void*>(uintptr_t(id));
 }
 
 void
 EmbedLiteApp::CancelTask(void* aTask)
 {
-  if (aTask) {
-    static_cast<CancelableRunnable*>(aTask)->Cancel();
+  CancelScheduledTask(EmbedLiteTaskId(reinterpret_cast<uintptr_t>(aTask)));
+}
+
+EmbedLiteTaskId
+EmbedLiteApp::ScheduleTask(EmbedLiteTaskPriority aPriority, const std::function<void()>& aTask,
+                           uint32_t aDelayMs, uint32_t aIntervalMs)
+{
+  NS_ENSURE_TRUE(mUILoop && aTask && aPriority < EmbedLiteTaskPriority::Count, 0);
+  return mTaskQueue->Schedule(aPriority, aTask, TimeDuration::FromMilliseconds(aDelayMs),
+                              TimeDuration::FromMilliseconds(aIntervalMs), TimeStamp::Now());
+}
+
+bool
+EmbedLiteApp::CancelScheduledTask(EmbedLiteTaskId aId)
+{
+  return aId && mTaskQueue->Cancel(aId);
+}
+
+EmbedLiteTaskStats
+EmbedLiteApp::GetTaskStats(EmbedLiteTaskPriority aPriority)
+{
+  return mTaskQueue->GetStats(aPriority);
+}
+
+void
+EmbedLiteApp::RunTasks(EmbedLiteApp* aApp)
+{
+  aApp->mTaskQueue->RunNext(TimeStamp::Now());
+}
+
+bool
+EmbedLiteApp::IdlePeriod(uint32_t aBudgetMs)
+{
+  // Shorter periods fit no GC slice or CC step, content is left alone.
+  static const uint32_t kMinContentIdleBudget = 5;
+
+  TimeStamp now = TimeStamp::Now();
+  TimeStamp deadline = now + TimeDuration::FromMilliseconds(aBudgetMs);
+  mTaskQueue->EnableIdlePeriods();
+  mIdleStats.periods++;
+
+  if (mState == INITIALIZED && aBudgetMs >= kMinContentIdleBudget) {
+    ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+      // One period at a time, and none before the last one is over, so
+      // that short reports in a row do not keep content busy.
+      EmbedLiteAppParent* parent = static_cast<EmbedLiteAppParent*>(aParent);
+      if (parent->mIdlePeriodPending || (!parent->mIdleDeadline.IsNull() && now < parent->mIdleDeadline)) {
+        return;
+      }
+      parent->mIdlePeriodPending = true;
+      parent->mIdleDeadline = deadline;
+      Unused << parent->SendIdlePeriod(deadline);
+      mIdleStats.contentPeriods++;
+    });
+  }
+
+  while (now < deadline && mTaskQueue->RunIdle(now)) {
+    mIdleStats.run++;
+    now = TimeStamp::Now();
+    if (now > deadline) {
+      mIdleStats.overran++;
+      mIdleStats.overrunMs += (now - deadline).ToMilliseconds();
+    }
+  }
+
+  bool idleTaskDue = mTaskQueue->IdleTaskDue(now);
+  if (idleTaskDue) {
+    mIdleStats.deferred++;
   }
+  return idleTaskDue;
+}
+
+void
+EmbedLiteApp::ContentIdlePeriodDone(bool aMissed, double aOverrunMs)
+{
+  if (aMissed) {
+    mIdleStats.contentMissed++;
+  } else if (aOverrunMs > 0) {
+    mIdleStats.contentOverran++;
+    mIdleStats.contentOverrunMs += aOverrunMs;
+  }
+}
+
+EmbedLiteTabManager*
+EmbedLiteApp::GetTabManager()
+{
+  if (!mTabManager) {
+    mTabManager = new EmbedLiteTabManager(this);
+  }
+  return mTabManager;
+}
+
+EmbedLitePriorityManager*
+EmbedLiteApp::GetPriorityManager()
+{
+  if (!mPriorityManager) {
+    mPriorityManager = new EmbedLitePriorityManager(this);
+  }
+  return mPriorityManager;
 }
 
 void
@@ -183,7 +323,10 @@ EmbedLiteApp::StartChild(EmbedLiteApp* aApp)
       }
     }
   } else if (aApp->mEmbedType == EMBED_PROCESS) {
-    aApp->mAppParent = EmbedLiteAppProcessParent::CreateEmbedLiteAppProcessParent();
+    aApp->mProcessManager = new EmbedLiteContentProcessManager(aApp);
+    if (!aApp->mProcessManager->Start()) {
+      LOGE("Failed to start content process");
+    }
   }
 }
 
@@ -257,7 +400,13 @@ void
 EmbedLiteApp::AddManifestLocation(const char* manifest)
 {
   if (mState == INITIALIZED) {
-    Unused << mAppParent->SendLoadComponentManifest(nsDependentCString(manifest));
+    nsDependentCString location(manifest);
+    if (mProcessManager) {
+      mProcessManager->RecordManifest(location);
+    }
+    ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+      Unused << aParent->SendLoadComponentManifest(location);
+    });
   } else {
     sComponentDirs.AppendElement(nsCString(manifest));
   }
@@ -325,6 +474,10 @@ void _FinalStop(EmbedLiteApp* app)
 void
 EmbedLiteApp::PreDestroy(EmbedLiteApp* app)
 {
+  if (app->mProcessManager) {
+    app->mProcessManager->Shutdown();
+    return;
+  }
   if (app->mAppParent == nullptr) {
     LOGE("!!!!!!!!!!!!!!!!!!!!!!!!!!!!!app->mAppParent is null, wrong logic?");
     return;
@@ -339,6 +492,9 @@ EmbedLiteApp::Stop()
   NS_ASSERTION(mState == STARTING || mState == INITIALIZED, "Wrong timing");
 
   if (mState == INITIALIZED) {
+    while (!mPendingWindows.empty()) {
+      DropPendingWindow(mPendingWindows.begin()->first);
+    }
     if (mViews.empty() && mWindows.empty()) {
       mUILoop->PostTask(NewRunnableFunction("mozilla::embedlite::EmbedLiteApp::PreDestroy",
                                             &EmbedLiteApp::PreDestroy, this));
@@ -371,7 +527,9 @@ EmbedLiteApp::Shutdown()
             "StopChildThread must be implemented when ExecuteChildThread defined");
       }
     } else if (mEmbedType == EMBED_PROCESS) {
-      delete mAppParent;
+      delete mProcessManager;
+      mProcessManager = nullptr;
+      GeckoLoader::TermEmbedding();
     }
   }
 
@@ -394,21 +552,139 @@ EmbedLiteApp::SetBoolPref(const char* aName, bool aValue)
 {
   NS_ENSURE_TRUE(mState == INITIALIZED, );
   NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
-  Unused << mAppParent->SendSetBoolPref(nsDependentCString(aName), aValue);
+  if (mProcessManager) {
+    AutoTArray<EmbedPref, 1> prefs;
+    prefs.AppendElement(EmbedPref(nsDependentCString(aName), dom::PrefValue(aValue)));
+    mProcessManager->RecordPrefs(prefs);
+  }
+  ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+    Unused << aParent->SendSetBoolPref(nsDependentCString(aName), aValue);
+  });
 }
 
 void
 EmbedLiteApp::SetCharPref(const char* aName, const char* aValue)
 {
   NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
-  Unused << mAppParent->SendSetCharPref(nsDependentCString(aName), nsDependentCString(aValue));
+  if (mProcessManager) {
+    AutoTArray<EmbedPref, 1> prefs;
+    prefs.AppendElement(EmbedPref(nsDependentCString(aName), dom::PrefValue(nsCString(aValue))));
+    mProcessManager->RecordPrefs(prefs);
+  }
+  ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+    Unused << aParent->SendSetCharPref(nsDependentCString(aName), nsDependentCString(aValue));
+  });
 }
 
 void
 EmbedLiteApp::SetIntPref(const char* aName, int aValue)
 {
   NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
-  Unused << mAppParent->SendSetIntPref(nsDependentCString(aName), aValue);
+  if (mProcessManager) {
+    AutoTArray<EmbedPref, 1> prefs;
+    prefs.AppendElement(EmbedPref(nsDependentCString(aName), dom::PrefValue(int32_t(aValue))));
+    mProcessManager->RecordPrefs(prefs);
+  }
+  ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+    Unused << aParent->SendSetIntPref(nsDependentCString(aName), aValue);
+  });
+}
+
+void
+EmbedLiteApp::SetPrefs(const std::vector<EmbedLitePref>& aPrefs)
+{
+  NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
+  nsTArray<EmbedPref> prefs(aPrefs.size());
+  for (const EmbedLitePref& pref : aPrefs) {
+    nsDependentCString name(pref.name.c_str());
+    switch (pref.type) {
+      case EmbedLitePref::PREF_BOOL:
+        prefs.AppendElement(EmbedPref(name, dom::PrefValue(pref.boolValue)));
+        break;
+      case EmbedLitePref::PREF_INT:
+        prefs.AppendElement(EmbedPref(name, dom::PrefValue(int32_t(pref.intValue))));
+        break;
+      case EmbedLitePref::PREF_STRING:
+        prefs.AppendElement(EmbedPref(name, dom::PrefValue(nsCString(pref.stringValue.c_str()))));
+        break;
+    }
+  }
+  if (mProcessManager) {
+    mProcessManager->RecordPrefs(prefs);
+  }
+  ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+    Unused << aParent->SendSetPrefs(prefs);
+  });
+}
+
+void
+EmbedLiteApp::GetPrefs(const char* aBranch, const EmbedLitePrefsCallback& aCallback)
+{
+  NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
+  NS_ENSURE_TRUE(mAppParent, );
+  uint32_t requestId = ++mLastRequestId;
+  mPrefsRequests[requestId] = aCallback;
+  Unused << mAppParent->SendGetPrefs(requestId, nsDependentCString(aBranch));
+}
+
+void
+EmbedLiteApp::PrefsReceived(uint32_t aRequestId, const std::vector<EmbedLitePref>& aPrefs)
+{
+  auto it = mPrefsRequests.find(aRequestId);
+  NS_ENSURE_TRUE(it != mPrefsRequests.end(), );
+  EmbedLitePrefsCallback callback = std::move(it->second);
+  mPrefsRequests.erase(it);
+  callback(aPrefs);
+}
+
+void
+EmbedLiteApp::SetObserverPolicy(const char* aTopic, EmbedLiteObserverPolicy aPolicy, uint32_t aWindowMs)
+{
+  LOGT("topic:%s policy:%u window:%u", aTopic, uint32_t(aPolicy), aWindowMs);
+  NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
+  if (mProcessManager) {
+    mProcessManager->RecordObserverPolicy(nsDependentCString(aTopic), uint32_t(aPolicy), aWindowMs);
+  }
+  ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+    Unused << aParent->SendSetObserverPolicy(nsDependentCString(aTopic), uint32_t(aPolicy), aWindowMs);
+  });
+}
+
+void
+EmbedLiteApp::GetObserverStats(const EmbedLiteObserverStatsCallback& aCallback)
+{
+  NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
+  NS_ENSURE_TRUE(mAppParent, );
+  uint32_t requestId = ++mLastRequestId;
+  mObserverStatsRequests[requestId] = aCallback;
+  Unused << mAppParent->SendGetObserverStats(requestId);
+}
+
+void
+EmbedLiteApp::ObserverStatsReceived(uint32_t aRequestId, const std::map<std::string, EmbedLiteObserverStats>& aStats)
+{
+  auto it = mObserverStatsRequests.find(aRequestId);
+  NS_ENSURE_TRUE(it != mObserverStatsRequests.end(), );
+  EmbedLiteObserverStatsCallback callback = std::move(it->second);
+  mObserverStatsRequests.erase(it);
+  callback(aStats);
+}
+
+void
+EmbedLiteApp::SetIPCTraceEnabled(bool aEnabled)
+{
+  EmbedLiteIPCTrace::SetEnabled(aEnabled);
+  SetBoolPref("embedlite.ipc.trace.enabled", aEnabled);
+}
+
+bool
+EmbedLiteApp::DumpIPCTrace(const char* aPath)
+{
+  NS_ENSURE_TRUE(aPath, false);
+  if (mEmbedType == EMBED_PROCESS && mAppParent) {
+    Unused << mAppParent->SendDumpIPCTrace(nsPrintfCString("%s.content", aPath));
+  }
+  return EmbedLiteIPCTrace::DumpTrace(aPath);
 }
 
 void
@@ -416,7 +692,12 @@ EmbedLiteApp::LoadGlobalStyleSheet(const char* aUri, bool aEnable)
 {
   LOGT();
   NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
-  Unused << mAppParent->SendLoadGlobalStyleSheet(nsDependentCString(aUri), aEnable);
+  if (mProcessManager) {
+    mProcessManager->RecordStyleSheet(nsDependentCString(aUri), aEnable);
+  }
+  ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+    Unused << aParent->SendLoadGlobalStyleSheet(nsDependentCString(aUri), aEnable);
+  });
 }
 
 void
@@ -424,7 +705,10 @@ EmbedLiteApp::SendObserve(const char* aMessageName, const char16_t* aMessage)
 {
   LOGT("topic:%s", aMessageName);
   NS_ENSURE_TRUE(mState == INITIALIZED, );
-  Unused << mAppParent->SendObserve(nsDependentCString(aMessageName), aMessage ? nsDependentString((const char16_t*)aMessage) : nsString());
+  nsString data(aMessage ? nsDependentString((const char16_t*)aMessage) : nsString());
+  ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+    Unused << aParent->SendObserve(nsDependentCString(aMessageName), data);
+  });
 }
 
 void
@@ -432,7 +716,12 @@ EmbedLiteApp::AddObserver(const char* aMessageName)
 {
   LOGT("topic:%s", aMessageName);
   NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
-  Unused << mAppParent->SendAddObserver(nsDependentCString(aMessageName));
+  if (mProcessManager) {
+    mProcessManager->RecordObserver(nsDependentCString(aMessageName), true);
+  }
+  ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+    Unused << aParent->SendAddObserver(nsDependentCString(aMessageName));
+  });
 }
 
 void
@@ -440,7 +729,12 @@ EmbedLiteApp::RemoveObserver(const char* aMessageName)
 {
   LOGT("topic:%s", aMessageName);
   NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
-  Unused << mAppParent->SendRemoveObserver(nsDependentCString(aMessageName));
+  if (mProcessManager) {
+    mProcessManager->RecordObserver(nsDependentCString(aMessageName), false);
+  }
+  ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+    Unused << aParent->SendRemoveObserver(nsDependentCString(aMessageName));
+  });
 }
 
 void EmbedLiteApp::AddObservers(const std::vector<std::string> &observersList)
@@ -450,9 +744,14 @@ void EmbedLiteApp::AddObservers(const std::vector<std::string> &observersList)
   nsTArray<nsCString> list;
   for (const auto &observer : observersList) {
       list.AppendElement(nsDependentCString(observer.c_str()));
+      if (mProcessManager) {
+        mProcessManager->RecordObserver(list.LastElement(), true);
+      }
   }
 
-  Unused << mAppParent->SendAddObservers(list);
+  ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+    Unused << aParent->SendAddObservers(list);
+  });
 }
 
 void EmbedLiteApp::RemoveObservers(const std::vector<std::string>& observersList)
@@ -462,9 +761,14 @@ void EmbedLiteApp::RemoveObservers(const std::vector<std::string>& observersList
   nsTArray<nsCString> list;
   for (const auto &observer : observersList) {
       list.AppendElement(nsDependentCString(observer.c_str()));
+      if (mProcessManager) {
+        mProcessManager->RecordObserver(list.LastElement(), false);
+      }
   }
 
-  Unused << mAppParent->SendRemoveObservers(list);
+  ForEachAppParent([&](PEmbedLiteAppParent* aParent) {
+    Unused << aParent->SendRemoveObservers(list);
+  });
 }
 
 EmbedLiteView*
@@ -472,17 +776,187 @@ EmbedLiteApp::CreateView(EmbedLiteWindow* aWindow, uint32_t aParent, uintptr_t a
 {
   LOGT();
   NS_ASSERTION(mState == INITIALIZED, "The app must be up and runnning by now");
+
+  if (aParentBrowsingContext) {
+    if (EmbedLiteView* view = AdoptPendingWindow(aWindow, aParent, aParentBrowsingContext)) {
+      view->Claimed(isDesktopMode);
+      return view;
+    }
+  }
+
+  // Prewarmed views have no opener, window.open with an opener builds a new one.
+  if (!aParentBrowsingContext) {
+    if (EmbedLiteView* view = ClaimPooledView(aWindow, aIsPrivateWindow)) {
+      view->Claimed(isDesktopMode);
+      return view;
+    }
+  }
+  return DoCreateView(aWindow, aParent, aParentBrowsingContext, aIsPrivateWindow, isDesktopMode);
+}
+
+EmbedLiteView*
+EmbedLiteApp::DoCreateView(EmbedLiteWindow* aWindow, uint32_t aParent, uintptr_t aParentBrowsingContext, bool aIsPrivateWindow, bool isDesktopMode)
+{
   static uint32_t sViewCreateID = 0;
   sViewCreateID++;
 
+  if (aWindow->IsCrashed()) {
+    RecoverWindow(aWindow);
+  }
+  PEmbedLiteAppParent* appParent = GetAppParent(aWindow->GetUniqueID());
+  NS_ENSURE_TRUE(appParent, nullptr);
+
   PEmbedLiteViewParent* viewParent = static_cast<PEmbedLiteViewParent*>(
-      mAppParent->SendPEmbedLiteViewConstructor(aWindow->GetUniqueID(), sViewCreateID,
-                                                aParent, aParentBrowsingContext, aIsPrivateWindow, isDesktopMode));
+      appParent->SendPEmbedLiteViewConstructor(aWindow->GetUniqueID(), sViewCreateID,
+                                               aParent, aParentBrowsingContext, aIsPrivateWindow, isDesktopMode));
   EmbedLiteView* view = new EmbedLiteView(this, aWindow, viewParent, sViewCreateID);
   mViews[sViewCreateID] = view;
   return view;
 }
 
+void
+EmbedLiteApp::SetViewPoolSize(EmbedLiteWindow* aWindow, uint32_t aSize, uint32_t aPrivateSize)
+{
+  LOGT("window:%u size:%u private:%u", aWindow->GetUniqueID(), aSize, aPrivateSize);
+  NS_ASSERTION(mState == INITIALIZED, "The app must be up and runnning by now");
+
+  ViewPool& pool = mViewPools[aWindow->GetUniqueID()];
+  pool.mWindow = aWindow;
+  pool.mSize[0] = aSize;
+  pool.mSize[1] = aPrivateSize;
+  for (int i = 0; i < 2; ++i) {
+    while (pool.mViews[i].size() > pool.mSize[i]) {
+      EmbedLiteView* view = pool.mViews[i].back();
+      pool.mViews[i].pop_back();
+      DestroyPooledView(view);
+    }
+  }
+  ScheduleViewPoolRefill();
+}
+
+EmbedLiteView*
+EmbedLiteApp::ClaimPooledView(EmbedLiteWindow* aWindow, bool aIsPrivateWindow)
+{
+  auto it = mViewPools.find(aWindow->GetUniqueID());
+  if (it == mViewPools.end()) {
+    return nullptr;
+  }
+
+  std::list<EmbedLiteView*>& views = it->second.mViews[aIsPrivateWindow];
+  if (views.empty()) {
+    ScheduleViewPoolRefill();
+    return nullptr;
+  }
+
+  // Views are appended in creation order, the oldest is the most likely
+  // to be initialized already.
+  EmbedLiteView* view = views.front();
+  views.pop_front();
+  mPooledViews->Claim(view->GetUniqueID());
+  LOGT("claimed view:%u", view->GetUniqueID());
+  ScheduleViewPoolRefill();
+  return view;
+}
+
+bool
+EmbedLiteApp::RemovePooledView(uint32_t aId)
+{
+  for (auto& pair : mViewPools) {
+    for (std::list<EmbedLiteView*>& views : pair.second.mViews) {
+      for (auto it = views.begin(); it != views.end(); ++it) {
+        if ((*it)->GetUniqueID() == aId) {
+          views.erase(it);
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+void
+EmbedLiteApp::DestroyPooledView(EmbedLiteView* aView)
+{
+  // Still pooled until ViewDestroyed, so it is not taken for the embedder's.
+  mPooledViews->StartDestroy(aView->GetUniqueID());
+  aView->Destroy();
+}
+
+void
+EmbedLiteApp::ScheduleViewPoolRefill()
+{
+  if (mViewPoolRefillPending || mState != INITIALIZED) {
+    return;
+  }
+
+  // Leave the UI thread and content alone while a claimed view starts
+  // loading, and wait for an idle period after that.
+  static const int kViewPoolRefillDelay = 1000;
+  mViewPoolRefillPending = true;
+  ScheduleTask(EmbedLiteTaskPriority::Idle, [this]() { RefillViewPools(this); }, kViewPoolRefillDelay);
+}
+
+void
+EmbedLiteApp::RefillViewPools(void* aApp)
+{
+  EmbedLiteApp* app = static_cast<EmbedLiteApp*>(aApp);
+  app->mViewPoolRefillPending = false;
+  if (app->mState != INITIALIZED) {
+    return;
+  }
+
+  // One view at a time, each one costs a docshell and an about:blank load.
+  for (auto& pair : app->mViewPools) {
+    ViewPool& pool = pair.second;
+    // Left to the embedder to bring back, see ReloadCrashedView.
+    if (pool.mWindow->IsCrashed()) {
+      continue;
+    }
+    for (int i = 0; i < 2; ++i) {
+      if (pool.mViews[i].size() < pool.mSize[i]) {
+        EmbedLiteView* view = app->DoCreateView(pool.mWindow, 0, 0, i == 1, false);
+        NS_ENSURE_TRUE(view, );
+        pool.mViews[i].push_back(view);
+        app->mPooledViews->Add(view->GetUniqueID());
+        app->ScheduleViewPoolRefill();
+        return;
+      }
+    }
+  }
+}
+
+void
+EmbedLiteApp::TrimViewPools(bool aCritical)
+{
+  LOGT("critical:%d pooled:%zu", aCritical, mPooledViews->Count());
+  for (auto& pair : mViewPools) {
+    for (std::list<EmbedLiteView*>& views : pair.second.mViews) {
+      size_t keep = aCritical ? 0 : views.size() / 2;
+      while (views.size() > keep) {
+        EmbedLiteView* view = views.back();
+        views.pop_back();
+        DestroyPooledView(view);
+      }
+    }
+  }
+}
+
+void
+EmbedLiteApp::DestroyViewPool(uint32_t aWindowId)
+{
+  auto it = mViewPools.find(aWindowId);
+  if (it == mViewPools.end()) {
+    return;
+  }
+
+  for (std::list<EmbedLiteView*>& views : it->second.mViews) {
+    for (EmbedLiteView* view : views) {
+      DestroyPooledView(view);
+    }
+  }
+  mViewPools.erase(it);
+}
+
 EmbedLiteWindow*
 EmbedLiteApp::CreateWindow(int width, int height, EmbedLiteWindowListener *aListener)
 {
@@ -495,13 +969,87 @@ EmbedLiteApp::CreateWindow(int width, int height, EmbedLiteWindowListener *aList
       aListener = &sFakeWindowListener;
   }
 
-  PEmbedLiteWindowParent* windowParent = static_cast<PEmbedLiteWindowParent*>(
-      mAppParent->SendPEmbedLiteWindowConstructor(width, height, sWindowCreateID, reinterpret_cast<uintptr_t>(aListener)));
+  PEmbedLiteWindowParent* windowParent = ConstructWindow(sWindowCreateID, width, height, aListener);
+  NS_ENSURE_TRUE(windowParent, nullptr);
   EmbedLiteWindow* window = new EmbedLiteWindow(this, windowParent, sWindowCreateID);
   mWindows[sWindowCreateID] = window;
   return window;
 }
 
+PEmbedLiteWindowParent*
+EmbedLiteApp::ConstructWindow(uint32_t aId, int aWidth, int aHeight, EmbedLiteWindowListener* aListener)
+{
+  PEmbedLiteAppParent* appParent = mProcessManager ? mProcessManager->AssignWindow(aId) : mAppParent;
+  NS_ENSURE_TRUE(appParent, nullptr);
+
+  PEmbedLiteWindowParent* windowParent = static_cast<PEmbedLiteWindowParent*>(
+      appParent->SendPEmbedLiteWindowConstructor(aWidth, aHeight, aId, reinterpret_cast<uintptr_t>(aListener)));
+  if (windowParent && mEmbedType == EMBED_PROCESS) {
+    static_cast<EmbedLiteWindowProcessParent*>(windowParent)->InitCompositor();
+  }
+  return windowParent;
+}
+
+void
+EmbedLiteApp::RecoverWindow(EmbedLiteWindow* aWindow)
+{
+  LOGT("window:%u", aWindow->GetUniqueID());
+  EmbedLiteWindowParent* crashed = aWindow->mWindowParent;
+  const gfxSize& size = crashed->GetSize();
+  PEmbedLiteWindowParent* windowParent = ConstructWindow(aWindow->GetUniqueID(), int(size.width),
+                                                         int(size.height), crashed->GetListener());
+  NS_ENSURE_TRUE(windowParent, );
+  aWindow->Recovered(windowParent);
+}
+
+bool
+EmbedLiteApp::ReloadCrashedView(EmbedLiteView* aView)
+{
+  NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
+  NS_ENSURE_TRUE(aView && aView->IsCrashed(), false);
+  LOGT("view:%u", aView->GetUniqueID());
+
+  EmbedLiteWindow* window = aView->mWindow;
+  if (window->IsCrashed()) {
+    RecoverWindow(window);
+  }
+  PEmbedLiteAppParent* appParent = GetAppParent(window->GetUniqueID());
+  NS_ENSURE_TRUE(appParent, false);
+
+  EmbedLiteViewParent* crashed = aView->mCrashedParent;
+  PEmbedLiteViewParent* viewParent = static_cast<PEmbedLiteViewParent*>(
+      appParent->SendPEmbedLiteViewConstructor(window->GetUniqueID(), aView->GetUniqueID(), 0, 0,
+                                               crashed->mIsPrivateWindow, crashed->mIsDesktopMode));
+  NS_ENSURE_TRUE(viewParent, false);
+  aView->Recovered(viewParent, crashed->mLocation);
+  return true;
+}
+
+void
+EmbedLiteApp::SetContentProcessPolicy(EmbedLiteProcessPolicy aPolicy, uint32_t aSpareProcesses)
+{
+  NS_ENSURE_TRUE(mProcessManager, );
+  mProcessManager->SetPolicy(aPolicy, aSpareProcesses);
+}
+
+PEmbedLiteAppParent*
+EmbedLiteApp::GetAppParent(uint32_t aWindowId)
+{
+  return mProcessManager ? mProcessManager->GetWindowProcess(aWindowId) : mAppParent;
+}
+
+void
+EmbedLiteApp::ForEachAppParent(const std::function<void(PEmbedLiteAppParent*)>& aCallback)
+{
+  if (mProcessManager) {
+    mProcessManager->ForEachProcess([&](EmbedLiteAppProcessParent* aProcess) {
+      aCallback(aProcess);
+    });
+  } else if (mAppParent) {
+    aCallback(mAppParent);
+  }
+}
+
 EmbedLiteSecurity* EmbedLiteApp::CreateSecurity(const char *aStatus, unsigned int aState) const
 {
     LOGT();
@@ -529,44 +1077,168 @@ EmbedLiteApp::CreateWindowRequested(const uint32_t &chromeFlags,
                                     const uint32_t &parentId,
                                     const uintptr_t &parentBrowsingContext)
 {
-  EmbedLiteView* view = nullptr;
-  std::map<uint32_t, EmbedLiteView*>::iterator it;
-  for (it = mViews.begin(); it != mViews.end(); it++) {
-    if (it->second && it->second->GetUniqueID() == parentId) {
-      LOGT("Found parent view:%p", it->second);
-      view = it->second;
-      break;
-    }
-  }
+  std::map<uint32_t, EmbedLiteView*>::iterator it = mViews.find(parentId);
+  EmbedLiteView* view = it != mViews.end() ? it->second : nullptr;
   uint32_t viewId = mListener ? mListener->CreateNewWindowRequested(chromeFlags, view, parentBrowsingContext) : 0;
   return viewId;
 }
 
+void
+EmbedLiteApp::WindowCreated(EmbedLiteViewParent* aActor, uint32_t aParentId,
+                            uintptr_t aParentBrowsingContext, uint32_t aChromeFlags)
+{
+  uint32_t id = aActor->mId;
+  LOGT("id:%u parent:%u", id, aParentId);
+  mPendingWindows[id] = { aActor, aParentId, aParentBrowsingContext };
+
+  uint32_t viewId = mState == INITIALIZED ?
+      CreateWindowRequested(aChromeFlags, aParentId, aParentBrowsingContext) : 0;
+  if (!mPendingWindows.count(id)) {
+    // Adopted by the listener.
+    return;
+  }
+
+  if (!viewId) {
+    LOGT("window declined, id:%u", id);
+    DropPendingWindow(id);
+    return;
+  }
+
+  static const int kWindowCreationTimeout = 5000;
+  PostTask(&EmbedLiteApp::PendingWindowTimeout, reinterpret_cast<void*>(uintptr_t(id)),
+           kWindowCreationTimeout);
+}
+
+EmbedLiteView*
+EmbedLiteApp::AdoptPendingWindow(EmbedLiteWindow* aWindow, uint32_t aParentId,
+                                 uintptr_t aParentBrowsingContext)
+{
+  for (auto it = mPendingWindows.begin(); it != mPendingWindows.end(); ++it) {
+    const PendingWindow& pending = it->second;
+    if (pending.mParentId != aParentId ||
+        pending.mParentBrowsingContext != aParentBrowsingContext) {
+      continue;
+    }
+
+    uint32_t id = it->first;
+    EmbedLiteViewParent* actor = pending.mActor;
+    mPendingWindows.erase(it);
+    if (actor->mWindowId != aWindow->GetUniqueID()) {
+      LOGE("View %u was created in window %u, not in %u", id, actor->mWindowId, aWindow->GetUniqueID());
+    }
+
+    LOGT("adopted view:%u", id);
+    EmbedLiteView* view = new EmbedLiteView(this, aWindow, actor, id);
+    view->mInitialized = actor->mInitialized;
+    mViews[id] = view;
+    return view;
+  }
+  return nullptr;
+}
+
+void
+EmbedLiteApp::DropPendingWindow(uint32_t aId)
+{
+  auto it = mPendingWindows.find(aId);
+  if (it == mPendingWindows.end()) {
+    return;
+  }
+
+  // Content sees the window being closed.
+  Unused << it->second.mActor->SendDestroy();
+  mPendingWindows.erase(it);
+}
+
+void
+EmbedLiteApp::PendingWindowTimeout(void* aId)
+{
+  EmbedLiteApp* app = EmbedLiteApp::GetInstance();
+  uint32_t id = uint32_t(reinterpret_cast<uintptr_t>(aId));
+  if (app->mPendingWindows.count(id)) {
+    LOGW("window %u was not adopted in time", id);
+    app->DropPendingWindow(id);
+  }
+}
+
 void
 EmbedLiteApp::ViewDestroyed(uint32_t id)
 {
   LOGT("id:%i", id);
+  if (mTabManager) {
+    mTabManager->ViewDestroyed(id);
+  }
+  // Content may also take a view down while it waits in its pool.
+  RemovePooledView(id);
+  bool pooled = mPooledViews->Destroyed(id);
   std::map<uint32_t, EmbedLiteView*>::iterator it = mViews.find(id);
   if (it != mViews.end()) {
     EmbedLiteView* view = it->second;
     mViews.erase(it);
     delete view;
   }
+  if (!pooled && GetNumberOfViews() == 0 && mListener) {
+    mListener->LastViewDestroyed();
+  }
   if (mViews.empty()) {
-    if (mListener) {
-      mListener->LastViewDestroyed();
-    }
     if (mState == DESTROYING) {
       mUILoop->PostTask(NewRunnableFunction("mozilla::embedlite::EmbedLiteApp::PreDestroy",
                                             &EmbedLiteApp::PreDestroy, this));
     }
   }
+  PriorityStateChanged();
+}
+
+void
+EmbedLiteApp::ViewCrashed(uint32_t id)
+{
+  // Windows of the process learn about it in the same go.
+  PostTask(&EmbedLiteApp::NotifyViewCrashed, reinterpret_cast<void*>(uintptr_t(id)));
+  PriorityStateChanged();
+}
+
+void
+EmbedLiteApp::PriorityStateChanged()
+{
+  if (mPriorityManager) {
+    mPriorityManager->ScheduleUpdate();
+  }
+}
+
+void
+EmbedLiteApp::NotifyViewCrashed(void* aId)
+{
+  EmbedLiteApp* app = EmbedLiteApp::GetInstance();
+  uint32_t id = uint32_t(reinterpret_cast<uintptr_t>(aId));
+  auto it = app->mViews.find(id);
+  if (it == app->mViews.end() || !it->second->IsCrashed()) {
+    return;
+  }
+
+  LOGW("content of view %u crashed", id);
+  EmbedLiteView* view = it->second;
+  if (app->mPooledViews->IsDestroying(id)) {
+    // Dropped from its pool, the Destroyed reply went down with content.
+    view->Destroy();
+    return;
+  }
+  if (app->RemovePooledView(id)) {
+    // Never handed out, a fresh one takes its place.
+    app->DestroyPooledView(view);
+    app->ScheduleViewPoolRefill();
+    return;
+  }
+  view->GetListener()->OnContentProcessCrashed();
 }
 
 void
 EmbedLiteApp::WindowDestroyed(uint32_t id)
 {
   LOGT("id:%i", id);
+  // Normally emptied by DestroyWindow, views left over go with the window.
+  DestroyViewPool(id);
+  if (mProcessManager) {
+    mProcessManager->WindowDestroyed(id);
+  }
   std::map<uint32_t, EmbedLiteWindow*>::iterator it = mWindows.find(id);
   if (it != mWindows.end()) {
     EmbedLiteWindow* win = it->second;
@@ -584,11 +1256,10 @@ void EmbedLiteApp::DestroyView(EmbedLiteView* aView)
 {
   LOGT();
   NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
-  for (auto elm : mViews) {
-    if (aView == elm.second) {
-      elm.second->Destroy();
-      return;
-    }
+  auto it = aView ? mViews.find(aView->GetUniqueID()) : mViews.end();
+  if (it != mViews.end() && it->second == aView) {
+    aView->Destroy();
+    return;
   }
   MOZ_ASSERT(false, "Invalid EmbedLiteView pointer!");
 }
@@ -597,18 +1268,18 @@ void EmbedLiteApp::DestroyWindow(EmbedLiteWindow* aWindow)
 {
   LOGT();
   NS_ASSERTION(mState == INITIALIZED, "Wrong timing");
-  for (auto elm : mWindows) {
-    if (aWindow == elm.second) {
-      elm.second->Destroy();
-      return;
-    }
+  auto it = aWindow ? mWindows.find(aWindow->GetUniqueID()) : mWindows.end();
+  if (it != mWindows.end() && it->second == aWindow) {
+    DestroyViewPool(it->first);
+    aWindow->Destroy();
+    return;
   }
   MOZ_ASSERT(false, "Invalid EmbedLiteWindow pointer!");
 }
 
 int EmbedLiteApp::GetNumberOfViews() const
 {
-    return mViews.size();
+    return mViews.size() - mPooledViews->Count();
 }
 
 int EmbedLiteApp::GetNumberOfWindows() const
@@ -650,6 +1321,7 @@ EmbedLiteApp::Initialized()
   }
 
   SetState(INITIALIZED);
+  PriorityStateChanged();
   if (mListener) {
     mListener->Initialized();
   }
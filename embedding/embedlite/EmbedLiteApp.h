@@ -7,9 +7,11 @@
 #define EMBED_LITE_APP_H
 
 #include "mozilla/RefPtr.h"
+#include <functional>
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <list>
 #include <map>
 
 class MessageLoop;
@@ -27,9 +29,12 @@ class EmbedLiteAppThreadParent;
 class EmbedLiteSubThread;
 class EmbedLiteSubProcess;
 class EmbedLiteAppProcessParent;
+class EmbedLiteContentProcessManager;
 class EmbedLiteView;
+class EmbedLiteViewParent;
 class EmbedLiteWindow;
 class PEmbedLiteAppParent;
+class PEmbedLiteWindowParent;
 class EmbedLiteSecurity;
 class EmbedLiteWindowListener;
 class EmbedLiteAppListener
@@ -49,7 +54,11 @@ public:
   virtual void Destroyed() {}
   // Messaging interface, allow to receive json messages from content child scripts
   virtual void OnObserve(const char* aMessage, const char16_t* aData) {}
-  // New Window request which is usually coming from WebPage new window request
+  // New Window request which is usually coming from WebPage new window request.
+  // Content has already built the view, it is adopted by calling
+  // EmbedLiteApp::CreateView with the same parentId and
+  // parentBrowsingContext, either here or within a few seconds afterwards.
+  // Returning 0 declines the window.
   virtual uint32_t CreateNewWindowRequested(const uint32_t &chromeFlags,
                                             EmbedLiteView *aParentView,
                                             const uintptr_t &parentBrowsingContext) { return 0; }
@@ -57,6 +66,120 @@ public:
   virtual void LastWindowDestroyed() {};
 };
 
+class EmbedLiteTabManager;
+class EmbedLitePooledViews;
+class EmbedLitePriorityManager;
+class EmbedLiteTaskQueue;
+
+// Typed preference value for EmbedLiteApp::SetPrefs and GetPrefs.
+struct EmbedLitePref
+{
+  enum Type {
+    PREF_BOOL,
+    PREF_INT,
+    PREF_STRING
+  };
+
+  EmbedLitePref(const std::string& aName, bool aValue)
+    : name(aName), type(PREF_BOOL), boolValue(aValue), intValue(0) {}
+  EmbedLitePref(const std::string& aName, int aValue)
+    : name(aName), type(PREF_INT), boolValue(false), intValue(aValue) {}
+  EmbedLitePref(const std::string& aName, const char* aValue)
+    : name(aName), type(PREF_STRING), boolValue(false), intValue(0), stringValue(aValue) {}
+  EmbedLitePref(const std::string& aName, const std::string& aValue)
+    : name(aName), type(PREF_STRING), boolValue(false), intValue(0), stringValue(aValue) {}
+
+  std::string name;
+  Type type;
+  bool boolValue;
+  int intValue;
+  std::string stringValue;
+};
+
+typedef std::function<void(const std::vector<EmbedLitePref>& prefs)> EmbedLitePrefsCallback;
+
+// How observer notifications reach EmbedLiteAppListener::OnObserve, see
+// EmbedLiteApp::SetObserverPolicy.
+enum class EmbedLiteObserverPolicy : uint32_t {
+  // Every notification right away, the default.
+  Immediate,
+  // Only the latest notification within the window.
+  Coalesce,
+  // All notifications within the window, sent together and delivered in order.
+  Batch,
+  // None, the notifications are counted and discarded in content.
+  Drop
+};
+
+struct EmbedLiteObserverStats
+{
+  // Messages sent to the UI side.
+  uint64_t sent;
+  // Notifications replaced by a later one or folded into a batch.
+  uint64_t merged;
+  // Dropped notifications.
+  uint64_t suppressed;
+};
+
+typedef std::function<void(const std::map<std::string, EmbedLiteObserverStats>& stats)> EmbedLiteObserverStatsCallback;
+
+// Task classes of EmbedLiteApp::ScheduleTask, most urgent first.
+enum class EmbedLiteTaskPriority : uint32_t {
+  Input,
+  Render,
+  Normal,
+  // Runs only while nothing more urgent is waiting, and only within idle
+  // periods once the embedder reports them, see EmbedLiteApp::IdlePeriod.
+  Idle,
+  Count
+};
+
+// 0 is never a valid task.
+typedef uint64_t EmbedLiteTaskId;
+
+struct EmbedLiteTaskStats
+{
+  // Tasks run, every run of a repeating task counts.
+  uint64_t run;
+  uint64_t cancelled;
+  // Scheduled and not run or cancelled yet.
+  uint32_t pending;
+  // Time from when a task was due until it started to run.
+  double meanLatencyMs;
+  double maxLatencyMs;
+};
+
+struct EmbedLiteIdleStats
+{
+  // Idle periods reported by the embedder.
+  uint64_t periods;
+  // Idle tasks run within them.
+  uint64_t run;
+  // Periods that ended with Idle tasks still due.
+  uint64_t deferred;
+  // Idle tasks that were still running at the deadline, and by how long
+  // in total.
+  uint64_t overran;
+  double overrunMs;
+  // The same for garbage and cycle collection in content. Periods missed
+  // arrived after their deadline and were left to Gecko's own scheduling.
+  uint64_t contentPeriods;
+  uint64_t contentMissed;
+  uint64_t contentOverran;
+  double contentOverrunMs;
+};
+
+// Content process of new windows with EMBED_PROCESS, see
+// EmbedLiteApp::SetContentProcessPolicy. Views always live in the process
+// of their window.
+enum class EmbedLiteProcessPolicy : uint32_t {
+  // All windows in one process, the default.
+  Shared,
+  // Every window in a process of its own, a window per tab gives a
+  // process per tab.
+  PerWindow
+};
+
 class EmbedLiteApp
 {
 public:
@@ -83,11 +206,30 @@ public:
     return mEmbedType;
   }
 
-  // Delayed post task helper for delayed functions call in main thread
+  // Delayed post task helper for delayed functions call in main thread,
+  // a Normal task of ScheduleTask
   virtual void* PostTask(EMBEDTaskCallback callback, void* userData, int timeout = 0);
   virtual void* PostCompositorTask(EMBEDTaskCallback callback, void* userData, int timeout = 0);
+  // Safe to call with tasks that already ran
   virtual void CancelTask(void* aTask);
 
+  // Runs aTask on the UI thread after aDelayMs, then every aIntervalMs if
+  // that is not 0. Due tasks of a more urgent priority run first. Can be
+  // called from any thread once the UI loop is running, 0 otherwise.
+  virtual EmbedLiteTaskId ScheduleTask(EmbedLiteTaskPriority aPriority, const std::function<void()>& aTask,
+                                       uint32_t aDelayMs = 0, uint32_t aIntervalMs = 0);
+  // False if aId already ran or was cancelled. Also takes the handles of
+  // PostTask and PostCompositorTask.
+  virtual bool CancelScheduledTask(EmbedLiteTaskId aId);
+  virtual EmbedLiteTaskStats GetTaskStats(EmbedLiteTaskPriority aPriority);
+  // The UI loop is idle for aBudgetMs, typically until the next frame is
+  // due. Runs due Idle tasks until then and lets content collect garbage
+  // within the same deadline. Once called, Idle tasks wait for idle periods.
+  // Meant for between frames or when the loop is about to block, true if
+  // Idle tasks are left for the next period. UI thread only.
+  virtual bool IdlePeriod(uint32_t aBudgetMs);
+  virtual EmbedLiteIdleStats GetIdleStats() { return mIdleStats; }
+
   // Setup profile path for embedding, or null if embedding supposed to be profile-less
   virtual void SetProfilePath(const char* aPath);
   // Start UI embedding loop merged with Gecko GFX, blocking call until Stop() called
@@ -123,6 +265,15 @@ public:
   virtual void DestroyWindow(EmbedLiteWindow* aWindow);
   virtual void DestroySecurity(EmbedLiteSecurity* aSecurity) const;
 
+  // Keeps aSize blank views (and aPrivateSize private ones) initialized in
+  // aWindow, CreateView calls without a parent browsing context then claim
+  // one of them instead of building a new view. The pool is refilled
+  // shortly after a claim and trimmed under memory pressure, see
+  // EmbedLiteTabManager::MemoryPressure. Sizes of 0 empty the pool, which
+  // happens implicitly when the window is destroyed.
+  virtual void SetViewPoolSize(EmbedLiteWindow* aWindow, uint32_t aSize, uint32_t aPrivateSize = 0);
+
+  // Pooled views are not counted.
   virtual int GetNumberOfViews() const;
   virtual int GetNumberOfWindows() const;
   virtual void SetIsAccelerated(bool aIsAccelerated);
@@ -137,6 +288,13 @@ public:
   virtual void SetBoolPref(const char* aName, bool aValue);
   virtual void SetCharPref(const char* aName, const char* aValue);
   virtual void SetIntPref(const char* aName, int aValue);
+  // Applies all prefs with one message. Content sees them change at once
+  // and gets a single embedlite-prefs-changed notification. If any value
+  // does not match the type of an existing pref nothing is applied.
+  virtual void SetPrefs(const std::vector<EmbedLitePref>& aPrefs);
+  // Current values of all prefs whose name starts with aBranch, "" for
+  // all of them. aCallback is called on the UI thread.
+  virtual void GetPrefs(const char* aBranch, const EmbedLitePrefsCallback& aCallback);
 
   virtual void LoadGlobalStyleSheet(const char* aUri, bool aEnable);
 
@@ -146,6 +304,37 @@ public:
   virtual void RemoveObserver(const char* aMessageName);
   virtual void AddObservers(const std::vector<std::string> &observersList);
   virtual void RemoveObservers(const std::vector<std::string> &observersList);
+  // Applied in content before notifications of aTopic cross over. aWindowMs
+  // is the coalescing or batching window, 0 delivers immediately.
+  virtual void SetObserverPolicy(const char* aTopic, EmbedLiteObserverPolicy aPolicy, uint32_t aWindowMs = 0);
+  // Per topic counters of everything observed so far.
+  virtual void GetObserverStats(const EmbedLiteObserverStatsCallback& aCallback);
+
+  // Records counts, sizes, queueing and handler times of the messages of
+  // all EmbedLite actors, in content as well. Same as setting the
+  // embedlite.ipc.trace.enabled pref.
+  virtual void SetIPCTraceEnabled(bool aEnabled);
+  // Writes what was recorded so far to aPath as a Trace Event Format file
+  // for chrome://tracing or Perfetto. With EMBED_PROCESS content writes its
+  // side to aPath.content asynchronously.
+  virtual bool DumpIPCTrace(const char* aPath);
+
+  // EMBED_PROCESS only. Assigns new windows to content processes by
+  // aPolicy and keeps aSpareProcesses processes launched ahead of time,
+  // so that a new process or the replacement of a crashed one is ready
+  // at once.
+  virtual void SetContentProcessPolicy(EmbedLiteProcessPolicy aPolicy, uint32_t aSpareProcesses = 1);
+  // Builds a view reported by EmbedLiteViewListener::OnContentProcessCrashed
+  // again in a working process and loads the location it was showing. Its
+  // window moves along, the other crashed views of the window need their
+  // own call. ViewInitialized is delivered again. False if the view has
+  // not crashed.
+  virtual bool ReloadCrashedView(EmbedLiteView* aView);
+
+  // Lifecycle management of background views, created on first use
+  virtual EmbedLiteTabManager* GetTabManager();
+  // Process and thread priorities, created on first use
+  virtual EmbedLitePriorityManager* GetPriorityManager();
 
   // Only one EmbedHelper object allowed
   static EmbedLiteApp* GetInstance();
@@ -183,35 +372,105 @@ private:
   static void StartChild(EmbedLiteApp* aApp);
   void Initialized();
 
+  friend class EmbedLiteAppParent;
   friend class EmbedLiteAppProcessParent;
   friend class EmbedLiteAppThreadParent;
   friend class EmbedLiteCompositorBridgeParent;
+  friend class EmbedLiteCompositorProcessParent;
+  friend class EmbedLiteContentProcessManager;
   friend class EmbedLitePuppetWidget;
   friend class nsWindow;
   friend class EmbedLiteView;
   friend class EmbedLiteWindow;
 
+  friend class EmbedLiteTabManager;
+  friend class EmbedLitePriorityManager;
+  friend class EmbedLiteViewParent;
+
+  void PrefsReceived(uint32_t aRequestId, const std::vector<EmbedLitePref>& aPrefs);
+  void ObserverStatsReceived(uint32_t aRequestId, const std::map<std::string, EmbedLiteObserverStats>& aStats);
+  void ContentIdlePeriodDone(bool aMissed, double aOverrunMs);
   void ViewDestroyed(uint32_t id);
+  void ViewCrashed(uint32_t id);
+  static void NotifyViewCrashed(void* aId);
   void WindowDestroyed(uint32_t id);
+  // Activity, media playback or processes changed.
+  void PriorityStateChanged();
   void ChildReadyToDestroy();
   uint32_t CreateWindowRequested(const uint32_t &chromeFlags,
                                  const uint32_t &parentId,
                                  const uintptr_t &parentBrowsingContext);
+  void WindowCreated(EmbedLiteViewParent* aActor, uint32_t aParentId,
+                     uintptr_t aParentBrowsingContext, uint32_t aChromeFlags);
+  EmbedLiteView* AdoptPendingWindow(EmbedLiteWindow* aWindow, uint32_t aParentId,
+                                    uintptr_t aParentBrowsingContext);
+  void DropPendingWindow(uint32_t aId);
+  static void PendingWindowTimeout(void* aId);
   EmbedLiteAppListener* GetListener();
   MessageLoop* GetUILoop();
+  // Actor of the content process aWindowId lives in.
+  PEmbedLiteAppParent* GetAppParent(uint32_t aWindowId);
+  PEmbedLiteWindowParent* ConstructWindow(uint32_t aId, int aWidth, int aHeight,
+                                          EmbedLiteWindowListener* aListener);
+  // Content wide state and notifications go to every content process.
+  void ForEachAppParent(const std::function<void(PEmbedLiteAppParent*)>& aCallback);
+  void RecoverWindow(EmbedLiteWindow* aWindow);
   static void PreDestroy(EmbedLiteApp*);
+  static void RunTasks(EmbedLiteApp*);
+
+  // View built by content for window.open, waiting for CreateView.
+  struct PendingWindow {
+    EmbedLiteViewParent* mActor;
+    uint32_t mParentId;
+    uintptr_t mParentBrowsingContext;
+  };
+
+  struct ViewPool {
+    EmbedLiteWindow* mWindow;
+    // Indexed by private mode.
+    uint32_t mSize[2];
+    std::list<EmbedLiteView*> mViews[2];
+  };
+
+  EmbedLiteView* DoCreateView(EmbedLiteWindow* aWindow, uint32_t aParent,
+                              uintptr_t aParentBrowsingContext, bool aIsPrivateWindow,
+                              bool isDesktopMode);
+  EmbedLiteView* ClaimPooledView(EmbedLiteWindow* aWindow, bool aIsPrivateWindow);
+  // Takes aId out of its pool's list, false if it is in none.
+  bool RemovePooledView(uint32_t aId);
+  // aView must have been taken out of its pool's list already.
+  void DestroyPooledView(EmbedLiteView* aView);
+  void ScheduleViewPoolRefill();
+  static void RefillViewPools(void* aApp);
+  void TrimViewPools(bool aCritical);
+  void DestroyViewPool(uint32_t aWindowId);
 
   static EmbedLiteApp* sSingleton;
   EmbedLiteAppListener* mListener;
   EmbedLiteUILoop* mUILoop;
 
   RefPtr<EmbedLiteSubThread> mSubThread;
+  // With EMBED_PROCESS the primary content process, owned by mProcessManager.
   PEmbedLiteAppParent* mAppParent;
   RefPtr<EmbedLiteAppThreadChild> mAppChild;
+  EmbedLiteContentProcessManager* mProcessManager;
 
   EmbedType mEmbedType;
   std::map<uint32_t, EmbedLiteView*> mViews;
   std::map<uint32_t, EmbedLiteWindow*> mWindows;
+  EmbedLiteTabManager* mTabManager;
+  EmbedLitePriorityManager* mPriorityManager;
+  EmbedLiteTaskQueue* mTaskQueue;
+  EmbedLiteIdleStats mIdleStats;
+  // By view id.
+  std::map<uint32_t, PendingWindow> mPendingWindows;
+  std::map<uint32_t, EmbedLitePrefsCallback> mPrefsRequests;
+  std::map<uint32_t, EmbedLiteObserverStatsCallback> mObserverStatsRequests;
+  uint32_t mLastRequestId;
+  // Prewarmed views by window id.
+  std::map<uint32_t, ViewPool> mViewPools;
+  EmbedLitePooledViews* mPooledViews;
+  bool mViewPoolRefillPending;
   State mState;
   RenderType mRenderType;
   char* mProfilePath;
@@ -15,6 +15,8 @@
 #include "base/time.h"
 #include "EmbedLiteUILoop.h"
 
+#include <algorithm>
+
 using namespace base;
 
 namespace mozilla {
@@ -134,6 +136,11 @@ bool EmbedLiteMessagePump::DoIdleWork(void* aDelegate)
   return static_cast<base::MessagePump::Delegate*>(aDelegate)->DoIdleWork();
 }
 
+bool EmbedLiteMessagePump::DoIdlePeriod(int aBudgetMs)
+{
+  return EmbedLiteApp::GetInstance()->IdlePeriod(std::max(aBudgetMs, 0));
+}
+
 void*
 EmbedLiteMessagePump::PostTask(EMBEDTaskCallback callback,
                                void* userData,
@@ -38,6 +38,9 @@ public:
   virtual bool DoWork(void* aDelegate);
   virtual bool DoDelayedWork(void* aDelegate);
   virtual bool DoIdleWork(void* aDelegate);
+  // The embedder loop is idle for aBudgetMs, see EmbedLiteApp::IdlePeriod.
+  // True if idle work is left for the next period.
+  virtual bool DoIdlePeriod(int aBudgetMs);
   // Delayed post task helper for delayed functions call in main thread
   virtual void* PostTask(EMBEDTaskCallback callback, void* userData, int timeout = 0);
   virtual void CancelTask(void* aTask);
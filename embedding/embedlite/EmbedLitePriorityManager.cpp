@@ -0,0 +1,412 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLitePriorityManager.h"
+#include "EmbedLiteApp.h"
+#include "EmbedLiteView.h"
+#include "EmbedLiteAppProcessParent.h"
+#include "EmbedLiteContentProcessManager.h"
+
+#include "base/message_loop.h"
+#include "mozilla/layers/CompositorThread.h"
+#include "nsThreadUtils.h"
+#include "nsXULAppAPI.h"
+
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <linux/capability.h>
+#include <map>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mozilla {
+namespace embedlite {
+
+EmbedLitePriorityManager::EmbedLitePriorityManager(EmbedLiteApp* aApp)
+  : mApp(aApp)
+  , mListener(nullptr)
+  , mForeground(true)
+  , mUpdatePending(false)
+  , mMinNice(19)
+  , mContentThreadRequested(false)
+  , mCompositorThreadRequested(false)
+  , mIPCThreadRequested(false)
+{
+  // Lowering the nice value again needs CAP_SYS_NICE or a RLIMIT_NICE
+  // allowing it, raising it and switching between SCHED_OTHER and
+  // SCHED_BATCH is always possible.
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NICE, &limit) == 0) {
+    if (limit.rlim_cur == RLIM_INFINITY) {
+      mMinNice = -20;
+    } else {
+      mMinNice = 20 - int32_t(std::min<rlim_t>(limit.rlim_cur, 40));
+    }
+  }
+
+  FILE* status = fopen("/proc/self/status", "r");
+  if (status) {
+    char line[128];
+    unsigned long long capabilities;
+    while (fgets(line, sizeof(line), status)) {
+      if (sscanf(line, "CapEff: %llx", &capabilities) == 1) {
+        if (capabilities & (1ULL << CAP_SYS_NICE)) {
+          mMinNice = -20;
+        }
+        break;
+      }
+    }
+    fclose(status);
+  }
+
+  LOGT("min nice:%d", mMinNice);
+  ScheduleUpdate();
+}
+
+EmbedLitePriorityManager::~EmbedLitePriorityManager()
+{
+  LOGT();
+}
+
+void
+EmbedLitePriorityManager::SetPolicy(const EmbedLitePriorityPolicy& aPolicy)
+{
+  mPolicy = aPolicy;
+  // Reapply everything with the new values.
+  for (Target& target : mTargets) {
+    target.mApplied = false;
+    target.mRefused = false;
+  }
+  Update();
+}
+
+void
+EmbedLitePriorityManager::SetForeground(bool aForeground)
+{
+  LOGT("foreground:%d", aForeground);
+  if (mForeground != aForeground) {
+    mForeground = aForeground;
+    Update();
+  }
+}
+
+void
+EmbedLitePriorityManager::ScheduleUpdate()
+{
+  if (mUpdatePending) {
+    return;
+  }
+
+  mUpdatePending = true;
+  mApp->PostTask(&EmbedLitePriorityManager::UpdateTask, nullptr);
+}
+
+void
+EmbedLitePriorityManager::UpdateTask(void*)
+{
+  // The manager may be gone by now.
+  EmbedLitePriorityManager* manager = EmbedLiteApp::GetInstance()->mPriorityManager;
+  if (manager) {
+    manager->mUpdatePending = false;
+    manager->Update();
+  }
+}
+
+void
+EmbedLitePriorityManager::Update()
+{
+  if (mApp->mState != EmbedLiteApp::INITIALIZED) {
+    return;
+  }
+
+  RegisterThreads();
+
+  // Content of the views by process, EMBED_THREAD has a single one.
+  EmbedLiteContentProcessManager* processManager = mApp->mProcessManager;
+  std::map<int32_t, EmbedLitePriority> processes;
+  if (processManager) {
+    processManager->ForEachProcess([&processes](EmbedLiteAppProcessParent* aProcess) {
+      processes[aProcess->OtherPid()] = EmbedLitePriority::Background;
+    });
+  }
+
+  EmbedLitePriority content = EmbedLitePriority::Background;
+  bool mediaPlaying = false;
+  for (const auto& pair : mApp->mViews) {
+    EmbedLiteView* view = pair.second;
+    if (view->IsCrashed()) {
+      continue;
+    }
+
+    EmbedLitePriority priority = EmbedLitePriority::Background;
+    if (mForeground && view->mIsActive) {
+      priority = EmbedLitePriority::Foreground;
+    } else if (view->mMediaPlaying) {
+      priority = EmbedLitePriority::BackgroundPerceivable;
+    }
+    mediaPlaying |= view->mMediaPlaying;
+
+    if (processManager) {
+      EmbedLiteAppProcessParent* process = processManager->GetWindowProcess(view->mWindow->GetUniqueID());
+      if (process) {
+        EmbedLitePriority& processPriority = processes[process->OtherPid()];
+        processPriority = std::max(processPriority, priority);
+      }
+    } else {
+      content = std::max(content, priority);
+    }
+  }
+
+  // Forget processes that are gone.
+  mTargets.erase(std::remove_if(mTargets.begin(), mTargets.end(), [&processes](const Target& aTarget) {
+    return aTarget.mType == EmbedLitePriorityTarget::ContentProcess && !processes.count(aTarget.mId);
+  }), mTargets.end());
+
+  for (const auto& pair : processes) {
+    SetPriority(EmbedLitePriorityTarget::ContentProcess, pair.first, pair.second);
+  }
+
+  EmbedLitePriority application = mForeground ? EmbedLitePriority::Foreground
+                                              : EmbedLitePriority::Background;
+  EmbedLitePriority ipc = application;
+  if (!mForeground && mediaPlaying) {
+    // Media of content processes streams through it.
+    ipc = EmbedLitePriority::BackgroundPerceivable;
+  }
+
+  for (const Target& target : mTargets) {
+    switch (target.mType) {
+      case EmbedLitePriorityTarget::ContentThread:
+        SetPriority(target.mType, target.mId, content);
+        break;
+      case EmbedLitePriorityTarget::CompositorThread:
+        SetPriority(target.mType, target.mId, application);
+        break;
+      case EmbedLitePriorityTarget::IPCThread:
+        SetPriority(target.mType, target.mId, ipc);
+        break;
+      case EmbedLitePriorityTarget::ContentProcess:
+        break;
+    }
+  }
+}
+
+void
+EmbedLitePriorityManager::RegisterThreads()
+{
+  if (!mContentThreadRequested && mApp->mEmbedType == EmbedLiteApp::EMBED_THREAD) {
+    // Gecko runs on the content thread with EMBED_THREAD.
+    mContentThreadRequested = true;
+    NS_DispatchToMainThread(NewRunnableFunction("mozilla::embedlite::EmbedLitePriorityManager::RegisterCurrentThread",
+                                                &EmbedLitePriorityManager::RegisterCurrentThread,
+                                                EmbedLitePriorityTarget::ContentThread));
+  }
+
+  if (!mCompositorThreadRequested && layers::CompositorThreadHolder::IsActive()) {
+    mCompositorThreadRequested = true;
+    layers::CompositorThread()->Dispatch(NewRunnableFunction("mozilla::embedlite::EmbedLitePriorityManager::RegisterCurrentThread",
+                                                             &EmbedLitePriorityManager::RegisterCurrentThread,
+                                                             EmbedLitePriorityTarget::CompositorThread));
+  }
+
+  MessageLoop* ioLoop = XRE_GetIOMessageLoop();
+  if (!mIPCThreadRequested && ioLoop) {
+    mIPCThreadRequested = true;
+    ioLoop->PostTask(NewRunnableFunction("mozilla::embedlite::EmbedLitePriorityManager::RegisterCurrentThread",
+                                         &EmbedLitePriorityManager::RegisterCurrentThread,
+                                         EmbedLitePriorityTarget::IPCThread));
+  }
+}
+
+void
+EmbedLitePriorityManager::RegisterCurrentThread(EmbedLitePriorityTarget aType)
+{
+  int32_t tid = int32_t(syscall(SYS_gettid));
+  EmbedLiteApp::GetInstance()->GetUILoop()->PostTask(
+      NewRunnableFunction("mozilla::embedlite::EmbedLitePriorityManager::ThreadRegistered",
+                          &EmbedLitePriorityManager::ThreadRegistered, aType, tid));
+}
+
+void
+EmbedLitePriorityManager::ThreadRegistered(EmbedLitePriorityTarget aType, int32_t aTid)
+{
+  EmbedLitePriorityManager* manager = EmbedLiteApp::GetInstance()->mPriorityManager;
+  if (!manager) {
+    return;
+  }
+
+  LOGT("type:%d tid:%d", int(aType), aTid);
+  if (manager->AddTarget(aType, aTid)) {
+    manager->Update();
+  }
+}
+
+EmbedLitePriorityManager::Target*
+EmbedLitePriorityManager::GetTarget(EmbedLitePriorityTarget aType, int32_t aId)
+{
+  for (Target& target : mTargets) {
+    if (target.mType == aType && target.mId == aId) {
+      return &target;
+    }
+  }
+  return nullptr;
+}
+
+EmbedLitePriorityManager::Target*
+EmbedLitePriorityManager::AddTarget(EmbedLitePriorityTarget aType, int32_t aId)
+{
+  errno = 0;
+  int nice = getpriority(PRIO_PROCESS, aId);
+  if (nice == -1 && errno) {
+    LOGW("Cannot read priority of %d, errno:%d", aId, errno);
+    return nullptr;
+  }
+
+  // Everything starts out like the foreground.
+  mTargets.push_back({ aType, aId, nice, EmbedLitePriority::Foreground, false, false });
+  return &mTargets.back();
+}
+
+void
+EmbedLitePriorityManager::SetPriority(EmbedLitePriorityTarget aType, int32_t aId, EmbedLitePriority aPriority)
+{
+  Target* target = GetTarget(aType, aId);
+  if (!target) {
+    target = AddTarget(aType, aId);
+  }
+  if (!target || (target->mApplied && target->mPriority == aPriority)) {
+    return;
+  }
+
+  EmbedLitePriorityTransition transition;
+  transition.target = aType;
+  transition.id = aId;
+  transition.from = target->mPriority;
+  transition.to = aPriority;
+
+  switch (aPriority) {
+    case EmbedLitePriority::Foreground:
+      transition.nice = target->mBaseNice + mPolicy.foregroundNice;
+      break;
+    case EmbedLitePriority::BackgroundPerceivable:
+      transition.nice = target->mBaseNice + mPolicy.perceivableNice;
+      break;
+    case EmbedLitePriority::Background:
+      transition.nice = target->mBaseNice + mPolicy.backgroundNice;
+      break;
+  }
+  transition.nice = std::min(std::max(transition.nice, -20), 19);
+
+  if (!CanRenice(*target)) {
+    // Could not be undone, the nice value stays where it was.
+    transition.nice = target->mBaseNice;
+  }
+
+  // Refused changes are tried again with the next update, but only
+  // reported the first time.
+  bool retry = target->mRefused && target->mPriority == aPriority;
+  target->mPriority = aPriority;
+  transition.applied = Apply(*target, transition.nice);
+  target->mApplied = transition.applied;
+  target->mRefused = !transition.applied;
+  LOGT("type:%d id:%d priority:%d->%d nice:%d applied:%d", int(aType), aId,
+       int(transition.from), int(transition.to), transition.nice, transition.applied);
+  if (mListener && !(retry && !transition.applied)) {
+    mListener->PriorityChanged(transition);
+  }
+}
+
+bool
+EmbedLitePriorityManager::CanRenice(const Target& aTarget) const
+{
+  // Every nice value of the policy must be reachable from every other one.
+  int32_t nice = aTarget.mBaseNice + std::min({ mPolicy.foregroundNice,
+                                                mPolicy.perceivableNice,
+                                                mPolicy.backgroundNice });
+  return std::max(nice, -20) >= mMinNice;
+}
+
+bool
+EmbedLitePriorityManager::ApplyToThread(int32_t aTid, int aPolicy, int32_t aNice, bool aRenice)
+{
+  bool applied = true;
+
+  // Scheduling policy first, switching it keeps the nice value.
+  struct sched_param param = { 0 };
+  if (sched_setscheduler(aTid, aPolicy, &param) != 0 && errno != ESRCH) {
+    LOGW("Cannot set scheduling policy of %d, errno:%d", aTid, errno);
+    applied = false;
+  }
+
+  // A thread that exited in the meantime needs nothing.
+  if (aRenice && setpriority(PRIO_PROCESS, aTid, aNice) != 0 && errno != ESRCH) {
+    LOGW("Cannot set nice %d of %d, errno:%d", aNice, aTid, errno);
+    applied = false;
+  }
+
+  return applied;
+}
+
+bool
+EmbedLitePriorityManager::Apply(const Target& aTarget, int32_t aNice)
+{
+  int policy = aTarget.mPriority == EmbedLitePriority::Background && mPolicy.batchBackground
+             ? SCHED_BATCH : SCHED_OTHER;
+
+  bool renice = CanRenice(aTarget);
+  bool applied = true;
+  if (aTarget.mType == EmbedLitePriorityTarget::ContentProcess) {
+    // Both only affect a single thread on Linux, threads started later
+    // inherit the values of the thread starting them.
+    std::string path = "/proc/" + std::to_string(aTarget.mId) + "/task";
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+      LOGW("Cannot list threads of %d, errno:%d", aTarget.mId, errno);
+      applied = ApplyToThread(aTarget.mId, policy, aNice, renice);
+    } else {
+      while (struct dirent* entry = readdir(dir)) {
+        int32_t tid = atoi(entry->d_name);
+        if (tid > 0) {
+          applied &= ApplyToThread(tid, policy, aNice, renice);
+        }
+      }
+      closedir(dir);
+    }
+  } else {
+    applied = ApplyToThread(aTarget.mId, policy, aNice, renice);
+  }
+
+  const std::string* cgroup = &mPolicy.foregroundCgroup;
+  if (aTarget.mPriority == EmbedLitePriority::BackgroundPerceivable) {
+    cgroup = &mPolicy.perceivableCgroup;
+  } else if (aTarget.mPriority == EmbedLitePriority::Background) {
+    cgroup = &mPolicy.backgroundCgroup;
+  }
+  if (!cgroup->empty()) {
+    bool process = aTarget.mType == EmbedLitePriorityTarget::ContentProcess;
+    std::string path = *cgroup + (process ? "/cgroup.procs" : "/tasks");
+    FILE* file = fopen(path.c_str(), "w");
+    bool moved = file && fprintf(file, "%d\n", aTarget.mId) >= 0;
+    if (file && fclose(file) != 0) {
+      moved = false;
+    }
+    if (!moved) {
+      applied = false;
+      LOGW("Cannot move %d to %s", aTarget.mId, path.c_str());
+    }
+  }
+
+  return applied;
+}
+
+} // namespace embedlite
+} // namespace mozilla
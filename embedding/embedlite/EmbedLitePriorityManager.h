@@ -0,0 +1,147 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef EMBED_LITE_PRIORITY_MANAGER_H
+#define EMBED_LITE_PRIORITY_MANAGER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace mozilla {
+namespace embedlite {
+
+class EmbedLiteApp;
+
+enum class EmbedLitePriority {
+  // Nothing the user is waiting for.
+  Background,
+  // In the background, but playing media.
+  BackgroundPerceivable,
+  // Showing the active view of the foreground application.
+  Foreground
+};
+
+enum class EmbedLitePriorityTarget {
+  // EMBED_PROCESS content process, all of its threads.
+  ContentProcess,
+  // EMBED_THREAD gecko thread.
+  ContentThread,
+  CompositorThread,
+  // IPC I/O thread of this process.
+  IPCThread
+};
+
+struct EmbedLitePriorityTransition
+{
+  EmbedLitePriorityTarget target;
+  // Process id or thread id.
+  int32_t id;
+  EmbedLitePriority from;
+  EmbedLitePriority to;
+  // Nice value requested for the target.
+  int32_t nice;
+  // False if the kernel refused part of it. Reported once, the change is
+  // retried silently with later updates.
+  bool applied;
+};
+
+class EmbedLitePriorityManagerListener
+{
+public:
+  virtual void PriorityChanged(const EmbedLitePriorityTransition& aTransition) {}
+};
+
+struct EmbedLitePriorityPolicy
+{
+  // Added to the nice value a target had when it was first seen. Only used
+  // when the nice value can be lowered again afterwards, which needs
+  // RLIMIT_NICE or CAP_SYS_NICE, otherwise only the scheduling policy and
+  // cgroup are changed.
+  int32_t foregroundNice = 0;
+  int32_t perceivableNice = 5;
+  int32_t backgroundNice = 10;
+  // Run Background targets with SCHED_BATCH.
+  bool batchBackground = true;
+  // cgroup directories targets are moved into, empty leaves the cgroup
+  // alone. Processes are written to cgroup.procs, threads to tasks.
+  std::string foregroundCgroup;
+  std::string perceivableCgroup;
+  std::string backgroundCgroup;
+};
+
+/**
+ * Adjusts nice values, scheduling policy and cgroups of the content
+ * processes or thread, the compositor thread and the IPC thread. Content
+ * is Foreground while one of its views is active (EmbedLiteView::SetIsActive)
+ * and the application is in the foreground, BackgroundPerceivable while one
+ * of its views plays media, Background otherwise. The compositor and IPC
+ * threads follow the application, the IPC thread stays perceivable for
+ * media playing in the background.
+ *
+ * Obtained with EmbedLiteApp::GetPriorityManager, priorities are managed
+ * from then on. UI thread only, Linux only.
+ */
+class EmbedLitePriorityManager
+{
+public:
+  void SetListener(EmbedLitePriorityManagerListener* aListener) { mListener = aListener; }
+  void SetPolicy(const EmbedLitePriorityPolicy& aPolicy);
+  const EmbedLitePriorityPolicy& GetPolicy() const { return mPolicy; }
+
+  // The application window went to the fore- or background.
+  void SetForeground(bool aForeground);
+  bool IsForeground() const { return mForeground; }
+
+private:
+  friend class EmbedLiteApp;
+
+  struct Target {
+    EmbedLitePriorityTarget mType;
+    int32_t mId;
+    int32_t mBaseNice;
+    EmbedLitePriority mPriority;
+    bool mApplied;
+    // The last change was refused and reported as such.
+    bool mRefused;
+  };
+
+  explicit EmbedLitePriorityManager(EmbedLiteApp* aApp);
+  ~EmbedLitePriorityManager();
+
+  // Views, windows or processes changed, priorities are updated once the
+  // UI loop gets to it.
+  void ScheduleUpdate();
+  static void UpdateTask(void* aData);
+  void Update();
+  void RegisterThreads();
+  static void RegisterCurrentThread(EmbedLitePriorityTarget aType);
+  static void ThreadRegistered(EmbedLitePriorityTarget aType, int32_t aTid);
+
+  Target* GetTarget(EmbedLitePriorityTarget aType, int32_t aId);
+  Target* AddTarget(EmbedLitePriorityTarget aType, int32_t aId);
+  void SetPriority(EmbedLitePriorityTarget aType, int32_t aId, EmbedLitePriority aPriority);
+  bool CanRenice(const Target& aTarget) const;
+  bool Apply(const Target& aTarget, int32_t aNice);
+  static bool ApplyToThread(int32_t aTid, int aPolicy, int32_t aNice, bool aRenice);
+
+  EmbedLiteApp* mApp;
+  EmbedLitePriorityManagerListener* mListener;
+  EmbedLitePriorityPolicy mPolicy;
+  bool mForeground;
+  bool mUpdatePending;
+  // Lowest nice value this process may set, checked once.
+  int32_t mMinNice;
+  // Thread ids are collected once on the threads themselves.
+  bool mContentThreadRequested;
+  bool mCompositorThreadRequested;
+  bool mIPCThreadRequested;
+  std::vector<Target> mTargets;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // EMBED_LITE_PRIORITY_MANAGER_H
@@ -0,0 +1,404 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLiteStructuredClone.h"
+
+#include "mozilla/Assertions.h"
+#include "mozilla/EndianUtils.h"
+
+#include <string.h>
+
+namespace mozilla {
+namespace embedlite {
+
+// Subset of the SpiderMonkey structured clone wire format,
+// see js/src/vm/StructuredClone.cpp. Every entry is a little endian
+// 64 bit word holding a (tag, data) pair, or a raw double when the tag
+// is not above SCTAG_FLOAT_MAX.
+static const uint32_t SCTAG_FLOAT_MAX = 0xFFF00000;
+static const uint32_t SCTAG_HEADER = 0xFFF10000;
+static const uint32_t SCTAG_NULL = 0xFFFF0000;
+static const uint32_t SCTAG_UNDEFINED = 0xFFFF0001;
+static const uint32_t SCTAG_BOOLEAN = 0xFFFF0002;
+static const uint32_t SCTAG_INT32 = 0xFFFF0003;
+static const uint32_t SCTAG_STRING = 0xFFFF0004;
+static const uint32_t SCTAG_ARRAY_OBJECT = 0xFFFF0007;
+static const uint32_t SCTAG_OBJECT_OBJECT = 0xFFFF0008;
+static const uint32_t SCTAG_END_OF_KEYS = 0xFFFF0013;
+
+// JS::StructuredCloneScope::DifferentProcess, readable by every message
+// manager scope.
+static const uint32_t kCloneScopeDifferentProcess = 2;
+
+static const uint32_t kLatin1Flag = 0x80000000;
+static const uint64_t kCanonicalNaN = 0x7FF8000000000000ULL;
+
+static size_t
+PaddedLength(size_t aLength)
+{
+  return (aLength + 7) & ~size_t(7);
+}
+
+EmbedLiteStructuredCloneReader::EmbedLiteStructuredCloneReader(const uint8_t* aData, size_t aLength)
+  : mData(aData)
+  , mLength(aLength)
+  , mPosition(0)
+  , mError(!aData || aLength % sizeof(uint64_t))
+{
+  uint32_t tag, data;
+  if (!mError && PeekPair(&tag, &data) && tag == SCTAG_HEADER) {
+    mPosition += sizeof(uint64_t);
+  }
+}
+
+bool
+EmbedLiteStructuredCloneReader::Fail()
+{
+  if (!mError) {
+    LOGW("Malformed or unsupported structured clone data at offset:%zu", mPosition);
+  }
+  mError = true;
+  return false;
+}
+
+bool
+EmbedLiteStructuredCloneReader::PeekPair(uint32_t* aTag, uint32_t* aData)
+{
+  if (mError || mLength - mPosition < sizeof(uint64_t)) {
+    return Fail();
+  }
+  uint64_t pair = LittleEndian::readUint64(mData + mPosition);
+  *aTag = uint32_t(pair >> 32);
+  *aData = uint32_t(pair);
+  return true;
+}
+
+bool
+EmbedLiteStructuredCloneReader::ReadPair(uint32_t* aTag, uint32_t* aData)
+{
+  if (!PeekPair(aTag, aData)) {
+    return false;
+  }
+  mPosition += sizeof(uint64_t);
+  return true;
+}
+
+bool
+EmbedLiteStructuredCloneReader::ReadChars(uint32_t aLengthAndEncoding, std::u16string& aValue)
+{
+  bool latin1 = aLengthAndEncoding & kLatin1Flag;
+  size_t length = aLengthAndEncoding & ~kLatin1Flag;
+  size_t bytes = latin1 ? length : length * sizeof(char16_t);
+  if (PaddedLength(bytes) > mLength - mPosition) {
+    return Fail();
+  }
+
+  const uint8_t* chars = mData + mPosition;
+  aValue.resize(length);
+  for (size_t i = 0; i < length; ++i) {
+    aValue[i] = latin1 ? char16_t(chars[i]) : char16_t(LittleEndian::readUint16(chars + i * 2));
+  }
+  mPosition += PaddedLength(bytes);
+  return true;
+}
+
+EmbedLiteCloneType
+EmbedLiteStructuredCloneReader::Peek()
+{
+  uint32_t tag, data;
+  if (!PeekPair(&tag, &data)) {
+    return EmbedLiteCloneType::Invalid;
+  }
+  if (tag <= SCTAG_FLOAT_MAX) {
+    return EmbedLiteCloneType::Double;
+  }
+
+  switch (tag) {
+    case SCTAG_NULL:
+      return EmbedLiteCloneType::Null;
+    case SCTAG_UNDEFINED:
+      return EmbedLiteCloneType::Undefined;
+    case SCTAG_BOOLEAN:
+      return EmbedLiteCloneType::Boolean;
+    case SCTAG_INT32:
+      return EmbedLiteCloneType::Int32;
+    case SCTAG_STRING:
+      return EmbedLiteCloneType::String;
+    case SCTAG_ARRAY_OBJECT:
+      return EmbedLiteCloneType::Array;
+    case SCTAG_OBJECT_OBJECT:
+      return EmbedLiteCloneType::Object;
+    default:
+      return EmbedLiteCloneType::Unsupported;
+  }
+}
+
+bool
+EmbedLiteStructuredCloneReader::ReadNull()
+{
+  uint32_t tag, data;
+  return ReadPair(&tag, &data) && (tag == SCTAG_NULL || Fail());
+}
+
+bool
+EmbedLiteStructuredCloneReader::ReadUndefined()
+{
+  uint32_t tag, data;
+  return ReadPair(&tag, &data) && (tag == SCTAG_UNDEFINED || Fail());
+}
+
+bool
+EmbedLiteStructuredCloneReader::ReadBoolean(bool* aValue)
+{
+  uint32_t tag, data;
+  if (!ReadPair(&tag, &data) || tag != SCTAG_BOOLEAN) {
+    return Fail();
+  }
+  *aValue = !!data;
+  return true;
+}
+
+bool
+EmbedLiteStructuredCloneReader::ReadInt32(int32_t* aValue)
+{
+  uint32_t tag, data;
+  if (!ReadPair(&tag, &data) || tag != SCTAG_INT32) {
+    return Fail();
+  }
+  *aValue = int32_t(data);
+  return true;
+}
+
+bool
+EmbedLiteStructuredCloneReader::ReadDouble(double* aValue)
+{
+  uint32_t tag, data;
+  if (!PeekPair(&tag, &data)) {
+    return false;
+  }
+  if (tag == SCTAG_INT32) {
+    mPosition += sizeof(uint64_t);
+    *aValue = int32_t(data);
+    return true;
+  }
+  if (tag > SCTAG_FLOAT_MAX) {
+    return Fail();
+  }
+  uint64_t bits = LittleEndian::readUint64(mData + mPosition);
+  memcpy(aValue, &bits, sizeof(double));
+  mPosition += sizeof(uint64_t);
+  return true;
+}
+
+bool
+EmbedLiteStructuredCloneReader::ReadString(std::u16string& aValue)
+{
+  uint32_t tag, data;
+  if (!ReadPair(&tag, &data) || tag != SCTAG_STRING) {
+    return Fail();
+  }
+  return ReadChars(data, aValue);
+}
+
+bool
+EmbedLiteStructuredCloneReader::BeginArray(uint32_t* aLength)
+{
+  uint32_t tag, data;
+  if (!ReadPair(&tag, &data) || tag != SCTAG_ARRAY_OBJECT) {
+    return Fail();
+  }
+  *aLength = data;
+  return true;
+}
+
+bool
+EmbedLiteStructuredCloneReader::NextIndex(uint32_t* aIndex)
+{
+  uint32_t tag, data;
+  if (!ReadPair(&tag, &data) || tag == SCTAG_END_OF_KEYS) {
+    return false;
+  }
+  if (tag != SCTAG_INT32) {
+    return Fail();
+  }
+  *aIndex = data;
+  return true;
+}
+
+bool
+EmbedLiteStructuredCloneReader::BeginObject()
+{
+  uint32_t tag, data;
+  if (!ReadPair(&tag, &data) || tag != SCTAG_OBJECT_OBJECT) {
+    return Fail();
+  }
+  return true;
+}
+
+bool
+EmbedLiteStructuredCloneReader::NextKey(std::u16string& aKey)
+{
+  uint32_t tag, data;
+  if (!ReadPair(&tag, &data) || tag == SCTAG_END_OF_KEYS) {
+    return false;
+  }
+  if (tag == SCTAG_INT32) {
+    // Integer keys are written as jsid ints.
+    std::string index = std::to_string(int32_t(data));
+    aKey.assign(index.begin(), index.end());
+    return true;
+  }
+  if (tag != SCTAG_STRING) {
+    return Fail();
+  }
+  return ReadChars(data, aKey);
+}
+
+bool
+EmbedLiteStructuredCloneReader::Skip()
+{
+  uint32_t tag, data;
+  std::u16string ignored;
+  switch (Peek()) {
+    case EmbedLiteCloneType::Null:
+    case EmbedLiteCloneType::Undefined:
+    case EmbedLiteCloneType::Boolean:
+    case EmbedLiteCloneType::Int32:
+    case EmbedLiteCloneType::Double:
+      return ReadPair(&tag, &data);
+    case EmbedLiteCloneType::String:
+      return ReadString(ignored);
+    case EmbedLiteCloneType::Array:
+    case EmbedLiteCloneType::Object:
+      ReadPair(&tag, &data);
+      while (NextKey(ignored)) {
+        if (!Skip()) {
+          return false;
+        }
+      }
+      return !mError;
+    default:
+      return Fail();
+  }
+}
+
+EmbedLiteStructuredCloneWriter::EmbedLiteStructuredCloneWriter()
+{
+  WritePair(SCTAG_HEADER, kCloneScopeDifferentProcess);
+}
+
+void
+EmbedLiteStructuredCloneWriter::WriteUint64(uint64_t aValue)
+{
+  size_t offset = mBuffer.size();
+  mBuffer.resize(offset + sizeof(uint64_t));
+  LittleEndian::writeUint64(mBuffer.data() + offset, aValue);
+}
+
+void
+EmbedLiteStructuredCloneWriter::WritePair(uint32_t aTag, uint32_t aData)
+{
+  WriteUint64((uint64_t(aTag) << 32) | aData);
+}
+
+void
+EmbedLiteStructuredCloneWriter::WriteChars(uint32_t aTag, const char16_t* aChars, size_t aLength)
+{
+  MOZ_RELEASE_ASSERT(aLength < kLatin1Flag);
+
+  bool latin1 = true;
+  for (size_t i = 0; i < aLength && latin1; ++i) {
+    latin1 = aChars[i] <= 0xFF;
+  }
+  WritePair(aTag, uint32_t(aLength) | (latin1 ? kLatin1Flag : 0));
+
+  size_t offset = mBuffer.size();
+  size_t bytes = latin1 ? aLength : aLength * sizeof(char16_t);
+  mBuffer.resize(offset + PaddedLength(bytes), 0);
+  uint8_t* out = mBuffer.data() + offset;
+  for (size_t i = 0; i < aLength; ++i) {
+    if (latin1) {
+      out[i] = uint8_t(aChars[i]);
+    } else {
+      LittleEndian::writeUint16(out + i * 2, aChars[i]);
+    }
+  }
+}
+
+void
+EmbedLiteStructuredCloneWriter::WriteNull()
+{
+  WritePair(SCTAG_NULL, 0);
+}
+
+void
+EmbedLiteStructuredCloneWriter::WriteUndefined()
+{
+  WritePair(SCTAG_UNDEFINED, 0);
+}
+
+void
+EmbedLiteStructuredCloneWriter::WriteBoolean(bool aValue)
+{
+  WritePair(SCTAG_BOOLEAN, aValue);
+}
+
+void
+EmbedLiteStructuredCloneWriter::WriteInt32(int32_t aValue)
+{
+  WritePair(SCTAG_INT32, uint32_t(aValue));
+}
+
+void
+EmbedLiteStructuredCloneWriter::WriteDouble(double aValue)
+{
+  uint64_t bits = kCanonicalNaN;
+  if (aValue == aValue) {
+    memcpy(&bits, &aValue, sizeof(double));
+  }
+  WriteUint64(bits);
+}
+
+void
+EmbedLiteStructuredCloneWriter::WriteString(const char16_t* aChars, size_t aLength)
+{
+  WriteChars(SCTAG_STRING, aChars, aLength);
+}
+
+void
+EmbedLiteStructuredCloneWriter::BeginArray(uint32_t aLength)
+{
+  WritePair(SCTAG_ARRAY_OBJECT, aLength);
+}
+
+void
+EmbedLiteStructuredCloneWriter::WriteIndex(uint32_t aIndex)
+{
+  MOZ_ASSERT(aIndex <= INT32_MAX);
+  WritePair(SCTAG_INT32, aIndex);
+}
+
+void
+EmbedLiteStructuredCloneWriter::BeginObject()
+{
+  WritePair(SCTAG_OBJECT_OBJECT, 0);
+}
+
+void
+EmbedLiteStructuredCloneWriter::WriteKey(const char16_t* aChars, size_t aLength)
+{
+  WriteChars(SCTAG_STRING, aChars, aLength);
+}
+
+void
+EmbedLiteStructuredCloneWriter::End()
+{
+  WritePair(SCTAG_END_OF_KEYS, 0);
+}
+
+} // namespace embedlite
+} // namespace mozilla
@@ -0,0 +1,125 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_STRUCTURED_CLONE_H
+#define MOZ_EMBED_LITE_STRUCTURED_CLONE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace mozilla {
+namespace embedlite {
+
+// Value types understood by the embedder side structured clone reader.
+// Only plain data is supported: anything else (blobs, typed arrays, maps,
+// back references to an already seen object...) is reported as Unsupported.
+enum class EmbedLiteCloneType
+{
+  Invalid,
+  Null,
+  Undefined,
+  Boolean,
+  Int32,
+  Double,
+  String,
+  Array,
+  Object,
+  Unsupported
+};
+
+// Reads a structured clone buffer as delivered by
+// EmbedLiteViewListener::RecvAsyncBinaryMessage without building any JSON.
+// Values are pulled in document order, for example:
+//
+//   EmbedLiteStructuredCloneReader reader(aData, aLength);
+//   if (reader.BeginObject()) {
+//     std::u16string key;
+//     while (reader.NextKey(key)) {
+//       if (key == u"x") { reader.ReadInt32(&x); } else { reader.Skip(); }
+//     }
+//   }
+//
+// Any failing call leaves the reader in an error state (see HasError).
+class EmbedLiteStructuredCloneReader
+{
+public:
+  EmbedLiteStructuredCloneReader(const uint8_t* aData, size_t aLength);
+
+  // Type of the next value, without consuming it.
+  EmbedLiteCloneType Peek();
+  bool HasError() const { return mError; }
+
+  bool ReadNull();
+  bool ReadUndefined();
+  bool ReadBoolean(bool* aValue);
+  bool ReadInt32(int32_t* aValue);
+  // Accepts int32 values as well, JS numbers are stored as int32 when possible.
+  bool ReadDouble(double* aValue);
+  bool ReadString(std::u16string& aValue);
+
+  // Containers. Properties are read with NextKey (objects) or NextIndex
+  // (arrays) followed by the property value. Both return false once the end
+  // of the container has been consumed.
+  bool BeginArray(uint32_t* aLength);
+  bool NextIndex(uint32_t* aIndex);
+  bool BeginObject();
+  bool NextKey(std::u16string& aKey);
+
+  // Skips the next value including all nested properties.
+  bool Skip();
+
+private:
+  bool PeekPair(uint32_t* aTag, uint32_t* aData);
+  bool ReadPair(uint32_t* aTag, uint32_t* aData);
+  bool ReadChars(uint32_t aLengthAndEncoding, std::u16string& aValue);
+  bool Fail();
+
+  const uint8_t* mData;
+  size_t mLength;
+  size_t mPosition;
+  bool mError;
+};
+
+// Builds a structured clone buffer which content scripts receive as a
+// regular message manager message, see EmbedLiteView::SendAsyncBinaryMessage.
+// Containers must be closed with End(). Object properties are written as
+// WriteKey followed by the value, array elements as WriteIndex and the value.
+class EmbedLiteStructuredCloneWriter
+{
+public:
+  EmbedLiteStructuredCloneWriter();
+
+  void WriteNull();
+  void WriteUndefined();
+  void WriteBoolean(bool aValue);
+  void WriteInt32(int32_t aValue);
+  void WriteDouble(double aValue);
+  void WriteString(const char16_t* aChars, size_t aLength);
+  void WriteString(const std::u16string& aValue) { WriteString(aValue.data(), aValue.size()); }
+
+  void BeginArray(uint32_t aLength);
+  void WriteIndex(uint32_t aIndex);
+  void BeginObject();
+  void WriteKey(const char16_t* aChars, size_t aLength);
+  void WriteKey(const std::u16string& aKey) { WriteKey(aKey.data(), aKey.size()); }
+  void End();
+
+  const uint8_t* Data() const { return mBuffer.data(); }
+  size_t Length() const { return mBuffer.size(); }
+
+private:
+  void WritePair(uint32_t aTag, uint32_t aData);
+  void WriteUint64(uint64_t aValue);
+  void WriteChars(uint32_t aTag, const char16_t* aChars, size_t aLength);
+
+  std::vector<uint8_t> mBuffer;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_STRUCTURED_CLONE_H
@@ -0,0 +1,356 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLiteTabManager.h"
+#include "EmbedLiteApp.h"
+#include "EmbedLiteView.h"
+
+#include <algorithm>
+
+namespace mozilla {
+namespace embedlite {
+
+EmbedLiteTabManager::EmbedLiteTabManager(EmbedLiteApp* aApp)
+  : mApp(aApp)
+  , mListener(nullptr)
+{
+  LOGT();
+}
+
+EmbedLiteTabManager::~EmbedLiteTabManager()
+{
+  LOGT();
+}
+
+void
+EmbedLiteTabManager::SetPolicy(const EmbedLiteTabPolicy& aPolicy)
+{
+  mPolicy = aPolicy;
+  Evaluate();
+}
+
+void
+EmbedLiteTabManager::AddView(EmbedLiteView* aView)
+{
+  NS_ENSURE_TRUE_VOID(aView);
+  uint32_t id = aView->GetUniqueID();
+  if (mEntries.count(id)) {
+    return;
+  }
+
+  LOGT("view:%u", id);
+  Entry& entry = mEntries[id];
+  entry.mView = aView;
+  entry.mState = EmbedLiteTabState::Throttled;
+  entry.mBackgroundSince = TimeStamp::Now();
+  entry.mMemory = 0;
+  mLru.push_back(id);
+
+  aView->SetIsActive(false);
+  aView->SetThrottlePainting(true);
+  Evaluate();
+}
+
+void
+EmbedLiteTabManager::RemoveView(EmbedLiteView* aView)
+{
+  NS_ENSURE_TRUE_VOID(aView);
+  uint32_t id = aView->GetUniqueID();
+  auto it = mEntries.find(id);
+  if (it == mEntries.end()) {
+    return;
+  }
+
+  // Hand the view back in a usable state, leaving SetIsActive to the embedder.
+  ApplySteps(aView, GetReleaseSteps(it->second.mState));
+  ViewDestroyed(id);
+}
+
+void
+EmbedLiteTabManager::ActivateView(EmbedLiteView* aView)
+{
+  NS_ENSURE_TRUE_VOID(aView);
+  uint32_t id = aView->GetUniqueID();
+  auto it = mEntries.find(id);
+  if (it == mEntries.end()) {
+    AddView(aView);
+    it = mEntries.find(id);
+  }
+
+  TimeStamp now = TimeStamp::Now();
+  for (auto& pair : mEntries) {
+    if (pair.first != id && pair.second.mState == EmbedLiteTabState::Active) {
+      pair.second.mBackgroundSince = now;
+      SetState(pair.second, EmbedLiteTabState::Throttled);
+    }
+  }
+
+  mLru.remove(id);
+  mLru.push_front(id);
+  SetState(it->second, EmbedLiteTabState::Active);
+  Evaluate();
+}
+
+void
+EmbedLiteTabManager::MemoryPressure(bool aCritical)
+{
+  LOGT("critical:%d", aCritical);
+  size_t background = 0;
+  for (uint32_t id : mLru) {
+    if (mEntries[id].mState != EmbedLiteTabState::Active) {
+      ++background;
+    }
+  }
+
+  // Least recently used views are at the back.
+  size_t toDiscard = aCritical ? background : (background + 1) / 2;
+  for (auto it = mLru.rbegin(); it != mLru.rend(); ++it) {
+    Entry& entry = mEntries[*it];
+    if (entry.mState == EmbedLiteTabState::Active) {
+      continue;
+    }
+    if (toDiscard) {
+      --toDiscard;
+      SetState(entry, EmbedLiteTabState::Discarded);
+    } else if (entry.mState == EmbedLiteTabState::Throttled) {
+      SetState(entry, EmbedLiteTabState::Frozen);
+    }
+  }
+
+  // Prewarmed views are cheaper to rebuild than any background page.
+  mApp->TrimViewPools(aCritical);
+
+  if (aCritical) {
+    mApp->SendObserve("memory-pressure", u"low-memory");
+  }
+}
+
+EmbedLiteTabState
+EmbedLiteTabManager::GetState(EmbedLiteView* aView) const
+{
+  auto it = aView ? mEntries.find(aView->GetUniqueID()) : mEntries.end();
+  return it != mEntries.end() ? it->second.mState : EmbedLiteTabState::Active;
+}
+
+uint64_t
+EmbedLiteTabManager::GetMemoryUsage(EmbedLiteView* aView) const
+{
+  auto it = aView ? mEntries.find(aView->GetUniqueID()) : mEntries.end();
+  return it != mEntries.end() ? it->second.mMemory : 0;
+}
+
+void
+EmbedLiteTabManager::RequestMemoryReports()
+{
+  mLastMemoryReport = TimeStamp::Now();
+  for (auto& pair : mEntries) {
+    if (pair.second.mState != EmbedLiteTabState::Discarded) {
+      pair.second.mView->RequestMemoryReport();
+    }
+  }
+}
+
+void
+EmbedLiteTabManager::ViewDestroyed(uint32_t aId)
+{
+  if (mEntries.erase(aId)) {
+    mLru.remove(aId);
+  }
+}
+
+void
+EmbedLiteTabManager::MemoryReported(EmbedLiteView* aView, uint64_t aBytes)
+{
+  auto it = mEntries.find(aView->GetUniqueID());
+  if (it == mEntries.end()) {
+    return;
+  }
+
+  it->second.mMemory = aBytes;
+  if (mListener) {
+    mListener->ViewMemoryReported(aView, aBytes);
+  }
+  if (mPolicy.memoryBudget) {
+    Evaluate();
+  }
+}
+
+void
+EmbedLiteTabManager::SetState(Entry& aEntry, EmbedLiteTabState aState)
+{
+  EmbedLiteTabState previous = aEntry.mState;
+  if (previous == aState) {
+    return;
+  }
+
+  LOGT("view:%u %d -> %d", aEntry.mView->GetUniqueID(), int(previous), int(aState));
+  EmbedLiteView* view = aEntry.mView;
+  aEntry.mState = aState;
+  ApplySteps(view, GetSteps(previous, aState));
+  if (aState == EmbedLiteTabState::Discarded) {
+    aEntry.mMemory = 0;
+  }
+
+  if (mListener) {
+    mListener->ViewStateChanged(view, aState);
+  }
+}
+
+EmbedLiteTabStep
+EmbedLiteTabManager::GetSteps(EmbedLiteTabState aFrom, EmbedLiteTabState aTo)
+{
+  EmbedLiteTabStep steps = EmbedLiteTabStep::None;
+  if (aFrom == aTo) {
+    return steps;
+  }
+
+  if (aFrom == EmbedLiteTabState::Discarded) {
+    steps |= EmbedLiteTabStep::Restore;
+  }
+  // Leaving Frozen for any state, timeouts of discarded views run again
+  // once they are restored.
+  if (aFrom == EmbedLiteTabState::Frozen) {
+    steps |= EmbedLiteTabStep::ResumeTimeouts;
+  }
+  if (aTo == EmbedLiteTabState::Active) {
+    steps |= EmbedLiteTabStep::Unthrottle | EmbedLiteTabStep::Activate;
+  } else if (aFrom == EmbedLiteTabState::Active) {
+    steps |= EmbedLiteTabStep::Deactivate | EmbedLiteTabStep::Throttle;
+  }
+  if (aTo == EmbedLiteTabState::Frozen) {
+    steps |= EmbedLiteTabStep::SuspendTimeouts;
+  } else if (aTo == EmbedLiteTabState::Discarded) {
+    steps |= EmbedLiteTabStep::Discard;
+  }
+  return steps;
+}
+
+EmbedLiteTabStep
+EmbedLiteTabManager::GetReleaseSteps(EmbedLiteTabState aState)
+{
+  // Everything of becoming active but the activation itself.
+  return GetSteps(aState, EmbedLiteTabState::Active) & ~EmbedLiteTabStep::Activate;
+}
+
+void
+EmbedLiteTabManager::ApplySteps(EmbedLiteView* aView, EmbedLiteTabStep aSteps)
+{
+  if (aSteps & EmbedLiteTabStep::Restore) {
+    aView->Restore();
+  }
+  if (aSteps & EmbedLiteTabStep::ResumeTimeouts) {
+    aView->ResumeTimeouts();
+  }
+  if (aSteps & EmbedLiteTabStep::Unthrottle) {
+    aView->SetThrottlePainting(false);
+  }
+  if (aSteps & EmbedLiteTabStep::Activate) {
+    aView->SetIsActive(true);
+  }
+  if (aSteps & EmbedLiteTabStep::Deactivate) {
+    aView->SetIsActive(false);
+  }
+  if (aSteps & EmbedLiteTabStep::Throttle) {
+    aView->SetThrottlePainting(true);
+  }
+  if (aSteps & EmbedLiteTabStep::SuspendTimeouts) {
+    aView->SuspendTimeouts();
+  }
+  if (aSteps & EmbedLiteTabStep::Discard) {
+    aView->Discard();
+  }
+}
+
+void
+EmbedLiteTabManager::Evaluate()
+{
+  TimeStamp now = TimeStamp::Now();
+  TimeDuration freezeDelay = TimeDuration::FromMilliseconds(mPolicy.freezeDelay);
+
+  uint32_t liveViews = 0;
+  uint64_t backgroundMemory = 0;
+  for (uint32_t id : mLru) {
+    Entry& entry = mEntries[id];
+    if (entry.mState == EmbedLiteTabState::Throttled &&
+        now - entry.mBackgroundSince >= freezeDelay) {
+      SetState(entry, EmbedLiteTabState::Frozen);
+    }
+    if (entry.mState != EmbedLiteTabState::Discarded) {
+      ++liveViews;
+      if (entry.mState != EmbedLiteTabState::Active) {
+        backgroundMemory += entry.mMemory;
+      }
+    }
+  }
+
+  for (auto it = mLru.rbegin(); it != mLru.rend(); ++it) {
+    bool overCount = mPolicy.maxLiveViews && liveViews > mPolicy.maxLiveViews;
+    bool overBudget = mPolicy.memoryBudget && backgroundMemory > mPolicy.memoryBudget;
+    if (!overCount && !overBudget) {
+      break;
+    }
+
+    Entry& entry = mEntries[*it];
+    if (entry.mState == EmbedLiteTabState::Active ||
+        entry.mState == EmbedLiteTabState::Discarded) {
+      continue;
+    }
+    backgroundMemory -= entry.mMemory;
+    --liveViews;
+    SetState(entry, EmbedLiteTabState::Discarded);
+  }
+
+  if (mPolicy.memoryReportInterval &&
+      (mLastMemoryReport.IsNull() ||
+       now - mLastMemoryReport >= TimeDuration::FromMilliseconds(mPolicy.memoryReportInterval))) {
+    RequestMemoryReports();
+  }
+
+  ScheduleEvaluate(now);
+}
+
+void
+EmbedLiteTabManager::ScheduleEvaluate(const TimeStamp& aNow)
+{
+  // Wake up for the next view to freeze or the next memory report.
+  TimeStamp next;
+  for (auto& pair : mEntries) {
+    if (pair.second.mState == EmbedLiteTabState::Throttled) {
+      TimeStamp freezeAt = pair.second.mBackgroundSince +
+                           TimeDuration::FromMilliseconds(mPolicy.freezeDelay);
+      if (next.IsNull() || freezeAt < next) {
+        next = freezeAt;
+      }
+    }
+  }
+  if (mPolicy.memoryReportInterval && !mEntries.empty()) {
+    TimeStamp reportAt = mLastMemoryReport +
+                         TimeDuration::FromMilliseconds(mPolicy.memoryReportInterval);
+    if (next.IsNull() || reportAt < next) {
+      next = reportAt;
+    }
+  }
+
+  // A task that wakes up earlier than needed just evaluates again.
+  if (next.IsNull() || (!mEvaluateAt.IsNull() && mEvaluateAt <= next)) {
+    return;
+  }
+  mEvaluateAt = next;
+  int delay = std::max(int((next - aNow).ToMilliseconds()), 1);
+  mApp->PostTask(&EmbedLiteTabManager::EvaluateTask, this, delay);
+}
+
+void
+EmbedLiteTabManager::EvaluateTask(void* aData)
+{
+  EmbedLiteTabManager* self = static_cast<EmbedLiteTabManager*>(aData);
+  self->mEvaluateAt = TimeStamp();
+  self->Evaluate();
+}
+
+} // namespace embedlite
+} // namespace mozilla
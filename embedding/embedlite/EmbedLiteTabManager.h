@@ -0,0 +1,147 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef EMBED_LITE_TAB_MANAGER_H
+#define EMBED_LITE_TAB_MANAGER_H
+
+#include "mozilla/TimeStamp.h"
+#include "mozilla/TypedEnumBits.h"
+
+#include <list>
+#include <map>
+#include <stdint.h>
+
+namespace mozilla {
+namespace embedlite {
+
+class EmbedLiteApp;
+class EmbedLiteView;
+
+enum class EmbedLiteTabState {
+  // Foreground view.
+  Active,
+  // Background, inactive with painting throttled.
+  Throttled,
+  // Background long enough to also have timeouts suspended.
+  Frozen,
+  // Page unloaded, session history kept for reactivation.
+  Discarded
+};
+
+// View calls that change the state of a managed view, made in this order.
+enum class EmbedLiteTabStep : uint32_t {
+  None = 0,
+  Restore = 1 << 0,
+  ResumeTimeouts = 1 << 1,
+  Unthrottle = 1 << 2,
+  Activate = 1 << 3,
+  Deactivate = 1 << 4,
+  Throttle = 1 << 5,
+  SuspendTimeouts = 1 << 6,
+  Discard = 1 << 7
+};
+MOZ_MAKE_ENUM_CLASS_BITWISE_OPERATORS(EmbedLiteTabStep)
+
+class EmbedLiteTabManagerListener
+{
+public:
+  virtual void ViewStateChanged(EmbedLiteView* aView, EmbedLiteTabState aState) {}
+  // DOM, style and layout memory of the view's top level document in bytes.
+  virtual void ViewMemoryReported(EmbedLiteView* aView, uint64_t aBytes) {}
+};
+
+struct EmbedLiteTabPolicy
+{
+  // Milliseconds a throttled view stays in the background before it is frozen.
+  uint32_t freezeDelay = 30000;
+  // Views that are not discarded, the active one included. Least recently
+  // used views beyond this are discarded. 0 means no limit.
+  uint32_t maxLiveViews = 5;
+  // Memory of background views that are not discarded, in bytes. Least
+  // recently used views are discarded until it fits. 0 means no limit.
+  uint64_t memoryBudget = 0;
+  // Milliseconds between memory reports of the live views, 0 disables them.
+  uint32_t memoryReportInterval = 60000;
+};
+
+/**
+ * Drives background views through Throttled, Frozen and Discarded states
+ * in least recently used order, honoring EmbedLiteTabPolicy budgets and
+ * memory pressure. Only views added with AddView are managed, their
+ * SetIsActive, SetThrottlePainting, Suspend/ResumeTimeouts and
+ * Discard/Restore calls should then be left to the manager.
+ *
+ * Obtained with EmbedLiteApp::GetTabManager, UI thread only.
+ */
+class EmbedLiteTabManager
+{
+public:
+  void SetListener(EmbedLiteTabManagerListener* aListener) { mListener = aListener; }
+  void SetPolicy(const EmbedLiteTabPolicy& aPolicy);
+  const EmbedLiteTabPolicy& GetPolicy() const { return mPolicy; }
+
+  // Starts managing aView as the least recently used background view.
+  void AddView(EmbedLiteView* aView);
+  // Stops managing aView. Throttling, freezing and discarding are undone,
+  // whether the view is active is up to the embedder again.
+  void RemoveView(EmbedLiteView* aView);
+  // Brings aView to the foreground, restoring it if it was discarded.
+  // The previously active view goes to the background.
+  void ActivateView(EmbedLiteView* aView);
+
+  // Frees memory of background views. Non critical pressure freezes all of
+  // them and discards the least recently used half, critical pressure
+  // discards all of them and lets gecko drop its caches as well. Pools of
+  // prewarmed views are halved or emptied accordingly.
+  void MemoryPressure(bool aCritical);
+
+  EmbedLiteTabState GetState(EmbedLiteView* aView) const;
+  // Last reported memory usage, 0 if not known.
+  uint64_t GetMemoryUsage(EmbedLiteView* aView) const;
+  void RequestMemoryReports();
+
+  // Steps that take a managed view from aFrom to aTo.
+  static EmbedLiteTabStep GetSteps(EmbedLiteTabState aFrom, EmbedLiteTabState aTo);
+  // Steps that hand a view in aState back to the embedder, see RemoveView.
+  static EmbedLiteTabStep GetReleaseSteps(EmbedLiteTabState aState);
+
+private:
+  friend class EmbedLiteApp;
+  friend class EmbedLiteViewParent;
+
+  struct Entry {
+    EmbedLiteView* mView;
+    EmbedLiteTabState mState;
+    TimeStamp mBackgroundSince;
+    uint64_t mMemory;
+  };
+
+  explicit EmbedLiteTabManager(EmbedLiteApp* aApp);
+  ~EmbedLiteTabManager();
+
+  void ViewDestroyed(uint32_t aId);
+  void MemoryReported(EmbedLiteView* aView, uint64_t aBytes);
+
+  void SetState(Entry& aEntry, EmbedLiteTabState aState);
+  static void ApplySteps(EmbedLiteView* aView, EmbedLiteTabStep aSteps);
+  void Evaluate();
+  void ScheduleEvaluate(const TimeStamp& aNow);
+  static void EvaluateTask(void* aData);
+
+  EmbedLiteApp* mApp;
+  EmbedLiteTabManagerListener* mListener;
+  EmbedLiteTabPolicy mPolicy;
+  std::map<uint32_t, Entry> mEntries;
+  // View ids, most recently used first.
+  std::list<uint32_t> mLru;
+  TimeStamp mLastMemoryReport;
+  // Wake up time of the pending evaluation task, null if none.
+  TimeStamp mEvaluateAt;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // EMBED_LITE_TAB_MANAGER_H
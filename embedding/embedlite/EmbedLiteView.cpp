@@ -20,6 +20,7 @@
 #include "imgIEncoder.h"
 #include "InputData.h"
 
+#include <algorithm>
 #include <sys/syscall.h>
 
 namespace mozilla {
@@ -35,6 +36,9 @@ EmbedLiteView::EmbedLiteView(EmbedLiteApp* aApp, EmbedLiteWindow* aWindow,  PEmb
   , mViewImpl(dynamic_cast<EmbedLiteViewIface*>(aViewImpl))
   , mViewParent(aViewImpl)
   , mUniqueID(aViewId)
+  , mInitialized(false)
+  , mIsActive(false)
+  , mMediaPlaying(false)
   , mMarginsChanging(false)
   , mDynamicToolbarHeightChanging(false)
   , mMargins(0, 0, 0, 0)
@@ -56,9 +60,52 @@ void
 EmbedLiteView::Destroy()
 {
   MOZ_ASSERT(mViewParent);
+  if (IsCrashed()) {
+    // Nobody left on the other side to confirm it.
+    mApp->PostTask(&EmbedLiteView::NotifyDestroyed, reinterpret_cast<void*>(uintptr_t(mUniqueID)));
+    return;
+  }
   Unused << mViewParent->SendDestroy();
 }
 
+void
+EmbedLiteView::Claimed(bool aDesktopMode)
+{
+  LOGT("id:%u initialized:%d", mUniqueID, mInitialized);
+  // Prewarmed views are always created in mobile mode.
+  if (aDesktopMode) {
+    SetDesktopMode(true);
+  }
+  if (mInitialized) {
+    // The embedder sets the listener only after CreateView returns.
+    mApp->PostTask(&EmbedLiteView::NotifyInitialized, reinterpret_cast<void*>(uintptr_t(mUniqueID)));
+  }
+}
+
+void
+EmbedLiteView::Initialized()
+{
+  mInitialized = true;
+  if (!mReloadLocation.IsEmpty()) {
+    // Reloaded after a crash, the embedder has been initialized before.
+    LoadURL(mReloadLocation.get());
+    mReloadLocation.Truncate();
+    return;
+  }
+  GetListener()->ViewInitialized();
+}
+
+void
+EmbedLiteView::NotifyInitialized(void* aViewId)
+{
+  // The view may have been destroyed in the meantime.
+  EmbedLiteApp* app = EmbedLiteApp::GetInstance();
+  auto it = app->mViews.find(uint32_t(reinterpret_cast<uintptr_t>(aViewId)));
+  if (it != app->mViews.end()) {
+    it->second->GetListener()->ViewInitialized();
+  }
+}
+
 void
 EmbedLiteView::Destroyed()
 {
@@ -68,6 +115,47 @@ EmbedLiteView::Destroyed()
   EmbedLiteApp::GetInstance()->ViewDestroyed(mUniqueID);
 }
 
+void
+EmbedLiteView::NotifyDestroyed(void* aViewId)
+{
+  EmbedLiteApp* app = EmbedLiteApp::GetInstance();
+  auto it = app->mViews.find(uint32_t(reinterpret_cast<uintptr_t>(aViewId)));
+  if (it != app->mViews.end()) {
+    it->second->Destroyed();
+  }
+}
+
+void
+EmbedLiteView::ContentCrashed()
+{
+  LOGT("id:%u", mUniqueID);
+  mCrashedParent = static_cast<EmbedLiteViewParent*>(mViewParent);
+  mApp->ViewCrashed(mUniqueID);
+}
+
+void
+EmbedLiteView::Recovered(PEmbedLiteViewParent* aViewImpl, const nsCString& aLocation)
+{
+  LOGT("id:%u location:%s", mUniqueID, aLocation.get());
+  MOZ_ASSERT(IsCrashed());
+  mViewImpl->ViewAPIDestroyed();
+  mViewImpl = dynamic_cast<EmbedLiteViewIface*>(aViewImpl);
+  mViewParent = aViewImpl;
+  mViewImpl->SetEmbedAPIView(this);
+  mInitialized = false;
+  mMediaPlaying = false;
+  mReloadLocation = aLocation;
+  mCrashedParent = nullptr;
+}
+
+void
+EmbedLiteView::MediaPlaybackChanged(bool aPlaying)
+{
+  LOGT("id:%u playing:%d", mUniqueID, aPlaying);
+  mMediaPlaying = aPlaying;
+  mApp->PriorityStateChanged();
+}
+
 void
 EmbedLiteView::SetListener(EmbedLiteViewListener* aListener)
 {
@@ -98,6 +186,8 @@ EmbedLiteView::SetIsActive(bool aIsActive)
   LOGT("active: %d thread %ld", aIsActive, syscall(SYS_gettid));
 
   NS_ENSURE_TRUE(mViewParent, );
+  mIsActive = aIsActive;
+  mApp->PriorityStateChanged();
   Unused << mViewParent->SendSetIsActive(aIsActive);
   // Make sure active view content controller is always registered with
   // APZCTreeManager for the window.
@@ -120,6 +210,7 @@ EmbedLiteView::SetDesktopMode(bool aDesktopMode)
 {
   LOGT();
   NS_ENSURE_TRUE(mViewParent, );
+  static_cast<EmbedLiteViewParent*>(mViewParent)->mIsDesktopMode = aDesktopMode;
   Unused << mViewParent->SendSetDesktopMode(aDesktopMode);
 }
 
@@ -147,6 +238,29 @@ EmbedLiteView::ResumeTimeouts()
   Unused << mViewParent->SendResumeTimeouts();
 }
 
+void
+EmbedLiteView::Discard()
+{
+  LOGT();
+  NS_ENSURE_TRUE(mViewParent, );
+  Unused << mViewParent->SendDiscard();
+}
+
+void
+EmbedLiteView::Restore()
+{
+  LOGT();
+  NS_ENSURE_TRUE(mViewParent, );
+  Unused << mViewParent->SendRestore();
+}
+
+void
+EmbedLiteView::RequestMemoryReport()
+{
+  NS_ENSURE_TRUE(mViewParent, );
+  Unused << mViewParent->SendRequestMemoryReport();
+}
+
 void EmbedLiteView::GoBack()
 {
   NS_ENSURE_TRUE(mViewParent, );
@@ -249,7 +363,97 @@ EmbedLiteView::SendAsyncMessage(const char16_t* aMessageName, const char16_t* aM
 
   const nsDependentString msgname(aMessageName);
   const nsDependentString msg(aMessage);
-  Unused << mViewParent->SendAsyncMessage(msgname, msg);
+  Unused << static_cast<EmbedLiteViewParent*>(mViewParent)->DoSendAsyncMessage(msgname, msg);
+}
+
+void
+EmbedLiteView::SetTouchResampling(bool aEnabled, int aLatencyMs)
+{
+  NS_ENSURE_TRUE(mViewParent, );
+  EmbedLiteViewParent* parent = static_cast<EmbedLiteViewParent*>(mViewParent);
+  parent->mTouchResampling = aEnabled;
+  parent->mTouchResampleLatency = TimeDuration::FromMilliseconds(std::max(aLatencyMs, 0));
+}
+
+void
+EmbedLiteView::SetTouchHistory(bool aEnabled)
+{
+  NS_ENSURE_TRUE(mViewParent, );
+  static_cast<EmbedLiteViewParent*>(mViewParent)->mTouchHistory = aEnabled;
+}
+
+void
+EmbedLiteView::SetShmemMessageThreshold(uint32_t aBytes)
+{
+  NS_ENSURE_TRUE(mViewParent, );
+  static_cast<EmbedLiteViewParent*>(mViewParent)->SetShmemMessageThreshold(aBytes);
+}
+
+void
+EmbedLiteView::GetMessageStatistics(uint64_t* aCopies, uint32_t* aShmemAllocations, uint32_t* aShmemReuses)
+{
+  *aCopies = *aShmemAllocations = *aShmemReuses = 0;
+  NS_ENSURE_TRUE(mViewParent, );
+  EmbedLiteViewParent* parent = static_cast<EmbedLiteViewParent*>(mViewParent);
+  *aCopies = parent->MessageCopies();
+  *aShmemAllocations = parent->ShmemPool().Allocations();
+  *aShmemReuses = parent->ShmemPool().Reuses();
+}
+
+void
+EmbedLiteView::CaptureFrame(const nsIntRect& aCrop, int aWidth, int aHeight,
+                            const EmbedLiteCaptureCallback& aCallback)
+{
+  mWindow->CaptureFrame(aCrop, aWidth, aHeight, aCallback);
+}
+
+void
+EmbedLiteView::SendAsyncResponse(uint32_t aRequestId, const char16_t* aData)
+{
+  NS_ENSURE_TRUE(mViewParent, );
+  Unused << static_cast<EmbedLiteViewParent*>(mViewParent)->DoSendAsyncResponse(aRequestId, true,
+                                                                                nsDependentString(aData));
+}
+
+void
+EmbedLiteView::RejectAsyncRequest(uint32_t aRequestId)
+{
+  NS_ENSURE_TRUE(mViewParent, );
+  Unused << static_cast<EmbedLiteViewParent*>(mViewParent)->DoSendAsyncResponse(aRequestId, false,
+                                                                                EmptyString());
+}
+
+void
+EmbedLiteView::IMEStatusChanged()
+{
+  NS_ENSURE_TRUE(mViewParent, );
+  static_cast<EmbedLiteViewParent*>(mViewParent)->UpdateInputContext();
+}
+
+void
+EmbedLiteView::AddBinaryMessageListener(const char* aName)
+{
+  LOGT("name:%s", aName);
+  NS_ENSURE_TRUE(mViewParent, );
+  Unused << mViewParent->SendAddBinaryMessageListener(nsDependentCString(aName));
+}
+
+void
+EmbedLiteView::RemoveBinaryMessageListener(const char* aName)
+{
+  LOGT("name:%s", aName);
+  NS_ENSURE_TRUE(mViewParent, );
+  Unused << mViewParent->SendRemoveBinaryMessageListener(nsDependentCString(aName));
+}
+
+void
+EmbedLiteView::SendAsyncBinaryMessage(const char16_t* aMessageName, const uint8_t* aData, size_t aLength)
+{
+  NS_ENSURE_TRUE(mViewParent, );
+
+  nsTArray<uint8_t> data;
+  data.AppendElements(aData, aLength);
+  Unused << mViewParent->SendAsyncBinaryMessage(nsDependentString(aMessageName), data);
 }
 
 // Render interface
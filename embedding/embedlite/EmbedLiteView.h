@@ -11,6 +11,9 @@
 #include "gfxRect.h"  // gfxRect
 #include "gfxPoint.h" // gfxSize
 #include "nsRect.h"
+#include "nsString.h"
+#include "EmbedLiteWindow.h"
+#include "EmbedLiteStructuredClone.h"
 
 #include <vector>
 #include <string>
@@ -22,10 +25,24 @@ namespace embedlite {
 
 class EmbedTouchInput;
 class EmbedLiteViewThreadParent;
+class EmbedLiteViewParent;
 class PEmbedLiteViewParent;
 class EmbedLiteView;
 class EmbedLiteWindow;
 
+// Statistics of a finished top level document load.
+struct EmbedLiteLoadSummary
+{
+  // Requests started by the load, the document included.
+  uint32_t requests;
+  // Bytes transferred as reported by the loaders.
+  uint64_t bytes;
+  // Milliseconds from the start of the load, 0 if nothing was painted
+  // before it finished.
+  uint32_t timeToFirstPaint;
+  uint32_t timeToLoad;
+};
+
 class EmbedLiteViewListener
 {
 public:
@@ -37,12 +54,25 @@ public:
   // Messaging interface, allow to receive json messages from content child scripts
   virtual void RecvAsyncMessage(const char16_t* aMessage, const char16_t* aData) {}
   virtual char* RecvSyncMessage(const char16_t* aMessage, const char16_t* aData) { return NULL; }
+  // Binary messaging interface, see EmbedLiteView::AddBinaryMessageListener.
+  // aData is a structured clone buffer, read it with EmbedLiteStructuredCloneReader.
+  virtual void RecvAsyncBinaryMessage(const char16_t* aMessage, const uint8_t* aData, size_t aLength) {}
+  // Non blocking alternative to RecvSyncMessage. Return true and answer
+  // (now or later) with EmbedLiteView::SendAsyncResponse or RejectAsyncRequest.
+  // Returning false answers the request with RecvSyncMessage instead.
+  virtual bool RecvAsyncRequest(uint32_t aRequestId, const char16_t* aMessage, const char16_t* aData) { return false; }
+  // Content stopped waiting for the request (timeout), do not answer it anymore.
+  virtual void OnAsyncRequestCancelled(uint32_t aRequestId) {}
 
   virtual void OnLocationChanged(const char* aLocation, bool aCanGoBack, bool aCanGoForward) {}
   virtual void OnLoadStarted(const char* aLocation) {}
   virtual void OnLoadFinished(void) {}
   virtual void OnLoadRedirect(void) {}
+  // aProgress never decreases during a load and is rate limited by
+  // embedlite.load_progress.interval, 100 is sent right before OnLoadFinished.
   virtual void OnLoadProgress(int32_t aProgress, int32_t aCurTotal, int32_t aMaxTotal) {}
+  // Right after OnLoadFinished.
+  virtual void OnLoadSummary(const EmbedLiteLoadSummary& aSummary) {}
   virtual void OnSecurityChanged(const char* aStatus, unsigned int aState) {}
   virtual void OnFirstPaint(int32_t aX, int32_t aY) {}
   virtual void OnScrolledAreaChanged(unsigned int aWidth, unsigned int aHeight) {}
@@ -66,6 +96,10 @@ public:
   virtual bool HandleDoubleTap(const nsIntPoint& aPoint) { return false; }
   virtual bool HandleSingleTap(const nsIntPoint& aPoint) { return false; }
   virtual bool HandleLongTap(const nsIntPoint& aPoint) { return false; }
+
+  // The content process of the view is gone. Bring it back with
+  // EmbedLiteApp::ReloadCrashedView or destroy it, other calls are ignored.
+  virtual void OnContentProcessCrashed() {}
 };
 
 class EmbedLiteApp;
@@ -86,6 +120,13 @@ public:
   virtual void SetThrottlePainting(bool);
   virtual void SuspendTimeouts();
   virtual void ResumeTimeouts();
+  // Unload the page to free memory, session history (including scroll
+  // positions and form data) is kept and brought back with Restore.
+  // Normally driven by EmbedLiteTabManager.
+  virtual void Discard();
+  virtual void Restore();
+  // Answered with EmbedLiteTabManagerListener::ViewMemoryReported.
+  virtual void RequestMemoryReport();
   virtual void GoBack();
   virtual void GoForward();
   virtual void StopLoad();
@@ -105,6 +146,13 @@ public:
   virtual void SendKeyRelease(int domKeyCode, int gmodifiers, int charCode);
 
   virtual void ReceiveInputEvent(const EmbedTouchInput& aEvent);
+  // Touch moves are batched and delivered once per frame, positioned
+  // aLatencyMs before the frame by interpolating between the raw samples.
+  // Enabled with 5ms latency by default, disabled every move is delivered.
+  virtual void SetTouchResampling(bool aEnabled, int aLatencyMs = 5);
+  // Content gets the raw moves a resampled move stands for as separate
+  // touchmove events, for pages that draw with the finger.
+  virtual void SetTouchHistory(bool aEnabled);
   virtual void MousePress(int x, int y, int mstime, unsigned int buttons, unsigned int modifiers);
   virtual void MouseRelease(int x, int y, int mstime, unsigned int buttons, unsigned int modifiers);
   virtual void MouseMove(int x, int y, int mstime, unsigned int buttons, unsigned int modifiers);
@@ -134,6 +182,35 @@ public:
   virtual void RemoveMessageListeners(const std::vector<std::string> &aMessageNames);
   virtual void SendAsyncMessage(const char16_t* aMessageName, const char16_t* aMessage);
 
+  // Opt-in binary variant of the messaging interface. Messages registered
+  // with AddBinaryMessageListener skip the JSON conversion and are delivered
+  // to EmbedLiteViewListener::RecvAsyncBinaryMessage as structured clone data.
+  // SendAsyncBinaryMessage expects a buffer built by EmbedLiteStructuredCloneWriter.
+  virtual void AddBinaryMessageListener(const char* aMessageName);
+  virtual void RemoveBinaryMessageListener(const char* aMessageName);
+  virtual void SendAsyncBinaryMessage(const char16_t* aMessageName, const uint8_t* aData, size_t aLength);
+
+  // Messages with at least aBytes of payload are sent through recycled
+  // shared memory segments instead of being copied into the IPC message.
+  // Content side threshold is the "embedlite.ipc.shmem_message_threshold" pref.
+  virtual void SetShmemMessageThreshold(uint32_t aBytes);
+  // Payload copies made on this side for messages sent and received so far,
+  // and how many shared memory segments were mapped or reused for sending.
+  virtual void GetMessageStatistics(uint64_t* aCopies, uint32_t* aShmemAllocations, uint32_t* aShmemReuses);
+
+  // Snapshot of the window this view is rendered into, see EmbedLiteWindow::CaptureFrame.
+  virtual void CaptureFrame(const nsIntRect& aCrop, int aWidth, int aHeight,
+                            const EmbedLiteCaptureCallback& aCallback);
+
+  // Answers requests received via EmbedLiteViewListener::RecvAsyncRequest.
+  // Requests are cancelled on the content side when the view is destroyed.
+  virtual void SendAsyncResponse(uint32_t aRequestId, const char16_t* aData);
+  virtual void RejectAsyncRequest(uint32_t aRequestId);
+
+  // Call when the state returned by EmbedLiteViewListener::GetIMEStatus
+  // changed, content caches it instead of querying synchronously.
+  virtual void IMEStatusChanged();
+
   virtual uint32_t GetUniqueID();
   virtual void SetScreenProperties(const int &depth, const float &density, const float &dpi);
 
@@ -146,12 +223,26 @@ protected:
   // should only be used by EmbedLiteApp. EmbedLite users should destroy
   // EmbedLiteViews by calling EmbedLiteApp::DestroyView.
   void Destroy();
+  // Hands a prewarmed view over to the embedder. ViewInitialized is
+  // delivered asynchronously if the view is already initialized.
+  void Claimed(bool aDesktopMode);
+  bool IsInitialized() const { return mInitialized; }
+  bool IsCrashed() const { return !!mCrashedParent; }
+  // Moves the view to the actor that replaces the crashed one, aLocation
+  // is loaded once it is initialized.
+  void Recovered(PEmbedLiteViewParent* aViewImpl, const nsCString& aLocation);
 
 private:
+  friend class EmbedLitePriorityManager;
   friend class EmbedLiteViewParent;
   friend class EmbedLiteViewThreadParent;
 
+  void Initialized();
+  static void NotifyInitialized(void* aViewId);
   void Destroyed();
+  static void NotifyDestroyed(void* aViewId);
+  void ContentCrashed();
+  void MediaPlaybackChanged(bool aPlaying);
   void MarginsChanged(int top, int right, int bottom, int left);
   void DynamicToolbarHeightChanged(int height);
 
@@ -163,10 +254,16 @@ private:
   EmbedLiteViewIface* mViewImpl;
   PEmbedLiteViewParent* mViewParent;
   const uint32_t mUniqueID;
+  bool mInitialized;
+  bool mIsActive;
+  bool mMediaPlaying;
   bool mMarginsChanging;
   bool mDynamicToolbarHeightChanging;
   mozilla::gfx::IntMargin mMargins;
   int mDynamicToolbarHeight;
+  // The actor of the crashed process, until the view is reloaded or destroyed.
+  RefPtr<EmbedLiteViewParent> mCrashedParent;
+  nsCString mReloadLocation;
 };
 
 } // namespace embedlite
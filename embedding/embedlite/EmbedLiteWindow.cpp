@@ -5,9 +5,13 @@
 
 #include "EmbedLiteWindow.h"
 
+#include "EmbedLiteApp.h"
 #include "mozilla/embedlite/PEmbedLiteWindowParent.h"
 #include "EmbedLiteWindowParent.h"
+#include "EmbedLiteCompositorBridgeParent.h"
 #include "mozilla/Unused.h"
+#include "base/message_loop.h"
+#include "nsThreadUtils.h"
 
 namespace mozilla {
 namespace embedlite {
@@ -29,6 +33,11 @@ EmbedLiteWindow::~EmbedLiteWindow()
 
 void EmbedLiteWindow::Destroy()
 {
+  if (IsCrashed()) {
+    // Nobody is left to confirm.
+    mApp->PostTask(&EmbedLiteWindow::NotifyDestroyed, reinterpret_cast<void*>(uintptr_t(mUniqueID)));
+    return;
+  }
   Unused << mWindowParent->SendDestroy();
 }
 
@@ -40,9 +49,35 @@ void EmbedLiteWindow::Destroyed()
   EmbedLiteApp::GetInstance()->WindowDestroyed(mUniqueID);
 }
 
+void EmbedLiteWindow::NotifyDestroyed(void* aId)
+{
+  EmbedLiteApp* app = EmbedLiteApp::GetInstance();
+  auto it = app->mWindows.find(uint32_t(reinterpret_cast<uintptr_t>(aId)));
+  if (it != app->mWindows.end()) {
+    it->second->Destroyed();
+  }
+}
+
+void EmbedLiteWindow::ContentCrashed()
+{
+  mCrashedParent = mWindowParent;
+}
+
+void EmbedLiteWindow::Recovered(PEmbedLiteWindowParent* aParent)
+{
+  MOZ_ASSERT(IsCrashed());
+  mWindowParent->SetEmbedAPIWindow(nullptr);
+  mWindowParent = static_cast<EmbedLiteWindowParent*>(aParent);
+  mWindowParent->SetEmbedAPIWindow(this);
+  if (mCrashedParent->mRotation != mozilla::ROTATION_0) {
+    mWindowParent->SetContentOrientation(mCrashedParent->mRotation);
+  }
+  mCrashedParent = nullptr;
+}
+
 void EmbedLiteWindow::SetSize(int width, int height)
 {
-  Unused << mWindowParent->SendSetSize(gfxSize(width, height));
+  mWindowParent->SetSize(width, height);
 }
 
 uint32_t EmbedLiteWindow::GetUniqueID() const
@@ -52,7 +87,7 @@ uint32_t EmbedLiteWindow::GetUniqueID() const
 
 void EmbedLiteWindow::SetContentOrientation(mozilla::embedlite::ScreenRotation rotation)
 {
-  Unused << mWindowParent->SendSetContentOrientation(rotation);
+  mWindowParent->SetContentOrientation(rotation);
 }
 
 void EmbedLiteWindow::ScheduleUpdate()
@@ -80,6 +115,44 @@ void EmbedLiteWindow::GetPlatformImage(const std::function<void(void *image, int
     mWindowParent->GetPlatformImage(callback);
 }
 
+void EmbedLiteWindow::GetFrameStatistics(uint64_t* aPublished, uint64_t* aDropped, uint64_t* aContention)
+{
+  *aPublished = *aDropped = *aContention = 0;
+  EmbedLiteCompositorBridgeParent* compositor = mWindowParent->GetCompositor();
+  if (compositor) {
+    *aPublished = compositor->PublishedFrames();
+    *aDropped = compositor->DroppedFrames();
+    *aContention = compositor->FrameSlotContention();
+  }
+}
+
+bool EmbedLiteWindow::GetSoftwareFrame(const std::function<void(const uint8_t *data, int width, int height, int stride)> &callback)
+{
+  EmbedLiteCompositorBridgeParent* compositor = mWindowParent->GetCompositor();
+  return compositor && compositor->GetSoftwareFrame(callback);
+}
+
+void EmbedLiteWindow::CaptureFrame(const nsIntRect& aCrop, int aWidth, int aHeight,
+                                   const EmbedLiteCaptureCallback& aCallback)
+{
+  EmbedLiteCompositorBridgeParent* compositor = mWindowParent->GetCompositor();
+  if (!compositor) {
+    EmbedLiteCaptureCallback callback = aCallback;
+    MessageLoop::current()->PostTask(NS_NewRunnableFunction("mozilla::embedlite::EmbedLiteWindow::CaptureFrame",
+                                                            [callback]() {
+      callback(false, nullptr, 0, 0, 0);
+    }));
+    return;
+  }
+  compositor->CaptureFrame(aCrop, gfx::IntSize(aWidth, aHeight), aCallback);
+}
+
+bool EmbedLiteWindow::GetFrameTimingStats(EmbedLiteFrameTimingStats* aStats)
+{
+  EmbedLiteCompositorBridgeParent* compositor = mWindowParent->GetCompositor();
+  return compositor && compositor->GetFrameTimingStats(aStats);
+}
+
 } // nemsapace embedlite
 } // namespace mozilla
 
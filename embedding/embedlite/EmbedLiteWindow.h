@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 
+#include "mozilla/RefPtr.h"
 #include "nsRect.h"
 #include <functional>
 
@@ -24,10 +25,40 @@ enum ScreenRotation {
   ROTATION_COUNT
 };
 
+// Captured frame as premultiplied 32 bit BGRA pixels, valid only during the call.
+typedef std::function<void(bool success, const uint8_t *data, int width, int height, int stride)> EmbedLiteCaptureCallback;
+
 class EmbedLiteApp;
 class PEmbedLiteWindowParent;
 class EmbedLiteWindowParent;
 
+// Frame timing summary over the most recent composited frames.
+// Durations are in milliseconds.
+struct EmbedLiteFrameTimingStats
+{
+  struct Percentiles {
+    float p50;
+    float p95;
+    float p99;
+  };
+
+  uint32_t frames;
+  // CompositeToDefaultTarget start to end.
+  Percentiles composite;
+  // Vsync to PresentOffscreenSurface, i.e. pacing drift.
+  Percentiles vsyncToPresent;
+  // Time spent waiting for the compositor render mutex.
+  Percentiles mutexWait;
+  // Frames presented later than one vsync interval after their vsync.
+  uint32_t jankFrames;
+  // Vsync intervals missed by those late frames.
+  uint32_t skippedVsyncs;
+  // Frames presenting touch input, and the time from the oldest touch
+  // sample they consumed to their presentation.
+  uint32_t inputFrames;
+  Percentiles inputToPresent;
+};
+
 class EmbedLiteWindowListener
 {
 public:
@@ -62,6 +93,10 @@ public:
   // This funtion will be called directly from gecko Compositor thread. The embedder
   // must ensure this function will be thread safe.
   virtual bool RequestGLContext(void*& surface, void*& context, void*& display) { return false; }
+
+  // Periodic frame timing summary, every embedlite.compositor.frame_timing_report_interval
+  // frames (0 disables the reports). Called directly from gecko compositor thread.
+  virtual void FrameTimingReport(const EmbedLiteFrameTimingStats& aStats) {}
 };
 
 class EmbedLiteWindow {
@@ -77,9 +112,31 @@ public:
   virtual void ScheduleUpdate();
   virtual void SuspendRendering();
   virtual void ResumeRendering();
+  // The image stays valid until the next call, or until the window is
+  // destroyed.
   virtual void* GetPlatformImage(int* width, int* height);
   virtual void GetPlatformImage(const std::function<void(void *image, int width, int height)> &callback);
 
+  // Frame hand off statistics of the compositor, all zero before it exists.
+  // Dropped frames were composited but replaced before GetPlatformImage
+  // picked them up. Contention counts how often the compositor and
+  // GetPlatformImage raced for the frame slots.
+  virtual void GetFrameStatistics(uint64_t* aPublished, uint64_t* aDropped, uint64_t* aContention);
+  // Newest frame composited with embedlite.compositor.software enabled, as
+  // premultiplied 32 bit BGRA pixels (QImage::Format_ARGB32_Premultiplied on
+  // little endian). The data is valid only during the callback. Returns false
+  // if there is no frame yet. Call from one thread only.
+  virtual bool GetSoftwareFrame(const std::function<void(const uint8_t *data, int width, int height, int stride)> &callback);
+  // Asynchronous snapshot of the next composited frame, for thumbnails and
+  // previews. aCrop is in frame pixels (empty for the whole frame) and the
+  // image is scaled to aWidth x aHeight (0 keeps the crop size). aCallback
+  // is called later on the calling thread, which must run a MessageLoop.
+  // Captures are rate limited by embedlite.compositor.capture_min_interval.
+  virtual void CaptureFrame(const nsIntRect& aCrop, int aWidth, int aHeight,
+                            const EmbedLiteCaptureCallback& aCallback);
+  // Timing of the recently composited frames, false if nothing was composited yet.
+  virtual bool GetFrameTimingStats(EmbedLiteFrameTimingStats* aStats);
+
 protected:
   friend class EmbedLiteApp;
 
@@ -89,15 +146,23 @@ protected:
   // should only be used by EmbedLiteApp. EmbedLite users should destroy
   // EmbedLiteWindowss by calling EmbedLiteApp::DestroyWindow.
   void Destroy();
+  // The content process is gone, until Recovered binds the window to a
+  // new actor.
+  bool IsCrashed() const { return !!mCrashedParent; }
+  void Recovered(PEmbedLiteWindowParent* aParent);
 
 private:
   friend class EmbedLiteWindowParent;
 
   // EmbedLiteWindowss are supposed to be destroyed through EmbedLiteApp::DestroyWindow.
   void Destroyed();
+  static void NotifyDestroyed(void* aId);
+  void ContentCrashed();
 
   EmbedLiteApp* mApp;
   EmbedLiteWindowParent* mWindowParent;
+  // Keeps the actor of the crashed process alive, it fails to send.
+  RefPtr<EmbedLiteWindowParent> mCrashedParent;
   const uint32_t mUniqueID;
 };
 
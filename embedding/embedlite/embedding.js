@@ -122,6 +122,23 @@ pref("embedlite.compositor.external_gl_context", false);
 // soon as the top level PuppetWidget is creted for the view. Setting
 // this pref only makes sense when using external compositor gl context.
 pref("embedlite.compositor.request_external_gl_context_early", false);
+// Deliver EmbedLiteWindowListener::FrameTimingReport every N composited frames, 0 disables it.
+pref("embedlite.compositor.frame_timing_report_interval", 0);
+// Composite on the CPU without any GL context, frames are read with
+// EmbedLiteWindow::GetSoftwareFrame. Must be set before creating windows.
+pref("embedlite.compositor.software", false);
+// Minimum time in ms between two EmbedLiteWindow::CaptureFrame readbacks.
+pref("embedlite.compositor.capture_min_interval", 100);
+// View messages carrying at least this many bytes are sent through shared memory.
+pref("embedlite.ipc.shmem_message_threshold", 65536);
+// Record counts, sizes and timings of EmbedLite IPC messages, see EmbedLiteApp::DumpIPCTrace.
+pref("embedlite.ipc.trace.enabled", false);
+// Number of most recent messages kept as individual trace events.
+pref("embedlite.ipc.trace.buffer_size", 16384);
+// Minimum time in ms between two scroll state updates of a view in the background.
+pref("embedlite.scroll_state.background_interval", 1000);
+// Minimum time in ms between two load progress updates of a view.
+pref("embedlite.load_progress.interval", 100);
 pref("extensions.update.enabled", false);
 pref("extensions.systemAddon.update.enabled", false);
 
@@ -0,0 +1,267 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLiteIPCTrace.h"
+#include "base/platform_thread.h"
+#include "chrome/common/ipc_message.h"
+#include "mozilla/JSONWriter.h"
+#include "mozilla/StaticMutex.h"
+#include "mozilla/StaticPtr.h"
+
+#include <map>
+#include <stdio.h>
+#include <unistd.h>
+#include <vector>
+
+namespace mozilla {
+namespace embedlite {
+
+namespace {
+
+struct MessageStats {
+  uint64_t mCount = 0;
+  uint64_t mBytes = 0;
+  uint64_t mReplyBytes = 0;
+  uint32_t mMaxBytes = 0;
+  bool mSync = false;
+  TimeDuration mQueue;
+  TimeDuration mMaxQueue;
+  TimeDuration mHandler;
+  TimeDuration mMaxHandler;
+};
+
+struct Event {
+  // Message names are static strings.
+  const char* mName;
+  TimeStamp mStart;
+  TimeDuration mQueue;
+  TimeDuration mHandler;
+  uint32_t mBytes;
+  uint32_t mReplyBytes;
+  PlatformThreadId mThread;
+};
+
+struct TraceData {
+  std::map<const char*, MessageStats> mStats;
+  // Ring buffer, mNext is the oldest event once it wrapped around.
+  std::vector<Event> mEvents;
+  size_t mNext = 0;
+  bool mWrapped = false;
+};
+
+static const uint32_t kDefaultBufferSize = 16384;
+
+StaticMutex sMutex;
+StaticAutoPtr<TraceData> sData;
+uint32_t sBufferSize = kDefaultBufferSize;
+
+TraceData* Data()
+{
+  sMutex.AssertCurrentThreadOwns();
+  if (!sData) {
+    sData = new TraceData();
+    sData->mEvents.reserve(sBufferSize);
+  }
+  return sData;
+}
+
+class FileWriteFunc final : public JSONWriteFunc
+{
+public:
+  explicit FileWriteFunc(FILE* aFile) : mFile(aFile) {}
+  void Write(const char* aStr) override { fputs(aStr, mFile); }
+
+private:
+  FILE* mFile;
+};
+
+class StringWriteFunc final : public JSONWriteFunc
+{
+public:
+  explicit StringWriteFunc(nsACString& aBuffer) : mBuffer(aBuffer) {}
+  void Write(const char* aStr) override { mBuffer.Append(aStr); }
+
+private:
+  nsACString& mBuffer;
+};
+
+void WriteStats(JSONWriter& aWriter, const TraceData* aData)
+{
+  if (!aData) {
+    return;
+  }
+  for (const auto& entry : aData->mStats) {
+    const MessageStats& stats = entry.second;
+    aWriter.StartObjectProperty(entry.first);
+    aWriter.IntProperty("count", stats.mCount);
+    aWriter.IntProperty("bytes", stats.mBytes);
+    aWriter.IntProperty("maxBytes", stats.mMaxBytes);
+    if (stats.mSync) {
+      aWriter.BoolProperty("sync", true);
+      aWriter.IntProperty("replyBytes", stats.mReplyBytes);
+    }
+    aWriter.DoubleProperty("queueMs", stats.mQueue.ToMilliseconds());
+    aWriter.DoubleProperty("maxQueueMs", stats.mMaxQueue.ToMilliseconds());
+    aWriter.DoubleProperty("handlerMs", stats.mHandler.ToMilliseconds());
+    aWriter.DoubleProperty("maxHandlerMs", stats.mMaxHandler.ToMilliseconds());
+    aWriter.EndObject();
+  }
+}
+
+} // namespace
+
+Atomic<bool, Relaxed> EmbedLiteIPCTrace::sEnabled(false);
+
+void
+EmbedLiteIPCTrace::SetEnabled(bool aEnabled)
+{
+  LOGT("enabled:%d", aEnabled);
+  sEnabled = aEnabled;
+}
+
+void
+EmbedLiteIPCTrace::SetBufferSize(uint32_t aEvents)
+{
+  StaticMutexAutoLock lock(sMutex);
+  if (aEvents == sBufferSize) {
+    return;
+  }
+  sBufferSize = aEvents;
+  if (sData) {
+    sData->mEvents.clear();
+    sData->mEvents.shrink_to_fit();
+    sData->mEvents.reserve(sBufferSize);
+    sData->mNext = 0;
+    sData->mWrapped = false;
+  }
+}
+
+void
+EmbedLiteIPCTrace::Reset()
+{
+  StaticMutexAutoLock lock(sMutex);
+  sData = nullptr;
+}
+
+void
+EmbedLiteIPCTrace::GetStats(nsACString& aJSON)
+{
+  aJSON.Truncate();
+  JSONWriter writer(MakeUnique<StringWriteFunc>(aJSON));
+  writer.Start(JSONWriter::SingleLineStyle);
+  {
+    StaticMutexAutoLock lock(sMutex);
+    WriteStats(writer, sData);
+  }
+  writer.End();
+}
+
+bool
+EmbedLiteIPCTrace::DumpTrace(const char* aPath)
+{
+  FILE* file = fopen(aPath, "w");
+  if (!file) {
+    LOGE("Cannot open %s", aPath);
+    return false;
+  }
+
+  TimeStamp origin = TimeStamp::ProcessCreation();
+  int pid = getpid();
+  {
+    JSONWriter writer(MakeUnique<FileWriteFunc>(file));
+    writer.Start();
+    StaticMutexAutoLock lock(sMutex);
+    writer.StartArrayProperty("traceEvents");
+    if (sData) {
+      const std::vector<Event>& events = sData->mEvents;
+      size_t first = sData->mWrapped ? sData->mNext : 0;
+      for (size_t i = 0; i < events.size(); ++i) {
+        const Event& event = events[(first + i) % events.size()];
+        writer.StartObjectElement(JSONWriter::SingleLineStyle);
+        writer.StringProperty("name", event.mName);
+        writer.StringProperty("cat", "ipc");
+        writer.StringProperty("ph", "X");
+        writer.DoubleProperty("ts", (event.mStart - origin).ToMicroseconds());
+        writer.DoubleProperty("dur", event.mHandler.ToMicroseconds());
+        writer.IntProperty("pid", pid);
+        writer.IntProperty("tid", event.mThread);
+        writer.StartObjectProperty("args");
+        writer.IntProperty("bytes", event.mBytes);
+        if (event.mReplyBytes) {
+          writer.IntProperty("replyBytes", event.mReplyBytes);
+        }
+        writer.DoubleProperty("queueUs", event.mQueue.ToMicroseconds());
+        writer.EndObject();
+        writer.EndObject();
+      }
+    }
+    writer.EndArray();
+    writer.StartObjectProperty("embedliteStats");
+    WriteStats(writer, sData);
+    writer.EndObject();
+    writer.End();
+  }
+
+  bool ok = !ferror(file);
+  return fclose(file) == 0 && ok;
+}
+
+EmbedLiteIPCTrace::AutoRecord::AutoRecord(const IPC::Message& aMsg, IPC::Message** aReply)
+  : mMsg(nullptr)
+  , mReply(aReply)
+{
+  if (sEnabled) {
+    mMsg = &aMsg;
+    mStart = TimeStamp::Now();
+  }
+}
+
+EmbedLiteIPCTrace::AutoRecord::~AutoRecord()
+{
+  if (!mMsg) {
+    return;
+  }
+
+  Event event;
+  event.mName = mMsg->name();
+  event.mStart = mStart;
+  event.mHandler = TimeStamp::Now() - mStart;
+  // Messages sent from another process share the monotonic clock on the
+  // platforms we run on.
+  const TimeStamp& created = mMsg->create_time();
+  event.mQueue = !created.IsNull() && created < mStart ? mStart - created : TimeDuration();
+  event.mBytes = mMsg->size();
+  event.mReplyBytes = mReply && *mReply ? (*mReply)->size() : 0;
+  event.mThread = PlatformThread::CurrentId();
+
+  StaticMutexAutoLock lock(sMutex);
+  TraceData* data = Data();
+  MessageStats& stats = data->mStats[event.mName];
+  ++stats.mCount;
+  stats.mBytes += event.mBytes;
+  stats.mReplyBytes += event.mReplyBytes;
+  stats.mMaxBytes = std::max(stats.mMaxBytes, event.mBytes);
+  stats.mSync = mMsg->is_sync();
+  stats.mQueue += event.mQueue;
+  stats.mMaxQueue = std::max(stats.mMaxQueue, event.mQueue);
+  stats.mHandler += event.mHandler;
+  stats.mMaxHandler = std::max(stats.mMaxHandler, event.mHandler);
+
+  if (!sBufferSize) {
+    return;
+  }
+  if (data->mEvents.size() < sBufferSize) {
+    data->mEvents.push_back(event);
+    return;
+  }
+  data->mEvents[data->mNext] = event;
+  data->mNext = (data->mNext + 1) % sBufferSize;
+  data->mWrapped = true;
+}
+
+} // namespace embedlite
+} // namespace mozilla
@@ -0,0 +1,80 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_IPC_TRACE_H
+#define MOZ_EMBED_LITE_IPC_TRACE_H
+
+#include "mozilla/Atomics.h"
+#include "mozilla/Attributes.h"
+#include "mozilla/TimeStamp.h"
+#include "nsString.h"
+
+namespace IPC {
+class Message;
+}
+
+namespace mozilla {
+namespace embedlite {
+
+/*
+ * Process wide trace of the messages received by the EmbedLite actors.
+ *
+ * Per message type it counts messages and bytes, the time a message waited
+ * between being sent and being handled and the time its handler took. For
+ * sync messages the sender is blocked for about the sum of the two. The
+ * most recent messages are also kept as individual events for DumpTrace.
+ *
+ * Disabled it costs one relaxed atomic load per message, enabled two
+ * timestamps and a short lock.
+ */
+class EmbedLiteIPCTrace
+{
+public:
+  static bool IsEnabled() { return sEnabled; }
+  static void SetEnabled(bool aEnabled);
+  // Number of events kept for DumpTrace, drops the ones recorded so far.
+  static void SetBufferSize(uint32_t aEvents);
+  static void Reset();
+
+  // {"PEmbedLiteView::Msg_AsyncMessage": {"count": n, "bytes": n, ...}, ...}
+  static void GetStats(nsACString& aJSON);
+  // Writes the buffered events in the Trace Event Format read by
+  // chrome://tracing and Perfetto, with the stats under "embedliteStats".
+  static bool DumpTrace(const char* aPath);
+
+  class MOZ_RAII AutoRecord
+  {
+  public:
+    explicit AutoRecord(const IPC::Message& aMsg, IPC::Message** aReply = nullptr);
+    ~AutoRecord();
+
+  private:
+    // Null when tracing is disabled.
+    const IPC::Message* mMsg;
+    IPC::Message** mReply;
+    TimeStamp mStart;
+  };
+
+private:
+  static Atomic<bool, Relaxed> sEnabled;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+// Traces every message received by the actor deriving from _protocol.
+#define EMBEDLITE_IPC_TRACE_RECEIVED(_protocol)                                     \
+  virtual Result OnMessageReceived(const Message& aMsg) override                    \
+  {                                                                                 \
+    mozilla::embedlite::EmbedLiteIPCTrace::AutoRecord record(aMsg);                 \
+    return _protocol::OnMessageReceived(aMsg);                                      \
+  }                                                                                 \
+  virtual Result OnMessageReceived(const Message& aMsg, Message*& aReply) override  \
+  {                                                                                 \
+    mozilla::embedlite::EmbedLiteIPCTrace::AutoRecord record(aMsg, &aReply);        \
+    return _protocol::OnMessageReceived(aMsg, aReply);                              \
+  }
+
+#endif // MOZ_EMBED_LITE_IPC_TRACE_H
@@ -0,0 +1,62 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_POOLED_VIEWS_H
+#define MOZ_EMBED_LITE_POOLED_VIEWS_H
+
+#include <map>
+#include <stdint.h>
+
+namespace mozilla {
+namespace embedlite {
+
+/*
+ * Ids of the prewarmed views of EmbedLiteApp's view pools.
+ *
+ * A view is pooled from its creation until it is claimed, or, when it is
+ * dropped from its pool instead, until its destruction completed. Views on
+ * their way out are not the embedder's either, they must neither count in
+ * GetNumberOfViews nor make ViewDestroyed report the last view gone.
+ */
+class EmbedLitePooledViews
+{
+public:
+  void Add(uint32_t aId) { mViews[aId] = false; }
+
+  // Handed out to the embedder, false if aId was not waiting in a pool.
+  bool Claim(uint32_t aId)
+  {
+    auto it = mViews.find(aId);
+    if (it == mViews.end() || it->second) {
+      return false;
+    }
+    mViews.erase(it);
+    return true;
+  }
+
+  // Dropped from its pool, the view is being destroyed.
+  void StartDestroy(uint32_t aId) { mViews[aId] = true; }
+
+  bool IsDestroying(uint32_t aId) const
+  {
+    auto it = mViews.find(aId);
+    return it != mViews.end() && it->second;
+  }
+
+  // Destruction of aId completed, returns whether it was pooled.
+  bool Destroyed(uint32_t aId) { return mViews.erase(aId); }
+
+  // Waiting in a pool or being destroyed.
+  size_t Count() const { return mViews.size(); }
+
+private:
+  // Whether the view is being destroyed, by view id.
+  std::map<uint32_t, bool> mViews;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_POOLED_VIEWS_H
@@ -0,0 +1,145 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_REGISTRY_H
+#define MOZ_EMBED_LITE_REGISTRY_H
+
+#include "mozilla/Assertions.h"
+
+#include <stdint.h>
+#include <thread>
+#include <unordered_map>
+
+namespace mozilla {
+namespace embedlite {
+
+// Secondary keys a registered view or window can be found by.
+enum class EmbedLiteRegistryKey {
+  // nsIWebBrowserChrome of a view.
+  Chrome,
+  // Outer window id of the top level content window.
+  OuterWindowID,
+  // Top level BrowsingContext.
+  BrowsingContext,
+  Count
+};
+
+/*
+ * Views or windows indexed by their unique id and optional secondary keys,
+ * all lookups are hash lookups. Items are not owned.
+ *
+ * A registry is bound to the thread that adds the first item, debug builds
+ * assert that it is not used from anywhere else.
+ */
+template<typename T>
+class EmbedLiteRegistry
+{
+public:
+  typedef std::unordered_map<uint32_t, T*> ItemMap;
+
+  // Replaces an item registered with the same id, returns false if there was one.
+  bool Add(uint32_t aId, T* aItem)
+  {
+    AssertOwningThread();
+    bool added = !mItems.count(aId);
+    if (!added) {
+      Remove(aId);
+    }
+    mItems[aId] = aItem;
+    return added;
+  }
+
+  // Drops the item and all of its secondary keys, returns it if there was one.
+  T* Remove(uint32_t aId)
+  {
+    AssertOwningThread();
+    auto it = mItems.find(aId);
+    if (it == mItems.end()) {
+      return nullptr;
+    }
+    T* item = it->second;
+    mItems.erase(it);
+    for (int key = 0; key < int(EmbedLiteRegistryKey::Count); ++key) {
+      ClearKey(aId, EmbedLiteRegistryKey(key));
+    }
+    return item;
+  }
+
+  T* Get(uint32_t aId) const
+  {
+    AssertOwningThread();
+    auto it = mItems.find(aId);
+    return it != mItems.end() ? it->second : nullptr;
+  }
+
+  // Indexes a registered item by aValue, 0 removes the key.
+  void SetKey(uint32_t aId, EmbedLiteRegistryKey aKey, uint64_t aValue)
+  {
+    AssertOwningThread();
+    ClearKey(aId, aKey);
+    if (!aValue || !mItems.count(aId)) {
+      return;
+    }
+    mKeys[int(aKey)][aValue] = aId;
+    mKeysById[int(aKey)][aId] = aValue;
+  }
+
+  // Id of the item indexed by aValue, 0 if there is none.
+  uint32_t GetId(EmbedLiteRegistryKey aKey, uint64_t aValue) const
+  {
+    AssertOwningThread();
+    const std::unordered_map<uint64_t, uint32_t>& keys = mKeys[int(aKey)];
+    auto it = keys.find(aValue);
+    return it != keys.end() ? it->second : 0;
+  }
+
+  T* GetBy(EmbedLiteRegistryKey aKey, uint64_t aValue) const
+  {
+    uint32_t id = GetId(aKey, aValue);
+    return id ? Get(id) : nullptr;
+  }
+
+  size_t Count() const { return mItems.size(); }
+  bool IsEmpty() const { return mItems.empty(); }
+
+  // Unordered, must not be modified while iterating.
+  typename ItemMap::const_iterator begin() const { return mItems.begin(); }
+  typename ItemMap::const_iterator end() const { return mItems.end(); }
+
+private:
+  void ClearKey(uint32_t aId, EmbedLiteRegistryKey aKey)
+  {
+    std::unordered_map<uint32_t, uint64_t>& keysById = mKeysById[int(aKey)];
+    auto it = keysById.find(aId);
+    if (it == keysById.end()) {
+      return;
+    }
+    mKeys[int(aKey)].erase(it->second);
+    keysById.erase(it);
+  }
+
+  void AssertOwningThread() const
+  {
+#ifdef DEBUG
+    if (mOwningThread == std::thread::id()) {
+      mOwningThread = std::this_thread::get_id();
+    }
+    MOZ_ASSERT(mOwningThread == std::this_thread::get_id(),
+               "EmbedLiteRegistry used off its owning thread");
+#endif
+  }
+
+  ItemMap mItems;
+  std::unordered_map<uint64_t, uint32_t> mKeys[int(EmbedLiteRegistryKey::Count)];
+  std::unordered_map<uint32_t, uint64_t> mKeysById[int(EmbedLiteRegistryKey::Count)];
+#ifdef DEBUG
+  mutable std::thread::id mOwningThread;
+#endif
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_REGISTRY_H
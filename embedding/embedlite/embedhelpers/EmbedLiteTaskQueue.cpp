@@ -0,0 +1,269 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLiteTaskQueue.h"
+
+#include "nsThreadUtils.h"
+
+#include <algorithm>
+
+namespace mozilla {
+namespace embedlite {
+
+EmbedLiteTaskQueue::EmbedLiteTaskQueue(const WakeUpCallback& aWakeUp)
+  : mLock("EmbedLiteTaskQueue::mLock")
+  , mWakeUp(aWakeUp)
+  , mLastId(0)
+  , mRunning(0)
+  , mIdlePeriods(false)
+{
+}
+
+EmbedLiteTaskQueue::~EmbedLiteTaskQueue()
+{
+}
+
+EmbedLiteTaskId
+EmbedLiteTaskQueue::Schedule(EmbedLiteTaskPriority aPriority, const std::function<void()>& aTask,
+                             const TimeDuration& aDelay, const TimeDuration& aInterval,
+                             const TimeStamp& aNow)
+{
+  MOZ_ASSERT(aPriority < EmbedLiteTaskPriority::Count);
+  MutexAutoLock lock(mLock);
+  EmbedLiteTaskId id = ++mLastId;
+  Task& task = mTasks[id];
+  task.mPriority = aPriority;
+  task.mCallback = aTask;
+  task.mInterval = aInterval;
+  task.mDueAt = aNow + aDelay;
+  if (aDelay > TimeDuration()) {
+    mDelayed.insert(std::make_pair(task.mDueAt, id));
+  } else {
+    mReady[uint32_t(aPriority)].push_back(id);
+  }
+  RequestWakeUpLocked(aNow);
+  return id;
+}
+
+bool
+EmbedLiteTaskQueue::Cancel(EmbedLiteTaskId aId)
+{
+  RefPtr<CancelableRunnable> runnable;
+  {
+    MutexAutoLock lock(mLock);
+    auto it = mTasks.find(aId);
+    if (it != mTasks.end()) {
+      if (aId == mRunning && it->second.mInterval == TimeDuration()) {
+        // Too late, and RunNext drops it when it returns.
+        return false;
+      }
+      mStats[uint32_t(it->second.mPriority)].mCancelled++;
+      // Its queue entry is skipped when it comes up.
+      mTasks.erase(it);
+      return true;
+    }
+
+    auto tracked = mTracked.find(aId);
+    if (tracked == mTracked.end()) {
+      return false;
+    }
+    runnable = tracked->second.forget();
+    mTracked.erase(tracked);
+  }
+
+  runnable->Cancel();
+  return true;
+}
+
+EmbedLiteTaskId
+EmbedLiteTaskQueue::ReserveId()
+{
+  MutexAutoLock lock(mLock);
+  return ++mLastId;
+}
+
+void
+EmbedLiteTaskQueue::Track(EmbedLiteTaskId aId, CancelableRunnable* aRunnable)
+{
+  MutexAutoLock lock(mLock);
+  mTracked[aId] = aRunnable;
+}
+
+void
+EmbedLiteTaskQueue::Untrack(EmbedLiteTaskId aId)
+{
+  MutexAutoLock lock(mLock);
+  mTracked.erase(aId);
+}
+
+bool
+EmbedLiteTaskQueue::RunNext(const TimeStamp& aNow)
+{
+  return Run(aNow, false);
+}
+
+void
+EmbedLiteTaskQueue::EnableIdlePeriods()
+{
+  MutexAutoLock lock(mLock);
+  mIdlePeriods = true;
+}
+
+bool
+EmbedLiteTaskQueue::RunIdle(const TimeStamp& aNow)
+{
+  return Run(aNow, true);
+}
+
+bool
+EmbedLiteTaskQueue::IdleTaskDue(const TimeStamp& aNow)
+{
+  MutexAutoLock lock(mLock);
+  PromoteDueLocked(aNow);
+  return HasReadyLocked(uint32_t(EmbedLiteTaskPriority::Idle));
+}
+
+bool
+EmbedLiteTaskQueue::Run(const TimeStamp& aNow, bool aIdlePeriod)
+{
+  EmbedLiteTaskId id = 0;
+  std::function<void()> callback;
+  {
+    MutexAutoLock lock(mLock);
+    if (!aIdlePeriod) {
+      // Timers may fire a little early, asking again is cheaper than
+      // telling the wake ups apart.
+      mWakeUpAt = TimeStamp();
+    }
+
+    PromoteDueLocked(aNow);
+    for (uint32_t priority = 0; priority < kPriorities; ++priority) {
+      if (!HasReadyLocked(priority)) {
+        continue;
+      }
+      bool idle = priority == uint32_t(EmbedLiteTaskPriority::Idle);
+      if (aIdlePeriod ? !idle : IdleGatedLocked(priority)) {
+        // Left to the wake up of the more urgent task, or to the next
+        // idle period.
+        break;
+      }
+      id = mReady[priority].front();
+      mReady[priority].pop_front();
+      break;
+    }
+
+    if (!id) {
+      RequestWakeUpLocked(aNow);
+      return false;
+    }
+
+    Task& task = mTasks[id];
+    QueueStats& stats = mStats[uint32_t(task.mPriority)];
+    TimeDuration latency = aNow - task.mDueAt;
+    stats.mRun++;
+    stats.mTotalLatency += latency;
+    if (latency > stats.mMaxLatency) {
+      stats.mMaxLatency = latency;
+    }
+    // A copy, the task may cancel itself.
+    callback = task.mCallback;
+    mRunning = id;
+  }
+
+  callback();
+
+  MutexAutoLock lock(mLock);
+  mRunning = 0;
+  auto it = mTasks.find(id);
+  if (it != mTasks.end()) {
+    Task& task = it->second;
+    if (task.mInterval > TimeDuration()) {
+      task.mDueAt += task.mInterval;
+      if (task.mDueAt <= aNow) {
+        // Fell behind, skip the runs that were missed.
+        task.mDueAt = aNow + task.mInterval;
+      }
+      mDelayed.insert(std::make_pair(task.mDueAt, id));
+    } else {
+      mTasks.erase(it);
+    }
+  }
+  RequestWakeUpLocked(aNow);
+  return true;
+}
+
+EmbedLiteTaskStats
+EmbedLiteTaskQueue::GetStats(EmbedLiteTaskPriority aPriority) const
+{
+  MOZ_ASSERT(aPriority < EmbedLiteTaskPriority::Count);
+  MutexAutoLock lock(mLock);
+  const QueueStats& queue = mStats[uint32_t(aPriority)];
+  EmbedLiteTaskStats stats;
+  stats.run = queue.mRun;
+  stats.cancelled = queue.mCancelled;
+  stats.pending = 0;
+  for (const auto& pair : mTasks) {
+    if (pair.second.mPriority == aPriority && pair.first != mRunning) {
+      stats.pending++;
+    }
+  }
+  stats.meanLatencyMs = queue.mRun ? queue.mTotalLatency.ToMilliseconds() / queue.mRun : 0;
+  stats.maxLatencyMs = queue.mMaxLatency.ToMilliseconds();
+  return stats;
+}
+
+void
+EmbedLiteTaskQueue::PromoteDueLocked(const TimeStamp& aNow)
+{
+  auto end = mDelayed.upper_bound(aNow);
+  for (auto it = mDelayed.begin(); it != end; ++it) {
+    auto task = mTasks.find(it->second);
+    if (task != mTasks.end()) {
+      mReady[uint32_t(task->second.mPriority)].push_back(it->second);
+    }
+  }
+  mDelayed.erase(mDelayed.begin(), end);
+}
+
+bool
+EmbedLiteTaskQueue::HasReadyLocked(uint32_t aPriority)
+{
+  std::deque<EmbedLiteTaskId>& ready = mReady[aPriority];
+  while (!ready.empty() && !mTasks.count(ready.front())) {
+    ready.pop_front();
+  }
+  return !ready.empty();
+}
+
+bool
+EmbedLiteTaskQueue::IdleGatedLocked(uint32_t aPriority) const
+{
+  return mIdlePeriods && aPriority == uint32_t(EmbedLiteTaskPriority::Idle);
+}
+
+void
+EmbedLiteTaskQueue::RequestWakeUpLocked(const TimeStamp& aNow)
+{
+  TimeStamp wakeUp;
+  for (uint32_t priority = 0; priority < kPriorities; ++priority) {
+    if (!IdleGatedLocked(priority) && !mReady[priority].empty()) {
+      wakeUp = aNow;
+      break;
+    }
+  }
+  if (wakeUp.IsNull() && !mDelayed.empty()) {
+    wakeUp = std::max(mDelayed.begin()->first, aNow);
+  }
+
+  if (wakeUp.IsNull() || (!mWakeUpAt.IsNull() && mWakeUpAt <= wakeUp)) {
+    return;
+  }
+
+  mWakeUpAt = wakeUp;
+  mWakeUp(wakeUp - aNow);
+}
+
+} // namespace embedlite
+} // namespace mozilla
@@ -0,0 +1,116 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_TASK_QUEUE_H
+#define MOZ_EMBED_LITE_TASK_QUEUE_H
+
+#include "mozilla/embedlite/EmbedLiteApp.h"
+#include "mozilla/Mutex.h"
+#include "mozilla/RefPtr.h"
+#include "mozilla/TimeStamp.h"
+
+#include <deque>
+#include <functional>
+#include <map>
+
+namespace mozilla {
+
+class CancelableRunnable;
+
+namespace embedlite {
+
+/*
+ * Tasks of EmbedLiteApp::ScheduleTask. The owning thread calls RunNext
+ * whenever the queue asks for it through the wake up callback, which runs
+ * the most urgent due task. Within a priority tasks run in the order they
+ * became due.
+ *
+ * Tasks can be scheduled and cancelled from any thread. Cancelling is by
+ * id, an id that already ran or was cancelled is ignored.
+ *
+ * With idle periods enabled Idle tasks are left to RunIdle, RunNext and
+ * the wake ups no longer consider them.
+ */
+class EmbedLiteTaskQueue
+{
+public:
+  // Asks the owning thread to call RunNext after aDelay. Called with the
+  // queue locked, it must not call back into the queue. Wake ups may
+  // come more often than asked for.
+  typedef std::function<void(TimeDuration aDelay)> WakeUpCallback;
+
+  explicit EmbedLiteTaskQueue(const WakeUpCallback& aWakeUp);
+  ~EmbedLiteTaskQueue();
+
+  // A zero aInterval runs the task once. Repeating tasks are due aInterval
+  // after they were due last time, runs missed by then are skipped.
+  EmbedLiteTaskId Schedule(EmbedLiteTaskPriority aPriority, const std::function<void()>& aTask,
+                           const TimeDuration& aDelay, const TimeDuration& aInterval,
+                           const TimeStamp& aNow);
+  // False if aId is not waiting to run. A repeating task may cancel itself.
+  bool Cancel(EmbedLiteTaskId aId);
+
+  // Runnables of other threads, only tracked so that Cancel reaches them.
+  // The runnable calls Untrack once it runs.
+  EmbedLiteTaskId ReserveId();
+  void Track(EmbedLiteTaskId aId, CancelableRunnable* aRunnable);
+  void Untrack(EmbedLiteTaskId aId);
+
+  // Runs the most urgent due task, false if none is due.
+  bool RunNext(const TimeStamp& aNow);
+
+  void EnableIdlePeriods();
+  // Runs the first due Idle task, false if there is none or a more urgent
+  // task is due.
+  bool RunIdle(const TimeStamp& aNow);
+  bool IdleTaskDue(const TimeStamp& aNow);
+
+  EmbedLiteTaskStats GetStats(EmbedLiteTaskPriority aPriority) const;
+
+private:
+  struct Task {
+    EmbedLiteTaskPriority mPriority;
+    std::function<void()> mCallback;
+    TimeDuration mInterval;
+    TimeStamp mDueAt;
+  };
+
+  struct QueueStats {
+    uint64_t mRun = 0;
+    uint64_t mCancelled = 0;
+    TimeDuration mTotalLatency;
+    TimeDuration mMaxLatency;
+  };
+
+  static const uint32_t kPriorities = uint32_t(EmbedLiteTaskPriority::Count);
+
+  bool Run(const TimeStamp& aNow, bool aIdlePeriod);
+  void PromoteDueLocked(const TimeStamp& aNow);
+  // Drops cancelled tasks from the front of the queue.
+  bool HasReadyLocked(uint32_t aPriority);
+  bool IdleGatedLocked(uint32_t aPriority) const;
+  void RequestWakeUpLocked(const TimeStamp& aNow);
+
+  mutable Mutex mLock;
+  WakeUpCallback mWakeUp;
+  EmbedLiteTaskId mLastId;
+  std::map<EmbedLiteTaskId, Task> mTasks;
+  // Not due yet, by due time.
+  std::multimap<TimeStamp, EmbedLiteTaskId> mDelayed;
+  // Due, by priority. Cancelled ids are skipped when they come up.
+  std::deque<EmbedLiteTaskId> mReady[kPriorities];
+  QueueStats mStats[kPriorities];
+  std::map<EmbedLiteTaskId, RefPtr<CancelableRunnable>> mTracked;
+  // The task RunNext is running, 0 if none.
+  EmbedLiteTaskId mRunning;
+  // Earliest wake up asked for since the last RunNext, null if none.
+  TimeStamp mWakeUpAt;
+  bool mIdlePeriods;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_TASK_QUEUE_H
@@ -20,6 +20,7 @@
 #include "nsIConsoleService.h"
 #include "nsDebugImpl.h"
 #include "EmbedLiteViewProcessChild.h"
+#include "EmbedLiteWindowProcessChild.h"
 #include "nsIWindowCreator.h"
 #include "nsIWindowWatcher.h"
 #include "WindowCreator.h"
@@ -31,7 +32,6 @@
 #include "nsIFactory.h"
 #include "mozilla/GenericFactory.h"
 #include "mozilla/ModuleUtils.h"               // for NS_GENERIC_FACTORY_CONSTRUCTOR
-#include "mozilla/layers/PCompositorBridgeChild.h"
 
 #include "mozilla/Preferences.h"
 #include "mozilla/dom/BrowsingContext.h"
@@ -196,6 +196,7 @@ EmbedLiteAppProcessChild::AllocPEmbedLiteViewChild(const uint32_t &windowId,
   EmbedLiteViewProcessChild* view = new EmbedLiteViewProcessChild(windowId, id, parentId,
                                                                   parentBrowsingContextPtr,
                                                                   isPrivateWindow, isDesktopMode);
+  mViews.Add(id, view);
   view->AddRef();
   return view;
 }
@@ -203,16 +204,12 @@ EmbedLiteAppProcessChild::AllocPEmbedLiteViewChild(const uint32_t &windowId,
 PEmbedLiteWindowChild*
 EmbedLiteAppProcessChild::AllocPEmbedLiteWindowChild(const uint16_t &width, const uint16_t &height, const uint32_t &id, const uintptr_t &aListener)
 {
-  LOGNI();
-  return nullptr;
-}
-
-PCompositorBridgeChild*
-EmbedLiteAppProcessChild::AllocPCompositorBridgeChild(Transport* aTransport, ProcessId aOtherProcess)
-{
-  LOGT();
-  //return CompositorBridgeChild::Create(aTransport, aOtherProcess);
-  return nullptr;
+  LOGT("id:%u", id);
+  // The listener lives in the UI process.
+  EmbedLiteWindowProcessChild *window = new EmbedLiteWindowProcessChild(width, height, id);
+  mWindows.Add(id, window);
+  window->AddRef();
+  return window;
 }
 
 } // namespace embedlite
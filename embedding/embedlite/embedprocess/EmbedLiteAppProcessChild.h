@@ -49,8 +49,6 @@ protected:
   virtual PEmbedLiteWindowChild* AllocPEmbedLiteWindowChild(const uint16_t &width, const uint16_t &height,
                                                             const uint32_t &id, const uintptr_t &aListener) override;
 
-  virtual PCompositorBridgeChild* AllocPCompositorBridgeChild(Transport* aTransport, ProcessId aOtherProcess);
-
   // IPDL protocol impl
   virtual void ActorDestroy(ActorDestroyReason aWhy) override;
 
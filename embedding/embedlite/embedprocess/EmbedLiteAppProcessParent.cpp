@@ -33,13 +33,18 @@
 #include "mozilla/layers/CompositorThread.h"
 #include "mozilla/layers/CompositorBridgeParent.h"
 #include "mozilla/layers/ImageBridgeParent.h"
+#include "mozilla/gfx/GPUProcessManager.h"
+#include "gfxPlatform.h"
 
 #include "EmbedLiteViewProcessParent.h"
 #include "EmbedLiteCompositorProcessParent.h"
+#include "EmbedLiteContentProcessManager.h"
+#include "EmbedLiteWindowProcessParent.h"
 
 static BrowserProcessSubThread* sIOThread;
 
 using namespace mozilla::dom;
+using namespace mozilla::gfx;
 using namespace base;
 using base::KillProcess;
 using namespace mozilla::dom::indexedDB;
@@ -78,38 +83,39 @@ protected:
   virtual void GetBackendName(nsAString&) override {}
 };
 
-static EmbedLiteAppProcessParent* sAppProcessParent = nullptr;
-
 EmbedLiteAppProcessParent*
 EmbedLiteAppProcessParent::GetInstance()
 {
-  return sAppProcessParent;
+  return EmbedLiteContentProcessManager::GetPrimaryProcess();
 }
 
-EmbedLiteAppProcessParent*
-EmbedLiteAppProcessParent::CreateEmbedLiteAppProcessParent()
+already_AddRefed<EmbedLiteAppProcessParent>
+EmbedLiteAppProcessParent::Launch(EmbedLiteContentProcessManager* aManager)
 {
   LOGT();
-  // Establish the main thread here.
-  NS_ASSERTION(false, "nsThreadManager::get()->Init()");
-#if 0
-  if (NS_FAILED(nsThreadManager::get()->Init())) {
-    NS_ERROR("Could not initialize thread manager");
+  RefPtr<EmbedLiteAppProcessParent> process = new EmbedLiteAppProcessParent(aManager);
+
+  std::vector<std::string> extraArgs;
+  extraArgs.push_back("-embedlite");
+  if (!process->mSubprocess->AsyncLaunch(extraArgs)) {
+    LOGE("Failed to launch a content process");
     return nullptr;
   }
-#endif
-
-  NS_SetMainThread();
 
-  return new EmbedLiteAppProcessParent();
+  RefPtr<EmbedLiteAppProcessParent> self = process;
+  process->mSubprocess->WhenProcessHandleReady()->Then(
+      MessageLoop::current()->SerialEventTarget(), __func__,
+      [self](base::ProcessHandle) { self->OnLaunched(); },
+      [self](LaunchError) { self->OnLaunchFailed(); });
+  return process.forget();
 }
 
-EmbedLiteAppProcessParent::EmbedLiteAppProcessParent()
-  : mApp(EmbedLiteApp::GetInstance())
+EmbedLiteAppProcessParent::EmbedLiteAppProcessParent(EmbedLiteContentProcessManager* aManager)
+  : mManager(aManager)
+  , mLaunched(false)
 {
   LOGT();
   MOZ_COUNT_CTOR(EmbedLiteAppProcessParent);
-  sAppProcessParent = this;
 
   mSubprocess = new GeckoChildProcessHost(GeckoProcessType_Content);
 
@@ -128,20 +134,74 @@ EmbedLiteAppProcessParent::EmbedLiteAppProcessParent()
     sIOThread = ioThread.release();
   }
 
-  NS_ASSERTION(false, "Fix IToplevelProtocol::SetTransport(mSubprocess->GetChannel())");
-  //IToplevelProtocol::SetTransport(mSubprocess->GetChannel());
-
   // set gGREBinPath
-  gGREBinPath = ToNewUnicode(nsDependentCString(getenv("GRE_HOME")));
+  if (!gGREBinPath) {
+    gGREBinPath = ToNewUnicode(nsDependentCString(getenv("GRE_HOME")));
+  }
 
   if (!CommandLine::IsInitialized()) {
     CommandLine::Init(0, nullptr);
   }
+}
 
-  std::vector<std::string> extraArgs;
-  extraArgs.push_back("-embedlite");
-  mSubprocess->LaunchAndWaitForProcessHandle(extraArgs);
+bool
+EmbedLiteAppProcessParent::WaitForLaunch()
+{
+  if (!mLaunched && mSubprocess && mSubprocess->WaitForProcessHandle()) {
+    OnLaunched();
+  }
+  return mLaunched;
+}
+
+void
+EmbedLiteAppProcessParent::OnLaunched()
+{
+  // Also resolved after WaitForLaunch.
+  if (mLaunched || !mSubprocess) {
+    return;
+  }
+
+  mLaunched = true;
   Open(mSubprocess->TakeChannel(), base::GetProcId(mSubprocess->GetChildProcessHandle()));
+  InitRendering();
+  mManager->ProcessLaunched(this);
+}
+
+void
+EmbedLiteAppProcessParent::OnLaunchFailed()
+{
+  LOGE("Content process failed to start");
+  mManager->ProcessDestroyed(this, false);
+}
+
+void
+EmbedLiteAppProcessParent::InitRendering()
+{
+  LOGT();
+  // Render offscreen, there is no native window in this process.
+  PR_SetEnv("MOZ_LAYERS_PREFER_OFFSCREEN=1");
+
+  // Starts the compositor thread.
+  gfxPlatform::GetPlatform();
+
+  // Like ContentParent::InitInternal, the UI process takes the place of
+  // the GPU process.
+  Endpoint<PCompositorManagerChild> compositor;
+  Endpoint<PImageBridgeChild> imageBridge;
+  Endpoint<PVRManagerChild> vrBridge;
+  Endpoint<PRemoteDecoderManagerChild> videoManager;
+  AutoTArray<uint32_t, 3> namespaces;
+
+  GPUProcessManager* gpm = GPUProcessManager::Get();
+  if (!gpm->CreateContentBridges(OtherPid(), &compositor, &imageBridge, &vrBridge,
+                                 &videoManager, &namespaces)) {
+    LOGE("Failed to create the rendering bridges to the content process");
+    return;
+  }
+
+  EmbedLiteCompositorProcessParent::AddContentProcess(OtherPid());
+  Unused << SendInitRendering(std::move(compositor), std::move(imageBridge), std::move(vrBridge),
+                              std::move(videoManager), namespaces);
 }
 
 EmbedLiteAppProcessParent::~EmbedLiteAppProcessParent()
@@ -154,7 +214,10 @@ EmbedLiteAppProcessParent::~EmbedLiteAppProcessParent()
     base::CloseProcessHandle(otherProcessHandle);
   }
 
-  mApp->ChildReadyToDestroy();
+  // Never connected.
+  if (mSubprocess) {
+    mSubprocess->Destroy();
+  }
 }
 
 void
@@ -194,8 +257,7 @@ mozilla::ipc::IPCResult
 EmbedLiteAppProcessParent::RecvInitialized()
 {
   LOGT();
-  PR_SetEnv("MOZ_LAYERS_PREFER_OFFSCREEN=1");
-  mApp->Initialized();
+  mManager->ProcessInitialized(this);
   return IPC_OK();
 }
 
@@ -211,23 +273,11 @@ EmbedLiteAppProcessParent::RecvReadyToShutdown()
   return IPC_OK();
 }
 
-mozilla::ipc::IPCResult
-EmbedLiteAppProcessParent::RecvCreateWindow(const uint32_t &parentId,
-                                            const uintptr_t &parentBrowsingContext,
-                                            const uint32_t &chromeFlags,
-                                            uint32_t *createdID,
-                                            bool *cancel)
-{
-  LOGT();
-  *createdID = mApp->CreateWindowRequested(chromeFlags, parentId, parentBrowsingContext);
-  *cancel = !*createdID;
-  return IPC_OK();
-}
-
 mozilla::ipc::IPCResult
 EmbedLiteAppProcessParent::RecvObserve(const nsCString& topic, const nsString& data)
 {
-  LOGT();
+  LOGT("topic:%s", topic.get());
+  EmbedLiteApp::GetInstance()->GetListener()->OnObserve(topic.get(), data.get());
   return IPC_OK();
 }
 
@@ -240,13 +290,6 @@ EmbedLiteAppProcessParent::AllocPEmbedLiteViewParent(const uint32_t &windowId,
                                                      const bool &isDesktopMode)
 {
   LOGT();
-
-  static bool sCompositorCreated = false;
-  if (!sCompositorCreated) {
-    sCompositorCreated = true;
-    mozilla::layers::CompositorThreadHolder::Start();
-  }
-
   EmbedLiteViewProcessParent* p = new EmbedLiteViewProcessParent(windowId, id, parentId, parentBrowsingContext, isPrivateWindow, isDesktopMode);
   p->AddRef();
   return p;
@@ -264,16 +307,18 @@ EmbedLiteAppProcessParent::DeallocPEmbedLiteViewParent(PEmbedLiteViewParent* aAc
 PEmbedLiteWindowParent*
 EmbedLiteAppProcessParent::AllocPEmbedLiteWindowParent(const uint16_t &width, const uint16_t &height, const uint32_t &id, const uintptr_t &aListener)
 {
-  LOGNI();
-
-  return nullptr;
+  LOGT("id:%u", id);
+  EmbedLiteWindowProcessParent *p = new EmbedLiteWindowProcessParent(width, height, id, reinterpret_cast<EmbedLiteWindowListener*>(aListener));
+  p->AddRef();
+  return p;
 }
 
 bool
 EmbedLiteAppProcessParent::DeallocPEmbedLiteWindowParent(PEmbedLiteWindowParent* aActor)
 {
-  LOGNI();
-
+  LOGT();
+  EmbedLiteWindowProcessParent* p = static_cast<EmbedLiteWindowProcessParent *>(aActor);
+  p->Release();
   return true;
 }
 
@@ -308,6 +353,11 @@ EmbedLiteAppProcessParent::ActorDestroy(ActorDestroyReason aWhy)
 
   MessageLoop::current()->PostTask(NS_NewRunnableFunction("mozilla::embedlite::EmbedLiteAppProcessParent::DelayedDeleteSubprocess", [subprocess = mSubprocess] { subprocess->Destroy(); }));
   mSubprocess = nullptr;
+
+  EmbedLiteCompositorProcessParent::RemoveContentProcess(OtherPid());
+  // The manager drops its reference right away.
+  MessageLoop::current()->PostTask(MakeAndAddRef<DelayedDeleteContentParentTask>(this));
+  mManager->ProcessDestroyed(this, aWhy == AbnormalShutdown);
 }
 
 void
@@ -17,16 +17,22 @@ class Pref;
 }
 namespace embedlite {
 
-class EmbedLiteApp;
+class EmbedLiteContentProcessManager;
 class EmbedLiteAppProcessParent : public EmbedLiteAppParent
 {
   NS_INLINE_DECL_THREADSAFE_REFCOUNTING(EmbedLiteAppProcessParent)
-  EmbedLiteAppProcessParent();
+  explicit EmbedLiteAppProcessParent(EmbedLiteContentProcessManager* aManager);
 
 public:
-  static EmbedLiteAppProcessParent* CreateEmbedLiteAppProcessParent();
-
+  // The primary content process, see EmbedLiteContentProcessManager.
   static EmbedLiteAppProcessParent* GetInstance();
+  // Starts launching a content process in the background.
+  static already_AddRefed<EmbedLiteAppProcessParent> Launch(EmbedLiteContentProcessManager* aManager);
+
+  // Blocks until the process runs and the channel is open, false if it
+  // failed to start.
+  bool WaitForLaunch();
+  bool IsLaunched() const { return mLaunched; }
 
   void GetPrefs(nsTArray<mozilla::dom::Pref>* prefs);
 
@@ -35,11 +41,6 @@ protected:
 
   virtual mozilla::ipc::IPCResult RecvInitialized() override;
   virtual mozilla::ipc::IPCResult RecvReadyToShutdown() override;
-  virtual mozilla::ipc::IPCResult RecvCreateWindow(const uint32_t &parentId,
-                                                   const uintptr_t &parentBrowsingContext,
-                                                   const uint32_t &chromeFlags,
-                                                   uint32_t *createdID,
-                                                   bool *cancel) override;
   virtual mozilla::ipc::IPCResult RecvObserve(const nsCString &topic,
                                               const nsString &data) override;
 
@@ -58,10 +59,15 @@ protected:
 
 private:
   virtual ~EmbedLiteAppProcessParent();
+  void OnLaunched();
+  void OnLaunchFailed();
+  // Connects the content process to the compositor of this process.
+  void InitRendering();
   void ShutDownProcess(bool aCloseWithError);
 
-  EmbedLiteApp* mApp;
+  EmbedLiteContentProcessManager* mManager;
   mozilla::ipc::GeckoChildProcessHost* mSubprocess;
+  bool mLaunched;
   nsTArray<mozilla::dom::Pref> mPrefs;
 
   DISALLOW_EVIL_CONSTRUCTORS(EmbedLiteAppProcessParent);
@@ -6,267 +6,94 @@
 #include "EmbedLog.h"
 
 #include "EmbedLiteCompositorProcessParent.h"
-#include "mozilla/layers/LayerTransactionParent.h"     // for LayerTransactionParent
-#include "mozilla/layers/LayerManagerComposite.h"
-#include "mozilla/layers/Compositor.h"  // for Compositor
-#include <stdio.h>                      // for fprintf, stdout
-#include <stdint.h>                     // for uint64_t
-#include <map>                          // for _Rb_tree_iterator, etc
-#include <utility>                      // for pair
+#include "EmbedLiteApp.h"
+#include "EmbedLiteCompositorWidget.h"
+#include "EmbedLiteWindowParent.h"
+#include "EmbedLiteWindowProcessParent.h"
+#include "mozilla/StaticMutex.h"
+#include "mozilla/VsyncDispatcher.h"
 
-#include "VsyncSource.h"
+#include <set>
 
-#include "mozilla/layers/AsyncCompositionManager.h"
-#include "mozilla/layers/BasicCompositor.h"  // for BasicCompositor
-#include "mozilla/layers/CompositorThread.h" // for CompositorThreadHolder
-#include "mozilla/layers/Compositor.h"  // for Compositor
-#include "mozilla/layers/CompositorOGL.h"  // for CompositorOGL
+using namespace mozilla::layers;
 
 namespace mozilla {
 namespace embedlite {
 
-using namespace base;
-using namespace mozilla::ipc;
-using namespace mozilla::gfx;
-using namespace std;
+// Checked on the compositor thread.
+static StaticMutex sContentProcessesMutex;
+static std::set<base::ProcessId> sContentProcesses;
 
-static void
-OpenCompositor(EmbedLiteCompositorProcessParent* aCompositor,
-               Transport* aTransport, ProcessHandle aHandle,
-               MessageLoop* aIOLoop)
+EmbedLiteCompositorProcessParent::EmbedLiteCompositorProcessParent(CompositorManagerParent* aManager,
+                                                                   CSSToLayoutDeviceScale aScale,
+                                                                   const TimeDuration &aVsyncRate,
+                                                                   const CompositorOptions &aOptions,
+                                                                   bool aUseExternalSurfaceSize,
+                                                                   const gfx::IntSize &aSurfaceSize)
+  : EmbedLiteCompositorBridgeParent(aManager, aScale, aVsyncRate, aOptions, aUseExternalSurfaceSize, aSurfaceSize)
 {
   LOGT();
 }
 
-/*static*/ PCompositorBridgeParent*
-EmbedLiteCompositorProcessParent::Create(Transport* aTransport, ProcessId aOtherProcess, int aSurfaceWidth, int aSurfaceHeight, uint32_t id)
-{
-  LOGT();
-
-  gfxPlatform::InitLayersIPC();
-
-  RefPtr<EmbedLiteCompositorProcessParent> cpcp =
-    new EmbedLiteCompositorProcessParent(aTransport, aOtherProcess, aSurfaceWidth, aSurfaceHeight, id);
-  ProcessHandle handle;
-  if (!base::OpenProcessHandle(aOtherProcess, &handle)) {
-    // XXX need to kill |aOtherProcess|, it's boned
-    return nullptr;
-  }
-
-  cpcp->mSelfRef = cpcp;
-  CompositorThread()->Dispatch(
-    NewRunnableFunction("mozilla::embedlite::EmbedLiteAppProcessParent::OpenCompositor",
-                        &OpenCompositor, cpcp.get(),
-                        aTransport, handle, XRE_GetIOMessageLoop()));
-  // The return value is just compared to null for success checking,
-  // we're not sharing a ref.
-  return cpcp.get();
-}
-
-EmbedLiteCompositorProcessParent::EmbedLiteCompositorProcessParent(Transport* aTransport, ProcessId aOtherProcess, int aSurfaceWidth, int aSurfaceHeight, uint32_t id)
-  : CompositorBridgeParent(nullptr,
-                           CSSToLayoutDeviceScale(1.0),
-                           gfxPlatform::GetPlatform()->GetHardwareVsync()->GetGlobalDisplay().GetVsyncRate(),
-                           CompositorOptions(true, false),
-                           true,
-                           IntSize(aSurfaceWidth, aSurfaceHeight))
-  , mTransport(aTransport)
-  , mChildProcessId(aOtherProcess)
-  , mNotifyAfterRemotePaint(false)
+EmbedLiteCompositorProcessParent::~EmbedLiteCompositorProcessParent()
 {
   LOGT();
-  MOZ_ASSERT(NS_IsMainThread());
-  gfxPlatform::GetPlatform();
-}
-
-mozilla::ipc::IPCResult EmbedLiteCompositorProcessParent::RecvRequestNotifyAfterRemotePaint()
-{
-  LOGT("Implement me");
-  mNotifyAfterRemotePaint = true;
-  return IPC_OK();
 }
 
 void
-EmbedLiteCompositorProcessParent::ActorDestroy(ActorDestroyReason aWhy)
+EmbedLiteCompositorProcessParent::AddContentProcess(base::ProcessId aPid)
 {
-  LOGT();
-  MessageLoop::current()->PostTask(
-        NewRunnableMethod("mozilla::embedlite::EmbedLiteCompositorProcessParent::DeferredDestroy",
-                          this, &EmbedLiteCompositorProcessParent::DeferredDestroy));
+  StaticMutexAutoLock lock(sContentProcessesMutex);
+  sContentProcesses.insert(aPid);
 }
 
 void
-EmbedLiteCompositorProcessParent::InitializeLayerManager(const nsTArray<LayersBackend>& aBackendHints)
-{
-  NS_ASSERTION(!mLayerManager, "Already initialised mLayerManager");
-  NS_ASSERTION(!mCompositor,   "Already initialised mCompositor");
-
-  for (size_t i = 0; i < aBackendHints.Length(); ++i) {
-    RefPtr<Compositor> compositor;
-    if (aBackendHints[i] == LayersBackend::LAYERS_OPENGL) {
-      compositor = new CompositorOGL(this,
-                                     nullptr,
-                                     mEGLSurfaceSize.width,
-                                     mEGLSurfaceSize.height,
-                                     true);
-    } else if (aBackendHints[i] == LayersBackend::LAYERS_BASIC) {
-#ifdef MOZ_WIDGET_GTK
-      if (gfxPlatformGtk::GetPlatform()->UseXRender()) {
-        compositor = new X11BasicCompositor(this, nullptr);
-      } else
-#endif
-      {
-        compositor = new BasicCompositor(this, nullptr);
-      }
-#ifdef XP_WIN
-    } else if (aBackendHints[i] == LayersBackend::LAYERS_D3D11) {
-      compositor = new CompositorD3D11(this, nullptr);
-    } else if (aBackendHints[i] == LayersBackend::LAYERS_D3D9) {
-      compositor = new CompositorD3D9(this, nullptr);
-#endif
-    }
-
-    if (!compositor) {
-      // We passed a backend hint for which we can't create a compositor.
-      // For example, we sometime pass LayersBackend::LAYERS_NONE as filler in aBackendHints.
-      continue;
-    }
-
-    RefPtr<LayerManagerComposite> layerManager = new LayerManagerComposite(compositor);
-
-    nsCString failureReason;
-    if (compositor->Initialize(&failureReason)) {
-      if (failureReason.IsEmpty()){
-        failureReason = "SUCCESS";
-      }
-      mLayerManager = layerManager;
-      MOZ_ASSERT(compositor);
-      mCompositor = compositor;
-      return;
-    }
-
-    gfxCriticalNote << "[OPENGL] Failed to init compositor with reason: "
-                    << failureReason.get();
-  }
-}
-
-PLayerTransactionParent*
-EmbedLiteCompositorProcessParent::AllocPLayerTransactionParent(const nsTArray<LayersBackend>& aBackendHints,
-                                                               const LayersId& aId)
+EmbedLiteCompositorProcessParent::RemoveContentProcess(base::ProcessId aPid)
 {
-  LOGT();
-  MOZ_ASSERT(aId != 0);
-
-  InitializeLayerManager(aBackendHints);
-
-  if (!mLayerManager) {
-    NS_WARNING("Failed to initialise Compositor");
-
-    // XXX: should be false, but that causes us to fail some tests on Mac w/ OMTC.
-    // Bug 900745. change *aSuccess to false to see test failures.
-    LayerTransactionParent *p = new LayerTransactionParent(nullptr, this, nullptr, aId, mVsyncRate);
-    p->AddIPDLReference();
-    return p;
-  }
-
-  // Check state etc from CompositorBridgeParent sIndirectLayerTrees
-  // mCompositionManager = new AsyncCompositionManager(mLayerManager);
-  LayerTransactionParent *p = new LayerTransactionParent(nullptr, this, nullptr, aId, mVsyncRate);
-  p->AddIPDLReference();
-  return p;
+  StaticMutexAutoLock lock(sContentProcessesMutex);
+  sContentProcesses.erase(aPid);
 }
 
 bool
-EmbedLiteCompositorProcessParent::DeallocPLayerTransactionParent(PLayerTransactionParent* aLayers)
+EmbedLiteCompositorProcessParent::IsContentProcess(base::ProcessId aPid)
 {
-  LOGT();
-  static_cast<LayerTransactionParent*>(aLayers)->ReleaseIPDLReference();
-  return true;
+  StaticMutexAutoLock lock(sContentProcessesMutex);
+  return aPid && sContentProcesses.count(aPid);
 }
 
 mozilla::ipc::IPCResult
-EmbedLiteCompositorProcessParent::RecvNotifyChildCreated(const LayersId& child, CompositorOptions *aOptions)
+EmbedLiteCompositorProcessParent::RecvInitialize(const LayersId &aRootLayerTreeId)
 {
-  LOGT("Implement me");
-  return IPC_OK();
-}
+  LOGT("root:%" PRIu64, aRootLayerTreeId.mId);
 
-bool
-EmbedLiteCompositorProcessParent::SetTestSampleTime(const LayersId &aId, const TimeStamp& aTime)
-{
-  LOGT("Implement me");
-  Unused << aId;
-  Unused << aTime;
-  return false;
-}
-
-void
-EmbedLiteCompositorProcessParent::LeaveTestMode(const LayersId &aId)
-{
-  LOGT("Implement me");
-  Unused << aId;
-}
-
-void
-EmbedLiteCompositorProcessParent::ApplyAsyncProperties(LayerTransactionParent *aLayerTree, TransformsToSkip aSkip)
-{
-  LOGT("Implement me");
-  LayersId id = aLayerTree->GetId();
-  MOZ_ASSERT(id != 0);
-  Unused << id;
-}
-
-void
-EmbedLiteCompositorProcessParent::FlushApzRepaints(const LayersId &aLayersId)
-{
-  LOGT("Implement me");
-  Unused << aLayersId;
-}
+  uint32_t windowId = 0;
+  RefPtr<CompositorVsyncDispatcher> vsyncDispatcher;
+  if (!EmbedLiteWindowProcessParent::GetLayerTree(aRootLayerTreeId, &windowId, &vsyncDispatcher)) {
+    return IPC_FAIL(this, "Unknown root layer tree");
+  }
 
-void
-EmbedLiteCompositorProcessParent::GetAPZTestData(const LayersId &aLayersId,
-                                                 APZTestData* aOutData)
-{
-  LOGT("Implement me");
-  Unused << aLayersId;
-  Unused << aOutData;
-}
+  mWindowId = windowId;
+  mCompositorWidget = new EmbedLiteCompositorWidget(GetOptions(), this, windowId, vsyncDispatcher);
+  mWidget = mCompositorWidget;
 
-void
-EmbedLiteCompositorProcessParent::SetConfirmedTargetAPZC(const LayersId &aLayersId, const uint64_t &aInputBlockId, const nsTArray<ScrollableLayerGuid> &aTargets)
-{
-  LOGT("Implement me");
-  Unused << aLayersId;
-  Unused << aInputBlockId;
-  Unused << aTargets;
-}
+  mozilla::ipc::IPCResult result = EmbedLiteCompositorBridgeParent::RecvInitialize(aRootLayerTreeId);
 
-AsyncCompositionManager*
-EmbedLiteCompositorProcessParent::GetCompositionManager(LayerTransactionParent* aLayerTree)
-{
-  LOGT("Implement me");
-  LayersId id = aLayerTree->GetId();
-  MOZ_ASSERT(id != 0);
-  Unused << id;
-  return nullptr;
+  // The window and its views live on the UI thread.
+  EmbedLiteApp::GetInstance()->GetUILoop()->PostTask(
+      NewRunnableMethod("mozilla::embedlite::EmbedLiteCompositorProcessParent::AttachWidgetToWindow",
+                        this, &EmbedLiteCompositorProcessParent::AttachWidgetToWindow));
+  return result;
 }
 
 void
-EmbedLiteCompositorProcessParent::DeferredDestroy()
+EmbedLiteCompositorProcessParent::AttachWidgetToWindow()
 {
-  LOGT();
-  mSelfRef = nullptr;
-}
+  AttachToWindow();
 
-EmbedLiteCompositorProcessParent::~EmbedLiteCompositorProcessParent()
-{
-  LOGT();
-  MOZ_ASSERT(NS_IsMainThread());
-  MOZ_ASSERT(XRE_GetIOMessageLoop());
-  RefPtr<DeleteTask<Transport>> task = new DeleteTask<Transport>(mTransport);
-  XRE_GetIOMessageLoop()->PostTask(task.forget());
+  EmbedLiteWindowParent *parentWindow = EmbedLiteWindowParent::From(mWindowId);
+  NS_ENSURE_TRUE(parentWindow, );
+  mCompositorWidget->SetListener(parentWindow->GetListener());
 }
 
 } // namespace embedlite
 } // namespace mozilla
-
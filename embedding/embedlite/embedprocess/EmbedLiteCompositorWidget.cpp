@@ -0,0 +1,85 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLiteCompositorWidget.h"
+#include "EmbedLiteCompositorBridgeParent.h"
+#include "EmbedLiteWindow.h"
+#include "mozilla/VsyncDispatcher.h"
+
+using namespace mozilla::layers;
+using namespace mozilla::widget;
+
+namespace mozilla {
+namespace embedlite {
+
+EmbedLiteCompositorWidget::EmbedLiteCompositorWidget(const CompositorOptions &aOptions,
+                                                     EmbedLiteCompositorBridgeParent *aCompositor,
+                                                     uint32_t aWindowId,
+                                                     CompositorVsyncDispatcher *aVsyncDispatcher)
+  : CompositorWidget(aOptions)
+  , mCompositor(aCompositor)
+  , mWindowId(aWindowId)
+  , mListener(nullptr)
+  , mVsyncDispatcher(aVsyncDispatcher)
+{
+  LOGT("window:%u", aWindowId);
+}
+
+EmbedLiteCompositorWidget::~EmbedLiteCompositorWidget()
+{
+  LOGT();
+}
+
+bool
+EmbedLiteCompositorWidget::PreRender(WidgetRenderingContext *aContext)
+{
+  // Visibility is not known here, the embedder suspends rendering instead.
+  EmbedLiteWindowListener *listener = mListener;
+  return listener && listener->PreRender();
+}
+
+void
+EmbedLiteCompositorWidget::PostRender(WidgetRenderingContext *aContext)
+{
+  mCompositor->PresentOffscreenSurface();
+
+  EmbedLiteWindowListener *listener = mListener;
+  if (listener) {
+    listener->CompositingFinished();
+  }
+}
+
+already_AddRefed<gfx::DrawTarget>
+EmbedLiteCompositorWidget::StartRemoteDrawingInRegion(LayoutDeviceIntRegion &aInvalidRegion,
+                                                      BufferMode *aBufferMode)
+{
+  // See nsWindow::StartRemoteDrawingInRegion.
+  *aBufferMode = BufferMode::BUFFER_NONE;
+  return mCompositor->StartSoftwareDrawing();
+}
+
+void
+EmbedLiteCompositorWidget::EndRemoteDrawingInRegion(gfx::DrawTarget *aDrawTarget,
+                                                    const LayoutDeviceIntRegion &aInvalidRegion)
+{
+  mCompositor->EndSoftwareDrawing();
+}
+
+LayoutDeviceIntSize
+EmbedLiteCompositorWidget::GetClientSize()
+{
+  return LayoutDeviceIntSize::FromUnknownSize(mCompositor->GetSurfaceSize());
+}
+
+void
+EmbedLiteCompositorWidget::ObserveVsync(VsyncObserver *aObserver)
+{
+  mVsyncDispatcher->SetCompositorVsyncObserver(aObserver);
+}
+
+} // namespace embedlite
+} // namespace mozilla
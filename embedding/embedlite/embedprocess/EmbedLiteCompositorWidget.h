@@ -0,0 +1,60 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_COMPOSITOR_WIDGET_H
+#define MOZ_EMBED_LITE_COMPOSITOR_WIDGET_H
+
+#include "mozilla/Atomics.h"
+#include "mozilla/widget/CompositorWidget.h"
+
+namespace mozilla {
+class CompositorVsyncDispatcher;
+
+namespace embedlite {
+
+class EmbedLiteCompositorBridgeParent;
+class EmbedLiteWindowListener;
+
+// What nsWindow does for the compositor in thread mode, for a window whose
+// widget lives in the content process. There is no nsIWidget on this side.
+class EmbedLiteCompositorWidget final : public mozilla::widget::CompositorWidget
+{
+public:
+  EmbedLiteCompositorWidget(const layers::CompositorOptions &aOptions,
+                            EmbedLiteCompositorBridgeParent *aCompositor,
+                            uint32_t aWindowId,
+                            CompositorVsyncDispatcher *aVsyncDispatcher);
+
+  // UI thread, once the window of mWindowId is known. Nothing is rendered
+  // before that.
+  void SetListener(EmbedLiteWindowListener *aListener) { mListener = aListener; }
+
+  bool PreRender(mozilla::widget::WidgetRenderingContext *aContext) override;
+  void PostRender(mozilla::widget::WidgetRenderingContext *aContext) override;
+  already_AddRefed<gfx::DrawTarget> StartRemoteDrawingInRegion(LayoutDeviceIntRegion &aInvalidRegion,
+                                                               layers::BufferMode *aBufferMode) override;
+  void EndRemoteDrawingInRegion(gfx::DrawTarget *aDrawTarget,
+                                const LayoutDeviceIntRegion &aInvalidRegion) override;
+  LayoutDeviceIntSize GetClientSize() override;
+  void ObserveVsync(VsyncObserver *aObserver) override;
+  nsIWidget *RealWidget() override { return nullptr; }
+  uintptr_t GetWidgetKey() override { return mWindowId; }
+
+private:
+  virtual ~EmbedLiteCompositorWidget();
+
+  // Owns this.
+  EmbedLiteCompositorBridgeParent *mCompositor;
+  uint32_t mWindowId;
+  // Resolved on the UI thread, the window map must not be read from the
+  // compositor thread. Outlives the compositor like in thread mode.
+  Atomic<EmbedLiteWindowListener*> mListener;
+  RefPtr<CompositorVsyncDispatcher> mVsyncDispatcher;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_COMPOSITOR_WIDGET_H
@@ -0,0 +1,404 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLiteContentProcessManager.h"
+#include "EmbedLiteAppProcessParent.h"
+#include "GeckoLoader.h"
+#include "mozilla/Unused.h"
+
+namespace mozilla {
+namespace embedlite {
+
+// Leave the UI thread and the new process alone while a window starts up,
+// the launch then waits for an idle period.
+static const int kSpareLaunchDelay = 1000;
+
+EmbedLiteContentProcessManager::EmbedLiteContentProcessManager(EmbedLiteApp* aApp)
+  : mApp(aApp)
+  , mPolicy(EmbedLiteProcessPolicy::Shared)
+  , mSpareCount(0)
+  , mSpareLaunchPending(false)
+  , mAppInitialized(false)
+  , mShuttingDown(false)
+{
+  MOZ_COUNT_CTOR(EmbedLiteContentProcessManager);
+}
+
+EmbedLiteContentProcessManager::~EmbedLiteContentProcessManager()
+{
+  MOZ_COUNT_DTOR(EmbedLiteContentProcessManager);
+  MOZ_ASSERT(mProcesses.IsEmpty() && mSpares.IsEmpty() && mClosing.IsEmpty());
+}
+
+bool
+EmbedLiteContentProcessManager::Start()
+{
+  LOGT();
+  // The UI thread becomes the main thread of this process. Compositing
+  // and APZ of the content processes happen here, they need XPCOM and gfx
+  // but no profile.
+  if (!GeckoLoader::InitEmbedding(nullptr)) {
+    LOGE("Failed to initialize XPCOM");
+    return false;
+  }
+
+  UpdatePrimary();
+  return !!GetPrimary();
+}
+
+void
+EmbedLiteContentProcessManager::Shutdown()
+{
+  LOGT("processes:%zu spares:%zu", mProcesses.Length(), mSpares.Length());
+  mShuttingDown = true;
+  mWindows.clear();
+  mApp->mAppParent = nullptr;
+  // Spares still launching are closed by ProcessLaunched.
+  for (auto& process : mProcesses) {
+    CloseProcess(process);
+  }
+  for (auto& spare : mSpares) {
+    CloseProcess(spare);
+  }
+  mProcesses.Clear();
+  mSpares.Clear();
+  if (mClosing.IsEmpty()) {
+    mApp->ChildReadyToDestroy();
+  }
+}
+
+void
+EmbedLiteContentProcessManager::SetPolicy(EmbedLiteProcessPolicy aPolicy, uint32_t aSpareProcesses)
+{
+  LOGT("policy:%u spares:%u", uint32_t(aPolicy), aSpareProcesses);
+  mPolicy = aPolicy;
+  mSpareCount = aSpareProcesses;
+  while (mSpares.Length() > mSpareCount) {
+    RefPtr<EmbedLiteAppProcessParent> spare = mSpares.PopLastElement();
+    CloseProcess(spare);
+  }
+  ScheduleSpareLaunch();
+}
+
+EmbedLiteAppProcessParent*
+EmbedLiteContentProcessManager::GetPrimary() const
+{
+  return mProcesses.IsEmpty() ? nullptr : mProcesses[0].get();
+}
+
+EmbedLiteAppProcessParent*
+EmbedLiteContentProcessManager::GetPrimaryProcess()
+{
+  EmbedLiteApp* app = EmbedLiteApp::GetInstance();
+  return app && app->mProcessManager ? app->mProcessManager->GetPrimary() : nullptr;
+}
+
+EmbedLiteAppProcessParent*
+EmbedLiteContentProcessManager::AssignWindow(uint32_t aWindowId)
+{
+  EmbedLiteAppProcessParent* process = nullptr;
+  if (mPolicy == EmbedLiteProcessPolicy::Shared) {
+    process = GetPrimary();
+  } else {
+    // The primary process starts without windows.
+    for (auto& candidate : mProcesses) {
+      if (!WindowCount(candidate)) {
+        process = candidate;
+        break;
+      }
+    }
+  }
+
+  if (!process) {
+    process = ClaimProcess();
+  }
+
+  if (process) {
+    mWindows[aWindowId] = process;
+    mApp->PriorityStateChanged();
+  }
+  LOGT("window:%u process:%d", aWindowId, process ? int(process->OtherPid()) : 0);
+  return process;
+}
+
+EmbedLiteAppProcessParent*
+EmbedLiteContentProcessManager::GetWindowProcess(uint32_t aWindowId) const
+{
+  auto it = mWindows.find(aWindowId);
+  return it != mWindows.end() ? it->second : nullptr;
+}
+
+void
+EmbedLiteContentProcessManager::WindowDestroyed(uint32_t aWindowId)
+{
+  auto it = mWindows.find(aWindowId);
+  if (it == mWindows.end()) {
+    return;
+  }
+
+  EmbedLiteAppProcessParent* process = it->second;
+  mWindows.erase(it);
+  mApp->PriorityStateChanged();
+  // Processes of their own go with their last window, the primary one
+  // stays for the app wide messages.
+  if (mPolicy == EmbedLiteProcessPolicy::PerWindow && process != GetPrimary() &&
+      !WindowCount(process)) {
+    LOGT("shutting down process:%d", int(process->OtherPid()));
+    RefPtr<EmbedLiteAppProcessParent> kungFuDeathGrip(process);
+    mProcesses.RemoveElement(process);
+    CloseProcess(process);
+  }
+}
+
+void
+EmbedLiteContentProcessManager::ForEachProcess(const std::function<void(EmbedLiteAppProcessParent*)>& aCallback)
+{
+  for (auto& process : mProcesses) {
+    aCallback(process);
+  }
+  for (auto& spare : mSpares) {
+    if (spare->IsLaunched()) {
+      aCallback(spare);
+    }
+  }
+}
+
+void
+EmbedLiteContentProcessManager::RecordPrefs(const nsTArray<EmbedPref>& aPrefs)
+{
+  for (const EmbedPref& pref : aPrefs) {
+    auto it = mPrefs.find(pref.name());
+    if (it != mPrefs.end()) {
+      it->second = pref;
+    } else {
+      mPrefs.insert(std::make_pair(pref.name(), pref));
+    }
+  }
+}
+
+void
+EmbedLiteContentProcessManager::RecordManifest(const nsACString& aManifest)
+{
+  mManifests.AppendElement(aManifest);
+}
+
+void
+EmbedLiteContentProcessManager::RecordStyleSheet(const nsACString& aUri, bool aEnable)
+{
+  if (aEnable) {
+    mStyleSheets[nsCString(aUri)] = true;
+  } else {
+    mStyleSheets.erase(nsCString(aUri));
+  }
+}
+
+void
+EmbedLiteContentProcessManager::RecordObserver(const nsACString& aTopic, bool aAdd)
+{
+  if (aAdd) {
+    mObservers.insert(nsCString(aTopic));
+  } else {
+    mObservers.erase(nsCString(aTopic));
+  }
+}
+
+void
+EmbedLiteContentProcessManager::RecordObserverPolicy(const nsACString& aTopic, uint32_t aPolicy, uint32_t aWindowMs)
+{
+  mObserverPolicies[nsCString(aTopic)] = { aPolicy, aWindowMs };
+}
+
+void
+EmbedLiteContentProcessManager::ProcessLaunched(EmbedLiteAppProcessParent* aProcess)
+{
+  LOGT("pid:%d", int(aProcess->OtherPid()));
+  if (mClosing.Contains(aProcess)) {
+    // Not wanted anymore while it was launching.
+    Unused << aProcess->SendPreDestroy();
+    return;
+  }
+
+  // Queued behind the initialization of the child. Prefs go one by one,
+  // SetPrefs rejects a batch as a whole.
+  for (const auto& pair : mPrefs) {
+    AutoTArray<EmbedPref, 1> prefs;
+    prefs.AppendElement(pair.second);
+    Unused << aProcess->SendSetPrefs(prefs);
+  }
+  for (const nsCString& manifest : mManifests) {
+    Unused << aProcess->SendLoadComponentManifest(manifest);
+  }
+  for (const auto& pair : mStyleSheets) {
+    Unused << aProcess->SendLoadGlobalStyleSheet(pair.first, true);
+  }
+  if (!mObservers.empty()) {
+    nsTArray<nsCString> observers;
+    for (const nsCString& topic : mObservers) {
+      observers.AppendElement(topic);
+    }
+    Unused << aProcess->SendAddObservers(observers);
+  }
+  for (const auto& pair : mObserverPolicies) {
+    Unused << aProcess->SendSetObserverPolicy(pair.first, pair.second.mPolicy, pair.second.mWindowMs);
+  }
+  // Spares wait in the background.
+  mApp->PriorityStateChanged();
+}
+
+void
+EmbedLiteContentProcessManager::ProcessInitialized(EmbedLiteAppProcessParent* aProcess)
+{
+  LOGT("pid:%d", int(aProcess->OtherPid()));
+  if (!mAppInitialized && aProcess == GetPrimary()) {
+    mAppInitialized = true;
+    mApp->Initialized();
+    ScheduleSpareLaunch();
+  }
+}
+
+void
+EmbedLiteContentProcessManager::ProcessDestroyed(EmbedLiteAppProcessParent* aProcess, bool aCrashed)
+{
+  LOGT("pid:%d crashed:%d", int(aProcess->OtherPid()), aCrashed);
+  if (aCrashed) {
+    LOGE("Content process %d crashed", int(aProcess->OtherPid()));
+  }
+
+  for (auto it = mWindows.begin(); it != mWindows.end();) {
+    if (it->second == aProcess) {
+      it = mWindows.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  bool wasPrimary = aProcess == GetPrimary();
+  // A failed launch is reported by WaitForLaunch and the launch promise.
+  bool known = mProcesses.RemoveElement(aProcess);
+  known |= mSpares.RemoveElement(aProcess);
+  known |= mClosing.RemoveElement(aProcess);
+  if (!known) {
+    return;
+  }
+
+  if (mShuttingDown) {
+    if (mClosing.IsEmpty()) {
+      mApp->ChildReadyToDestroy();
+    }
+    return;
+  }
+
+  if (wasPrimary) {
+    UpdatePrimary();
+  }
+  ScheduleSpareLaunch();
+  mApp->PriorityStateChanged();
+}
+
+EmbedLiteAppProcessParent*
+EmbedLiteContentProcessManager::ClaimProcess()
+{
+  RefPtr<EmbedLiteAppProcessParent> process;
+  while (!process && !mSpares.IsEmpty()) {
+    // The oldest spare is the most likely to be running already.
+    process = mSpares[0];
+    mSpares.RemoveElementAt(0);
+    mProcesses.AppendElement(process);
+    if (!process->WaitForLaunch()) {
+      mProcesses.RemoveElement(process);
+      process = nullptr;
+    }
+  }
+
+  if (!process) {
+    LOGT("no spare process, launching one");
+    process = EmbedLiteAppProcessParent::Launch(this);
+    if (process) {
+      mProcesses.AppendElement(process);
+      if (!process->WaitForLaunch()) {
+        mProcesses.RemoveElement(process);
+        process = nullptr;
+      }
+    }
+  }
+
+  ScheduleSpareLaunch();
+  // Owned by mProcesses.
+  return process.get();
+}
+
+void
+EmbedLiteContentProcessManager::UpdatePrimary()
+{
+  if (mProcesses.IsEmpty()) {
+    ClaimProcess();
+  }
+  mApp->mAppParent = GetPrimary();
+}
+
+uint32_t
+EmbedLiteContentProcessManager::WindowCount(EmbedLiteAppProcessParent* aProcess) const
+{
+  uint32_t count = 0;
+  for (const auto& pair : mWindows) {
+    if (pair.second == aProcess) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void
+EmbedLiteContentProcessManager::CloseProcess(EmbedLiteAppProcessParent* aProcess)
+{
+  if (mClosing.Contains(aProcess)) {
+    return;
+  }
+
+  mClosing.AppendElement(aProcess);
+  if (aProcess->IsLaunched()) {
+    Unused << aProcess->SendPreDestroy();
+  }
+}
+
+void
+EmbedLiteContentProcessManager::ScheduleSpareLaunch()
+{
+  if (mSpareLaunchPending || !mAppInitialized || mShuttingDown ||
+      mSpares.Length() >= mSpareCount) {
+    return;
+  }
+
+  mSpareLaunchPending = true;
+  mApp->ScheduleTask(EmbedLiteTaskPriority::Idle, &EmbedLiteContentProcessManager::LaunchSpare,
+                     kSpareLaunchDelay);
+}
+
+void
+EmbedLiteContentProcessManager::LaunchSpare()
+{
+  // The manager may be gone by now.
+  EmbedLiteContentProcessManager* manager = EmbedLiteApp::GetInstance()->mProcessManager;
+  if (!manager) {
+    return;
+  }
+
+  manager->mSpareLaunchPending = false;
+  if (manager->mShuttingDown || manager->mSpares.Length() >= manager->mSpareCount) {
+    return;
+  }
+
+  // One at a time, each one is a whole Gecko starting up.
+  RefPtr<EmbedLiteAppProcessParent> spare = EmbedLiteAppProcessParent::Launch(manager);
+  if (spare) {
+    manager->mSpares.AppendElement(spare);
+  }
+  manager->ScheduleSpareLaunch();
+}
+
+} // namespace embedlite
+} // namespace mozilla
@@ -0,0 +1,103 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_CONTENT_PROCESS_MANAGER_H
+#define MOZ_EMBED_LITE_CONTENT_PROCESS_MANAGER_H
+
+#include "mozilla/embedlite/EmbedLiteApp.h"
+#include "mozilla/embedlite/PEmbedLiteApp.h"
+#include "nsTArray.h"
+
+#include <functional>
+#include <map>
+#include <set>
+
+namespace mozilla {
+namespace embedlite {
+
+class EmbedLiteAppProcessParent;
+
+// Content processes of EMBED_PROCESS. Windows are assigned to a process
+// when they are created, see EmbedLiteProcessPolicy. Spare processes are
+// launched in the background and get the content wide state EmbedLiteApp
+// has set so far, so that they can take a window right away.
+class EmbedLiteContentProcessManager
+{
+public:
+  explicit EmbedLiteContentProcessManager(EmbedLiteApp* aApp);
+  ~EmbedLiteContentProcessManager();
+
+  // Initializes XPCOM of this process and launches the primary process,
+  // EmbedLiteApp is initialized once it is up.
+  bool Start();
+  // Asks every process to shut down, EmbedLiteApp::ChildReadyToDestroy
+  // follows when the last one is gone.
+  void Shutdown();
+
+  void SetPolicy(EmbedLiteProcessPolicy aPolicy, uint32_t aSpareProcesses);
+
+  EmbedLiteAppProcessParent* GetPrimary() const;
+  // GetPrimary of the manager of EmbedLiteApp, null outside EMBED_PROCESS.
+  static EmbedLiteAppProcessParent* GetPrimaryProcess();
+  // Picks the process for a new window by the policy.
+  EmbedLiteAppProcessParent* AssignWindow(uint32_t aWindowId);
+  // Null if the process of the window crashed.
+  EmbedLiteAppProcessParent* GetWindowProcess(uint32_t aWindowId) const;
+  void WindowDestroyed(uint32_t aWindowId);
+
+  // Launched processes only, the others are brought up to date by
+  // ProcessLaunched.
+  void ForEachProcess(const std::function<void(EmbedLiteAppProcessParent*)>& aCallback);
+
+  // Content wide state, replayed to every process launched later.
+  void RecordPrefs(const nsTArray<EmbedPref>& aPrefs);
+  void RecordManifest(const nsACString& aManifest);
+  void RecordStyleSheet(const nsACString& aUri, bool aEnable);
+  void RecordObserver(const nsACString& aTopic, bool aAdd);
+  void RecordObserverPolicy(const nsACString& aTopic, uint32_t aPolicy, uint32_t aWindowMs);
+
+  // Notifications of EmbedLiteAppProcessParent.
+  void ProcessLaunched(EmbedLiteAppProcessParent* aProcess);
+  void ProcessInitialized(EmbedLiteAppProcessParent* aProcess);
+  void ProcessDestroyed(EmbedLiteAppProcessParent* aProcess, bool aCrashed);
+
+private:
+  struct ObserverPolicy {
+    uint32_t mPolicy;
+    uint32_t mWindowMs;
+  };
+
+  EmbedLiteAppProcessParent* ClaimProcess();
+  // Sets EmbedLiteApp::mAppParent, launching a process if there is none.
+  void UpdatePrimary();
+  uint32_t WindowCount(EmbedLiteAppProcessParent* aProcess) const;
+  // Asks aProcess to shut down, it is kept until its channel is closed.
+  void CloseProcess(EmbedLiteAppProcessParent* aProcess);
+  void ScheduleSpareLaunch();
+  static void LaunchSpare();
+
+  EmbedLiteApp* mApp;
+  EmbedLiteProcessPolicy mPolicy;
+  uint32_t mSpareCount;
+  // Processes with windows, the primary first.
+  nsTArray<RefPtr<EmbedLiteAppProcessParent>> mProcesses;
+  nsTArray<RefPtr<EmbedLiteAppProcessParent>> mSpares;
+  nsTArray<RefPtr<EmbedLiteAppProcessParent>> mClosing;
+  std::map<uint32_t, EmbedLiteAppProcessParent*> mWindows;
+  bool mSpareLaunchPending;
+  bool mAppInitialized;
+  bool mShuttingDown;
+
+  std::map<nsCString, EmbedPref> mPrefs;
+  nsTArray<nsCString> mManifests;
+  std::map<nsCString, bool> mStyleSheets;
+  std::set<nsCString> mObservers;
+  std::map<nsCString, ObserverPolicy> mObserverPolicies;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_CONTENT_PROCESS_MANAGER_H
@@ -25,9 +25,6 @@ public:
                                          const bool &isPrivateWindow,
                                          const bool &isDesktopMode);
 
-protected:
-  virtual void OnGeckoWindowInitialized();
-
 private:
   virtual ~EmbedLiteViewProcessChild();
 
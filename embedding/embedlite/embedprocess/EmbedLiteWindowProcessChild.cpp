@@ -0,0 +1,26 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLiteWindowProcessChild.h"
+
+namespace mozilla {
+namespace embedlite {
+
+EmbedLiteWindowProcessChild::EmbedLiteWindowProcessChild(const uint16_t &width, const uint16_t &height, const uint32_t &id)
+  : EmbedLiteWindowChild(width, height, id, nullptr)
+{
+  LOGT();
+  mRemoteCompositor = true;
+}
+
+EmbedLiteWindowProcessChild::~EmbedLiteWindowProcessChild()
+{
+  LOGT();
+}
+
+} // namespace embedlite
+} // namespace mozilla
@@ -0,0 +1,30 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_WINDOW_EMBED_PROCESS_CHILD_H
+#define MOZ_WINDOW_EMBED_PROCESS_CHILD_H
+
+#include "EmbedLiteWindowChild.h"
+
+namespace mozilla {
+namespace embedlite {
+
+// The widget is created once RecvInitCompositor has told which layer tree
+// of the UI process it composites to.
+class EmbedLiteWindowProcessChild : public EmbedLiteWindowChild
+{
+public:
+  EmbedLiteWindowProcessChild(const uint16_t &width, const uint16_t &height, const uint32_t &id);
+
+protected:
+  virtual ~EmbedLiteWindowProcessChild();
+
+  DISALLOW_EVIL_CONSTRUCTORS(EmbedLiteWindowProcessChild);
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_WINDOW_EMBED_PROCESS_CHILD_H
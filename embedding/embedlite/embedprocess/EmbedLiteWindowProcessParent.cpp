@@ -0,0 +1,77 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLiteWindowProcessParent.h"
+#include "mozilla/StaticMutex.h"
+#include "mozilla/Unused.h"
+#include "mozilla/VsyncDispatcher.h"
+#include "mozilla/gfx/GPUProcessManager.h"
+
+#include <map>
+
+using namespace mozilla::gfx;
+using namespace mozilla::layers;
+
+namespace mozilla {
+namespace embedlite {
+
+namespace {
+
+struct LayerTree
+{
+  uint32_t mWindowId;
+  RefPtr<CompositorVsyncDispatcher> mVsyncDispatcher;
+};
+
+static StaticMutex sLayerTreeMutex;
+static std::map<LayersId, LayerTree> sLayerTrees;
+
+} // namespace
+
+EmbedLiteWindowProcessParent::EmbedLiteWindowProcessParent(const uint16_t &width, const uint16_t &height, const uint32_t &id, EmbedLiteWindowListener *aListener)
+  : EmbedLiteWindowParent(width, height, id, aListener)
+  , mRootLayerTreeId(GPUProcessManager::Get()->AllocateLayerTreeId())
+  , mVsyncDispatcher(new CompositorVsyncDispatcher())
+{
+  LOGT("id:%u root:%" PRIu64, id, mRootLayerTreeId.mId);
+  StaticMutexAutoLock lock(sLayerTreeMutex);
+  sLayerTrees[mRootLayerTreeId] = LayerTree { id, mVsyncDispatcher };
+}
+
+EmbedLiteWindowProcessParent::~EmbedLiteWindowProcessParent()
+{
+  LOGT();
+  {
+    StaticMutexAutoLock lock(sLayerTreeMutex);
+    sLayerTrees.erase(mRootLayerTreeId);
+  }
+  mVsyncDispatcher->Shutdown();
+}
+
+void
+EmbedLiteWindowProcessParent::InitCompositor()
+{
+  Unused << SendInitCompositor(mRootLayerTreeId, GPUProcessManager::Get()->AllocateNamespace());
+}
+
+bool
+EmbedLiteWindowProcessParent::GetLayerTree(const LayersId &aRootLayerTreeId,
+                                           uint32_t *aWindowId,
+                                           RefPtr<CompositorVsyncDispatcher> *aVsyncDispatcher)
+{
+  StaticMutexAutoLock lock(sLayerTreeMutex);
+  std::map<LayersId, LayerTree>::const_iterator it = sLayerTrees.find(aRootLayerTreeId);
+  if (it == sLayerTrees.end()) {
+    return false;
+  }
+  *aWindowId = it->second.mWindowId;
+  *aVsyncDispatcher = it->second.mVsyncDispatcher;
+  return true;
+}
+
+} // namespace embedlite
+} // namespace mozilla
@@ -0,0 +1,47 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_WINDOW_EMBED_PROCESS_PARENT_H
+#define MOZ_WINDOW_EMBED_PROCESS_PARENT_H
+
+#include "EmbedLiteWindowParent.h"
+#include "mozilla/layers/LayersTypes.h"
+
+namespace mozilla {
+class CompositorVsyncDispatcher;
+
+namespace embedlite {
+
+// The compositor of an out of process window lives in this process. Its
+// root layer tree is allocated here, the widget in the content process
+// connects to it, see EmbedLiteCompositorProcessParent::RecvInitialize.
+class EmbedLiteWindowProcessParent : public EmbedLiteWindowParent
+{
+public:
+  EmbedLiteWindowProcessParent(const uint16_t &width, const uint16_t &height, const uint32_t &id, EmbedLiteWindowListener *aListener);
+
+  // Sends the root layer tree to the child, right after construction.
+  void InitCompositor();
+
+  // Window and vsync source of a root layer tree allocated by
+  // InitCompositor. Callable from the compositor thread.
+  static bool GetLayerTree(const mozilla::layers::LayersId &aRootLayerTreeId,
+                           uint32_t *aWindowId,
+                           RefPtr<CompositorVsyncDispatcher> *aVsyncDispatcher);
+
+protected:
+  virtual ~EmbedLiteWindowProcessParent() override;
+
+private:
+  mozilla::layers::LayersId mRootLayerTreeId;
+  RefPtr<CompositorVsyncDispatcher> mVsyncDispatcher;
+
+  DISALLOW_EVIL_CONSTRUCTORS(EmbedLiteWindowProcessParent);
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_WINDOW_EMBED_PROCESS_PARENT_H
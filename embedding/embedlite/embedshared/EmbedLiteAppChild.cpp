@@ -16,20 +16,28 @@
 #include "nsIPrefBranch.h"
 #include "nsIPrefService.h"
 #include "nsIWindowWatcher.h"
+#include "nsIWebBrowserChrome.h"
 #include "WindowCreator.h"
 #include "nsIURI.h"
 #include "nsIStyleSheetService.h"
 #include "nsNetUtil.h"
 #include "gfxPlatform.h"
+#include "nsJSEnvironment.h"
 
 #include "EmbedLiteViewThreadChild.h"
 #include "EmbedLiteWindowThreadChild.h"
+#include "mozilla/Preferences.h"
+#include "mozilla/RemoteDecoderManagerChild.h"
 #include "mozilla/Unused.h"
+#include "mozilla/dom/BrowsingContext.h"
+#include "mozilla/gfx/VRManagerChild.h"
+#include "mozilla/layers/CompositorManagerChild.h"
 #include "mozilla/layers/ImageBridgeChild.h"
 
 using namespace base;
 using namespace mozilla::ipc;
 using namespace mozilla::layers;
+using mozilla::dom::PrefValue;
 
 namespace mozilla {
 namespace embedlite {
@@ -39,6 +47,13 @@ NS_GENERIC_FACTORY_CONSTRUCTOR(EmbedLiteAppService)
 
 static EmbedLiteAppChild* sAppBaseChild = nullptr;
 
+static void
+IPCTracePrefChanged(const char* aPref, void* aClosure)
+{
+  EmbedLiteIPCTrace::SetBufferSize(Preferences::GetUint("embedlite.ipc.trace.buffer_size", 16384));
+  EmbedLiteIPCTrace::SetEnabled(Preferences::GetBool("embedlite.ipc.trace.enabled", false));
+}
+
 EmbedLiteAppChild*
 EmbedLiteAppChild::GetInstance()
 {
@@ -47,6 +62,7 @@ EmbedLiteAppChild::GetInstance()
 
 EmbedLiteAppChild::EmbedLiteAppChild(MessageLoop* aParentLoop)
   : mParentLoop(aParentLoop)
+  , mObserverFilter(this)
 {
   LOGT();
   sAppBaseChild = this;
@@ -66,7 +82,7 @@ EmbedLiteAppChild::Observe(nsISupports* aSubject,
                            const char16_t* aData)
 {
   LOGF("topic:%s", aTopic);
-  Unused << SendObserve(nsDependentCString(aTopic), aData ? nsDependentString(aData) : nsString());
+  mObserverFilter.Notify(nsDependentCString(aTopic), aData ? nsDependentString(aData) : nsString());
   return NS_OK;
 }
 
@@ -77,6 +93,7 @@ EmbedLiteAppChild::Init(MessageChannel* aParentChannel)
   InitWindowWatcher();
   Open(aParentChannel, mParentLoop, ipc::ChildSide);
   RecvSetBoolPref(nsDependentCString("layers.offmainthreadcomposition.enabled"), true);
+  Preferences::RegisterPrefixCallbackAndCall(IPCTracePrefChanged, "embedlite.ipc.trace.");
 
   mozilla::DebugOnly<nsresult> rv = InitAppService();
   MOZ_ASSERT(NS_SUCCEEDED(rv));
@@ -153,20 +170,19 @@ void
 EmbedLiteAppChild::ActorDestroy(ActorDestroyReason aWhy)
 {
   LOGT("reason:%i", aWhy);
+  mObserverFilter.Shutdown();
+  Preferences::UnregisterPrefixCallback(IPCTracePrefChanged, "embedlite.ipc.trace.");
 }
 
 bool
 EmbedLiteAppChild::DeallocPEmbedLiteViewChild(PEmbedLiteViewChild* actor)
 {
   LOGT();
-  std::map<uint32_t, EmbedLiteViewChild*>::iterator it;
-  for (it = mWeakViewMap.begin(); it != mWeakViewMap.end(); ++it) {
-    if (actor == it->second) {
-      mWeakViewMap.erase(it);
-      break;
-    }
-  }
   EmbedLiteViewChild* p = static_cast<EmbedLiteViewChild*>(actor);
+  if (mViews.Get(p->GetID()) == p) {
+    mViews.Remove(p->GetID());
+    mActiveViews.erase(p->GetID());
+  }
   p->Release();
   return true;
 }
@@ -175,61 +191,124 @@ bool
 EmbedLiteAppChild::DeallocPEmbedLiteWindowChild(PEmbedLiteWindowChild* aActor)
 {
   LOGT();
-  std::map<uint32_t, EmbedLiteWindowChild*>::iterator it;
-  for (it = mWeakWindowMap.begin(); it != mWeakWindowMap.end(); ++it) {
-    if (aActor == it->second) {
-      mWeakWindowMap.erase(it);
-      break;
-    }
-  }
   EmbedLiteWindowChild* w = static_cast<EmbedLiteWindowChild*>(aActor);
+  if (mWindows.Get(w->GetUniqueID()) == w) {
+    mWindows.Remove(w->GetUniqueID());
+  }
   w->Release();
   return true;
 }
 
-bool EmbedLiteAppChild::CreateWindow(const uint32_t &parentId,
-                                     const uintptr_t &parentBrowsingContext,
-                                     const uint32_t &chromeFlags,
-                                     uint32_t *createdID,
-                                     bool *cancel)
+EmbedLiteViewChildIface*
+EmbedLiteAppChild::CreateWindow(const uint32_t &parentId,
+                                const uintptr_t &parentBrowsingContext,
+                                const uint32_t &chromeFlags)
 {
-  return SendCreateWindow(parentId, parentBrowsingContext, chromeFlags, createdID, cancel);
+  // The new view shares the window of its opener.
+  EmbedLiteViewChild* parent = mViews.Get(parentId);
+  EmbedLiteWindowChild* window = parent ? parent->mWindow : nullptr;
+  if (!window && !mWindows.IsEmpty()) {
+    window = mWindows.begin()->second;
+  }
+  NS_ENSURE_TRUE(window, nullptr);
+
+  // Views created by the embedder count up from 1, keep content created
+  // ones apart from them.
+  static const uint32_t kContentViewIdBase = 1u << 31;
+  static uint32_t sContentViewCreateID = 0;
+  uint32_t id = kContentViewIdBase | ++sContentViewCreateID;
+  bool isPrivateWindow = chromeFlags & nsIWebBrowserChrome::CHROME_PRIVATE_WINDOW;
+
+  LOGT("id:%u parentId:%u window:%u", id, parentId, window->GetUniqueID());
+  EmbedLiteViewChild* view = static_cast<EmbedLiteViewChild*>(
+      SendPEmbedLiteViewConstructor(window->GetUniqueID(), id, parentId, parentBrowsingContext,
+                                    isPrivateWindow, false));
+  NS_ENSURE_TRUE(view, nullptr);
+
+  // Announce the window before Initialized so that the embedder gets the
+  // chance to adopt the view first.
+  Unused << view->SendWindowCreated(parentId, parentBrowsingContext, chromeFlags);
+  view->InitGeckoWindow(parentId,
+                        reinterpret_cast<mozilla::dom::BrowsingContext*>(parentBrowsingContext),
+                        isPrivateWindow, false);
+  return view;
 }
 
 EmbedLiteViewChildIface*
 EmbedLiteAppChild::GetViewByID(uint32_t aId) const
 {
-  const std::map<uint32_t, EmbedLiteViewChild*>::const_iterator it = mWeakViewMap.find(aId);
-  return (it != mWeakViewMap.end()) ? it->second : nullptr;
+  return mViews.Get(aId);
 }
 
 EmbedLiteViewChildIface*
 EmbedLiteAppChild::GetViewByChromeParent(nsIWebBrowserChrome* aParent) const
 {
-  LOGT("mWeakViewMap:%i", mWeakViewMap.size());
-  for (const std::pair<uint32_t, EmbedLiteViewChild*> &viewPair : mWeakViewMap) {
-    if (aParent == viewPair.second->mChrome.get()) {
-      return viewPair.second;
-    }
-  }
-  return nullptr;
+  return mViews.GetBy(EmbedLiteRegistryKey::Chrome, reinterpret_cast<uintptr_t>(aParent));
 }
 
 EmbedLiteWindowChild*
 EmbedLiteAppChild::GetWindowByID(uint32_t aWindowID)
 {
-  LOGT("mWeakWindowMap:%i", mWeakWindowMap.size());
-  std::map<uint32_t, EmbedLiteWindowChild*>::const_iterator it;
-  it = mWeakWindowMap.find(aWindowID);
-  if (it != mWeakWindowMap.end()) {
-    return it->second;
+  return mWindows.Get(aWindowID);
+}
+
+EmbedLiteViewChildIface*
+EmbedLiteAppChild::GetViewByOuterID(uint64_t aOuterID) const
+{
+  return mViews.GetBy(EmbedLiteRegistryKey::OuterWindowID, aOuterID);
+}
+
+EmbedLiteViewChildIface*
+EmbedLiteAppChild::GetViewByBrowsingContext(mozilla::dom::BrowsingContext* aContext) const
+{
+  return mViews.GetBy(EmbedLiteRegistryKey::BrowsingContext, reinterpret_cast<uintptr_t>(aContext));
+}
+
+EmbedLiteViewChildIface*
+EmbedLiteAppChild::GetAnyView(bool aActive) const
+{
+  if (!mActiveViews.empty()) {
+    return mViews.Get(*mActiveViews.begin());
+  }
+  if (aActive || mViews.IsEmpty()) {
+    return nullptr;
+  }
+  return mViews.begin()->second;
+}
+
+void
+EmbedLiteAppChild::ViewWindowCreated(EmbedLiteViewChild* aView)
+{
+  uint32_t id = aView->GetID();
+  mViews.SetKey(id, EmbedLiteRegistryKey::Chrome, reinterpret_cast<uintptr_t>(aView->mChrome.get()));
+  mViews.SetKey(id, EmbedLiteRegistryKey::OuterWindowID, aView->GetOuterID());
+  mozilla::dom::BrowsingContext* context = aView->mDOMWindow ? aView->mDOMWindow->GetBrowsingContext() : nullptr;
+  mViews.SetKey(id, EmbedLiteRegistryKey::BrowsingContext, reinterpret_cast<uintptr_t>(context));
+}
+
+void
+EmbedLiteAppChild::ViewWindowDestroyed(uint32_t aId)
+{
+  mViews.SetKey(aId, EmbedLiteRegistryKey::Chrome, 0);
+  mViews.SetKey(aId, EmbedLiteRegistryKey::OuterWindowID, 0);
+  mViews.SetKey(aId, EmbedLiteRegistryKey::BrowsingContext, 0);
+  mActiveViews.erase(aId);
+}
+
+void
+EmbedLiteAppChild::ViewActivated(uint32_t aId, bool aIsActive)
+{
+  if (aIsActive) {
+    mActiveViews.insert(aId);
+  } else {
+    mActiveViews.erase(aId);
   }
-  return nullptr;
 }
 
 mozilla::ipc::IPCResult EmbedLiteAppChild::RecvPreDestroy()
 {
   LOGT();
+  mObserverFilter.Shutdown();
   ImageBridgeChild::ShutDown();
   SendReadyToShutdown();
   return IPC_OK();
@@ -266,6 +345,103 @@ mozilla::ipc::IPCResult EmbedLiteAppChild::RecvSetIntPref(const nsCString &aName
   return IPC_OK();
 }
 
+mozilla::ipc::IPCResult EmbedLiteAppChild::RecvSetPrefs(nsTArray<EmbedPref> &&aPrefs)
+{
+  LOGC("EmbedPrefs", "count:%zu", aPrefs.Length());
+  nsresult rv;
+  nsCOMPtr<nsIPrefBranch> pref(do_GetService(NS_PREFSERVICE_CONTRACTID, &rv));
+  NS_ENSURE_TRUE(pref, IPC_OK());
+
+  // All or nothing, a value of the wrong type rejects the whole batch.
+  for (const EmbedPref &embedPref : aPrefs) {
+    int32_t type = nsIPrefBranch::PREF_INVALID;
+    pref->GetPrefType(embedPref.name().get(), &type);
+    int32_t newType = nsIPrefBranch::PREF_INVALID;
+    switch (embedPref.value().type()) {
+      case PrefValue::TnsCString: newType = nsIPrefBranch::PREF_STRING; break;
+      case PrefValue::Tint32_t: newType = nsIPrefBranch::PREF_INT; break;
+      case PrefValue::Tbool: newType = nsIPrefBranch::PREF_BOOL; break;
+      default: break;
+    }
+    if (newType == nsIPrefBranch::PREF_INVALID ||
+        (type != nsIPrefBranch::PREF_INVALID && type != newType)) {
+      LOGE("Type mismatch for pref %s, batch of %zu prefs rejected",
+           embedPref.name().get(), aPrefs.Length());
+      return IPC_OK();
+    }
+  }
+
+  for (const EmbedPref &embedPref : aPrefs) {
+    const char* name = embedPref.name().get();
+    const PrefValue &value = embedPref.value();
+    switch (value.type()) {
+      case PrefValue::TnsCString:
+        pref->SetCharPref(name, value.get_nsCString());
+        break;
+      case PrefValue::Tint32_t:
+        pref->SetIntPref(name, value.get_int32_t());
+        break;
+      case PrefValue::Tbool:
+        pref->SetBoolPref(name, value.get_bool());
+        break;
+      default:
+        break;
+    }
+  }
+
+  nsCOMPtr<nsIObserverService> observerService =
+    do_GetService(NS_OBSERVERSERVICE_CONTRACTID);
+  if (observerService) {
+    observerService->NotifyObservers(nullptr, "embedlite-prefs-changed", nullptr);
+  }
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteAppChild::RecvGetPrefs(const uint32_t &aRequestId, const nsCString &aBranch)
+{
+  LOGC("EmbedPrefs", "request:%u branch:%s", aRequestId, aBranch.get());
+  nsTArray<EmbedPref> prefs;
+  nsresult rv;
+  nsCOMPtr<nsIPrefBranch> pref(do_GetService(NS_PREFSERVICE_CONTRACTID, &rv));
+  nsTArray<nsCString> names;
+  if (pref) {
+    pref->GetChildList(aBranch.get(), names);
+  }
+
+  for (const nsCString &name : names) {
+    int32_t type = nsIPrefBranch::PREF_INVALID;
+    pref->GetPrefType(name.get(), &type);
+    switch (type) {
+      case nsIPrefBranch::PREF_STRING: {
+        nsAutoCString value;
+        if (NS_SUCCEEDED(pref->GetCharPref(name.get(), value))) {
+          prefs.AppendElement(EmbedPref(name, PrefValue(value)));
+        }
+        break;
+      }
+      case nsIPrefBranch::PREF_INT: {
+        int32_t value;
+        if (NS_SUCCEEDED(pref->GetIntPref(name.get(), &value))) {
+          prefs.AppendElement(EmbedPref(name, PrefValue(value)));
+        }
+        break;
+      }
+      case nsIPrefBranch::PREF_BOOL: {
+        bool value;
+        if (NS_SUCCEEDED(pref->GetBoolPref(name.get(), &value))) {
+          prefs.AppendElement(EmbedPref(name, PrefValue(value)));
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  Unused << SendPrefsReceived(aRequestId, prefs);
+  return IPC_OK();
+}
+
 mozilla::ipc::IPCResult EmbedLiteAppChild::RecvLoadGlobalStyleSheet(const nsCString &uri,
                                                                     const bool &aEnable)
 {
@@ -372,6 +548,75 @@ mozilla::ipc::IPCResult EmbedLiteAppChild::RecvRemoveObservers(nsTArray<nsCStrin
   return IPC_OK();
 }
 
+mozilla::ipc::IPCResult EmbedLiteAppChild::RecvSetObserverPolicy(const nsCString &aTopic,
+                                                                 const uint32_t &aPolicy,
+                                                                 const uint32_t &aWindowMs)
+{
+  NS_ENSURE_TRUE(aPolicy <= uint32_t(EmbedLiteObserverPolicy::Drop), IPC_OK());
+  mObserverFilter.SetPolicy(aTopic, EmbedLiteObserverPolicy(aPolicy), aWindowMs);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteAppChild::RecvGetObserverStats(const uint32_t &aRequestId)
+{
+  nsTArray<EmbedObserverStats> stats;
+  mObserverFilter.GetStats(&stats);
+  Unused << SendObserverStats(aRequestId, stats);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteAppChild::RecvDumpIPCTrace(const nsCString &aPath)
+{
+  LOGT("path:%s", aPath.get());
+  if (!EmbedLiteIPCTrace::DumpTrace(aPath.get())) {
+    NS_WARNING("Failed to write IPC trace");
+  }
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteAppChild::RecvIdlePeriod(const TimeStamp &aDeadline)
+{
+  TimeStamp now = TimeStamp::Now();
+  bool missed = now >= aDeadline;
+  double overrunMs = 0;
+  if (!missed) {
+    // Whichever of the GC and CC runners is waiting, it keeps to the
+    // deadline. Gecko still runs them on its own idle hints as well.
+    nsJSContext::RunNextCollectorTimer(JS::GCReason::DOM_IPC, aDeadline);
+    now = TimeStamp::Now();
+    if (now > aDeadline) {
+      overrunMs = (now - aDeadline).ToMilliseconds();
+    }
+  }
+  Unused << SendIdlePeriodDone(missed, overrunMs);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteAppChild::RecvInitRendering(Endpoint<PCompositorManagerChild> &&aCompositor,
+                                                             Endpoint<PImageBridgeChild> &&aImageBridge,
+                                                             Endpoint<gfx::PVRManagerChild> &&aVRBridge,
+                                                             Endpoint<PRemoteDecoderManagerChild> &&aVideoManager,
+                                                             nsTArray<uint32_t> &&aNamespaces)
+{
+  LOGT();
+  // Only sent to a content process, see EmbedLiteAppProcessParent::InitRendering.
+  MOZ_ASSERT(aNamespaces.Length() == 3);
+
+  if (!CompositorManagerChild::Init(std::move(aCompositor), aNamespaces[0])) {
+    return IPC_FAIL(this, "Failed to bind the compositor manager");
+  }
+  if (!CompositorManagerChild::CreateContentCompositorBridge(aNamespaces[1])) {
+    return IPC_FAIL(this, "Failed to create the content compositor bridge");
+  }
+  if (!ImageBridgeChild::InitForContent(std::move(aImageBridge), aNamespaces[2])) {
+    return IPC_FAIL(this, "Failed to bind the image bridge");
+  }
+  if (!gfx::VRManagerChild::InitForContent(std::move(aVRBridge))) {
+    return IPC_FAIL(this, "Failed to bind the VR manager");
+  }
+  RemoteDecoderManagerChild::InitForGPUProcess(std::move(aVideoManager));
+  return IPC_OK();
+}
+
 } // namespace embedlite
 } // namespace mozilla
-
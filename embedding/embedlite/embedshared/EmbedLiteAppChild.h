@@ -7,13 +7,21 @@
 #define MOZ_APP_EMBED_CHILD_H
 
 #include "mozilla/embedlite/PEmbedLiteAppChild.h"  // for PEmbedLiteAppChild
+#include "EmbedLiteIPCTrace.h"
 #include "nsIObserver.h"                           // for nsIObserver
 #include "EmbedLiteAppChildIface.h"
+#include "EmbedLiteObserverFilter.h"
+#include "EmbedLiteRegistry.h"
+
+#include <unordered_set>
 
 class EmbedLiteAppService;
 class nsIWebBrowserChrome;
 
 namespace mozilla {
+namespace dom {
+class BrowsingContext;
+}
 namespace embedlite {
 
 class EmbedLiteViewChild;
@@ -32,11 +40,14 @@ public:
   EmbedLiteViewChildIface* GetViewByID(uint32_t aId) const override;
   EmbedLiteViewChildIface* GetViewByChromeParent(nsIWebBrowserChrome* aParent) const override;
   EmbedLiteWindowChild* GetWindowByID(uint32_t aWindowID);
-  bool CreateWindow(const uint32_t &parentId,
-                    const uintptr_t &parentBrowsingContext,
-                    const uint32_t &chromeFlags,
-                    uint32_t *createdID,
-                    bool *cancel) override;
+  EmbedLiteViewChildIface* GetViewByOuterID(uint64_t aOuterID) const;
+  // aContext is the top level BrowsingContext of the view.
+  EmbedLiteViewChildIface* GetViewByBrowsingContext(mozilla::dom::BrowsingContext* aContext) const;
+  // Any active view, or any view if none is active.
+  EmbedLiteViewChildIface* GetAnyView(bool aActive) const;
+  EmbedLiteViewChildIface* CreateWindow(const uint32_t &parentId,
+                                        const uintptr_t &parentBrowsingContext,
+                                        const uint32_t &chromeFlags) override;
   static EmbedLiteAppChild* GetInstance();
 
 protected:
@@ -44,6 +55,7 @@ protected:
 
   // IPDL protocol impl
   virtual void ActorDestroy(ActorDestroyReason aWhy) override;
+  EMBEDLITE_IPC_TRACE_RECEIVED(PEmbedLiteAppChild)
 
   virtual PEmbedLiteViewChild* AllocPEmbedLiteViewChild(const uint32_t &windowId,
                                                         const uint32_t &id,
@@ -55,8 +67,10 @@ protected:
 
 protected:
   MessageLoop* mParentLoop;
-  std::map<uint32_t, EmbedLiteViewChild*> mWeakViewMap;
-  std::map<uint32_t, EmbedLiteWindowChild*> mWeakWindowMap;
+  EmbedLiteRegistry<EmbedLiteViewChild> mViews;
+  EmbedLiteRegistry<EmbedLiteWindowChild> mWindows;
+  std::unordered_set<uint32_t> mActiveViews;
+  EmbedLiteObserverFilter mObserverFilter;
   void InitWindowWatcher();
   nsresult InitAppService();
 
@@ -69,10 +83,18 @@ private:
 
   DISALLOW_EVIL_CONSTRUCTORS(EmbedLiteAppChild);
 
+  // Secondary keys of a view, set once its gecko window exists and
+  // cleared when it starts to be destroyed.
+  void ViewWindowCreated(EmbedLiteViewChild* aView);
+  void ViewWindowDestroyed(uint32_t aId);
+  void ViewActivated(uint32_t aId, bool aIsActive);
+
   // Embed API ipdl interface
   mozilla::ipc::IPCResult RecvSetBoolPref(const nsCString &, const bool &);
   mozilla::ipc::IPCResult RecvSetCharPref(const nsCString &, const nsCString &);
   mozilla::ipc::IPCResult RecvSetIntPref(const nsCString &, const int &);
+  mozilla::ipc::IPCResult RecvSetPrefs(nsTArray<EmbedPref> &&aPrefs);
+  mozilla::ipc::IPCResult RecvGetPrefs(const uint32_t &aRequestId, const nsCString &aBranch);
   mozilla::ipc::IPCResult RecvLoadGlobalStyleSheet(const nsCString &, const bool &);
   mozilla::ipc::IPCResult RecvLoadComponentManifest(const nsCString &);
 
@@ -83,6 +105,16 @@ private:
   mozilla::ipc::IPCResult RecvRemoveObserver(const nsCString &);
   mozilla::ipc::IPCResult RecvAddObservers(nsTArray<nsCString> &&observers);
   mozilla::ipc::IPCResult RecvRemoveObservers(nsTArray<nsCString> &&observers);
+  mozilla::ipc::IPCResult RecvSetObserverPolicy(const nsCString &aTopic, const uint32_t &aPolicy,
+                                                const uint32_t &aWindowMs);
+  mozilla::ipc::IPCResult RecvGetObserverStats(const uint32_t &aRequestId);
+  mozilla::ipc::IPCResult RecvDumpIPCTrace(const nsCString &aPath);
+  mozilla::ipc::IPCResult RecvIdlePeriod(const TimeStamp &aDeadline);
+  mozilla::ipc::IPCResult RecvInitRendering(mozilla::ipc::Endpoint<mozilla::layers::PCompositorManagerChild> &&aCompositor,
+                                            mozilla::ipc::Endpoint<mozilla::layers::PImageBridgeChild> &&aImageBridge,
+                                            mozilla::ipc::Endpoint<mozilla::gfx::PVRManagerChild> &&aVRBridge,
+                                            mozilla::ipc::Endpoint<PRemoteDecoderManagerChild> &&aVideoManager,
+                                            nsTArray<uint32_t> &&aNamespaces);
 
   bool DeallocPEmbedLiteViewChild(PEmbedLiteViewChild*);
   bool DeallocPEmbedLiteWindowChild(PEmbedLiteWindowChild*);
@@ -13,11 +13,12 @@ class EmbedLiteAppChildIface
 public:
   virtual EmbedLiteViewChildIface* GetViewByID(uint32_t aId) const = 0;
   virtual EmbedLiteViewChildIface* GetViewByChromeParent(nsIWebBrowserChrome *aParent) const = 0;
-  virtual bool CreateWindow(const uint32_t &parentId,
-                            const uintptr_t &parentBrowsingContext,
-                            const uint32_t &chromeFlags,
-                            uint32_t *createdID,
-                            bool *cancel) = 0;
+  // Builds the view for a new content window right away and lets the
+  // embedder adopt it asynchronously. Returns null if there is no window
+  // to create it in.
+  virtual EmbedLiteViewChildIface* CreateWindow(const uint32_t &parentId,
+                                                const uintptr_t &parentBrowsingContext,
+                                                const uint32_t &chromeFlags) = 0;
 };
 
 }}
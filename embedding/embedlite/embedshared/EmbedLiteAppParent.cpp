@@ -22,6 +22,7 @@ namespace embedlite {
 
 
 EmbedLiteAppParent::EmbedLiteAppParent()
+  : mIdlePeriodPending(false)
 {
   LOGT();
   MOZ_COUNT_CTOR(EmbedLiteAppParent);
@@ -33,6 +34,62 @@ EmbedLiteAppParent::~EmbedLiteAppParent()
   MOZ_COUNT_DTOR(EmbedLiteAppParent);
 }
 
+mozilla::ipc::IPCResult
+EmbedLiteAppParent::RecvPrefsReceived(const uint32_t &aRequestId, nsTArray<EmbedPref> &&aPrefs)
+{
+  LOGT("request:%u count:%zu", aRequestId, aPrefs.Length());
+  std::vector<EmbedLitePref> prefs;
+  prefs.reserve(aPrefs.Length());
+  for (const EmbedPref &pref : aPrefs) {
+    std::string name(pref.name().get());
+    const dom::PrefValue &value = pref.value();
+    switch (value.type()) {
+      case dom::PrefValue::TnsCString:
+        prefs.emplace_back(name, std::string(value.get_nsCString().get()));
+        break;
+      case dom::PrefValue::Tint32_t:
+        prefs.emplace_back(name, int(value.get_int32_t()));
+        break;
+      case dom::PrefValue::Tbool:
+        prefs.emplace_back(name, value.get_bool());
+        break;
+      default:
+        break;
+    }
+  }
+  EmbedLiteApp::GetInstance()->PrefsReceived(aRequestId, prefs);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult
+EmbedLiteAppParent::RecvObserveBatch(const nsCString &aTopic, nsTArray<nsString> &&aData)
+{
+  LOGT("topic:%s count:%zu", aTopic.get(), aData.Length());
+  EmbedLiteAppListener* listener = EmbedLiteApp::GetInstance()->GetListener();
+  for (const nsString &data : aData) {
+    listener->OnObserve(aTopic.get(), data.get());
+  }
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult
+EmbedLiteAppParent::RecvObserverStats(const uint32_t &aRequestId, nsTArray<EmbedObserverStats> &&aStats)
+{
+  std::map<std::string, EmbedLiteObserverStats> stats;
+  for (const EmbedObserverStats &topicStats : aStats) {
+    stats[topicStats.topic().get()] = { topicStats.sent(), topicStats.merged(), topicStats.suppressed() };
+  }
+  EmbedLiteApp::GetInstance()->ObserverStatsReceived(aRequestId, stats);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult
+EmbedLiteAppParent::RecvIdlePeriodDone(const bool &aMissed, const double &aOverrunMs)
+{
+  mIdlePeriodPending = false;
+  EmbedLiteApp::GetInstance()->ContentIdlePeriodDone(aMissed, aOverrunMs);
+  return IPC_OK();
+}
 
 } // namespace embedlite
 } // namespace mozilla
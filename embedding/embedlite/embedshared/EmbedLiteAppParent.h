@@ -7,6 +7,8 @@
 #define MOZ_APP_EMBED_PARENT_H
 
 #include "mozilla/embedlite/PEmbedLiteAppParent.h"
+#include "EmbedLiteIPCTrace.h"
+#include "mozilla/TimeStamp.h"
 
 namespace mozilla {
 
@@ -29,6 +31,7 @@ protected:
 
   // IPDL implementation
   virtual void ActorDestroy(ActorDestroyReason aWhy)  = 0;
+  EMBEDLITE_IPC_TRACE_RECEIVED(PEmbedLiteAppParent)
   virtual PEmbedLiteViewParent* AllocPEmbedLiteViewParent(const uint32_t &windowId,
                                                           const uint32_t &id,
                                                           const uint32_t &parentId,
@@ -44,17 +47,20 @@ protected:
   virtual mozilla::ipc::IPCResult RecvReadyToShutdown()  = 0;
   virtual mozilla::ipc::IPCResult RecvObserve(const nsCString &topic,
                                               const nsString &data)  = 0;
-  virtual mozilla::ipc::IPCResult RecvCreateWindow(const uint32_t &parentId,
-                                                   const uintptr_t &parentBrowsingContext,
-                                                   const uint32_t &chromeFlags,
-                                                   uint32_t *createdID,
-                                                   bool *cancel)  = 0;
   virtual mozilla::ipc::IPCResult RecvPrefsArrayInitialized(nsTArray<mozilla::dom::Pref> &&prefs)  = 0;
+  mozilla::ipc::IPCResult RecvPrefsReceived(const uint32_t &aRequestId, nsTArray<EmbedPref> &&aPrefs);
+  mozilla::ipc::IPCResult RecvObserveBatch(const nsCString &aTopic, nsTArray<nsString> &&aData);
+  mozilla::ipc::IPCResult RecvObserverStats(const uint32_t &aRequestId, nsTArray<EmbedObserverStats> &&aStats);
+  mozilla::ipc::IPCResult RecvIdlePeriodDone(const bool &aMissed, const double &aOverrunMs);
 
 private:
   friend class EmbedLiteApp;
   friend class PEmbedLiteAppParent;
   DISALLOW_EVIL_CONSTRUCTORS(EmbedLiteAppParent);
+
+  // See EmbedLiteApp::IdlePeriod.
+  bool mIdlePeriodPending;
+  TimeStamp mIdleDeadline;
 };
 
 } // namespace embedlite
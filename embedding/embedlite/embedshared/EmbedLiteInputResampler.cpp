@@ -0,0 +1,147 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLiteInputResampler.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace mozilla {
+namespace embedlite {
+
+EmbedLiteInputResampler::EmbedLiteInputResampler()
+  : mLastTime(0)
+{
+}
+
+void
+EmbedLiteInputResampler::Stamp(MultiTouchInput& aInput)
+{
+  if (!aInput.mTimeStamp.IsNull()) {
+    return;
+  }
+
+  TimeStamp origin = TimeStamp::Now() - TimeDuration::FromMilliseconds(aInput.mTime);
+  // The earliest arrival has the least delivery delay in it. A source
+  // clock going backwards starts over.
+  if (mTimeOrigin.IsNull() || origin < mTimeOrigin || aInput.mTime < mLastTime) {
+    mTimeOrigin = origin;
+  }
+  mLastTime = aInput.mTime;
+  aInput.mTimeStamp = mTimeOrigin + TimeDuration::FromMilliseconds(aInput.mTime);
+}
+
+void
+EmbedLiteInputResampler::AddMove(const MultiTouchInput& aMove)
+{
+  MOZ_ASSERT(aMove.mType == MultiTouchInput::MULTITOUCH_MOVE);
+  mPending.AppendElement(aMove);
+}
+
+TimeStamp
+EmbedLiteInputResampler::OldestMoveTime() const
+{
+  return mPending.IsEmpty() ? TimeStamp() : mPending[0].mTimeStamp;
+}
+
+void
+EmbedLiteInputResampler::Interpolate(const MultiTouchInput& aFrom, const MultiTouchInput& aTo,
+                                     double aAlpha, MultiTouchInput* aResult)
+{
+  for (SingleTouchData& touch : aResult->mTouches) {
+    for (const SingleTouchData& from : aFrom.mTouches) {
+      if (from.mIdentifier != touch.mIdentifier) {
+        continue;
+      }
+      touch.mScreenPoint.x = int32_t(lround(from.mScreenPoint.x + (touch.mScreenPoint.x - from.mScreenPoint.x) * aAlpha));
+      touch.mScreenPoint.y = int32_t(lround(from.mScreenPoint.y + (touch.mScreenPoint.y - from.mScreenPoint.y) * aAlpha));
+      break;
+    }
+  }
+}
+
+MultiTouchInput
+EmbedLiteInputResampler::Resample(const TimeStamp& aSampleTime, nsTArray<MultiTouchInput>* aHistory)
+{
+  MOZ_ASSERT(HasMoves());
+  const MultiTouchInput& newest = mPending.LastElement();
+  MultiTouchInput result(newest);
+
+  if (!aSampleTime.IsNull() && !newest.mTimeStamp.IsNull()) {
+    size_t count = mPending.Length();
+    const MultiTouchInput* from = nullptr;
+    const MultiTouchInput* to = nullptr;
+    if (aSampleTime >= newest.mTimeStamp) {
+      to = &newest;
+      from = count > 1 ? &mPending[count - 2] : mPrevious.ptrOr(nullptr);
+      TimeDuration interval = from ? to->mTimeStamp - from->mTimeStamp : TimeDuration();
+      if (interval >= TimeDuration::FromMilliseconds(kMinSampleIntervalMs)) {
+        TimeDuration prediction = std::min(aSampleTime - to->mTimeStamp,
+                                           std::min(interval / 2.0, TimeDuration::FromMilliseconds(kMaxPredictionMs)));
+        Interpolate(*from, *to, 1.0 + prediction / interval, &result);
+        result.mTimeStamp = to->mTimeStamp + prediction;
+      }
+    } else {
+      for (size_t i = 0; i < count; ++i) {
+        if (mPending[i].mTimeStamp > aSampleTime) {
+          to = &mPending[i];
+          from = i ? &mPending[i - 1] : mPrevious.ptrOr(nullptr);
+          break;
+        }
+      }
+      MOZ_ASSERT(to);
+      if (from && from->mTimeStamp <= aSampleTime) {
+        result = *to;
+        Interpolate(*from, *to, (aSampleTime - from->mTimeStamp) / (to->mTimeStamp - from->mTimeStamp), &result);
+        result.mTimeStamp = aSampleTime;
+      } else {
+        // Nothing older to interpolate from.
+        result = *to;
+      }
+    }
+    result.mTime = newest.mTime + int32_t(floor((result.mTimeStamp - newest.mTimeStamp).ToMilliseconds()));
+  }
+
+  mPrevious = Some(newest);
+  if (aHistory) {
+    aHistory->AppendElements(std::move(mPending));
+  }
+  mPending.Clear();
+  return result;
+}
+
+void
+EmbedLiteInputResampler::Reset()
+{
+  mPending.Clear();
+  mPrevious.reset();
+}
+
+void
+EmbedLiteInputResampler::Untransform(const MultiTouchInput& aRaw, const MultiTouchInput& aUntransformed,
+                                     nsTArray<MultiTouchInput>& aHistory)
+{
+  for (const SingleTouchData& raw : aRaw.mTouches) {
+    for (const SingleTouchData& untransformed : aUntransformed.mTouches) {
+      if (untransformed.mIdentifier != raw.mIdentifier) {
+        continue;
+      }
+      ScreenIntPoint screenDelta = untransformed.mScreenPoint - raw.mScreenPoint;
+      ParentLayerPoint localDelta = untransformed.mLocalScreenPoint - raw.mLocalScreenPoint;
+      for (MultiTouchInput& move : aHistory) {
+        for (SingleTouchData& touch : move.mTouches) {
+          if (touch.mIdentifier == raw.mIdentifier) {
+            touch.mScreenPoint += screenDelta;
+            touch.mLocalScreenPoint += localDelta;
+          }
+        }
+      }
+      break;
+    }
+  }
+}
+
+} // namespace embedlite
+} // namespace mozilla
@@ -0,0 +1,76 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_INPUT_RESAMPLER_H
+#define MOZ_EMBED_LITE_INPUT_RESAMPLER_H
+
+#include "InputData.h"
+#include "mozilla/Maybe.h"
+#include "mozilla/TimeStamp.h"
+#include "nsTArray.h"
+
+namespace mozilla {
+namespace embedlite {
+
+/*
+ * Collects the touch moves arriving between two frames and turns them into
+ * one move at the time the frame samples input.
+ *
+ * Positions are interpolated between the raw samples around the sample
+ * time, or extrapolated from the last two samples when the sample time is
+ * past the newest one. Extrapolation is limited to half the last sample
+ * interval and at most kMaxPrediction, like other platforms do, so a
+ * stopping finger does not overshoot noticeably.
+ */
+class EmbedLiteInputResampler
+{
+public:
+  static constexpr double kMaxPredictionMs = 8.0;
+  // Samples closer together than this are not used for extrapolation.
+  static constexpr double kMinSampleIntervalMs = 2.0;
+
+  EmbedLiteInputResampler();
+
+  // Fills in mTimeStamp from mTime when the source left it null. The
+  // offset between the two clocks is estimated from the earliest arrival,
+  // so aInput should be stamped as soon as it arrives.
+  void Stamp(MultiTouchInput& aInput);
+
+  void AddMove(const MultiTouchInput& aMove);
+  bool HasMoves() const { return !mPending.IsEmpty(); }
+  // Time of the oldest pending move.
+  TimeStamp OldestMoveTime() const;
+
+  // One move for all pending moves positioned at aSampleTime, the raw
+  // moves are appended to aHistory if given. Null aSampleTime returns the
+  // newest move as it is.
+  MultiTouchInput Resample(const TimeStamp& aSampleTime, nsTArray<MultiTouchInput>* aHistory = nullptr);
+
+  // Forgets the previous moves, at touch start, end and cancel.
+  void Reset();
+
+  // APZ moves aRaw into Gecko's coordinates for the async scroll and zoom,
+  // giving aUntransformed. Shifts the touches of aHistory by the same
+  // amount, per touch identifier.
+  static void Untransform(const MultiTouchInput& aRaw, const MultiTouchInput& aUntransformed,
+                          nsTArray<MultiTouchInput>& aHistory);
+
+private:
+  static void Interpolate(const MultiTouchInput& aFrom, const MultiTouchInput& aTo,
+                          double aAlpha, MultiTouchInput* aResult);
+
+  nsTArray<MultiTouchInput> mPending;
+  // Newest move of the previous batch, the base for interpolating to
+  // sample times before the first pending move.
+  Maybe<MultiTouchInput> mPrevious;
+  // TimeStamp of mTime 0, null until the first Stamp.
+  TimeStamp mTimeOrigin;
+  uint32_t mLastTime;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_INPUT_RESAMPLER_H
@@ -0,0 +1,131 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLiteObserverFilter.h"
+#include "mozilla/embedlite/PEmbedLiteAppChild.h"
+#include "mozilla/Unused.h"
+
+namespace mozilla {
+namespace embedlite {
+
+EmbedLiteObserverFilter::EmbedLiteObserverFilter(PEmbedLiteAppChild* aActor)
+  : mActor(aActor)
+{
+}
+
+EmbedLiteObserverFilter::~EmbedLiteObserverFilter()
+{
+  Shutdown();
+}
+
+void
+EmbedLiteObserverFilter::SetPolicy(const nsACString& aTopic, EmbedLiteObserverPolicy aPolicy, uint32_t aWindowMs)
+{
+  LOGT("topic:%s policy:%u window:%u", PromiseFlatCString(aTopic).get(), uint32_t(aPolicy), aWindowMs);
+  nsCString topic(aTopic);
+  // Whatever was collected under the old policy goes out first.
+  Flush(topic);
+
+  Topic& entry = mTopics[topic];
+  entry.mPolicy = aPolicy;
+  entry.mWindowMs = aWindowMs;
+}
+
+void
+EmbedLiteObserverFilter::Notify(const nsACString& aTopic, const nsAString& aData)
+{
+  nsCString topic(aTopic);
+  Topic& entry = mTopics[topic];
+
+  switch (entry.mPolicy) {
+    case EmbedLiteObserverPolicy::Drop:
+      ++entry.mSuppressed;
+      return;
+    case EmbedLiteObserverPolicy::Coalesce:
+      if (!entry.mPending.IsEmpty()) {
+        // Latest wins.
+        ++entry.mMerged;
+        entry.mPending[0] = aData;
+        return;
+      }
+      entry.mPending.AppendElement(aData);
+      break;
+    case EmbedLiteObserverPolicy::Batch:
+      entry.mPending.AppendElement(aData);
+      if (entry.mPending.Length() > 1) {
+        // Rides along with the first one.
+        ++entry.mMerged;
+        return;
+      }
+      break;
+    case EmbedLiteObserverPolicy::Immediate:
+    default:
+      ++entry.mSent;
+      Unused << mActor->SendObserve(topic, nsString(aData));
+      return;
+  }
+
+  // First notification of a window, deliver when it closes.
+  if (!entry.mWindowMs) {
+    Flush(topic);
+    return;
+  }
+  NS_NewTimerWithCallback(getter_AddRefs(entry.mTimer),
+                          [this, topic](nsITimer*) {
+                            Flush(topic);
+                          },
+                          entry.mWindowMs, nsITimer::TYPE_ONE_SHOT,
+                          "mozilla::embedlite::EmbedLiteObserverFilter::Flush");
+}
+
+void
+EmbedLiteObserverFilter::Flush(const nsCString& aTopic)
+{
+  auto it = mTopics.find(aTopic);
+  if (it == mTopics.end() || it->second.mPending.IsEmpty()) {
+    return;
+  }
+
+  Topic& entry = it->second;
+  if (entry.mTimer) {
+    entry.mTimer->Cancel();
+  }
+
+  nsTArray<nsString> pending;
+  pending.SwapElements(entry.mPending);
+  ++entry.mSent;
+  if (entry.mPolicy == EmbedLiteObserverPolicy::Batch) {
+    Unused << mActor->SendObserveBatch(aTopic, pending);
+  } else {
+    Unused << mActor->SendObserve(aTopic, pending[0]);
+  }
+}
+
+void
+EmbedLiteObserverFilter::GetStats(nsTArray<EmbedObserverStats>* aStats) const
+{
+  for (const auto& pair : mTopics) {
+    const Topic& entry = pair.second;
+    aStats->AppendElement(EmbedObserverStats(pair.first, entry.mSent,
+                                             entry.mMerged, entry.mSuppressed));
+  }
+}
+
+void
+EmbedLiteObserverFilter::Shutdown()
+{
+  for (auto& pair : mTopics) {
+    if (pair.second.mTimer) {
+      pair.second.mTimer->Cancel();
+      pair.second.mTimer = nullptr;
+    }
+    pair.second.mPending.Clear();
+  }
+}
+
+} // namespace embedlite
+} // namespace mozilla
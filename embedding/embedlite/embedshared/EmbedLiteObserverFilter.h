@@ -0,0 +1,65 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_OBSERVER_FILTER_H
+#define MOZ_EMBED_LITE_OBSERVER_FILTER_H
+
+#include "EmbedLiteApp.h"
+#include "nsCOMPtr.h"
+#include "nsITimer.h"
+#include "nsString.h"
+#include "nsTArray.h"
+
+#include <map>
+
+namespace mozilla {
+namespace embedlite {
+
+class EmbedObserverStats;
+class PEmbedLiteAppChild;
+
+/**
+ * Applies the embedder's EmbedLiteObserverPolicy to observer notifications
+ * before they cross to the UI side. Coalesced topics send only the latest
+ * notification of each window, batched topics send all notifications of a
+ * window in one ObserveBatch message. Topics without a policy are sent
+ * immediately.
+ *
+ * Content thread only.
+ */
+class EmbedLiteObserverFilter
+{
+public:
+  explicit EmbedLiteObserverFilter(PEmbedLiteAppChild* aActor);
+  ~EmbedLiteObserverFilter();
+
+  void SetPolicy(const nsACString& aTopic, EmbedLiteObserverPolicy aPolicy, uint32_t aWindowMs);
+  void Notify(const nsACString& aTopic, const nsAString& aData);
+  void GetStats(nsTArray<EmbedObserverStats>* aStats) const;
+  // Drops everything still pending, the channel is going away.
+  void Shutdown();
+
+private:
+  struct Topic {
+    EmbedLiteObserverPolicy mPolicy = EmbedLiteObserverPolicy::Immediate;
+    uint32_t mWindowMs = 0;
+    nsCOMPtr<nsITimer> mTimer;
+    // Latest notification of a coalesced topic, all of them for a batched one.
+    nsTArray<nsString> mPending;
+    uint64_t mSent = 0;
+    uint64_t mMerged = 0;
+    uint64_t mSuppressed = 0;
+  };
+
+  void Flush(const nsCString& aTopic);
+
+  PEmbedLiteAppChild* mActor;
+  std::map<nsCString, Topic> mTopics;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_OBSERVER_FILTER_H
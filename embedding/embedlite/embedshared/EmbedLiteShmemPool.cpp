@@ -0,0 +1,114 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLiteShmemPool.h"
+#include "mozilla/ipc/ProtocolUtils.h"
+#include "mozilla/MathAlgorithms.h"
+
+using namespace mozilla::ipc;
+
+namespace mozilla {
+namespace embedlite {
+
+// Upper bound of idle segments kept around for reuse.
+static const size_t kMaxCachedSegments = 4;
+static const size_t kMinSegmentSize = 64 * 1024;
+
+EmbedLiteShmemPool::EmbedLiteShmemPool(IProtocol* aActor)
+  : mActor(aActor)
+  , mAllocations(0)
+  , mReuses(0)
+{
+}
+
+EmbedLiteShmemPool::~EmbedLiteShmemPool()
+{
+  // Segments still owned by a live actor are released with its channel.
+  mFree.Clear();
+}
+
+bool
+EmbedLiteShmemPool::Get(size_t aSize, Shmem* aShmem)
+{
+  // Best fit among the idle segments.
+  size_t best = mFree.NoIndex;
+  for (size_t i = 0; i < mFree.Length(); ++i) {
+    size_t size = mFree[i].Size<uint8_t>();
+    if (size >= aSize && (best == mFree.NoIndex || size < mFree[best].Size<uint8_t>())) {
+      best = i;
+    }
+  }
+
+  if (best != mFree.NoIndex) {
+    *aShmem = mFree[best];
+    mFree.RemoveElementAt(best);
+    ++mReuses;
+    return true;
+  }
+
+  size_t size = RoundUpPow2(std::max(aSize, kMinSegmentSize));
+  if (!mActor->AllocShmem(size, SharedMemory::TYPE_BASIC, aShmem)) {
+    LOGE("Failed to allocate shmem segment of %zu bytes", size);
+    return false;
+  }
+  ++mAllocations;
+  return true;
+}
+
+bool
+EmbedLiteShmemPool::WriteString(const char16_t* aChars, uint32_t aLength, Shmem* aShmem)
+{
+  if (!Get((size_t(aLength) + 1) * sizeof(char16_t), aShmem)) {
+    return false;
+  }
+
+  char16_t* buffer = aShmem->get<char16_t>();
+  memcpy(buffer, aChars, aLength * sizeof(char16_t));
+  buffer[aLength] = 0;
+  return true;
+}
+
+/* static */ const char16_t*
+EmbedLiteShmemPool::ReadString(Shmem& aShmem, uint32_t aLength)
+{
+  if (!aShmem.IsReadable() || aShmem.Size<char16_t>() <= aLength) {
+    return nullptr;
+  }
+
+  // Do not rely on the sender for the terminator.
+  char16_t* buffer = aShmem.get<char16_t>();
+  buffer[aLength] = 0;
+  return buffer;
+}
+
+void
+EmbedLiteShmemPool::Recycle(Shmem& aShmem)
+{
+  if (!aShmem.IsReadable()) {
+    return;
+  }
+
+  if (mFree.Length() >= kMaxCachedSegments) {
+    mActor->DeallocShmem(aShmem);
+    return;
+  }
+  mFree.AppendElement(aShmem);
+}
+
+void
+EmbedLiteShmemPool::Clear(bool aDealloc)
+{
+  if (aDealloc) {
+    for (Shmem& shmem : mFree) {
+      mActor->DeallocShmem(shmem);
+    }
+  }
+  mFree.Clear();
+}
+
+} // namespace embedlite
+} // namespace mozilla
@@ -0,0 +1,67 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_SHMEM_POOL_H
+#define MOZ_EMBED_LITE_SHMEM_POOL_H
+
+#include "mozilla/ipc/Shmem.h"
+#include "nsTArray.h"
+
+namespace mozilla {
+namespace ipc {
+class IProtocol;
+} // namespace ipc
+
+namespace embedlite {
+
+// Payloads at least this large (in bytes) travel in shared memory
+// (AsyncShmemMessage) instead of inside the AsyncMessage IPC message.
+static const uint32_t kDefaultShmemMessageThreshold = 64 * 1024;
+
+/**
+ * Recycles shared memory segments used for large view messages.
+ *
+ * Sending a Shmem hands it over to the peer, which returns it with
+ * ReturnShmem once the payload has been consumed. Returned segments are
+ * kept here and reused for the next payload that fits, so steady state
+ * messaging does not map new memory. The payload is written once into the
+ * segment by the sender and read in place by the receiver, whereas the
+ * AsyncMessage path copies it into the IPC message and out again into a
+ * new string.
+ *
+ * Not thread safe, use from the owning actor's thread only.
+ */
+class EmbedLiteShmemPool
+{
+public:
+  explicit EmbedLiteShmemPool(mozilla::ipc::IProtocol* aActor);
+  ~EmbedLiteShmemPool();
+
+  // Copies aLength UTF-16 units plus a terminating null into a segment.
+  bool WriteString(const char16_t* aChars, uint32_t aLength, mozilla::ipc::Shmem* aShmem);
+  // Validates a received segment and null terminates it in place.
+  static const char16_t* ReadString(mozilla::ipc::Shmem& aShmem, uint32_t aLength);
+
+  // Takes back a segment released by the peer.
+  void Recycle(mozilla::ipc::Shmem& aShmem);
+  // Drops cached segments, aDealloc must be false once the channel is gone.
+  void Clear(bool aDealloc);
+
+  uint32_t Allocations() const { return mAllocations; }
+  uint32_t Reuses() const { return mReuses; }
+
+private:
+  bool Get(size_t aSize, mozilla::ipc::Shmem* aShmem);
+
+  mozilla::ipc::IProtocol* mActor;
+  nsTArray<mozilla::ipc::Shmem> mFree;
+  uint32_t mAllocations;
+  uint32_t mReuses;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_SHMEM_POOL_H
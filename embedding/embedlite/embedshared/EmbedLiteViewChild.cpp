@@ -42,6 +42,12 @@
 #include "mozilla/dom/Document.h"
 #include "mozilla/dom/LoadURIOptionsBinding.h"
 #include "mozilla/dom/MouseEventBinding.h"
+#include "mozilla/dom/ipc/StructuredCloneData.h"
+#include "mozilla/dom/ChildSHistory.h"
+#include "nsDocShell.h"
+#include "nsISHistory.h"
+#include "nsIMemoryReporter.h"
+#include "nsWindowSizes.h"
 #include "mozilla/PresShell.h"
 #include "mozilla/layers/DoubleTapToZoom.h" // for CalculateRectToZoomTo
 #include "mozilla/layers/InputAPZContext.h" // for InputAPZContext
@@ -81,6 +87,7 @@ static struct {
 } sPostAZPCAsJson;
 
 static bool sAllowKeyWordURL = false;
+static uint32_t sShmemMessageThreshold = kDefaultShmemMessageThreshold;
 
 static void ReadAZPCPrefs()
 {
@@ -98,6 +105,9 @@ static void ReadAZPCPrefs()
   Preferences::AddBoolVarCache(&sPostAZPCAsJson.scroll, "embedlite.azpc.json.scroll", false);
 
   Preferences::AddBoolVarCache(&sAllowKeyWordURL, "keyword.enabled", sAllowKeyWordURL);
+
+  Preferences::AddUintVarCache(&sShmemMessageThreshold, "embedlite.ipc.shmem_message_threshold",
+                               kDefaultShmemMessageThreshold);
 }
 
 EmbedLiteViewChild::EmbedLiteViewChild(const uint32_t &aWindowId,
@@ -115,9 +125,17 @@ EmbedLiteViewChild::EmbedLiteViewChild(const uint32_t &aWindowId,
   , mWebNavigation(nullptr)
   , mWindowObserverRegistered(false)
   , mIsFocused(false)
+  , mDiscarded(false)
+  , mDiscardedIndex(-1)
   , mMargins(0, 0, 0, 0)
   , mIMEComposing(false)
   , mPendingTouchPreventedBlockId(0)
+  , mShmemPool(this)
+  , mLastRequestId(0)
+  , mDPI(-1.0)
+  , mHasInputContext(false)
+  , mIMEEnabled(0)
+  , mIMEOpen(0)
   , mInitialized(false)
   , mDestroyAfterInit(false)
 {
@@ -169,6 +187,8 @@ EmbedLiteViewChild::ActorDestroy(ActorDestroyReason aWhy)
   if (mHelper) {
     mHelper->Disconnect();
   }
+  mShmemPool.Clear(false);
+  CancelAsyncRequests();
 }
 
 mozilla::ipc::IPCResult EmbedLiteViewChild::RecvDestroy()
@@ -186,7 +206,7 @@ mozilla::ipc::IPCResult EmbedLiteViewChild::RecvDestroy()
     observerService->NotifyObservers(mDOMWindow, "embedliteviewdestroyed", nullptr);
   }
 
-  EmbedLiteAppService::AppService()->UnregisterView(mId);
+  EmbedLiteAppChild::GetInstance()->ViewWindowDestroyed(mId);
   if (mWebBrowser) {
     mWebBrowser->Destroy();
   }
@@ -201,6 +221,7 @@ mozilla::ipc::IPCResult EmbedLiteViewChild::RecvDestroy()
   mChrome = nullptr;
   mDOMWindow = nullptr;
   mWebNavigation = nullptr;
+  CancelAsyncRequests();
   Unused << SendDestroyed();
   PEmbedLiteViewChild::Send__delete__(this);
   return IPC_OK();
@@ -217,6 +238,11 @@ EmbedLiteViewChild::InitGeckoWindow(const uint32_t parentId,
     return;
   }
 
+  if (mWidget) {
+    // Already initialized synchronously, see EmbedLiteAppChild::CreateWindow.
+    return;
+  }
+
   if (mDestroyAfterInit) {
     Unused << RecvDestroy();
     return;
@@ -301,7 +327,7 @@ EmbedLiteViewChild::InitGeckoWindow(const uint32_t parentId,
   nsCOMPtr<nsIDOMWindowUtils> utils = nsGlobalWindowOuter::Cast(mDOMWindow)->WindowUtils();
   utils->GetOuterWindowID(&mOuterId);
 
-  EmbedLiteAppService::AppService()->RegisterView(mId);
+  EmbedLiteAppChild::GetInstance()->ViewWindowCreated(this);
 
   mWebNavigation = do_QueryInterface(mWebBrowser);
   if (!mWebNavigation) {
@@ -408,6 +434,10 @@ EmbedLiteViewChild::SetInputContext(const int32_t& IMEEnabled,
                                     const int32_t& cause,
                                     const int32_t& focusChange)
 {
+  // Assume the new state until the parent pushes the embedder's view of it.
+  if (mHasInputContext) {
+    mIMEEnabled = IMEEnabled;
+  }
   return SendSetInputContext(IMEEnabled,
                              IMEOpen,
                              type,
@@ -421,7 +451,12 @@ bool
 EmbedLiteViewChild::GetInputContext(int32_t* IMEEnabled,
                                     int32_t* IMEOpen)
 {
-  LOGT();
+  LOGT("cached:%d", mHasInputContext);
+  if (mHasInputContext) {
+    *IMEEnabled = mIMEEnabled;
+    *IMEOpen = mIMEOpen;
+    return true;
+  }
   return SendGetInputContext(IMEEnabled, IMEOpen);
 }
 
@@ -457,9 +492,80 @@ EmbedLiteViewChild::SetTargetAPZC(uint64_t aInputBlockId, const nsTArray<Scrolla
 bool
 EmbedLiteViewChild::GetDPI(float* aDPI)
 {
+  if (mDPI > 0) {
+    *aDPI = mDPI;
+    return true;
+  }
   return SendGetDPI(aDPI);
 }
 
+uint32_t
+EmbedLiteViewChild::DoSendAsyncRequest(const nsAString& aMessageName,
+                                       const nsAString& aMessage,
+                                       uint32_t aTimeoutMs,
+                                       nsIEmbedRequestCallback* aCallback)
+{
+  uint32_t requestId = ++mLastRequestId;
+  PendingRequest& request = mPendingRequests[requestId];
+  request.mCallback = aCallback;
+
+  if (!mRegisteredMessages.Contains(aMessageName) ||
+      !SendAsyncRequest(requestId, nsString(aMessageName), nsString(aMessage))) {
+    // Keep the callback asynchronous also when failing early.
+    RefPtr<EmbedLiteViewChild> self(this);
+    NS_DispatchToCurrentThread(NS_NewRunnableFunction("mozilla::embedlite::EmbedLiteViewChild::DoSendAsyncRequest",
+                                                      [self, requestId] {
+      self->CompleteAsyncRequest(requestId, false, EmptyString());
+    }));
+    return requestId;
+  }
+
+  if (aTimeoutMs) {
+    RefPtr<EmbedLiteViewChild> self(this);
+    NS_NewTimerWithCallback(getter_AddRefs(request.mTimer),
+                            [self, requestId](nsITimer*) {
+                              LOGW("Request %u timed out", requestId);
+                              Unused << self->SendCancelAsyncRequest(requestId);
+                              self->CompleteAsyncRequest(requestId, false, EmptyString());
+                            },
+                            aTimeoutMs, nsITimer::TYPE_ONE_SHOT,
+                            "mozilla::embedlite::EmbedLiteViewChild::AsyncRequestTimeout");
+  }
+
+  LOGT("msg:%s, id:%u, timeout:%u", NS_ConvertUTF16toUTF8(aMessageName).get(), requestId, aTimeoutMs);
+  return requestId;
+}
+
+void
+EmbedLiteViewChild::CompleteAsyncRequest(uint32_t aRequestId, bool aSuccess, const nsAString &aData)
+{
+  auto it = mPendingRequests.find(aRequestId);
+  if (it == mPendingRequests.end()) {
+    // Already timed out or cancelled.
+    return;
+  }
+
+  PendingRequest request = std::move(it->second);
+  mPendingRequests.erase(it);
+  if (request.mTimer) {
+    request.mTimer->Cancel();
+  }
+  request.mCallback->OnResponse(aSuccess, aData);
+}
+
+void
+EmbedLiteViewChild::CancelAsyncRequests()
+{
+  std::map<uint32_t, PendingRequest> requests;
+  requests.swap(mPendingRequests);
+  for (auto& it : requests) {
+    if (it.second.mTimer) {
+      it.second.mTimer->Cancel();
+    }
+    it.second.mCallback->OnResponse(false, EmptyString());
+  }
+}
+
 bool
 EmbedLiteViewChild::UpdateZoomConstraints(const uint32_t& aPresShellId,
                                           const ViewID& aViewId,
@@ -480,10 +586,7 @@ EmbedLiteViewChild::RelayFrameMetrics(const FrameMetrics& aFrameMetrics)
 bool
 EmbedLiteViewChild::HasMessageListener(const nsAString& aMessageName)
 {
-  if (mRegisteredMessages.Get(aMessageName)) {
-    return true;
-  }
-  return false;
+  return mRegisteredMessages.Contains(aMessageName);
 }
 
 bool
@@ -492,8 +595,15 @@ EmbedLiteViewChild::DoSendAsyncMessage(const char16_t* aMessageName, const char1
 #if EMBEDLITE_LOG_SENSITIVE
   LOGT("msg:%s, data:%s", NS_ConvertUTF16toUTF8(aMessageName).get(), NS_ConvertUTF16toUTF8(aMessage).get());
 #endif
-  if (mRegisteredMessages.Get(nsDependentString(aMessageName))) {
-    return SendAsyncMessage(nsDependentString(aMessageName), nsDependentString(aMessage));
+  if (mRegisteredMessages.Contains(nsDependentString(aMessageName))) {
+    const nsDependentString message(aMessage);
+    if (message.Length() * sizeof(char16_t) >= sShmemMessageThreshold) {
+      Shmem shmem;
+      if (mShmemPool.WriteString(message.get(), message.Length(), &shmem)) {
+        return SendAsyncShmemMessage(nsDependentString(aMessageName), shmem, message.Length());
+      }
+    }
+    return SendAsyncMessage(nsDependentString(aMessageName), message);
   }
   return true;
 }
@@ -504,12 +614,39 @@ EmbedLiteViewChild::DoSendSyncMessage(const char16_t* aMessageName, const char16
 #if EMBEDLITE_LOG_SENSITIVE
   LOGT("msg:%s, data:%s", NS_ConvertUTF16toUTF8(aMessageName).get(), NS_ConvertUTF16toUTF8(aMessage).get());
 #endif
-  if (mRegisteredMessages.Get(nsDependentString(aMessageName))) {
+  if (mRegisteredMessages.Contains(nsDependentString(aMessageName))) {
     return SendSyncMessage(nsDependentString(aMessageName), nsDependentString(aMessage), aJSONRetVal);
   }
   return true;
 }
 
+bool
+EmbedLiteViewChild::HasBinaryMessageListener(const nsAString& aMessageName)
+{
+  return mRegisteredBinaryMessages.Contains(aMessageName);
+}
+
+bool
+EmbedLiteViewChild::DoSendAsyncBinaryMessage(const nsAString& aMessageName,
+                                             mozilla::dom::ipc::StructuredCloneData& aData)
+{
+  nsTArray<uint8_t> data;
+  if (!data.SetCapacity(aData.DataLength(), fallible)) {
+    return false;
+  }
+
+  // Flatten the clone buffer segments, no JS value is materialized.
+  if (aData.DataLength() > 0) {
+    aData.Data().ForEachDataChunk([&data](const char* aChunk, size_t aSize) {
+      data.AppendElements(reinterpret_cast<const uint8_t*>(aChunk), aSize);
+      return true;
+    });
+  }
+
+  LOGT("msg:%s, length:%zu", NS_ConvertUTF16toUTF8(aMessageName).get(), data.Length());
+  return SendAsyncBinaryMessage(nsString(aMessageName), data);
+}
+
 nsIWidget*
 EmbedLiteViewChild::WebWidget()
 {
@@ -522,6 +659,7 @@ mozilla::ipc::IPCResult EmbedLiteViewChild::RecvLoadURL(const nsString &url)
 {
   LOGT("url:%s", NS_ConvertUTF16toUTF8(url).get());
   NS_ENSURE_TRUE(mWebNavigation, IPC_OK());
+  ForgetDiscardedHistory();
 
   uint32_t flags = 0;
   if (sAllowKeyWordURL) {
@@ -622,6 +760,7 @@ mozilla::ipc::IPCResult EmbedLiteViewChild::RecvSetIsActive(const bool &aIsActiv
   }
 
   docShell->SetIsActive(aIsActive);
+  EmbedLiteAppChild::GetInstance()->ViewActivated(mId, aIsActive);
 
   mWidget->Show(aIsActive);
   mHelper->SetParentIsActive(aIsActive);
@@ -849,6 +988,90 @@ mozilla::ipc::IPCResult EmbedLiteViewChild::RecvResumeTimeouts()
   return IPC_OK();
 }
 
+static nsISHistory*
+GetLegacySHistory(nsIWebNavigation* aWebNavigation)
+{
+  nsCOMPtr<nsIDocShell> docShell = do_GetInterface(aWebNavigation);
+  NS_ENSURE_TRUE(docShell, nullptr);
+  dom::ChildSHistory* history = nsDocShell::Cast(docShell)->GetSessionHistory();
+  return history ? history->LegacySHistory() : nullptr;
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewChild::RecvDiscard()
+{
+  NS_ENSURE_TRUE(mWebNavigation && !mDiscarded, IPC_OK());
+  nsCOMPtr<nsISHistory> history = GetLegacySHistory(mWebNavigation);
+  NS_ENSURE_TRUE(history, IPC_OK());
+
+  // Keep the entries themselves, they carry scroll positions, form data and post data.
+  int32_t count = history->GetCount();
+  for (int32_t i = 0; i < count; ++i) {
+    nsCOMPtr<nsISHEntry> entry;
+    if (NS_SUCCEEDED(history->GetEntryAtIndex(i, getter_AddRefs(entry))) && entry) {
+      mDiscardedEntries.AppendElement(entry);
+    }
+  }
+  mDiscardedIndex = history->GetIndex();
+  // Cached documents would keep the memory alive.
+  history->EvictAllContentViewers();
+  LOGT("entries:%d index:%d", count, mDiscardedIndex);
+
+  mDiscarded = true;
+  LoadURIOptions loadURIOptions;
+  loadURIOptions.mTriggeringPrincipal = nsContentUtils::GetSystemPrincipal();
+  loadURIOptions.mLoadFlags = nsIWebNavigation::LOAD_FLAGS_REPLACE_HISTORY |
+                              nsIWebNavigation::LOAD_FLAGS_BYPASS_HISTORY;
+  mWebNavigation->LoadURI(NS_LITERAL_STRING("about:blank"), loadURIOptions);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewChild::RecvRestore()
+{
+  NS_ENSURE_TRUE(mWebNavigation && mDiscarded, IPC_OK());
+  mDiscarded = false;
+
+  nsTArray<nsCOMPtr<nsISHEntry>> entries;
+  entries.SwapElements(mDiscardedEntries);
+  nsCOMPtr<nsISHistory> history = GetLegacySHistory(mWebNavigation);
+  NS_ENSURE_TRUE(history && !entries.IsEmpty(), IPC_OK());
+
+  history->PurgeHistory(history->GetCount());
+  for (nsISHEntry* entry : entries) {
+    history->AddEntry(entry, true);
+  }
+  LOGT("entries:%zu index:%d", entries.Length(), mDiscardedIndex);
+  mWebNavigation->GotoIndex(mDiscardedIndex);
+  return IPC_OK();
+}
+
+void EmbedLiteViewChild::ForgetDiscardedHistory()
+{
+  if (!mDiscarded) {
+    return;
+  }
+  LOGT("entries:%zu", mDiscardedEntries.Length());
+  mDiscarded = false;
+  mDiscardedEntries.Clear();
+  mDiscardedIndex = -1;
+}
+
+MOZ_DEFINE_MALLOC_SIZE_OF(EmbedLiteViewMallocSizeOf)
+
+mozilla::ipc::IPCResult EmbedLiteViewChild::RecvRequestMemoryReport()
+{
+  NS_ENSURE_TRUE(mDOMWindow, IPC_OK());
+
+  // DOM, style and layout memory of the top level document.
+  SizeOfState state(EmbedLiteViewMallocSizeOf);
+  nsWindowSizes sizes(state);
+  nsGlobalWindowInner* window = nsGlobalWindowInner::Cast(mDOMWindow->GetCurrentInnerWindow());
+  if (window) {
+    window->AddSizeOfIncludingThis(sizes);
+  }
+  Unused << SendMemoryReport(sizes.getTotalSize());
+  return IPC_OK();
+}
+
 mozilla::ipc::IPCResult EmbedLiteViewChild::RecvLoadFrameScript(const nsString &uri)
 {
   if (mHelper) {
@@ -863,7 +1086,7 @@ mozilla::ipc::IPCResult EmbedLiteViewChild::RecvAsyncMessage(const nsString &aMe
 #if EMBEDLITE_LOG_SENSITIVE
   LOGT("msg:%s, data:%s", NS_ConvertUTF16toUTF8(aMessage).get(), NS_ConvertUTF16toUTF8(aData).get());
 #endif
-  EmbedLiteAppService::AppService()->HandleAsyncMessage(NS_ConvertUTF16toUTF8(aMessage).get(), aData);
+  EmbedLiteAppService::AppService()->HandleAsyncMessage(aMessage, aData);
   mHelper->DispatchMessageManagerMessage(aMessage, aData);
   return IPC_OK();
 }
@@ -879,10 +1102,87 @@ mozilla::ipc::IPCResult EmbedLiteViewChild::RecvAsyncMessage(const nsAString &aM
   return IPC_OK();
 }
 
+mozilla::ipc::IPCResult EmbedLiteViewChild::RecvAsyncBinaryMessage(const nsString &aMessage,
+                                                                   nsTArray<uint8_t> &&aData)
+{
+  LOGT("msg:%s, length:%zu", NS_ConvertUTF16toUTF8(aMessage).get(), aData.Length());
+  mozilla::dom::ipc::StructuredCloneData data;
+  if (!aData.IsEmpty() &&
+      !data.CopyExternalData(reinterpret_cast<const char*>(aData.Elements()), aData.Length())) {
+    NS_WARNING("Failed to copy binary message data");
+    return IPC_OK();
+  }
+  mHelper->DispatchMessageManagerMessage(aMessage, data);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewChild::RecvAsyncShmemMessage(const nsString &aMessage,
+                                                                  Shmem &&aData,
+                                                                  const uint32_t &aLength)
+{
+  LOGT("msg:%s, length:%u", NS_ConvertUTF16toUTF8(aMessage).get(), aLength);
+  const char16_t* chars = EmbedLiteShmemPool::ReadString(aData, aLength);
+  if (chars) {
+    const nsDependentString data(chars, aLength);
+    EmbedLiteAppService::AppService()->HandleAsyncMessage(aMessage, data);
+    mHelper->DispatchMessageManagerMessage(aMessage, data);
+  } else {
+    NS_WARNING("Invalid shmem message payload");
+  }
+  Unused << SendReturnShmem(aData);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewChild::RecvReturnShmem(Shmem &&aData)
+{
+  mShmemPool.Recycle(aData);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewChild::RecvAsyncResponse(const uint32_t &aRequestId,
+                                                              const bool &aSuccess,
+                                                              const nsString &aData)
+{
+  LOGT("id:%u, success:%d", aRequestId, aSuccess);
+  CompleteAsyncRequest(aRequestId, aSuccess, aData);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewChild::RecvUpdateDPI(const float &aDpi)
+{
+  LOGT("dpi:%g", aDpi);
+  mDPI = aDpi;
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewChild::RecvUpdateInputContext(const int32_t &aIMEEnabled,
+                                                                   const int32_t &aIMEOpen)
+{
+  LOGT("IMEEnabled:%i, IMEOpen:%i", aIMEEnabled, aIMEOpen);
+  mHasInputContext = true;
+  mIMEEnabled = aIMEEnabled;
+  mIMEOpen = aIMEOpen;
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewChild::RecvAddBinaryMessageListener(const nsCString &name)
+{
+  LOGT("name:%s", name.get());
+  mRegisteredBinaryMessages.PutEntry(NS_ConvertUTF8toUTF16(name));
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewChild::RecvRemoveBinaryMessageListener(const nsCString &name)
+{
+  LOGT("name:%s", name.get());
+  mRegisteredBinaryMessages.RemoveEntry(NS_ConvertUTF8toUTF16(name));
+  return IPC_OK();
+}
+
 mozilla::ipc::IPCResult EmbedLiteViewChild::RecvAddMessageListener(const nsCString &name)
 {
   LOGT("name:%s", name.get());
-  mRegisteredMessages.Put(NS_ConvertUTF8toUTF16(name), 1);
+  mRegisteredMessages.Add(NS_ConvertUTF8toUTF16(name));
   return IPC_OK();
 }
 
@@ -896,7 +1196,7 @@ mozilla::ipc::IPCResult EmbedLiteViewChild::RecvRemoveMessageListener(const nsCS
 mozilla::ipc::IPCResult EmbedLiteViewChild::RecvAddMessageListeners(nsTArray<nsString> &&messageNames)
 {
   for (unsigned int i = 0; i < messageNames.Length(); i++) {
-    mRegisteredMessages.Put(messageNames[i], 1);
+    mRegisteredMessages.Add(messageNames[i]);
   }
   return IPC_OK();
 }
@@ -1360,11 +1660,20 @@ mozilla::ipc::IPCResult EmbedLiteViewChild::RecvInputDataTouchEvent(const Scroll
 
 mozilla::ipc::IPCResult EmbedLiteViewChild::RecvInputDataTouchMoveEvent(const ScrollableLayerGuid& aGuid,
                                                                         const mozilla::MultiTouchInput& aData,
+                                                                        nsTArray<mozilla::MultiTouchInput>&& aHistory,
                                                                         const uint64_t& aInputBlockId,
                                                                         const nsEventStatus& aApzResponse)
 {
-  LOGT();
-  return RecvInputDataTouchEvent(aGuid, aData, aInputBlockId, aApzResponse);
+  LOGT("history:%zu", aHistory.Length());
+  if (aHistory.IsEmpty()) {
+    return RecvInputDataTouchEvent(aGuid, aData, aInputBlockId, aApzResponse);
+  }
+
+  // The view wants every raw move instead of the resampled one.
+  for (const MultiTouchInput& move : aHistory) {
+    Unused << RecvInputDataTouchEvent(aGuid, move, aInputBlockId, aApzResponse);
+  }
+  return IPC_OK();
 }
 
 mozilla::ipc::IPCResult EmbedLiteViewChild::RecvNotifyAPZStateChange(const ViewID &aViewId, const APZStateChange &aChange, const int &aArg)
@@ -1392,18 +1701,32 @@ NS_IMETHODIMP
 EmbedLiteViewChild::OnLocationChanged(const char* aLocation, bool aCanGoBack, bool aCanGoForward, bool aIsSameDocument)
 {
   Unused << aIsSameDocument;
+  if (mDiscarded) {
+    return NS_OK;
+  }
   return SendOnLocationChanged(nsDependentCString(aLocation), aCanGoBack, aCanGoForward) ? NS_OK : NS_ERROR_FAILURE;
 }
 
 NS_IMETHODIMP
 EmbedLiteViewChild::OnLoadStarted(const char* aLocation)
 {
+  if (mDiscarded) {
+    // Only the placeholder of Discard itself is hidden, pages navigating
+    // away from it start a new history.
+    if (nsDependentCString(aLocation).EqualsLiteral("about:blank")) {
+      return NS_OK;
+    }
+    ForgetDiscardedHistory();
+  }
   return SendOnLoadStarted(nsDependentCString(aLocation)) ? NS_OK : NS_ERROR_FAILURE;
 }
 
 NS_IMETHODIMP
 EmbedLiteViewChild::OnLoadFinished()
 {
+  if (mDiscarded) {
+    return NS_OK;
+  }
   return SendOnLoadFinished() ? NS_OK : NS_ERROR_FAILURE;
 }
 
@@ -1436,9 +1759,22 @@ EmbedLiteViewChild::OnLoadRedirect()
 NS_IMETHODIMP
 EmbedLiteViewChild::OnLoadProgress(int32_t aProgress, int32_t aCurTotal, int32_t aMaxTotal)
 {
+  if (mDiscarded) {
+    return NS_OK;
+  }
   return SendOnLoadProgress(aProgress, aCurTotal, aMaxTotal) ? NS_OK : NS_ERROR_FAILURE;
 }
 
+NS_IMETHODIMP
+EmbedLiteViewChild::OnLoadSummary(uint32_t aRequests, uint64_t aBytes,
+                                  uint32_t aTimeToFirstPaint, uint32_t aTimeToLoad)
+{
+  if (mDiscarded) {
+    return NS_OK;
+  }
+  return SendOnLoadSummary(aRequests, aBytes, aTimeToFirstPaint, aTimeToLoad) ? NS_OK : NS_ERROR_FAILURE;
+}
+
 NS_IMETHODIMP
 EmbedLiteViewChild::OnSecurityChanged(const char* aStatus, uint32_t aState)
 {
@@ -1446,9 +1782,10 @@ EmbedLiteViewChild::OnSecurityChanged(const char* aStatus, uint32_t aState)
 }
 
 NS_IMETHODIMP
-EmbedLiteViewChild::OnFirstPaint(int32_t aX, int32_t aY)
+EmbedLiteViewChild::OnScrollStateChanged(uint32_t aChanges, int32_t aX, int32_t aY,
+                                         uint32_t aWidth, uint32_t aHeight)
 {
-  if (mDOMWindow) {
+  if ((aChanges & nsIEmbedBrowserChromeListener::SCROLL_FIRST_PAINT) && mDOMWindow) {
     nsCOMPtr<nsIDocShell> docShell = mDOMWindow->GetDocShell();
     if (docShell) {
       RefPtr<PresShell> presShell = docShell->GetPresShell();
@@ -1459,38 +1796,28 @@ EmbedLiteViewChild::OnFirstPaint(int32_t aX, int32_t aY)
     }
   }
 
-  return SendOnFirstPaint(aX, aY) ? NS_OK : NS_ERROR_FAILURE;
-}
-
-NS_IMETHODIMP
-EmbedLiteViewChild::OnScrolledAreaChanged(uint32_t aWidth, uint32_t aHeight)
-{
-  return SendOnScrolledAreaChanged(aWidth, aHeight) ? NS_OK : NS_ERROR_FAILURE;
-}
-
-NS_IMETHODIMP
-EmbedLiteViewChild::OnScrollChanged(int32_t offSetX, int32_t offSetY)
-{
-  return SendOnScrollChanged(offSetX, offSetY) ? NS_OK : NS_ERROR_FAILURE;
+  return SendOnScrollStateChanged(aChanges, aX, aY, aWidth, aHeight) ? NS_OK : NS_ERROR_FAILURE;
 }
 
 NS_IMETHODIMP
 EmbedLiteViewChild::OnTitleChanged(const char16_t* aTitle)
 {
+  if (mDiscarded) {
+    return NS_OK;
+  }
   return SendOnTitleChanged(nsDependentString(aTitle)) ? NS_OK : NS_ERROR_FAILURE;
 }
 
 NS_IMETHODIMP
-EmbedLiteViewChild::OnUpdateDisplayPort()
+EmbedLiteViewChild::OnHttpUserAgentUsed(const char16_t* aHttpUserAgent)
 {
-  LOGNI();
-  return NS_OK;
+  return SendOnHttpUserAgentUsed(nsDependentString(aHttpUserAgent)) ? NS_OK : NS_ERROR_FAILURE;
 }
 
 NS_IMETHODIMP
-EmbedLiteViewChild::OnHttpUserAgentUsed(const char16_t* aHttpUserAgent)
+EmbedLiteViewChild::OnMediaPlaybackChanged(bool aPlaying)
 {
-  return SendOnHttpUserAgentUsed(nsDependentString(aHttpUserAgent)) ? NS_OK : NS_ERROR_FAILURE;
+  return SendOnMediaPlaybackChanged(aPlaying) ? NS_OK : NS_ERROR_FAILURE;
 }
 
 bool
@@ -7,6 +7,7 @@
 #define MOZ_VIEW_EMBED_BASE_CHILD_H
 
 #include "mozilla/embedlite/PEmbedLiteViewChild.h"
+#include "EmbedLiteIPCTrace.h"
 #include "mozilla/EventForwards.h"      // for Modifiers
 
 #include "nsIWebBrowser.h"
@@ -19,6 +20,12 @@
 #include "mozilla/layers/APZCCallbackHelper.h"
 #include "EmbedLiteViewChildIface.h"
 #include "EmbedLitePuppetWidget.h"
+#include "EmbedLiteShmemPool.h"
+#include "EmbedLiteMessageRouter.h"
+#include "nsIEmbedAppService.h"
+#include "nsISHEntry.h"
+#include "nsITimer.h"
+#include <map>
 
 class nsWebBrowser;
 
@@ -81,6 +88,9 @@ public:
   virtual bool DoSendSyncMessage(const char16_t* aMessageName,
                                  const char16_t* aMessage,
                                  nsTArray<nsString>* aJSONRetVal) override;
+  virtual bool HasBinaryMessageListener(const nsAString& aMessageName) override;
+  virtual bool DoSendAsyncBinaryMessage(const nsAString& aMessageName,
+                                        mozilla::dom::ipc::StructuredCloneData& aData) override;
 
   /**
    * Relay given frame metrics to listeners subscribed via EmbedLiteAppService
@@ -89,6 +99,10 @@ public:
 
   virtual nsIWidget* WebWidget() override;
   virtual bool GetDPI(float* aDPI) override;
+  virtual uint32_t DoSendAsyncRequest(const nsAString& aMessageName,
+                                      const nsAString& aMessage,
+                                      uint32_t aTimeoutMs,
+                                      nsIEmbedRequestCallback* aCallback) override;
 
 /*---------TabChildIface---------------*/
 
@@ -137,6 +151,7 @@ protected:
   virtual ~EmbedLiteViewChild();
 
   virtual void ActorDestroy(ActorDestroyReason aWhy) override;
+  EMBEDLITE_IPC_TRACE_RECEIVED(PEmbedLiteViewChild)
   virtual mozilla::ipc::IPCResult RecvDestroy();
   virtual mozilla::ipc::IPCResult RecvLoadURL(const nsString &);
   virtual mozilla::ipc::IPCResult RecvGoBack();
@@ -158,6 +173,9 @@ protected:
 
   virtual mozilla::ipc::IPCResult RecvSuspendTimeouts();
   virtual mozilla::ipc::IPCResult RecvResumeTimeouts();
+  virtual mozilla::ipc::IPCResult RecvDiscard();
+  virtual mozilla::ipc::IPCResult RecvRestore();
+  virtual mozilla::ipc::IPCResult RecvRequestMemoryReport();
   virtual mozilla::ipc::IPCResult RecvLoadFrameScript(const nsString &);
   virtual mozilla::ipc::IPCResult RecvHandleScrollEvent(const gfxRect &contentRect,
                                                         const gfxSize &scrollSize);
@@ -196,6 +214,7 @@ protected:
                                                           const nsEventStatus &aApzResponse);
   virtual mozilla::ipc::IPCResult RecvInputDataTouchMoveEvent(const ScrollableLayerGuid &aGuid,
                                                               const mozilla::MultiTouchInput &,
+                                                              nsTArray<mozilla::MultiTouchInput> &&aHistory,
                                                               const uint64_t &aInputBlockId,
                                                               const nsEventStatus &aApzResponse);
 
@@ -208,6 +227,19 @@ protected:
   virtual mozilla::ipc::IPCResult RecvAddMessageListeners(nsTArray<nsString> &&messageNames);
   virtual mozilla::ipc::IPCResult RecvRemoveMessageListeners(nsTArray<nsString>&& messageNames);
   virtual mozilla::ipc::IPCResult RecvAsyncMessage(const nsAString &aMessage, const nsAString &aData);
+  virtual mozilla::ipc::IPCResult RecvAddBinaryMessageListener(const nsCString &);
+  virtual mozilla::ipc::IPCResult RecvRemoveBinaryMessageListener(const nsCString &);
+  virtual mozilla::ipc::IPCResult RecvAsyncBinaryMessage(const nsString &aMessage, nsTArray<uint8_t> &&aData);
+  virtual mozilla::ipc::IPCResult RecvAsyncShmemMessage(const nsString &aMessage,
+                                                        Shmem &&aData,
+                                                        const uint32_t &aLength);
+  virtual mozilla::ipc::IPCResult RecvReturnShmem(Shmem &&aData);
+  virtual mozilla::ipc::IPCResult RecvAsyncResponse(const uint32_t &aRequestId,
+                                                    const bool &aSuccess,
+                                                    const nsString &aData);
+  virtual mozilla::ipc::IPCResult RecvUpdateDPI(const float &aDpi);
+  virtual mozilla::ipc::IPCResult RecvUpdateInputContext(const int32_t &aIMEEnabled,
+                                                         const int32_t &aIMEOpen);
   virtual mozilla::ipc::IPCResult RecvSetScreenProperties(const int& aDepth, const float &aDensity, const float &aDpi);
 
   virtual void OnGeckoWindowInitialized() {}
@@ -236,6 +268,9 @@ private:
   void InitEvent(WidgetGUIEvent& event, nsIntPoint* aPoint = nullptr);
   nsresult DispatchKeyPressEvent(nsIWidget *widget, const EventMessage &message, const int &domKeyCode, const int &gmodifiers, const int &charCode);
   void SetDesktopMode(const bool aDesktopMode);
+  // Another page is loaded into a discarded view, the kept history is
+  // stale and progress is reported again.
+  void ForgetDiscardedHistory();
   bool SetDesktopModeInternal(const bool aDesktopMode);
 
   const uint32_t mId;
@@ -251,11 +286,35 @@ private:
   bool mIsFocused;
   LayoutDeviceIntMargin mMargins;
 
+  // Set while the page is unloaded by Discard, progress of the
+  // placeholder document is not reported to the embedder. Cleared by
+  // Restore or by any other load.
+  bool mDiscarded;
+  nsTArray<nsCOMPtr<nsISHEntry>> mDiscardedEntries;
+  int32_t mDiscardedIndex;
+
   RefPtr<BrowserChildHelper> mHelper;
   bool mIMEComposing;
   uint64_t mPendingTouchPreventedBlockId;
 
-  nsDataHashtable<nsStringHashKey, bool/*start with key*/> mRegisteredMessages;
+  EmbedLiteMessageFilter mRegisteredMessages;
+  nsTHashtable<nsStringHashKey> mRegisteredBinaryMessages;
+  EmbedLiteShmemPool mShmemPool;
+
+  struct PendingRequest {
+    nsCOMPtr<nsIEmbedRequestCallback> mCallback;
+    nsCOMPtr<nsITimer> mTimer;
+  };
+  void CompleteAsyncRequest(uint32_t aRequestId, bool aSuccess, const nsAString &aData);
+  void CancelAsyncRequests();
+  std::map<uint32_t, PendingRequest> mPendingRequests;
+  uint32_t mLastRequestId;
+
+  // Values pushed by the parent, negative / false until first received.
+  float mDPI;
+  bool mHasInputContext;
+  int32_t mIMEEnabled;
+  int32_t mIMEOpen;
 
   RefPtr<APZEventState> mAPZEventState;
   mozilla::layers::SetAllowedTouchBehaviorCallback mSetAllowedTouchBehaviorCallback;
@@ -9,12 +9,19 @@ class nsIWebNavigation;
 class nsIWidget;
 class nsIWebBrowserChrome;
 class nsIWebBrowser;
+class nsIEmbedRequestCallback;
 namespace mozilla {
 
 namespace layers {
 struct FrameMetrics;
 } // namespace layers
 
+namespace dom {
+namespace ipc {
+class StructuredCloneData;
+} // namespace ipc
+} // namespace dom
+
 namespace embedlite {
 class EmbedLiteViewChildIface
 {
@@ -56,8 +63,20 @@ public:
   virtual bool DoSendSyncMessage(const char16_t* aMessageName,
                                  const char16_t* aMessage,
                                  nsTArray<nsString>* aJSONRetVal) = 0;
+
+  // Messages for which the embedder asked raw structured clone data.
+  virtual bool HasBinaryMessageListener(const nsAString& aMessageName) = 0;
+  virtual bool DoSendAsyncBinaryMessage(const nsAString& aMessageName,
+                                        mozilla::dom::ipc::StructuredCloneData& aData) = 0;
   virtual bool GetDPI(float* aDPI) = 0;
 
+  // Non blocking alternative to DoSendSyncMessage. aCallback is always
+  // invoked exactly once and never synchronously. Returns the request id.
+  virtual uint32_t DoSendAsyncRequest(const nsAString& aMessageName,
+                                      const nsAString& aMessage,
+                                      uint32_t aTimeoutMs,
+                                      nsIEmbedRequestCallback* aCallback) = 0;
+
   /**
    * Relay given frame metrics to listeners subscribed via EmbedLiteAppService
    */
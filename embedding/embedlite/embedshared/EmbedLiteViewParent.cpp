@@ -5,16 +5,18 @@
 
 #include "EmbedLog.h"
 
+#include "EmbedLiteApp.h"
+#include "EmbedLiteTabManager.h"
 #include "EmbedLiteView.h"
 #include "EmbedLiteViewParent.h"
 #include "EmbedLiteWindowParent.h"
-#include "EmbedLiteWindowChild.h"
-#include "nsWindow.h"
 
 #include "EmbedLiteCompositorBridgeParent.h"
 #include "mozilla/Unused.h"
+#include "nsIEmbedBrowserChromeListener.h"
 #include "EmbedContentController.h"
 #include "mozilla/layers/APZThreadUtils.h"
+#include "base/message_loop.h"
 
 #include <sys/syscall.h>
 
@@ -24,6 +26,13 @@ using namespace mozilla::widget;
 namespace mozilla {
 namespace embedlite {
 
+static const double kDefaultTouchResampleLatencyMs = 5.0;
+// Queued moves are flushed this long before the next vsync, so that APZ
+// has handled them when the compositor samples it.
+static const double kTouchFlushLeadMs = 4.0;
+// Frame interval assumed until the compositor has seen a vsync.
+static const double kFallbackFrameIntervalMs = 1000.0 / 60.0;
+
 EmbedLiteViewParent::EmbedLiteViewParent(const uint32_t &windowId,
                                          const uint32_t &id,
                                          const uint32_t &parentId,
@@ -32,8 +41,12 @@ EmbedLiteViewParent::EmbedLiteViewParent(const uint32_t &windowId,
                                          const bool &isDesktopMode)
   : mWindowId(windowId)
   , mId(id)
+  , mView(nullptr)
   , mViewAPIDestroyed(false)
+  , mInitialized(false)
   , mWindow(*EmbedLiteWindowParent::From(windowId))
+  , mIsPrivateWindow(isPrivateWindow)
+  , mIsDesktopMode(isDesktopMode)
   , mCompositor(nullptr)
   , mDPI(-1.0)
   , mThread(NS_GetCurrentThread())
@@ -41,6 +54,13 @@ EmbedLiteViewParent::EmbedLiteViewParent(const uint32_t &windowId,
   , mUploadTexture(0)
   , mApzcTreeManager(nullptr)
   , mContentController(new EmbedContentController(this, mThread))
+  , mShmemPool(this)
+  , mShmemMessageThreshold(kDefaultShmemMessageThreshold)
+  , mMessageCopies(0)
+  , mTouchResampling(true)
+  , mTouchResampleLatency(TimeDuration::FromMilliseconds(kDefaultTouchResampleLatencyMs))
+  , mTouchHistory(false)
+  , mTouchFlushScheduled(false)
 {
   MOZ_COUNT_CTOR(EmbedLiteViewParent);
 
@@ -76,6 +96,20 @@ EmbedLiteViewParent::ActorDestroy(ActorDestroyReason aWhy)
 {
   LOGT("reason: %i", aWhy);
   mContentController = nullptr;
+  mShmemPool.Clear(false);
+
+  if (aWhy != AbnormalShutdown) {
+    return;
+  }
+
+  mCompositor = nullptr;
+  if (mView && !mViewAPIDestroyed) {
+    mCrashedWindow = &mWindow;
+    mView->ContentCrashed();
+  } else if (!mView) {
+    // Built for window.open, nobody has adopted it yet.
+    EmbedLiteApp::GetInstance()->DropPendingWindow(mId);
+  }
 }
 
 void
@@ -99,19 +133,16 @@ EmbedLiteViewParent::UpdateScrollController()
       GetApzcTreeManager()->SetDPI(mDPI);
     }
 
-    nsWindow *window = GetWindowWidget();
-    if (window) {
-      window->SetContentController(mContentController);
+    if (GetRootLayerId().IsValid()) {
+      CompositorBridgeParent::SetControllerForLayerTree(GetRootLayerId(), mContentController);
     }
   }
 }
 
 mozilla::layers::IAPZCTreeManager *EmbedLiteViewParent::GetApzcTreeManager()
 {
-  nsWindow *window = GetWindowWidget();
-
-  if (!mApzcTreeManager && mCompositor && window) {
-    mApzcTreeManager = window->GetAPZCTreeManager();
+  if (!mApzcTreeManager && GetRootLayerId().IsValid()) {
+    mApzcTreeManager = CompositorBridgeParent::GetAPZCTreeManager(GetRootLayerId());
   }
   return mApzcTreeManager.get();
 }
@@ -121,9 +152,22 @@ mozilla::layers::IAPZCTreeManager *EmbedLiteViewParent::GetApzcTreeManager()
 mozilla::ipc::IPCResult
 EmbedLiteViewParent::RecvInitialized()
 {
+  mInitialized = true;
   NS_ENSURE_TRUE(mView && !mViewAPIDestroyed, IPC_OK());
 
-  mView->GetListener()->ViewInitialized();
+  mView->Initialized();
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult
+EmbedLiteViewParent::RecvWindowCreated(const uint32_t &aParentId,
+                                       const uintptr_t &aParentBrowsingContext,
+                                       const uint32_t &aChromeFlags)
+{
+  LOGT("id:%u parent:%u flags:%u", mId, aParentId, aChromeFlags);
+  NS_ENSURE_TRUE(!mView && !mViewAPIDestroyed, IPC_OK());
+
+  EmbedLiteApp::GetInstance()->WindowCreated(this, aParentId, aParentBrowsingContext, aChromeFlags);
   return IPC_OK();
 }
 
@@ -162,6 +206,7 @@ EmbedLiteViewParent::RecvOnLocationChanged(const nsCString& aLocation,
                                            const bool& aCanGoForward)
 {
   LOGT();
+  mLocation = aLocation;
   NS_ENSURE_TRUE(mView && !mViewAPIDestroyed, IPC_OK());
 
   mView->GetListener()->OnLocationChanged(aLocation.get(), aCanGoBack, aCanGoForward);
@@ -213,51 +258,66 @@ mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnLoadProgress(const int32_t &a
   return IPC_OK();
 }
 
-mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnSecurityChanged(const nsCString &aStatus,
-                                                                   const uint32_t &aState)
+mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnLoadSummary(const uint32_t &aRequests,
+                                                               const uint64_t &aBytes,
+                                                               const uint32_t &aTimeToFirstPaint,
+                                                               const uint32_t &aTimeToLoad)
 {
-  LOGT();
+  LOGT("requests:%u bytes:%llu paint:%u load:%u", aRequests,
+       (unsigned long long)aBytes, aTimeToFirstPaint, aTimeToLoad);
   NS_ENSURE_TRUE(mView && !mViewAPIDestroyed, IPC_OK());
 
-  mView->GetListener()->OnSecurityChanged(aStatus.get(), aState);
+  EmbedLiteLoadSummary summary = { aRequests, aBytes, aTimeToFirstPaint, aTimeToLoad };
+  mView->GetListener()->OnLoadSummary(summary);
   return IPC_OK();
 }
 
-mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnFirstPaint(const int32_t &aX,
-                                                              const int32_t &aY)
+mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnSecurityChanged(const nsCString &aStatus,
+                                                                   const uint32_t &aState)
 {
   LOGT();
   NS_ENSURE_TRUE(mView && !mViewAPIDestroyed, IPC_OK());
 
-  mView->GetListener()->OnFirstPaint(aX, aY);
+  mView->GetListener()->OnSecurityChanged(aStatus.get(), aState);
   return IPC_OK();
 }
 
-mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnScrolledAreaChanged(const uint32_t &aWidth,
-                                                                       const uint32_t &aHeight)
+mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnScrollStateChanged(const uint32_t &aChanges,
+                                                                      const int32_t &aX,
+                                                                      const int32_t &aY,
+                                                                      const uint32_t &aWidth,
+                                                                      const uint32_t &aHeight)
 {
-  LOGT("area[%u,%u]", aWidth, aHeight);
+  LOGT("changes:%u off[%i,%i] area[%u,%u]", aChanges, aX, aY, aWidth, aHeight);
   NS_ENSURE_TRUE(mView && !mViewAPIDestroyed, IPC_OK());
 
-  mView->GetListener()->OnScrolledAreaChanged(aWidth, aHeight);
+  EmbedLiteViewListener* listener = mView->GetListener();
+  if (aChanges & nsIEmbedBrowserChromeListener::SCROLLED_AREA_CHANGED) {
+    listener->OnScrolledAreaChanged(aWidth, aHeight);
+  }
+  if (aChanges & nsIEmbedBrowserChromeListener::SCROLL_OFFSET_CHANGED) {
+    listener->OnScrollChanged(aX, aY);
+  }
+  if (aChanges & nsIEmbedBrowserChromeListener::SCROLL_FIRST_PAINT) {
+    listener->OnFirstPaint(aX, aY);
+  }
   return IPC_OK();
 }
 
-mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnScrollChanged(const int32_t& offSetX,
-                                                                 const int32_t& offSetY)
+mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnTitleChanged(const nsString& aTitle)
 {
-  LOGT("off[%i,%i]", offSetX, offSetY);
   NS_ENSURE_TRUE(mView && !mViewAPIDestroyed, IPC_OK());
 
-  mView->GetListener()->OnScrollChanged(offSetX, offSetY);
+  mView->GetListener()->OnTitleChanged(aTitle.get());
   return IPC_OK();
 }
 
-mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnTitleChanged(const nsString& aTitle)
+mozilla::ipc::IPCResult EmbedLiteViewParent::RecvMemoryReport(const uint64_t &aBytes)
 {
+  LOGT("bytes:%llu", (unsigned long long)aBytes);
   NS_ENSURE_TRUE(mView && !mViewAPIDestroyed, IPC_OK());
 
-  mView->GetListener()->OnTitleChanged(aTitle.get());
+  EmbedLiteApp::GetInstance()->GetTabManager()->MemoryReported(mView, aBytes);
   return IPC_OK();
 }
 
@@ -266,9 +326,8 @@ mozilla::ipc::IPCResult EmbedLiteViewParent::RecvUpdateZoomConstraints(const uin
                                                                        const Maybe<ZoomConstraints> &aConstraints)
 {
   LOGT("manager: %p", GetApzcTreeManager());
-  nsWindow *window = GetWindowWidget();
-  if (GetApzcTreeManager() && window) {
-    GetApzcTreeManager()->UpdateZoomConstraints(ScrollableLayerGuid(window->GetRootLayerId(),
+  if (GetApzcTreeManager()) {
+    GetApzcTreeManager()->UpdateZoomConstraints(ScrollableLayerGuid(GetRootLayerId(),
                                                                     aPresShellId,
                                                                     aViewId),
                                                 aConstraints);
@@ -281,9 +340,8 @@ mozilla::ipc::IPCResult EmbedLiteViewParent::RecvZoomToRect(const uint32_t &aPre
                                                             const CSSRect &aRect)
 {
   LOGT("thread id: %ld", syscall(SYS_gettid));
-  nsWindow *window = GetWindowWidget();
-  if (GetApzcTreeManager() && window) {
-    GetApzcTreeManager()->ZoomToRect(ScrollableLayerGuid(window->GetRootLayerId(),
+  if (GetApzcTreeManager()) {
+    GetApzcTreeManager()->ZoomToRect(ScrollableLayerGuid(GetRootLayerId(),
                                                          aPresShellId,
                                                          aViewId),
                                      aRect);
@@ -319,6 +377,8 @@ mozilla::ipc::IPCResult EmbedLiteViewParent::RecvSetBackgroundColor(const nscolo
 mozilla::ipc::IPCResult EmbedLiteViewParent::RecvAsyncMessage(const nsString &aMessage,
                                                               const nsString &aData)
 {
+  // Read out of the IPC message into aData.
+  ++mMessageCopies;
   NS_ENSURE_TRUE(mView && !mViewAPIDestroyed, IPC_OK());
 
 #if EMBEDLITE_LOG_SENSITIVE
@@ -347,16 +407,109 @@ mozilla::ipc::IPCResult EmbedLiteViewParent::RecvSyncMessage(const nsString &aMe
   return IPC_OK();
 }
 
+mozilla::ipc::IPCResult EmbedLiteViewParent::RecvAsyncBinaryMessage(const nsString &aMessage,
+                                                                    nsTArray<uint8_t> &&aData)
+{
+  NS_ENSURE_TRUE(mView && !mViewAPIDestroyed, IPC_OK());
+
+  LOGF("msg:%s, length:%zu", NS_ConvertUTF16toUTF8(aMessage).get(), aData.Length());
+
+  mView->GetListener()->RecvAsyncBinaryMessage(aMessage.get(), aData.Elements(), aData.Length());
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewParent::RecvAsyncShmemMessage(const nsString &aMessage,
+                                                                   Shmem &&aData,
+                                                                   const uint32_t &aLength)
+{
+  LOGF("msg:%s, length:%u", NS_ConvertUTF16toUTF8(aMessage).get(), aLength);
+
+  // The listener reads the payload in place, no copy into a string.
+  const char16_t* data = EmbedLiteShmemPool::ReadString(aData, aLength);
+  if (data && mView && !mViewAPIDestroyed) {
+    mView->GetListener()->RecvAsyncMessage(aMessage.get(), data);
+  }
+
+  Unused << SendReturnShmem(aData);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewParent::RecvReturnShmem(Shmem &&aData)
+{
+  mShmemPool.Recycle(aData);
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewParent::RecvAsyncRequest(const uint32_t &aRequestId,
+                                                              const nsString &aMessage,
+                                                              const nsString &aData)
+{
+#if EMBEDLITE_LOG_SENSITIVE
+  LOGT("id:%u, msg:%s, data:%s", aRequestId, NS_ConvertUTF16toUTF8(aMessage).get(), NS_ConvertUTF16toUTF8(aData).get());
+#endif
+  if (!mView || mViewAPIDestroyed) {
+    Unused << SendAsyncResponse(aRequestId, false, EmptyString());
+    return IPC_OK();
+  }
+
+  mPendingRequests.insert(aRequestId);
+  if (mView->GetListener()->RecvAsyncRequest(aRequestId, aMessage.get(), aData.get())) {
+    // Answered now or later through EmbedLiteView::SendAsyncResponse.
+    return IPC_OK();
+  }
+
+  // Listener is not request aware, answer through the sync message handler.
+  char* retval = mView->GetListener()->RecvSyncMessage(aMessage.get(), aData.get());
+  DoSendAsyncResponse(aRequestId, !!retval,
+                      retval ? NS_ConvertUTF8toUTF16(nsDependentCString(retval)) : EmptyString());
+  delete retval;
+  return IPC_OK();
+}
+
+mozilla::ipc::IPCResult EmbedLiteViewParent::RecvCancelAsyncRequest(const uint32_t &aRequestId)
+{
+  LOGT("id:%u", aRequestId);
+  if (mPendingRequests.erase(aRequestId) && mView && !mViewAPIDestroyed) {
+    mView->GetListener()->OnAsyncRequestCancelled(aRequestId);
+  }
+  return IPC_OK();
+}
+
+bool
+EmbedLiteViewParent::DoSendAsyncResponse(uint32_t aRequestId, bool aSuccess, const nsAString &aData)
+{
+  if (!mPendingRequests.erase(aRequestId)) {
+    LOGW("Unknown or cancelled request:%u", aRequestId);
+    return false;
+  }
+  return SendAsyncResponse(aRequestId, aSuccess, nsString(aData));
+}
+
+bool
+EmbedLiteViewParent::DoSendAsyncMessage(const nsAString &aMessage, const nsAString &aData)
+{
+  if (aData.Length() * sizeof(char16_t) >= mShmemMessageThreshold) {
+    Shmem shmem;
+    if (mShmemPool.WriteString(aData.BeginReading(), aData.Length(), &shmem)) {
+      ++mMessageCopies;
+      return SendAsyncShmemMessage(nsString(aMessage), shmem, aData.Length());
+    }
+  }
+  // Into an owning string and from there into the IPC message.
+  mMessageCopies += 2;
+  return SendAsyncMessage(nsString(aMessage), nsString(aData));
+}
+
 mozilla::ipc::IPCResult EmbedLiteViewParent::RecvSetTargetAPZC(const uint64_t &aInputBlockId,
                                                                nsTArray<ScrollableLayerGuid> &&aTargets)
 {
   LOGT("view destoyed: %d", mViewAPIDestroyed);
   NS_ENSURE_TRUE(!mViewAPIDestroyed, IPC_OK());
 
-  nsWindow *window = GetWindowWidget();
+  LayersId rootLayerId = GetRootLayerId();
 
   for (size_t i = 0; i < aTargets.Length(); i++) {
-    if (window && (aTargets[i].mLayersId != window->GetRootLayerId())) {
+    if (rootLayerId.IsValid() && (aTargets[i].mLayersId != rootLayerId)) {
       // Guard against bad data from hijacked child processes
       NS_ERROR("Unexpected layers id in SetTargetAPZC; dropping message...");
       return IPC_OK();
@@ -407,6 +560,7 @@ EmbedLiteViewParent::SetDPI(float dpi)
     GetApzcTreeManager()->SetDPI(mDPI);
   }
 
+  Unused << SendUpdateDPI(mDPI);
   return NS_OK;
 }
 
@@ -416,12 +570,10 @@ mozilla::ipc::IPCResult EmbedLiteViewParent::RecvGetDPI(float *aValue)
   return IPC_OK();
 }
 
-mozilla::embedlite::nsWindow *EmbedLiteViewParent::GetWindowWidget() const
+LayersId EmbedLiteViewParent::GetRootLayerId() const
 {
-  // Use this with care!! Only CompositorSession (and related bits)
-  // may be tampered via this.
-  EmbedLiteWindowChild *window = EmbedLiteWindowChild::From(mWindowId);
-  return window ? window->GetWidget() : nullptr;
+  // The compositor and APZ live in this process also when content does not.
+  return mCompositor ? mCompositor->RootLayerTreeId() : LayersId{0};
 }
 
 bool EmbedLiteViewParent::GetScrollableRect(CSSRect &scrollableRect)
@@ -449,24 +601,111 @@ EmbedLiteViewParent::ReceiveInputEvent(const mozilla::InputData& aEvent)
     return NS_OK;
   }
 
+  if (aEvent.mInputType != MULTITOUCH_INPUT) {
+    return NS_OK;
+  }
+
   mozilla::MultiTouchInput multiTouchInput = aEvent.AsMultiTouchInput();
-  mozilla::layers::APZEventResult apzResult = GetApzcTreeManager()->InputBridge()->ReceiveInputEvent(multiTouchInput);
+  mInputResampler.Stamp(multiTouchInput);
 
-  // If the APZ says to drop it, then we drop it
-  if (apzResult.mStatus == nsEventStatus_eConsumeNoDefault) {
+  if (multiTouchInput.mType == MultiTouchInput::MULTITOUCH_MOVE && mTouchResampling) {
+    mInputResampler.AddMove(multiTouchInput);
+    ScheduleTouchFlush();
     return NS_OK;
   }
 
-  if (multiTouchInput.mInputType == MULTITOUCH_INPUT) {
-    if (multiTouchInput.mType == MultiTouchInput::MULTITOUCH_MOVE) {
-      Unused << SendInputDataTouchMoveEvent(apzResult.mTargetGuid, multiTouchInput, apzResult.mInputBlockId, apzResult.mStatus);
-    } else {
-      Unused << SendInputDataTouchEvent(apzResult.mTargetGuid, multiTouchInput, apzResult.mInputBlockId, apzResult.mStatus);
-    }
+  // Anything else goes out right away, after the moves queued before it.
+  FlushTouchMoves(TimeStamp());
+  if (multiTouchInput.mType != MultiTouchInput::MULTITOUCH_MOVE) {
+    mInputResampler.Reset();
   }
+  DispatchTouchInput(multiTouchInput, multiTouchInput.mTimeStamp, nsTArray<MultiTouchInput>());
   return NS_OK;
 }
 
+void
+EmbedLiteViewParent::DispatchTouchInput(MultiTouchInput& aInput, const TimeStamp& aOldestSample,
+                                        nsTArray<MultiTouchInput>&& aHistory)
+{
+  Maybe<MultiTouchInput> raw;
+  if (!aHistory.IsEmpty()) {
+    raw = Some(aInput);
+  }
+  mozilla::layers::APZEventResult apzResult = GetApzcTreeManager()->InputBridge()->ReceiveInputEvent(aInput);
+  if (raw) {
+    // Only aInput went through APZ, content expects all in its coordinates.
+    EmbedLiteInputResampler::Untransform(*raw, aInput, aHistory);
+  }
+  if (mCompositor && !aOldestSample.IsNull()) {
+    mCompositor->NoteInputSample(aOldestSample);
+  }
+
+  // If the APZ says to drop it, then we drop it
+  if (apzResult.mStatus == nsEventStatus_eConsumeNoDefault) {
+    return;
+  }
+
+  if (aInput.mType == MultiTouchInput::MULTITOUCH_MOVE) {
+    Unused << SendInputDataTouchMoveEvent(apzResult.mTargetGuid, aInput, aHistory,
+                                          apzResult.mInputBlockId, apzResult.mStatus);
+  } else {
+    Unused << SendInputDataTouchEvent(apzResult.mTargetGuid, aInput, apzResult.mInputBlockId, apzResult.mStatus);
+  }
+}
+
+void
+EmbedLiteViewParent::FlushTouchMoves(const TimeStamp& aSampleTime)
+{
+  if (!mInputResampler.HasMoves()) {
+    return;
+  }
+
+  TimeStamp oldest = mInputResampler.OldestMoveTime();
+  nsTArray<MultiTouchInput> history;
+  MultiTouchInput move = mInputResampler.Resample(aSampleTime, mTouchHistory ? &history : nullptr);
+  LOGT("sample:%g history:%zu", aSampleTime.IsNull() ? 0.0 : (TimeStamp::Now() - aSampleTime).ToMilliseconds(),
+       history.Length());
+  DispatchTouchInput(move, oldest, std::move(history));
+}
+
+void
+EmbedLiteViewParent::ScheduleTouchFlush()
+{
+  if (mTouchFlushScheduled) {
+    return;
+  }
+
+  TimeStamp now = TimeStamp::Now();
+  TimeStamp vsync;
+  TimeDuration interval;
+  TimeStamp deadline;
+  if (mCompositor && mCompositor->GetLastVsync(&vsync, &interval)) {
+    // Next vsync on the compositor's grid.
+    int64_t frames = int64_t((now - vsync) / interval) + 1;
+    deadline = vsync + interval * double(frames) - TimeDuration::FromMilliseconds(kTouchFlushLeadMs);
+  } else {
+    deadline = now + TimeDuration::FromMilliseconds(kFallbackFrameIntervalMs - kTouchFlushLeadMs);
+  }
+
+  mTouchFlushScheduled = true;
+  int32_t delay = deadline > now ? int32_t((deadline - now).ToMilliseconds()) : 0;
+  MessageLoop::current()->PostDelayedTask(NewRunnableMethod("mozilla::embedlite::EmbedLiteViewParent::TouchFlushTimeout",
+                                                            this,
+                                                            &EmbedLiteViewParent::TouchFlushTimeout),
+                                          delay);
+}
+
+void
+EmbedLiteViewParent::TouchFlushTimeout()
+{
+  mTouchFlushScheduled = false;
+  if (mViewAPIDestroyed || !GetApzcTreeManager()) {
+    mInputResampler.Reset();
+    return;
+  }
+  FlushTouchMoves(TimeStamp::Now() - mTouchResampleLatency);
+}
+
 NS_IMETHODIMP
 EmbedLiteViewParent::TextEvent(const char *composite, const char *preEdit, const int replacementStart, const int replacementLength)
 {
@@ -496,6 +735,12 @@ EmbedLiteViewParent::ViewAPIDestroyed()
   mViewAPIDestroyed = true;
   mView = nullptr;
 
+  // Nobody is left to answer, let the child fail the requests right away.
+  for (uint32_t requestId : mPendingRequests) {
+    Unused << SendAsyncResponse(requestId, false, EmptyString());
+  }
+  mPendingRequests.clear();
+
   return NS_OK;
 }
 
@@ -614,9 +859,21 @@ mozilla::ipc::IPCResult EmbedLiteViewParent::RecvSetInputContext(const int32_t &
 
   mLastIMEState = aIMEEnabled;
   mView->GetListener()->IMENotification(aIMEEnabled, aIMEOpen, aCause, aFocusChange, aType.get(), aInputmode.get());
+  UpdateInputContext();
   return IPC_OK();
 }
 
+void
+EmbedLiteViewParent::UpdateInputContext()
+{
+  NS_ENSURE_TRUE(mView && !mViewAPIDestroyed, );
+
+  int32_t enabled = mLastIMEState;
+  int32_t open = IMEState::OPEN_STATE_NOT_SUPPORTED;
+  mView->GetListener()->GetIMEStatus(&enabled, &open);
+  Unused << SendUpdateInputContext(enabled, open);
+}
+
 mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnHttpUserAgentUsed(const nsString &aHttpUserAgent)
 {
   LOGT();
@@ -626,6 +883,15 @@ mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnHttpUserAgentUsed(const nsStr
   return IPC_OK();
 }
 
+mozilla::ipc::IPCResult EmbedLiteViewParent::RecvOnMediaPlaybackChanged(const bool &aPlaying)
+{
+  LOGT("playing:%d", aPlaying);
+  NS_ENSURE_TRUE(mView && !mViewAPIDestroyed, IPC_OK());
+
+  mView->MediaPlaybackChanged(aPlaying);
+  return IPC_OK();
+}
+
 NS_IMETHODIMP
 EmbedLiteViewParent::GetUniqueID(uint32_t *aId)
 {
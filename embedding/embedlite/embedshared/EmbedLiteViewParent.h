@@ -7,11 +7,15 @@
 #define MOZ_VIEW_EMBED_PARENT_H
 
 #include "mozilla/embedlite/PEmbedLiteViewParent.h"
+#include "EmbedLiteIPCTrace.h"
 #include "mozilla/embedlite/EmbedLiteWindowParent.h"
 #include "mozilla/WidgetUtils.h"
 #include "EmbedLiteViewIface.h"
+#include "EmbedLiteShmemPool.h"
+#include "EmbedLiteInputResampler.h"
 #include "GLDefs.h"
 #include <functional>
+#include <set>
 
 #include "mozilla/layers/IAPZCTreeManager.h" // public IAPZCTreeManager
 
@@ -21,7 +25,6 @@ namespace embedlite {
 class EmbedContentController;
 class EmbedLiteCompositorBridgeParent;
 class EmbedLiteView;
-class nsWindow;
 
 class EmbedLiteViewParent : public PEmbedLiteViewParent,
                             public EmbedLiteViewIface,
@@ -40,12 +43,20 @@ public:
   NS_IMETHOD QueryInterface(REFNSIID aIID, void** aInstancePtr) override;
 
   EmbedLiteCompositorBridgeParent* GetCompositor() { return mCompositor.get(); }; // XXX: Remove
+  // Payloads of at least aBytes go through shared memory.
+  void SetShmemMessageThreshold(uint32_t aBytes) { mShmemMessageThreshold = aBytes; }
+  uint64_t MessageCopies() const { return mMessageCopies; }
+  const EmbedLiteShmemPool& ShmemPool() const { return mShmemPool; }
 
 protected:
   virtual ~EmbedLiteViewParent();
   virtual void ActorDestroy(ActorDestroyReason aWhy) override;
+  EMBEDLITE_IPC_TRACE_RECEIVED(PEmbedLiteViewParent)
 
   virtual mozilla::ipc::IPCResult RecvInitialized();
+  virtual mozilla::ipc::IPCResult RecvWindowCreated(const uint32_t &aParentId,
+                                                    const uintptr_t &aParentBrowsingContext,
+                                                    const uint32_t &aChromeFlags);
   virtual mozilla::ipc::IPCResult RecvDestroyed();
   virtual mozilla::ipc::IPCResult RecvDynamicToolbarHeightChanged(const int &height);
   virtual mozilla::ipc::IPCResult RecvMarginsChanged(const int &top,
@@ -65,24 +76,38 @@ protected:
                                                      const int32_t &aCurTotal,
                                                      const int32_t &aMaxTotal);
 
+  virtual mozilla::ipc::IPCResult RecvOnLoadSummary(const uint32_t &aRequests,
+                                                    const uint64_t &aBytes,
+                                                    const uint32_t &aTimeToFirstPaint,
+                                                    const uint32_t &aTimeToLoad);
+
   virtual mozilla::ipc::IPCResult RecvOnSecurityChanged(const nsCString &aStatus,
                                                         const uint32_t &aState);
 
-  virtual mozilla::ipc::IPCResult RecvOnFirstPaint(const int32_t &aX, const int32_t &aY);
-
-  virtual mozilla::ipc::IPCResult RecvOnScrolledAreaChanged(const uint32_t &aWidth,
-                                                            const uint32_t &aHeight);
-
-  virtual mozilla::ipc::IPCResult RecvOnScrollChanged(const int32_t &offSetX,
-                                                      const int32_t &offSetY);
+  virtual mozilla::ipc::IPCResult RecvOnScrollStateChanged(const uint32_t &aChanges,
+                                                           const int32_t &aX,
+                                                           const int32_t &aY,
+                                                           const uint32_t &aWidth,
+                                                           const uint32_t &aHeight);
 
   virtual mozilla::ipc::IPCResult RecvOnTitleChanged(const nsString &aTitle);
+  virtual mozilla::ipc::IPCResult RecvMemoryReport(const uint64_t &aBytes);
 
   virtual mozilla::ipc::IPCResult RecvAsyncMessage(const nsString &aMessage,
                                                    const nsString &aData);
   virtual mozilla::ipc::IPCResult RecvSyncMessage(const nsString &aMessage,
                                                   const nsString &aJSON,
                                                   nsTArray<nsString> *aJSONRetVal);
+  virtual mozilla::ipc::IPCResult RecvAsyncBinaryMessage(const nsString &aMessage,
+                                                         nsTArray<uint8_t> &&aData);
+  virtual mozilla::ipc::IPCResult RecvAsyncShmemMessage(const nsString &aMessage,
+                                                        Shmem &&aData,
+                                                        const uint32_t &aLength);
+  virtual mozilla::ipc::IPCResult RecvReturnShmem(Shmem &&aData);
+  virtual mozilla::ipc::IPCResult RecvAsyncRequest(const uint32_t &aRequestId,
+                                                   const nsString &aMessage,
+                                                   const nsString &aData);
+  virtual mozilla::ipc::IPCResult RecvCancelAsyncRequest(const uint32_t &aRequestId);
 
   virtual mozilla::ipc::IPCResult RecvUpdateZoomConstraints(const uint32_t &aPresShellId,
                                                             const ViewID &aViewId,
@@ -111,17 +136,20 @@ protected:
                                                       const int32_t &aFocusChange);
 
   virtual mozilla::ipc::IPCResult RecvOnHttpUserAgentUsed(const nsString &aHttpUserAgent);
+  virtual mozilla::ipc::IPCResult RecvOnMediaPlaybackChanged(const bool &aPlaying);
 
   // EmbedLiteWindowParentObserver:
   void CompositorCreated() override;
 
   virtual mozilla::ipc::IPCResult RecvGetDPI(float *aValue);
 
-  mozilla::embedlite::nsWindow *GetWindowWidget() const;
+  // Invalid until the compositor of the window is initialized.
+  mozilla::layers::LayersId GetRootLayerId() const;
 
   bool GetScrollableRect(CSSRect &scrollableRect);
 
 private:
+  friend class EmbedLiteApp;
   friend class EmbedContentController;
   friend class EmbedLiteCompositorBridgeParent;
   friend class PEmbedLiteViewParent;
@@ -133,11 +161,37 @@ private:
 
   mozilla::layers::IAPZCTreeManager *GetApzcTreeManager();
 
+  // Sends through shared memory when aData is over mShmemMessageThreshold.
+  bool DoSendAsyncMessage(const nsAString &aMessage, const nsAString &aData);
+  // Answers a pending AsyncRequest, false if it is unknown or already cancelled.
+  bool DoSendAsyncResponse(uint32_t aRequestId, bool aSuccess, const nsAString &aData);
+  // Pushes the listener's IME status so the child does not need GetInputContext.
+  void UpdateInputContext();
+
+  // Hands a touch event to APZ and forwards it to content. aHistory holds
+  // the raw moves a resampled move stands for, they get the same untransform
+  // as aInput.
+  void DispatchTouchInput(MultiTouchInput& aInput, const TimeStamp& aOldestSample,
+                          nsTArray<MultiTouchInput>&& aHistory);
+  // Resamples the queued moves at aSampleTime and dispatches the result.
+  void FlushTouchMoves(const TimeStamp& aSampleTime);
+  void ScheduleTouchFlush();
+  void TouchFlushTimeout();
+
   uint32_t mWindowId;
   uint32_t mId;
   EmbedLiteView* mView;
   bool mViewAPIDestroyed;
+  // Content side is up, possibly before an EmbedLiteView adopted this actor.
+  bool mInitialized;
   EmbedLiteWindowParent& mWindow;
+  // Kept to build the view again if content crashes, see
+  // EmbedLiteApp::ReloadCrashedView.
+  bool mIsPrivateWindow;
+  bool mIsDesktopMode;
+  nsCString mLocation;
+  // A crashed actor is kept by its EmbedLiteView, and keeps mWindow.
+  RefPtr<EmbedLiteWindowParent> mCrashedWindow;
   RefPtr<EmbedLiteCompositorBridgeParent> mCompositor;
 
   float mDPI;
@@ -150,6 +204,24 @@ private:
   RefPtr<mozilla::layers::IAPZCTreeManager> mApzcTreeManager;
   RefPtr<EmbedContentController> mContentController;
 
+  EmbedLiteShmemPool mShmemPool;
+  uint32_t mShmemMessageThreshold;
+  // Copies of message payloads made on this side, see GetMessageStatistics.
+  uint64_t mMessageCopies;
+
+  // Touch moves are queued and sent as one move per frame, shortly before
+  // the compositor samples APZ.
+  EmbedLiteInputResampler mInputResampler;
+  bool mTouchResampling;
+  // Moves are resampled this far behind the frame, so there are usually
+  // raw samples on both sides to interpolate between.
+  TimeDuration mTouchResampleLatency;
+  // Content also gets the raw moves behind each resampled one.
+  bool mTouchHistory;
+  bool mTouchFlushScheduled;
+
+  std::set<uint32_t> mPendingRequests;
+
   DISALLOW_EVIL_CONSTRUCTORS(EmbedLiteViewParent);
 };
 
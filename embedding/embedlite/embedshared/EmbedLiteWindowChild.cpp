@@ -28,11 +28,13 @@ static std::map<uint32_t, EmbedLiteWindowChild*> sWindowChildMap;
 } // namespace
 
 EmbedLiteWindowChild::EmbedLiteWindowChild(const uint16_t &width, const uint16_t &height, const uint32_t &aId, EmbedLiteWindowListener *aListener)
-  : mId(aId)
+  : mRemoteCompositor(false)
+  , mId(aId)
   , mListener(aListener)
   , mWidget(nullptr)
   , mBounds(0, 0, width, height)
   , mRotation(ROTATION_0)
+  , mIdNamespace(0)
   , mInitialized(false)
   , mDestroyAfterInit(false)
   , mDepth(32)
@@ -40,7 +42,6 @@ EmbedLiteWindowChild::EmbedLiteWindowChild(const uint16_t &width, const uint16_t
   , mDpi(96)
 {
   MOZ_ASSERT(sWindowChildMap.find(aId) == sWindowChildMap.end());
-  MOZ_ASSERT(mListener);
   sWindowChildMap[aId] = this;
 
   MOZ_COUNT_CTOR(EmbedLiteWindowChild);
@@ -90,6 +91,18 @@ void EmbedLiteWindowChild::ActorDestroy(ActorDestroyReason aWhy)
   LOGT("reason:%i", aWhy);
 }
 
+mozilla::ipc::IPCResult EmbedLiteWindowChild::RecvInitCompositor(const mozilla::layers::LayersId &aRootLayerTreeId,
+                                                                 const uint32_t &aIdNamespace)
+{
+  LOGT("this:%p root:%" PRIu64, this, aRootLayerTreeId.mId);
+  NS_ENSURE_TRUE(mRemoteCompositor && !mRootLayerTreeId.IsValid(),
+                 IPC_FAIL(this, "Unexpected InitCompositor"));
+  mRootLayerTreeId = aRootLayerTreeId;
+  mIdNamespace = aIdNamespace;
+  CreateWidget();
+  return IPC_OK();
+}
+
 mozilla::ipc::IPCResult EmbedLiteWindowChild::RecvDestroy()
 {
   if (!mInitialized) {
@@ -176,6 +189,11 @@ void EmbedLiteWindowChild::CreateWidget()
     mCreateWidgetTask = nullptr;
   }
 
+  if (mWidget || (mRemoteCompositor && !mRootLayerTreeId.IsValid())) {
+    // Created already, or called again from RecvInitCompositor.
+    return;
+  }
+
   if (mDestroyAfterInit) {
     RecvDestroy();
     return;
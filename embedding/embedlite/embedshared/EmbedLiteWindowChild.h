@@ -7,7 +7,9 @@
 #define MOZ_WINDOW_EMBED_CHILD_H
 
 #include "mozilla/embedlite/PEmbedLiteWindowChild.h"
+#include "EmbedLiteIPCTrace.h"
 #include "mozilla/WidgetUtils.h"
+#include "mozilla/layers/LayersTypes.h"
 #include "nsIWidget.h"
 #include "base/task.h" // for CancelableRunnable
 
@@ -29,17 +31,28 @@ public:
   uint32_t GetUniqueID() const { return mId; }
   nsWindow *GetWidget() const;
   LayoutDeviceIntRect GetSize() const { return mBounds; }
+  // Null out of process.
   EmbedLiteWindowListener* GetListener() const { return mListener; }
+  // Out of process the compositor lives in the UI process, the widget
+  // connects to it through the ids of RecvInitCompositor.
+  bool HasRemoteCompositor() const { return mRemoteCompositor; }
+  mozilla::layers::LayersId GetRootLayerTreeId() const { return mRootLayerTreeId; }
+  uint32_t GetIdNamespace() const { return mIdNamespace; }
   void SetScreenProperties(const int &depth, const float &density, const float &dpi);
 
 protected:
   virtual ~EmbedLiteWindowChild() override;
   virtual void ActorDestroy(ActorDestroyReason aWhy) override;
+  EMBEDLITE_IPC_TRACE_RECEIVED(PEmbedLiteWindowChild)
+
+  bool mRemoteCompositor;
 
 private:
   friend class PEmbedLiteWindowChild;
   void CreateWidget();
 
+  mozilla::ipc::IPCResult RecvInitCompositor(const mozilla::layers::LayersId &aRootLayerTreeId,
+                                             const uint32_t &aIdNamespace);
   mozilla::ipc::IPCResult RecvDestroy();
   mozilla::ipc::IPCResult RecvSetSize(const gfxSize &size);
   mozilla::ipc::IPCResult RecvSetContentOrientation(const uint32_t &);
@@ -51,6 +64,8 @@ private:
   LayoutDeviceIntRect mBounds;
   mozilla::ScreenRotation mRotation;
   RefPtr<CancelableRunnable> mCreateWidgetTask;
+  mozilla::layers::LayersId mRootLayerTreeId;
+  uint32_t mIdNamespace;
 
   bool mInitialized;
   bool mDestroyAfterInit;
@@ -8,6 +8,7 @@
 #include "EmbedLiteCompositorBridgeParent.h"
 #include "EmbedLiteWindow.h"
 #include "EmbedLog.h"
+#include "mozilla/Unused.h"
 
 #include "gfxContext.h"
 #include "gfxImageSurface.h"
@@ -43,8 +44,11 @@ EmbedLiteWindowParent::EmbedLiteWindowParent(const uint16_t &width, const uint16
 
 EmbedLiteWindowParent::~EmbedLiteWindowParent()
 {
-  MOZ_ASSERT(sWindowMap.find(mId) != sWindowMap.end());
-  sWindowMap.erase(sWindowMap.find(mId));
+  // A crashed window is replaced by an actor with the same id.
+  auto it = sWindowMap.find(mId);
+  if (it != sWindowMap.end() && it->second == this) {
+    sWindowMap.erase(it);
+  }
   if (mId == sCurrentWindowId) {
     sCurrentWindowId = 0;
   }
@@ -78,6 +82,18 @@ void EmbedLiteWindowParent::RemoveObserver(EmbedLiteWindowParentObserver* obs)
   mObservers.RemoveElement(obs);
 }
 
+void EmbedLiteWindowParent::SetSize(int width, int height)
+{
+  mSize = gfxSize(width, height);
+  Unused << SendSetSize(mSize);
+}
+
+void EmbedLiteWindowParent::SetContentOrientation(const uint32_t &aRotation)
+{
+  mRotation = static_cast<mozilla::ScreenRotation>(aRotation);
+  Unused << SendSetContentOrientation(aRotation);
+}
+
 bool EmbedLiteWindowParent::ScheduleUpdate()
 {
   if (mCompositor) {
@@ -124,6 +140,20 @@ void EmbedLiteWindowParent::SetEmbedAPIWindow(EmbedLiteWindow* window)
 void EmbedLiteWindowParent::ActorDestroy(ActorDestroyReason aWhy)
 {
   LOGT("reason:%i", aWhy);
+  if (aWhy != AbnormalShutdown) {
+    return;
+  }
+
+  // The content process crashed, its compositor is gone as well. The
+  // id is free for the actor EmbedLiteApp::ReloadCrashedView creates.
+  auto it = sWindowMap.find(mId);
+  if (it != sWindowMap.end() && it->second == this) {
+    sWindowMap.erase(it);
+  }
+  mCompositor = nullptr;
+  if (mWindow) {
+    mWindow->ContentCrashed();
+  }
 }
 
 mozilla::ipc::IPCResult EmbedLiteWindowParent::RecvInitialized()
@@ -140,6 +170,16 @@ mozilla::ipc::IPCResult EmbedLiteWindowParent::RecvDestroyed()
   return IPC_OK();
 }
 
+mozilla::ipc::IPCResult EmbedLiteWindowParent::RecvSurfaceRectChanged(const LayoutDeviceIntRect &aRect)
+{
+  // Resizes racing the creation of the compositor are covered by the
+  // surface size it is created with.
+  if (mCompositor) {
+    mCompositor->SetSurfaceRect(aRect.x, aRect.y, aRect.width, aRect.height);
+  }
+  return IPC_OK();
+}
+
 void EmbedLiteWindowParent::SetCompositor(EmbedLiteCompositorBridgeParent* aCompositor)
 {
   LOGT("compositor:%p, observers:%d", aCompositor, mObservers.Length());
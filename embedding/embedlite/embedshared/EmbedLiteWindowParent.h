@@ -7,6 +7,7 @@
 #define MOZ_WINDOW_EMBED_PARENT_H
 
 #include "mozilla/embedlite/PEmbedLiteWindowParent.h"
+#include "EmbedLiteIPCTrace.h"
 #include "mozilla/WidgetUtils.h"
 
 namespace mozilla {
@@ -36,6 +37,7 @@ public:
 
   EmbedLiteCompositorBridgeParent* GetCompositor() const { return mCompositor.get(); }
 
+  const gfxSize& GetSize() const { return mSize; }
   void SetSize(int width, int height);
   void SetContentOrientation(const uint32_t &);
   bool ScheduleUpdate();
@@ -51,6 +53,7 @@ protected:
 
   virtual ~EmbedLiteWindowParent() override;
   virtual void ActorDestroy(ActorDestroyReason aWhy) override;
+  EMBEDLITE_IPC_TRACE_RECEIVED(PEmbedLiteWindowParent)
 
   void SetEmbedAPIWindow(EmbedLiteWindow* window);
   void SetCompositor(EmbedLiteCompositorBridgeParent* aCompositor);
@@ -61,6 +64,7 @@ private:
 
   mozilla::ipc::IPCResult RecvInitialized();
   mozilla::ipc::IPCResult RecvDestroyed();
+  mozilla::ipc::IPCResult RecvSurfaceRectChanged(const LayoutDeviceIntRect &aRect);
 
   uint32_t mId;
   EmbedLiteWindowListener *const mListener;
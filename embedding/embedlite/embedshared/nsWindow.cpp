@@ -25,8 +25,11 @@
 
 #include "mozilla/Hal.h"
 #include "mozilla/layers/CompositorBridgeChild.h"
+#include "mozilla/layers/CompositorManagerChild.h"
 #include "mozilla/layers/ImageBridgeChild.h"
 #include "mozilla/layers/CompositorSession.h"
+#include "mozilla/layers/PLayerTransactionChild.h"
+#include "mozilla/layers/RemoteCompositorSession.h"
 #include "mozilla/ipc/MessageChannel.h"
 
 using namespace mozilla::gl;
@@ -43,6 +46,7 @@ NS_IMPL_ISUPPORTS_INHERITED(nsWindow, PuppetWidgetBase,
 static bool sFailedToCreateGLContext = false;
 static bool sUseExternalGLContext = false;
 static bool sRequestGLContextEarly = false;
+static bool sUseSoftwareCompositing = false;
 
 static void InitPrefs()
 {
@@ -52,6 +56,8 @@ static void InitPrefs()
         "embedlite.compositor.external_gl_context", false);
     Preferences::AddBoolVarCache(&sRequestGLContextEarly,
         "embedlite.compositor.request_external_gl_context_early", false);
+    Preferences::AddBoolVarCache(&sUseSoftwareCompositing,
+        "embedlite.compositor.software", false);
     prefsInitialized = true;
   }
 }
@@ -62,9 +68,10 @@ nsWindow::nsWindow(EmbedLiteWindowChild *window)
   , mWindow(window)
 {
   InitPrefs();
-  LOGT("nsWindow: %p window: %p external: %d early: %d", this, mWindow, sUseExternalGLContext, sRequestGLContextEarly);
+  LOGT("nsWindow: %p window: %p external: %d early: %d software: %d", this, mWindow,
+       sUseExternalGLContext, sRequestGLContextEarly, sUseSoftwareCompositing);
 
-  if (sUseExternalGLContext && sRequestGLContextEarly) {
+  if (sUseExternalGLContext && sRequestGLContextEarly && !sUseSoftwareCompositing && mWindow->GetListener()) {
     mozilla::layers::CompositorThread()->Dispatch(NewRunnableFunction(
                                                  "mozilla::embedlite::nsWindow::CreateGLContextEarly",
                                                  &CreateGLContextEarly,
@@ -135,6 +142,8 @@ nsWindow::Resize(double aWidth, double aHeight, bool aRepaint)
   if (GetCompositorBridgeParent()) {
     static_cast<EmbedLiteCompositorBridgeParent*>(GetCompositorBridgeParent())->
         SetSurfaceRect(mNaturalBounds.x, mNaturalBounds.y, mNaturalBounds.width, mNaturalBounds.height);
+  } else if (mCompositorSession && mWindow && mWindow->HasRemoteCompositor()) {
+    Unused << mWindow->SendSurfaceRectChanged(mNaturalBounds);
   }
 }
 
@@ -158,7 +167,56 @@ void
 nsWindow::CreateCompositor(int aWidth, int aHeight)
 {
   LOGT();
-  nsBaseWidget::CreateCompositor(aWidth, aHeight);
+  if (mWindow && mWindow->HasRemoteCompositor()) {
+    CreateRemoteCompositor(aWidth, aHeight);
+  } else {
+    nsBaseWidget::CreateCompositor(aWidth, aHeight);
+  }
+}
+
+void
+nsWindow::CreateRemoteCompositor(int aWidth, int aHeight)
+{
+  // Like nsBaseWidget::CreateCompositor, but the bridge connects to the
+  // compositor manager of the UI process (see EmbedLiteAppChild::RecvInitRendering)
+  // and composites the root layer tree the UI process allocated for this window.
+  // APZ lives in the UI process too.
+  LayersId rootLayerTreeId = mWindow->GetRootLayerTreeId();
+  NS_ENSURE_TRUE(rootLayerTreeId.IsValid() && !mCompositorSession, );
+
+  CompositorOptions options(UseAPZ(), /* useWebRender */ false);
+  RefPtr<ClientLayerManager> lm = new ClientLayerManager(this);
+  RefPtr<CompositorBridgeChild> bridge =
+    CompositorManagerChild::CreateWidgetCompositorBridge(0, lm, mWindow->GetIdNamespace(),
+                                                         GetDefaultScale(), options,
+                                                         UseExternalCompositingSurface(),
+                                                         gfx::IntSize(aWidth, aHeight));
+  if (!bridge || !bridge->SendInitialize(rootLayerTreeId)) {
+    NS_WARNING("Failed to create the compositor bridge to the UI process");
+    return;
+  }
+
+  mCompositorBridgeChild = bridge;
+  mCompositorSession = new RemoteCompositorSession(this, bridge, nullptr, nullptr, rootLayerTreeId);
+
+  nsTArray<LayersBackend> backendHints;
+  gfxPlatform::GetPlatform()->GetCompositorBackends(ComputeShouldAccelerate(), backendHints);
+
+  TextureFactoryIdentifier textureFactoryIdentifier;
+  PLayerTransactionChild* shadowManager =
+    backendHints.IsEmpty() ? nullptr : bridge->SendPLayerTransactionConstructor(backendHints, LayersId{0});
+  if (!shadowManager ||
+      !shadowManager->SendGetTextureFactoryIdentifier(&textureFactoryIdentifier) ||
+      textureFactoryIdentifier.mParentBackend == LayersBackend::LAYERS_NONE) {
+    NS_WARNING("Failed to create the layer tree in the UI process");
+    DestroyCompositor();
+    return;
+  }
+
+  lm->AsShadowForwarder()->SetShadowManager(shadowManager);
+  lm->UpdateTextureFactoryIdentifier(textureFactoryIdentifier);
+  ImageBridgeChild::IdentifyCompositorTextureHost(textureFactoryIdentifier);
+  mLayerManager = lm.forget();
 }
 
 void *
@@ -253,6 +311,27 @@ nsWindow::PostRender(mozilla::widget::WidgetRenderingContext *aContext)
   mWindow->GetListener()->CompositingFinished();
 }
 
+already_AddRefed<mozilla::gfx::DrawTarget>
+nsWindow::StartRemoteDrawingInRegion(LayoutDeviceIntRegion &aInvalidRegion, BufferMode *aBufferMode)
+{
+  NS_ENSURE_TRUE(GetCompositorBridgeParent(), nullptr);
+
+  // Draw straight into the target, EndSoftwareDrawing copies the frame out.
+  *aBufferMode = BufferMode::BUFFER_NONE;
+  return static_cast<EmbedLiteCompositorBridgeParent*>(GetCompositorBridgeParent())->StartSoftwareDrawing();
+}
+
+void
+nsWindow::EndRemoteDrawingInRegion(mozilla::gfx::DrawTarget *aDrawTarget, const LayoutDeviceIntRegion &aInvalidRegion)
+{
+  Unused << aDrawTarget;
+  Unused << aInvalidRegion;
+
+  if (GetCompositorBridgeParent()) {
+    static_cast<EmbedLiteCompositorBridgeParent*>(GetCompositorBridgeParent())->EndSoftwareDrawing();
+  }
+}
+
 void
 nsWindow::AddObserver(EmbedLitePuppetWidgetObserver *aObserver)
 {
@@ -320,6 +399,16 @@ bool nsWindow::UseExternalCompositingSurface() const
   return true;
 }
 
+bool nsWindow::ComputeShouldAccelerate()
+{
+  // Software compositing makes gecko pick the basic compositor,
+  // no GL context is needed at all.
+  if (sUseSoftwareCompositing) {
+    return false;
+  }
+  return PuppetWidgetBase::ComputeShouldAccelerate();
+}
+
 const char *
 nsWindow::Type() const
 {
@@ -347,7 +436,7 @@ nsWindow::GetGLContext() const
     void* context = nullptr;
     void* surface = nullptr;
     void* display = nullptr;
-    if (mWindow && mWindow->GetListener()->RequestGLContext(context, surface, display)) {
+    if (mWindow && mWindow->GetListener() && mWindow->GetListener()->RequestGLContext(context, surface, display)) {
       MOZ_ASSERT(context && surface);
       RefPtr<GLContext> mozContext = GLContextProvider::CreateWrappingExisting(context, surface, display);
       if (!mozContext || !mozContext->Init()) {
@@ -82,6 +82,17 @@ public:
   virtual bool PreRender(mozilla::widget::WidgetRenderingContext* aContext) override;
   virtual void PostRender(mozilla::widget::WidgetRenderingContext* aContext) override;
 
+  /**
+   * Software compositing only. The basic compositor draws into a CPU side
+   * target owned by the EmbedLiteCompositorBridgeParent.
+   *
+   * Always called from the compositing thread.
+   */
+  virtual already_AddRefed<mozilla::gfx::DrawTarget> StartRemoteDrawingInRegion(LayoutDeviceIntRegion& aInvalidRegion,
+                                                                                 mozilla::layers::BufferMode* aBufferMode) override;
+  virtual void EndRemoteDrawingInRegion(mozilla::gfx::DrawTarget* aDrawTarget,
+                                        const LayoutDeviceIntRegion& aInvalidRegion) override;
+
   void AddObserver(EmbedLitePuppetWidgetObserver* aObserver);
   void RemoveObserver(EmbedLitePuppetWidgetObserver* aObserver);
 
@@ -101,6 +112,7 @@ protected:
   virtual already_AddRefed<GeckoContentController> CreateRootContentController() override;
 
   virtual bool UseExternalCompositingSurface() const override;
+  virtual bool ComputeShouldAccelerate() override;
 
   const char *Type() const override;
 
@@ -108,6 +120,8 @@ protected:
 
 private:
   nsWindow();
+  // Out of process, see EmbedLiteCompositorProcessParent.
+  void CreateRemoteCompositor(int aWidth, int aHeight);
   mozilla::gl::GLContext* GetGLContext() const;
   nsEventStatus DispatchEvent(mozilla::WidgetGUIEvent* aEvent);
 
@@ -52,7 +52,7 @@ EmbedLiteAppThreadChild::AllocPEmbedLiteViewChild(const uint32_t &windowId,
   EmbedLiteViewThreadChild* view = new EmbedLiteViewThreadChild(windowId, id, parentId,
                                                                 parentBrowsingContextPtr,
                                                                 isPrivateWindow, isDesktopMode);
-  mWeakViewMap[id] = view;
+  mViews.Add(id, view);
   view->AddRef();
   return view;
 }
@@ -62,7 +62,7 @@ EmbedLiteAppThreadChild::AllocPEmbedLiteWindowChild(const uint16_t &width, const
 {
   LOGT("id:%u", id);
   EmbedLiteWindowThreadChild *window = new EmbedLiteWindowThreadChild(width, height, id, reinterpret_cast<EmbedLiteWindowListener*>(aListener));
-  mWeakWindowMap[id] = window;
+  mWindows.Add(id, window);
   window->AddRef();
   return window;
 }
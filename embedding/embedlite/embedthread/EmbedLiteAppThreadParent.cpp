@@ -45,11 +45,15 @@ mozilla::ipc::IPCResult EmbedLiteAppThreadParent::RecvInitialized()
   PR_SetEnv("MOZ_LAYERS_PREFER_OFFSCREEN=1");
   mApp->Initialized();
   bool accel = mApp->IsAccelerated();
-  mApp->SetBoolPref("dom.netinfo.enabled", false);
-  mApp->SetBoolPref("layers.acceleration.disabled", !accel);
-  mApp->SetBoolPref("layers.acceleration.force-enabled", accel);
-  mApp->SetBoolPref("layers.async-video.enabled", accel);
-  mApp->SetBoolPref("layers.offmainthreadcomposition.force-basic", !accel);
+  // One batch, applied all or nothing: should any of these gecko bool prefs
+  // ever change type, none of them is set and content logs the mismatch.
+  mApp->SetPrefs({
+    { "dom.netinfo.enabled", false },
+    { "layers.acceleration.disabled", !accel },
+    { "layers.acceleration.force-enabled", accel },
+    { "layers.async-video.enabled", accel },
+    { "layers.offmainthreadcomposition.force-basic", !accel },
+  });
   return IPC_OK();
 }
 
@@ -60,17 +64,6 @@ mozilla::ipc::IPCResult EmbedLiteAppThreadParent::RecvReadyToShutdown()
   return IPC_OK();
 }
 
-mozilla::ipc::IPCResult EmbedLiteAppThreadParent::RecvCreateWindow(const uint32_t &parentId,
-                                                                   const uintptr_t &parentBrowsingContext,
-                                                                   const uint32_t &chromeFlags,
-                                                                   uint32_t *createdID,
-                                                                   bool *cancel)
-{
-  *createdID = mApp->CreateWindowRequested(chromeFlags, parentId, parentBrowsingContext);
-  *cancel = !*createdID;
-  return IPC_OK();
-}
-
 void
 EmbedLiteAppThreadParent::ActorDestroy(ActorDestroyReason aWhy)
 {
@@ -39,11 +39,6 @@ protected:
   virtual mozilla::ipc::IPCResult RecvReadyToShutdown() override;
   virtual mozilla::ipc::IPCResult RecvObserve(const nsCString &topic,
                                               const nsString &data) override;
-  virtual mozilla::ipc::IPCResult RecvCreateWindow(const uint32_t &parentId,
-                                                   const uintptr_t &parentBrowsingContext,
-                                                   const uint32_t &chromeFlags,
-                                                   uint32_t *createdID,
-                                                   bool *cancel) override;
   virtual mozilla::ipc::IPCResult RecvPrefsArrayInitialized(nsTArray<mozilla::dom::Pref> &&prefs) override;
 
 private:
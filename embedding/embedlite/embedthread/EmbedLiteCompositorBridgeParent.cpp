@@ -15,6 +15,7 @@
 #include "mozilla/layers/AsyncCompositionManager.h"
 #include "mozilla/layers/LayerTransactionParent.h"
 #include "mozilla/layers/CompositorOGL.h"
+#include "mozilla/layers/CompositorThread.h"
 #include "mozilla/layers/TextureClientSharedSurface.h" // for SharedSurfaceTextureClient
 #include "mozilla/Preferences.h"
 #include "gfxUtils.h"
@@ -24,6 +25,7 @@
 
 #include "GLContext.h"                  // for GLContext
 #include "GLScreenBuffer.h"             // for GLScreenBuffer
+#include "ScopedGLHelpers.h"            // for ScopedBindFramebuffer
 #include "SharedSurfaceEGL.h"           // for SurfaceFactory_EGLImage
 #include "SharedSurfaceGL.h"            // for SurfaceFactory_GLTexture, etc
 #include "SurfaceTypes.h"               // for SurfaceStreamType
@@ -46,28 +48,50 @@ EmbedLiteCompositorBridgeParent::EmbedLiteCompositorBridgeParent(uint32_t window
                                                                  const CompositorOptions &aOptions,
                                                                  bool aRenderToEGLSurface,
                                                                  const gfx::IntSize &aSurfaceSize)
+  : EmbedLiteCompositorBridgeParent(aManager, aScale, aVsyncRate, aOptions, aRenderToEGLSurface, aSurfaceSize)
+{
+  mWindowId = windowId ? windowId : EmbedLiteWindowParent::Current();
+  AttachToWindow();
+}
+
+EmbedLiteCompositorBridgeParent::EmbedLiteCompositorBridgeParent(CompositorManagerParent* aManager,
+                                                                 CSSToLayoutDeviceScale aScale,
+                                                                 const TimeDuration &aVsyncRate,
+                                                                 const CompositorOptions &aOptions,
+                                                                 bool aRenderToEGLSurface,
+                                                                 const gfx::IntSize &aSurfaceSize)
   : CompositorBridgeParent(aManager, aScale, aVsyncRate, aOptions, aRenderToEGLSurface, aSurfaceSize)
-  , mWindowId(windowId)
+  , mWindowId(0)
   , mCurrentCompositeTask(nullptr)
   , mSurfaceOrigin(0, 0)
   , mRenderMutex("EmbedLiteCompositorBridgeParent render mutex")
+  , mFrameTiming(aVsyncRate)
 {
-  if (mWindowId == 0) {
-    mWindowId = EmbedLiteWindowParent::Current();
-  }
-  EmbedLiteWindowParent* parentWindow = EmbedLiteWindowParent::From(mWindowId);
-  LOGT("this:%p, window:%p, sz[%i,%i]", this, parentWindow, aSurfaceSize.width, aSurfaceSize.height);
+  LOGT("this:%p, sz[%i,%i]", this, aSurfaceSize.width, aSurfaceSize.height);
   Preferences::AddBoolVarCache(&mUseExternalGLContext,
                                "embedlite.compositor.external_gl_context", false);
-  parentWindow->SetCompositor(this);
-
-  // Post open parent?
-  //
+  Preferences::AddUintVarCache(&mFrameTimingReportInterval,
+                               "embedlite.compositor.frame_timing_report_interval", 0);
 }
 
 EmbedLiteCompositorBridgeParent::~EmbedLiteCompositorBridgeParent()
 {
-  LOGT();
+  LOGT("published:%llu dropped:%llu contention:%llu",
+       (unsigned long long)mFrameSlots.PublishedFrames(),
+       (unsigned long long)mFrameSlots.DroppedFrames(),
+       (unsigned long long)mFrameSlots.SlotContention());
+  // The pixel buffer is released in RecvWillClose or ActorDestroy, this
+  // only fails requests that came in after that.
+  mFrameCapture.Shutdown(nullptr);
+}
+
+void
+EmbedLiteCompositorBridgeParent::AttachToWindow()
+{
+  EmbedLiteWindowParent* parentWindow = EmbedLiteWindowParent::From(mWindowId);
+  LOGT("this:%p, window:%p", this, parentWindow);
+  NS_ENSURE_TRUE(parentWindow, );
+  parentWindow->SetCompositor(this);
 }
 
 PLayerTransactionParent*
@@ -96,15 +120,27 @@ bool EmbedLiteCompositorBridgeParent::DeallocPLayerTransactionParent(PLayerTrans
     return deallocated;
 }
 
+mozilla::ipc::IPCResult
+EmbedLiteCompositorBridgeParent::RecvWillClose()
+{
+  // The base class destroys the layer manager and with it the GL context.
+  ReleaseCaptureResources();
+  return CompositorBridgeParent::RecvWillClose();
+}
+
+void
+EmbedLiteCompositorBridgeParent::ActorDestroy(ActorDestroyReason aWhy)
+{
+  ReleaseCaptureResources();
+  CompositorBridgeParent::ActorDestroy(aWhy);
+}
+
 void
 EmbedLiteCompositorBridgeParent::PrepareOffscreen()
 {
   fprintf(stderr, "=============== Preparing offscreen rendering context ===============\n");
 
-  const CompositorBridgeParent::LayerTreeState* state = CompositorBridgeParent::GetIndirectShadowTree(RootLayerTreeId());
-  NS_ENSURE_TRUE(state && state->mLayerManager, );
-
-  GLContext* context = static_cast<CompositorOGL*>(state->mLayerManager->GetCompositor())->gl();
+  GLContext* context = GetGLContext();
   NS_ENSURE_TRUE(context, );
 
   if (context->IsOffscreen()) {
@@ -126,6 +162,12 @@ EmbedLiteCompositorBridgeParent::PrepareOffscreen()
         factory = MakeUnique<SurfaceFactory_GLTexture>(context, screen->mCaps, nullptr, flags);
       }
       if (factory) {
+        // The old factory stops recycling its surfaces when it goes, the
+        // embedder may still read the frame it acquired.
+        mFrameSlots.Retire();
+        if (context->MakeCurrent()) {
+          mFrameCapture.ReleaseGL(context);
+        }
         screen->Morph(std::move(factory));
       }
     }
@@ -138,50 +180,201 @@ EmbedLiteCompositorBridgeParent::CompositeToDefaultTarget(VsyncId aId)
   const CompositorBridgeParent::LayerTreeState* state = CompositorBridgeParent::GetIndirectShadowTree(RootLayerTreeId());
   NS_ENSURE_TRUE(state && state->mLayerManager, );
 
-  GLContext* context = static_cast<CompositorOGL*>(state->mLayerManager->GetCompositor())->gl();
-  NS_ENSURE_TRUE(context, );
-  if (!context->IsCurrent()) {
+  // Null with the software (basic) compositor.
+  GLContext* context = GetGLContext();
+  if (context && !context->IsCurrent()) {
     context->MakeCurrent(true);
   }
-  NS_ENSURE_TRUE(context->IsCurrent(), );
+  NS_ENSURE_TRUE(!context || context->IsCurrent(), );
 
-  if (context->IsOffscreen()) {
+  EmbedLiteFrameTimingRecord timing;
+  timing.mCompositeStart = TimeStamp::Now();
+  // Composites scheduled outside of vsync (e.g. ResumeRendering) have no vsync of their own.
+  if (mCompositorScheduler && aId == mCompositorScheduler->GetLastVsyncId()) {
+    timing.mVsync = mCompositorScheduler->GetLastVsyncTime();
+  }
+
+  if (context && context->IsOffscreen()) {
     MutexAutoLock lock(mRenderMutex);
+    timing.mMutexWait = TimeStamp::Now() - timing.mCompositeStart;
     if (context->OffscreenSize() != mEGLSurfaceSize && !context->ResizeOffscreen(mEGLSurfaceSize)) {
       return;
     }
   }
 
-  {
+  mPresentTime = TimeStamp();
+  if (context) {
     ScopedScissorRect autoScissor(context);
     GLenum oldTexUnit;
     context->GetUIntegerv(LOCAL_GL_ACTIVE_TEXTURE, &oldTexUnit);
     CompositeToTarget(aId, nullptr);
     context->fActiveTexture(oldTexUnit);
+  } else {
+    CompositeToTarget(aId, nullptr);
+  }
+
+  timing.mCompositeEnd = TimeStamp::Now();
+  timing.mPresent = mPresentTime;
+  if (mFrameTiming.Record(timing, mFrameTimingReportInterval)) {
+    EmbedLiteWindowParent* parentWindow = EmbedLiteWindowParent::From(mWindowId);
+    EmbedLiteFrameTimingStats stats;
+    if (parentWindow && mFrameTiming.GetStats(&stats)) {
+      parentWindow->GetListener()->FrameTimingReport(stats);
+    }
   }
 }
 
 void
 EmbedLiteCompositorBridgeParent::PresentOffscreenSurface()
 {
-  const CompositorBridgeParent::LayerTreeState* state = CompositorBridgeParent::GetIndirectShadowTree(RootLayerTreeId());
-  NS_ENSURE_TRUE(state && state->mLayerManager, );
-
-  GLContext* context = static_cast<CompositorOGL*>(state->mLayerManager->GetCompositor())->gl();
-  NS_ENSURE_TRUE(context, );
+  // Software frames are published in EndSoftwareDrawing.
+  GLContext* context = GetGLContext();
+  if (!context) {
+    return;
+  }
   NS_ENSURE_TRUE(context->IsOffscreen(), );
 
   // RenderGL is called always from Gecko compositor thread.
-  // GLScreenBuffer::PublishFrame does swap buffers and that
-  // cannot happen while reading previous frame on EmbedLiteCompositorBridgeParent::GetPlatformImage
-  // (potentially from another thread).
-  MutexAutoLock lock(mRenderMutex);
-
+  // GLScreenBuffer::PublishFrame swaps buffers. The published front surface
+  // is kept referenced in mFrameSlots, so the surface factory cannot recycle
+  // it for rendering while EmbedLiteCompositorBridgeParent::GetPlatformImage
+  // may still read it from another thread.
   GLScreenBuffer* screen = context->Screen();
   MOZ_ASSERT(screen);
 
+  // Capture readback of the previous frame should be complete by now.
+  mFrameCapture.FinishReadbackGL(context);
+  if (mFrameCapture.WantsFrame()) {
+    ScopedBindFramebuffer autoFB(context, 0);
+    mFrameCapture.ReadbackGL(context, screen->Size());
+    // Don't leave the readback pending until the next composite.
+    if (!mCaptureReadbackTask) {
+      mCaptureReadbackTask =
+        NewCancelableRunnableMethod("mozilla::embedlite::EmbedLiteCompositorBridgeParent::FinishCaptureReadback",
+                                    this, &EmbedLiteCompositorBridgeParent::FinishCaptureReadback);
+      CompositorThreadHolder::Loop()->PostDelayedTask(do_AddRef(mCaptureReadbackTask),
+                                                      sDefaultPaintInterval);
+    }
+  }
+
   if (screen->Size().IsEmpty() || !screen->PublishFrame(screen->Size())) {
     NS_ERROR("Failed to publish context frame");
+    return;
+  }
+
+  if (screen->Front()) {
+    mFrameSlots.Publish(RefPtr<SharedSurfaceTextureClient>(screen->Front()));
+  }
+  mPresentTime = TimeStamp::Now();
+}
+
+GLContext*
+EmbedLiteCompositorBridgeParent::GetGLContext() const
+{
+  const CompositorBridgeParent::LayerTreeState* state = CompositorBridgeParent::GetIndirectShadowTree(RootLayerTreeId());
+  NS_ENSURE_TRUE(state && state->mLayerManager, nullptr);
+
+  Compositor* compositor = state->mLayerManager->GetCompositor();
+  CompositorOGL* compositorOGL = compositor ? compositor->AsCompositorOGL() : nullptr;
+  return compositorOGL ? compositorOGL->gl() : nullptr;
+}
+
+already_AddRefed<DrawTarget>
+EmbedLiteCompositorBridgeParent::StartSoftwareDrawing()
+{
+  IntSize size;
+  {
+    MutexAutoLock lock(mRenderMutex);
+    size = IntSize(mEGLSurfaceSize.width, mEGLSurfaceSize.height);
+  }
+  NS_ENSURE_TRUE(size.width > 0 && size.height > 0, nullptr);
+
+  if (!mSoftwareTarget || mSoftwareTarget->GetSize() != size) {
+    mSoftwareTarget = Factory::CreateDrawTarget(BackendType::SKIA, size, SurfaceFormat::B8G8R8A8);
+    NS_ENSURE_TRUE(mSoftwareTarget, nullptr);
+    mSoftwareTarget->ClearRect(Rect(0, 0, size.width, size.height));
+  }
+
+  RefPtr<DrawTarget> target = mSoftwareTarget;
+  return target.forget();
+}
+
+void
+EmbedLiteCompositorBridgeParent::EndSoftwareDrawing()
+{
+  NS_ENSURE_TRUE(mSoftwareTarget, );
+
+  RefPtr<SourceSurface> snapshot = mSoftwareTarget->Snapshot();
+  RefPtr<DataSourceSurface> source = snapshot ? snapshot->GetDataSurface() : nullptr;
+  NS_ENSURE_TRUE(source, );
+
+  // Copy, the compositor only repaints the invalid region of mSoftwareTarget.
+  // The frame the embedder is done with is reused unless a capture still
+  // holds it or the size changed.
+  RefPtr<DataSourceSurface> frame = mSoftwareFrames.TakeRecycled();
+  if (!frame || frame->refCount() > 1 ||
+      frame->GetSize() != source->GetSize() || frame->GetFormat() != source->GetFormat()) {
+    frame = Factory::CreateDataSourceSurface(source->GetSize(), source->GetFormat());
+  }
+  NS_ENSURE_TRUE(frame, );
+  {
+    DataSourceSurface::ScopedMap src(source, DataSourceSurface::READ);
+    DataSourceSurface::ScopedMap dst(frame, DataSourceSurface::WRITE);
+    NS_ENSURE_TRUE(src.IsMapped() && dst.IsMapped(), );
+
+    size_t rowLength = source->GetSize().width * BytesPerPixel(source->GetFormat());
+    for (int32_t y = 0; y < source->GetSize().height; ++y) {
+      memcpy(dst.GetData() + y * dst.GetStride(), src.GetData() + y * src.GetStride(), rowLength);
+    }
+  }
+
+  if (mFrameCapture.WantsFrame()) {
+    mFrameCapture.CaptureSurface(frame);
+  }
+  mSoftwareFrames.Publish(std::move(frame));
+  mPresentTime = TimeStamp::Now();
+}
+
+bool
+EmbedLiteCompositorBridgeParent::GetSoftwareFrame(const std::function<void(const uint8_t *data, int width, int height, int stride)> &callback)
+{
+  RefPtr<DataSourceSurface>* frame = mSoftwareFrames.Acquire();
+  NS_ENSURE_TRUE(frame, false);
+
+  DataSourceSurface::ScopedMap map(*frame, DataSourceSurface::READ);
+  NS_ENSURE_TRUE(map.IsMapped(), false);
+  callback(map.GetData(), (*frame)->GetSize().width, (*frame)->GetSize().height, map.GetStride());
+  return true;
+}
+
+void
+EmbedLiteCompositorBridgeParent::CaptureFrame(const IntRect &aCrop, const IntSize &aSize,
+                                              const EmbedLiteCaptureCallback &aCallback)
+{
+  mFrameCapture.Request(aCrop, aSize, aCallback);
+  // Make sure there is a frame to capture also when the content is static.
+  ScheduleRenderOnCompositorThread();
+}
+
+void
+EmbedLiteCompositorBridgeParent::FinishCaptureReadback()
+{
+  mCaptureReadbackTask = nullptr;
+  GLContext* context = GetGLContext();
+  NS_ENSURE_TRUE(context && context->MakeCurrent(), );
+  mFrameCapture.FinishReadbackGL(context);
+}
+
+void
+EmbedLiteCompositorBridgeParent::ReleaseCaptureResources()
+{
+  if (mCaptureReadbackTask) {
+    mCaptureReadbackTask->Cancel();
+    mCaptureReadbackTask = nullptr;
+  }
+  GLContext* context = GetGLContext();
+  if (context && context->MakeCurrent()) {
+    mFrameCapture.ReleaseGL(context);
   }
 }
 
@@ -196,6 +389,13 @@ bool EmbedLiteCompositorBridgeParent::GetScrollableRect(CSSRect &scrollableRect)
   return true;
 }
 
+IntSize
+EmbedLiteCompositorBridgeParent::GetSurfaceSize()
+{
+  MutexAutoLock lock(mRenderMutex);
+  return IntSize(mEGLSurfaceSize.width, mEGLSurfaceSize.height);
+}
+
 void EmbedLiteCompositorBridgeParent::SetSurfaceRect(int x, int y, int width, int height)
 {
   if (width > 0 && height > 0 && (mEGLSurfaceSize.width != width ||
@@ -211,18 +411,10 @@ void EmbedLiteCompositorBridgeParent::SetSurfaceRect(int x, int y, int width, in
 void
 EmbedLiteCompositorBridgeParent::GetPlatformImage(const std::function<void(void *image, int width, int height)> &callback)
 {
-  MutexAutoLock lock(mRenderMutex);
-  const CompositorBridgeParent::LayerTreeState* state = CompositorBridgeParent::GetIndirectShadowTree(RootLayerTreeId());
-  NS_ENSURE_TRUE(state && state->mLayerManager, );
-
-  GLContext* context = static_cast<CompositorOGL*>(state->mLayerManager->GetCompositor())->gl();
-  NS_ENSURE_TRUE(context, );
-  NS_ENSURE_TRUE(context->IsOffscreen(), );
-
-  GLScreenBuffer* screen = context->Screen();
-  MOZ_ASSERT(screen);
-  NS_ENSURE_TRUE(screen->Front(),);
-  SharedSurface* sharedSurf = screen->Front()->Surf();
+  // Newest completed frame, owned by this (consumer) side until the next call.
+  RefPtr<SharedSurfaceTextureClient>* frame = mFrameSlots.Acquire();
+  NS_ENSURE_TRUE(frame, );
+  SharedSurface* sharedSurf = (*frame)->Surf();
   NS_ENSURE_TRUE(sharedSurf, );
 
   sharedSurf->ProducerReadAcquire();
@@ -239,18 +431,10 @@ EmbedLiteCompositorBridgeParent::GetPlatformImage(const std::function<void(void
 void*
 EmbedLiteCompositorBridgeParent::GetPlatformImage(int* width, int* height)
 {
-  MutexAutoLock lock(mRenderMutex);
-  const CompositorBridgeParent::LayerTreeState* state = CompositorBridgeParent::GetIndirectShadowTree(RootLayerTreeId());
-  NS_ENSURE_TRUE(state && state->mLayerManager, nullptr);
-
-  GLContext* context = static_cast<CompositorOGL*>(state->mLayerManager->GetCompositor())->gl();
-  NS_ENSURE_TRUE(context, nullptr);
-  NS_ENSURE_TRUE(context->IsOffscreen(), nullptr);
-
-  GLScreenBuffer* screen = context->Screen();
-  MOZ_ASSERT(screen);
-  NS_ENSURE_TRUE(screen->Front(), nullptr);
-  SharedSurface* sharedSurf = screen->Front()->Surf();
+  // The returned image stays valid until the next GetPlatformImage call.
+  RefPtr<SharedSurfaceTextureClient>* frame = mFrameSlots.Acquire();
+  NS_ENSURE_TRUE(frame, nullptr);
+  SharedSurface* sharedSurf = (*frame)->Surf();
   NS_ENSURE_TRUE(sharedSurf, nullptr);
   // sharedSurf->WaitSync();
   // ProducerAcquireImpl & ProducerReleaseImpl ?
@@ -6,10 +6,14 @@
 #ifndef mozilla_layers_EmbedLiteCompositorBridgeParent_h
 #define mozilla_layers_EmbedLiteCompositorBridgeParent_h
 
+#include "EmbedLiteFrameCapture.h"
+#include "EmbedLiteFrameSlots.h"
+#include "EmbedLiteFrameTiming.h"
 #include "Layers.h"
 #include "base/task.h" // for CancelableRunnable
 #include "mozilla/Mutex.h"
 #include "mozilla/WidgetUtils.h"
+#include "mozilla/gfx/2D.h"
 #include "mozilla/layers/CompositorBridgeChild.h"
 #include "mozilla/layers/CompositorBridgeParent.h"
 #include "mozilla/layers/CompositorManagerParent.h"
@@ -18,8 +22,13 @@
 
 namespace mozilla {
 
+namespace gl {
+class GLContext;
+}
+
 namespace layers {
 class LayerManagerComposite;
+class SharedSurfaceTextureClient;
 }
 
 namespace embedlite {
@@ -46,25 +55,80 @@ public:
   void PresentOffscreenSurface();
 
   bool GetScrollableRect(CSSRect &scrollableRect);
+  gfx::IntSize GetSurfaceSize();
+
+  // Software compositing (embedlite.compositor.software). The basic
+  // compositor draws through nsWindow into a CPU side target and every
+  // finished frame is copied into mSoftwareFrames for GetSoftwareFrame.
+  already_AddRefed<gfx::DrawTarget> StartSoftwareDrawing();
+  void EndSoftwareDrawing();
+  bool GetSoftwareFrame(const std::function<void(const uint8_t *data, int width, int height, int stride)> &callback);
+
+  // See EmbedLiteWindow::CaptureFrame.
+  void CaptureFrame(const gfx::IntRect &aCrop, const gfx::IntSize &aSize, const EmbedLiteCaptureCallback &aCallback);
+
+  uint64_t PublishedFrames() const { return mFrameSlots.PublishedFrames() + mSoftwareFrames.PublishedFrames(); }
+  uint64_t DroppedFrames() const { return mFrameSlots.DroppedFrames() + mSoftwareFrames.DroppedFrames(); }
+  uint64_t FrameSlotContention() const { return mFrameSlots.SlotContention() + mSoftwareFrames.SlotContention(); }
+  bool GetFrameTimingStats(EmbedLiteFrameTimingStats* aStats) const { return mFrameTiming.GetStats(aStats); }
+  // See EmbedLiteFrameTiming, callable from any thread.
+  void NoteInputSample(const TimeStamp& aSample) { mFrameTiming.NoteInputSample(aSample); }
+  bool GetLastVsync(TimeStamp* aVsync, TimeDuration* aInterval) const { return mFrameTiming.GetLastVsync(aVsync, aInterval); }
 
 protected:
   friend class EmbedLitePuppetWidget;
 
+  // Not bound to a window yet, see EmbedLiteCompositorProcessParent.
+  EmbedLiteCompositorBridgeParent(mozilla::layers::CompositorManagerParent *aManager,
+                                  CSSToLayoutDeviceScale aScale,
+                                  const TimeDuration &aVsyncRate,
+                                  const CompositorOptions &aOptions,
+                                  bool aRenderToEGLSurface,
+                                  const gfx::IntSize &aSurfaceSize);
   virtual ~EmbedLiteCompositorBridgeParent();
+
+  // Hands this to the EmbedLiteWindowParent of mWindowId.
+  void AttachToWindow();
+
   virtual PLayerTransactionParent*
   AllocPLayerTransactionParent(const nsTArray<LayersBackend>& aBackendHints,
                                const LayersId& aId) override;
   virtual bool DeallocPLayerTransactionParent(PLayerTransactionParent* aLayers) override;
   virtual void CompositeToDefaultTarget(VsyncId aId) override;
+  virtual mozilla::ipc::IPCResult RecvWillClose() override;
+  virtual void ActorDestroy(ActorDestroyReason aWhy) override;
+
+  uint32_t mWindowId;
 
 private:
   void PrepareOffscreen();
+  // Null when not compositing with OpenGL.
+  mozilla::gl::GLContext* GetGLContext() const;
+  // Completes a pipelined capture readback if no new frame did it already.
+  void FinishCaptureReadback();
+  // Frees the capture's GL objects while the GL context is still around.
+  void ReleaseCaptureResources();
 
-  uint32_t mWindowId;
   RefPtr<CancelableRunnable> mCurrentCompositeTask;
   ScreenIntPoint mSurfaceOrigin;
   bool mUseExternalGLContext;
+  // Guards the surface size against SetSurfaceRect, frames are handed over
+  // to GetPlatformImage through mFrameSlots without locking.
   Mutex mRenderMutex;
+  EmbedLiteFrameSlots<RefPtr<mozilla::layers::SharedSurfaceTextureClient>> mFrameSlots;
+
+  EmbedLiteFrameTiming mFrameTiming;
+  uint32_t mFrameTimingReportInterval;
+  // Set by PresentOffscreenSurface while compositing the current frame.
+  TimeStamp mPresentTime;
+
+  // Compositor thread only.
+  RefPtr<gfx::DrawTarget> mSoftwareTarget;
+  EmbedLiteFrameSlots<RefPtr<gfx::DataSourceSurface>> mSoftwareFrames;
+
+  EmbedLiteFrameCapture mFrameCapture;
+  // At most one FinishCaptureReadback is pending.
+  RefPtr<CancelableRunnable> mCaptureReadbackTask;
 
   DISALLOW_EVIL_CONSTRUCTORS(EmbedLiteCompositorBridgeParent);
 };
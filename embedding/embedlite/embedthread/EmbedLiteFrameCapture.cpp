@@ -0,0 +1,283 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLiteFrameCapture.h"
+#include "GLContext.h"
+#include "base/message_loop.h"
+#include "mozilla/Preferences.h"
+#include "mozilla/SharedThreadPool.h"
+#include "mozilla/gfx/Swizzle.h"
+#include "nsThreadUtils.h"
+
+using namespace mozilla::gfx;
+using namespace mozilla::gl;
+
+namespace mozilla {
+namespace embedlite {
+
+EmbedLiteFrameCapture::EmbedLiteFrameCapture()
+  : mMutex("EmbedLiteFrameCapture")
+  , mPendingCount(0)
+  , mMinInterval(100)
+  , mPixelBuffer(0)
+{
+  Preferences::AddUintVarCache(&mMinInterval,
+                               "embedlite.compositor.capture_min_interval", 100);
+}
+
+EmbedLiteFrameCapture::~EmbedLiteFrameCapture()
+{
+  MOZ_ASSERT(mPending.empty() && mInFlight.empty(), "Shutdown not called");
+}
+
+void
+EmbedLiteFrameCapture::Request(const IntRect& aCrop, const IntSize& aSize,
+                               const EmbedLiteCaptureCallback& aCallback)
+{
+  PendingRequest request = { aCrop, aSize, aCallback, MessageLoop::current() };
+  MOZ_ASSERT(request.mReplyLoop, "Capture requested from a thread without MessageLoop");
+
+  MutexAutoLock lock(mMutex);
+  mPending.push_back(std::move(request));
+  ++mPendingCount;
+}
+
+bool
+EmbedLiteFrameCapture::WantsFrame() const
+{
+  if (!mPendingCount || !mInFlight.empty()) {
+    return false;
+  }
+  return mLastCapture.IsNull() ||
+         (TimeStamp::Now() - mLastCapture).ToMilliseconds() >= mMinInterval;
+}
+
+bool
+EmbedLiteFrameCapture::StartCapture(std::vector<PendingRequest>& aRequests)
+{
+  MutexAutoLock lock(mMutex);
+  aRequests.swap(mPending);
+  mPendingCount = 0;
+  mLastCapture = TimeStamp::Now();
+  return !aRequests.empty();
+}
+
+void
+EmbedLiteFrameCapture::ReadbackGL(GLContext* aContext, const IntSize& aSize)
+{
+  MOZ_ASSERT(mInFlight.empty());
+  std::vector<PendingRequest> requests;
+  if (aSize.IsEmpty() || !StartCapture(requests)) {
+    return;
+  }
+
+  bool pipelined = aContext->IsSupported(GLFeature::map_buffer_range) &&
+                   (!aContext->IsGLES() || aContext->IsAtLeast(ContextProfile::OpenGLES, 300));
+  size_t bytes = size_t(aSize.width) * aSize.height * 4;
+
+  if (pipelined) {
+    if (mPixelBuffer && mPixelBufferSize != aSize) {
+      aContext->fDeleteBuffers(1, &mPixelBuffer);
+      mPixelBuffer = 0;
+    }
+    if (!mPixelBuffer) {
+      aContext->fGenBuffers(1, &mPixelBuffer);
+      aContext->fBindBuffer(LOCAL_GL_PIXEL_PACK_BUFFER, mPixelBuffer);
+      aContext->fBufferData(LOCAL_GL_PIXEL_PACK_BUFFER, bytes, nullptr, LOCAL_GL_STREAM_READ);
+      mPixelBufferSize = aSize;
+    } else {
+      aContext->fBindBuffer(LOCAL_GL_PIXEL_PACK_BUFFER, mPixelBuffer);
+    }
+    // Returns immediately, the copy completes asynchronously on the GPU.
+    aContext->fReadPixels(0, 0, aSize.width, aSize.height, LOCAL_GL_RGBA, LOCAL_GL_UNSIGNED_BYTE, nullptr);
+    aContext->fBindBuffer(LOCAL_GL_PIXEL_PACK_BUFFER, 0);
+    mInFlight.swap(requests);
+    return;
+  }
+
+  // No pixel buffer objects, read synchronously. Rate limited by mMinInterval.
+  RefPtr<DataSourceSurface> pixels = Factory::CreateDataSourceSurface(aSize, SurfaceFormat::R8G8B8A8);
+  if (pixels) {
+    DataSourceSurface::ScopedMap map(pixels, DataSourceSurface::READ_WRITE);
+    if (map.IsMapped() && map.GetStride() == aSize.width * 4) {
+      aContext->fReadPixels(0, 0, aSize.width, aSize.height, LOCAL_GL_RGBA, LOCAL_GL_UNSIGNED_BYTE, map.GetData());
+    } else {
+      pixels = nullptr;
+    }
+  }
+  Deliver(pixels, std::move(requests));
+}
+
+void
+EmbedLiteFrameCapture::FinishReadbackGL(GLContext* aContext)
+{
+  if (mInFlight.empty()) {
+    return;
+  }
+
+  std::vector<PendingRequest> requests;
+  requests.swap(mInFlight);
+
+  RefPtr<DataSourceSurface> pixels = Factory::CreateDataSourceSurface(mPixelBufferSize, SurfaceFormat::R8G8B8A8);
+  aContext->fBindBuffer(LOCAL_GL_PIXEL_PACK_BUFFER, mPixelBuffer);
+  size_t bytes = size_t(mPixelBufferSize.width) * mPixelBufferSize.height * 4;
+  void* data = aContext->fMapBufferRange(LOCAL_GL_PIXEL_PACK_BUFFER, 0, bytes, LOCAL_GL_MAP_READ_BIT);
+  if (data && pixels) {
+    DataSourceSurface::ScopedMap map(pixels, DataSourceSurface::WRITE);
+    if (map.IsMapped()) {
+      for (int32_t y = 0; y < mPixelBufferSize.height; ++y) {
+        memcpy(map.GetData() + y * map.GetStride(),
+               static_cast<uint8_t*>(data) + y * mPixelBufferSize.width * 4,
+               mPixelBufferSize.width * 4);
+      }
+    }
+  } else {
+    pixels = nullptr;
+  }
+  if (data) {
+    aContext->fUnmapBuffer(LOCAL_GL_PIXEL_PACK_BUFFER);
+  }
+  aContext->fBindBuffer(LOCAL_GL_PIXEL_PACK_BUFFER, 0);
+
+  Deliver(pixels, std::move(requests));
+}
+
+void
+EmbedLiteFrameCapture::CaptureSurface(DataSourceSurface* aFrame)
+{
+  std::vector<PendingRequest> requests;
+  if (StartCapture(requests)) {
+    Deliver(aFrame, std::move(requests));
+  }
+}
+
+void
+EmbedLiteFrameCapture::ReleaseGL(GLContext* aContext)
+{
+  FinishReadbackGL(aContext);
+  if (mPixelBuffer) {
+    aContext->fDeleteBuffers(1, &mPixelBuffer);
+    mPixelBuffer = 0;
+  }
+}
+
+void
+EmbedLiteFrameCapture::Shutdown(GLContext* aContext)
+{
+  if (aContext) {
+    ReleaseGL(aContext);
+  }
+  NS_WARNING_ASSERTION(!mPixelBuffer, "Capture pixel buffer leaked");
+  mPixelBuffer = 0;
+
+  std::vector<PendingRequest> requests;
+  requests.swap(mInFlight);
+  {
+    MutexAutoLock lock(mMutex);
+    requests.insert(requests.end(), mPending.begin(), mPending.end());
+    mPending.clear();
+    mPendingCount = 0;
+  }
+  for (const PendingRequest& request : requests) {
+    Reply(request, nullptr);
+  }
+}
+
+void
+EmbedLiteFrameCapture::Deliver(RefPtr<DataSourceSurface> aFrame, std::vector<PendingRequest>&& aRequests)
+{
+  RefPtr<SharedThreadPool> pool = SharedThreadPool::Get(NS_LITERAL_CSTRING("EmbedLiteCapture"), 1);
+  std::vector<PendingRequest> requests(std::move(aRequests));
+  nsresult rv = pool->Dispatch(NS_NewRunnableFunction("mozilla::embedlite::EmbedLiteFrameCapture::Deliver",
+                                                      [frame = std::move(aFrame), requests]() {
+    // GL readbacks are bottom up RGBA, software frames top down BGRA.
+    RefPtr<DataSourceSurface> source = frame;
+    if (source && source->GetFormat() == SurfaceFormat::R8G8B8A8) {
+      IntSize size = source->GetSize();
+      source = Factory::CreateDataSourceSurface(size, SurfaceFormat::B8G8R8A8);
+      if (source) {
+        DataSourceSurface::ScopedMap src(frame, DataSourceSurface::READ);
+        DataSourceSurface::ScopedMap dst(source, DataSourceSurface::WRITE);
+        if (!src.IsMapped() || !dst.IsMapped()) {
+          source = nullptr;
+        } else {
+          for (int32_t y = 0; y < size.height; ++y) {
+            SwizzleData(src.GetData() + (size.height - 1 - y) * src.GetStride(), src.GetStride(), SurfaceFormat::R8G8B8A8,
+                        dst.GetData() + y * dst.GetStride(), dst.GetStride(), SurfaceFormat::B8G8R8A8,
+                        IntSize(size.width, 1));
+          }
+        }
+      }
+    }
+
+    for (const PendingRequest& request : requests) {
+      if (!source) {
+        Reply(request, nullptr);
+        continue;
+      }
+
+      IntRect bounds(IntPoint(), source->GetSize());
+      IntRect crop = request.mCrop.IsEmpty() ? bounds : request.mCrop.Intersect(bounds);
+      IntSize size = request.mSize.IsEmpty() ? crop.Size() : request.mSize;
+      if (crop.IsEmpty()) {
+        Reply(request, nullptr);
+        continue;
+      }
+      if (crop.IsEqualEdges(bounds) && size == bounds.Size()) {
+        Reply(request, source);
+        continue;
+      }
+
+      RefPtr<DataSourceSurface> image = Factory::CreateDataSourceSurface(size, SurfaceFormat::B8G8R8A8, true);
+      if (image) {
+        DataSourceSurface::ScopedMap map(image, DataSourceSurface::WRITE);
+        RefPtr<DrawTarget> target = map.IsMapped() ?
+          Factory::CreateDrawTargetForData(BackendType::SKIA, map.GetData(), size, map.GetStride(), SurfaceFormat::B8G8R8A8) :
+          nullptr;
+        if (target) {
+          target->DrawSurface(source, Rect(0, 0, size.width, size.height), Rect(crop),
+                              DrawSurfaceOptions(SamplingFilter::GOOD),
+                              DrawOptions(1.0f, CompositionOp::OP_SOURCE));
+          target->Flush();
+        } else {
+          image = nullptr;
+        }
+      }
+      Reply(request, image);
+    }
+  }), NS_DISPATCH_NORMAL);
+
+  if (NS_FAILED(rv)) {
+    LOGE("Failed to dispatch frame capture");
+    for (const PendingRequest& request : requests) {
+      Reply(request, nullptr);
+    }
+  }
+}
+
+void
+EmbedLiteFrameCapture::Reply(const PendingRequest& aRequest, DataSourceSurface* aImage)
+{
+  RefPtr<DataSourceSurface> image = aImage;
+  EmbedLiteCaptureCallback callback = aRequest.mCallback;
+  aRequest.mReplyLoop->PostTask(NS_NewRunnableFunction("mozilla::embedlite::EmbedLiteFrameCapture::Reply",
+                                                       [image, callback]() {
+    if (!image) {
+      callback(false, nullptr, 0, 0, 0);
+      return;
+    }
+    DataSourceSurface::ScopedMap map(image, DataSourceSurface::READ);
+    if (!map.IsMapped()) {
+      callback(false, nullptr, 0, 0, 0);
+      return;
+    }
+    callback(true, map.GetData(), image->GetSize().width, image->GetSize().height, map.GetStride());
+  }));
+}
+
+} // namespace embedlite
+} // namespace mozilla
@@ -0,0 +1,97 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_FRAME_CAPTURE_H
+#define MOZ_EMBED_LITE_FRAME_CAPTURE_H
+
+#include "EmbedLiteWindow.h"
+#include "mozilla/Atomics.h"
+#include "mozilla/Mutex.h"
+#include "mozilla/TimeStamp.h"
+#include "mozilla/gfx/2D.h"
+
+#include <vector>
+
+class MessageLoop;
+
+namespace mozilla {
+
+namespace gl {
+class GLContext;
+}
+
+namespace embedlite {
+
+/**
+ * Snapshots of composited frames for thumbnails and previews.
+ *
+ * Requests can be made from any thread with a MessageLoop and are answered
+ * on that loop. The compositor thread only grabs the frame: with GL it
+ * starts a readback into a pixel buffer object which is mapped one frame
+ * later (or reads synchronously when PBOs are not available), with software
+ * compositing it takes the already copied frame. Cropping, scaling and
+ * format conversion happen on a background thread.
+ *
+ * At most one readback is in flight and consecutive readbacks are at least
+ * embedlite.compositor.capture_min_interval ms apart, all requests pending
+ * at that point are served from the same frame.
+ */
+class EmbedLiteFrameCapture
+{
+public:
+  EmbedLiteFrameCapture();
+  ~EmbedLiteFrameCapture();
+
+  // aCrop in frame pixels with top left origin, empty for the whole frame.
+  // aSize is the size of the delivered image, empty to keep the crop size.
+  void Request(const gfx::IntRect& aCrop, const gfx::IntSize& aSize,
+               const EmbedLiteCaptureCallback& aCallback);
+
+  // Compositor thread. Cheap when nothing is pending.
+  bool WantsFrame() const;
+  // Compositor thread, with the composited frame bound for reading.
+  void ReadbackGL(gl::GLContext* aContext, const gfx::IntSize& aSize);
+  // Compositor thread, completes a pipelined readback of the previous frame.
+  void FinishReadbackGL(gl::GLContext* aContext);
+  // Compositor thread, aFrame must not be modified afterwards.
+  void CaptureSurface(gfx::DataSourceSurface* aFrame);
+
+  // Compositor thread with aContext current. Completes a pending readback
+  // and deletes the pixel buffer, which is created again when needed.
+  void ReleaseGL(gl::GLContext* aContext);
+
+  // Compositor thread, fails all pending requests. Without aContext the
+  // pixel buffer must have been released with ReleaseGL already.
+  void Shutdown(gl::GLContext* aContext);
+
+private:
+  struct PendingRequest {
+    gfx::IntRect mCrop;
+    gfx::IntSize mSize;
+    EmbedLiteCaptureCallback mCallback;
+    MessageLoop* mReplyLoop;
+  };
+
+  bool StartCapture(std::vector<PendingRequest>& aRequests);
+  static void Deliver(RefPtr<gfx::DataSourceSurface> aFrame, std::vector<PendingRequest>&& aRequests);
+  static void Reply(const PendingRequest& aRequest, gfx::DataSourceSurface* aImage);
+
+  Mutex mMutex;
+  std::vector<PendingRequest> mPending;
+  Atomic<uint32_t> mPendingCount;
+  uint32_t mMinInterval;
+  TimeStamp mLastCapture;
+
+  // Pipelined GL readback.
+  uint32_t mPixelBuffer;
+  gfx::IntSize mPixelBufferSize;
+  // Requests waiting for the readback in mPixelBuffer.
+  std::vector<PendingRequest> mInFlight;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_FRAME_CAPTURE_H
@@ -0,0 +1,152 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_FRAME_SLOTS_H
+#define MOZ_EMBED_LITE_FRAME_SLOTS_H
+
+#include "mozilla/Atomics.h"
+
+#include <stdint.h>
+#include <utility>
+
+namespace mozilla {
+namespace embedlite {
+
+/*
+ * Triple buffered hand off of frames between a single producer (compositor
+ * thread) and a single consumer (embedder render thread).
+ *
+ * Each side owns one slot exclusively and the third one holds the newest
+ * completed frame. Publish and Acquire only exchange slot indices with a
+ * compare and swap, so neither side ever waits for the other. A frame that
+ * is replaced before the consumer picked it up is counted as dropped.
+ */
+template<typename T>
+class EmbedLiteFrameSlots
+{
+public:
+  EmbedLiteFrameSlots()
+    : mSlots()
+    , mState(Pack(0, 1, 2, false))
+    , mPublished(0)
+    , mDropped(0)
+    , mContention(0)
+  {
+  }
+
+  // Producer side. Stores aFrame as the newest frame and takes the slot of
+  // the previous newest frame as the next back buffer.
+  void Publish(T&& aFrame)
+  {
+    uint32_t state = mState;
+    mSlots[Back(state)] = std::move(aFrame);
+
+    uint32_t next;
+    do {
+      next = Pack(Ready(state), Back(state), Front(state), true);
+    } while (!CompareExchange(state, next));
+
+    ++mPublished;
+    // The replaced frame is the back buffer now. Retire leaves empty ones.
+    if (IsFresh(state) && mSlots[Ready(state)]) {
+      ++mDropped;
+    }
+  }
+
+  // Producer side. Drops the back buffer and the newest frame, Acquire
+  // returns nullptr until the next Publish. The frame the consumer holds
+  // is left alone, it comes back to the producer with the consumer's next
+  // Acquire and is dropped by a later Publish.
+  void Retire()
+  {
+    uint32_t state = mState;
+    mSlots[Back(state)] = T();
+
+    uint32_t next;
+    do {
+      next = Pack(Ready(state), Back(state), Front(state), true);
+    } while (!CompareExchange(state, next));
+
+    // The previous newest frame, handed to the producer by the exchange.
+    if (IsFresh(state) && mSlots[Ready(state)]) {
+      ++mDropped;
+    }
+    mSlots[Ready(state)] = T();
+  }
+
+  // Producer side. Takes the frame left in the back buffer, the one the
+  // last Publish replaced or the consumer moved away from, so its storage
+  // can be reused for the next frame. Empty before the third Publish.
+  T TakeRecycled()
+  {
+    return std::move(mSlots[Back(mState)]);
+  }
+
+  // Consumer side. Switches to the newest published frame if there is one
+  // and returns the frame owned by the consumer, which stays untouched by
+  // the producer until the next Acquire. Returns nullptr before the first
+  // Publish.
+  T* Acquire()
+  {
+    uint32_t state = mState;
+    uint32_t next;
+    do {
+      if (!IsFresh(state)) {
+        break;
+      }
+      next = Pack(Back(state), Front(state), Ready(state), false);
+    } while (!CompareExchange(state, next));
+
+    T& frame = mSlots[Front(mState)];
+    return frame ? &frame : nullptr;
+  }
+
+  // Drops all frames, neither side may use the slots concurrently, nor
+  // hold on to a frame. Retire is what the producer uses while running.
+  void Clear()
+  {
+    for (T& slot : mSlots) {
+      slot = T();
+    }
+    mState = Pack(0, 1, 2, false);
+  }
+
+  uint64_t PublishedFrames() const { return mPublished; }
+  uint64_t DroppedFrames() const { return mDropped; }
+  // Number of compare and swap retries, i.e. how often both sides raced.
+  uint64_t SlotContention() const { return mContention; }
+
+private:
+  // Layout: bits 0-1 back, 2-3 ready, 4-5 front, bit 6 unread ready frame.
+  static uint32_t Pack(uint32_t aBack, uint32_t aReady, uint32_t aFront, bool aFresh)
+  {
+    return aBack | (aReady << 2) | (aFront << 4) | (aFresh ? 1 << 6 : 0);
+  }
+  static uint32_t Back(uint32_t aState) { return aState & 3; }
+  static uint32_t Ready(uint32_t aState) { return (aState >> 2) & 3; }
+  static uint32_t Front(uint32_t aState) { return (aState >> 4) & 3; }
+  static bool IsFresh(uint32_t aState) { return aState & (1 << 6); }
+
+  bool CompareExchange(uint32_t& aState, uint32_t aNext)
+  {
+    if (mState.compareExchange(aState, aNext)) {
+      return true;
+    }
+    ++mContention;
+    aState = mState;
+    return false;
+  }
+
+  T mSlots[3];
+  Atomic<uint32_t> mState;
+  Atomic<uint64_t, Relaxed> mPublished;
+  Atomic<uint64_t, Relaxed> mDropped;
+  Atomic<uint64_t, Relaxed> mContention;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_FRAME_SLOTS_H
@@ -0,0 +1,137 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLiteFrameTiming.h"
+
+#include <algorithm>
+
+namespace mozilla {
+namespace embedlite {
+
+static void
+ComputePercentiles(float* aSamples, uint32_t aCount,
+                   EmbedLiteFrameTimingStats::Percentiles* aResult)
+{
+  if (!aCount) {
+    aResult->p50 = aResult->p95 = aResult->p99 = 0;
+    return;
+  }
+
+  std::sort(aSamples, aSamples + aCount);
+  // Nearest rank.
+  auto rank = [aCount](uint32_t aPercent) {
+    uint32_t index = (aPercent * aCount + 99) / 100;
+    return std::max(index, 1u) - 1;
+  };
+  aResult->p50 = aSamples[rank(50)];
+  aResult->p95 = aSamples[rank(95)];
+  aResult->p99 = aSamples[rank(99)];
+}
+
+EmbedLiteFrameTiming::EmbedLiteFrameTiming(const TimeDuration& aVsyncInterval)
+  : mVsyncInterval(aVsyncInterval)
+  , mMutex("EmbedLiteFrameTiming")
+  , mNext(0)
+  , mCount(0)
+  , mSinceReport(0)
+{
+}
+
+bool
+EmbedLiteFrameTiming::Record(const EmbedLiteFrameTimingRecord& aRecord, uint32_t aReportInterval)
+{
+  MutexAutoLock lock(mMutex);
+  mRecords[mNext] = aRecord;
+  if (!aRecord.mPresent.IsNull()) {
+    mRecords[mNext].mInputSample = mPendingInput;
+    mPendingInput = TimeStamp();
+  }
+  if (!aRecord.mVsync.IsNull()) {
+    mLastVsync = aRecord.mVsync;
+  }
+  mNext = (mNext + 1) % kCapacity;
+  mCount = std::min(mCount + 1, kCapacity);
+
+  if (!aReportInterval || ++mSinceReport < aReportInterval) {
+    return false;
+  }
+  mSinceReport = 0;
+  return true;
+}
+
+bool
+EmbedLiteFrameTiming::GetStats(EmbedLiteFrameTimingStats* aStats) const
+{
+  float composite[kCapacity];
+  float vsyncToPresent[kCapacity];
+  float mutexWait[kCapacity];
+  float inputToPresent[kCapacity];
+  uint32_t presented = 0;
+  uint32_t inputFrames = 0;
+  uint32_t jankFrames = 0;
+  uint32_t skippedVsyncs = 0;
+
+  uint32_t count;
+  {
+    MutexAutoLock lock(mMutex);
+    count = mCount;
+    for (uint32_t i = 0; i < count; ++i) {
+      const EmbedLiteFrameTimingRecord& record = mRecords[i];
+      composite[i] = (record.mCompositeEnd - record.mCompositeStart).ToMilliseconds();
+      mutexWait[i] = record.mMutexWait.ToMilliseconds();
+      if (!record.mInputSample.IsNull()) {
+        inputToPresent[inputFrames++] = (record.mPresent - record.mInputSample).ToMilliseconds();
+      }
+      if (record.mPresent.IsNull() || record.mVsync.IsNull()) {
+        continue;
+      }
+
+      TimeDuration latency = record.mPresent - record.mVsync;
+      vsyncToPresent[presented++] = latency.ToMilliseconds();
+      if (mVsyncInterval > TimeDuration() && latency > mVsyncInterval) {
+        ++jankFrames;
+        skippedVsyncs += uint32_t(latency / mVsyncInterval);
+      }
+    }
+  }
+
+  if (!count) {
+    return false;
+  }
+
+  aStats->frames = count;
+  ComputePercentiles(composite, count, &aStats->composite);
+  ComputePercentiles(vsyncToPresent, presented, &aStats->vsyncToPresent);
+  ComputePercentiles(mutexWait, count, &aStats->mutexWait);
+  aStats->jankFrames = jankFrames;
+  aStats->skippedVsyncs = skippedVsyncs;
+  aStats->inputFrames = inputFrames;
+  ComputePercentiles(inputToPresent, inputFrames, &aStats->inputToPresent);
+  return true;
+}
+
+void
+EmbedLiteFrameTiming::NoteInputSample(const TimeStamp& aSample)
+{
+  MutexAutoLock lock(mMutex);
+  if (mPendingInput.IsNull() || aSample < mPendingInput) {
+    mPendingInput = aSample;
+  }
+}
+
+bool
+EmbedLiteFrameTiming::GetLastVsync(TimeStamp* aVsync, TimeDuration* aInterval) const
+{
+  MutexAutoLock lock(mMutex);
+  if (mLastVsync.IsNull() || mVsyncInterval <= TimeDuration()) {
+    return false;
+  }
+  *aVsync = mLastVsync;
+  *aInterval = mVsyncInterval;
+  return true;
+}
+
+} // namespace embedlite
+} // namespace mozilla
@@ -0,0 +1,67 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_FRAME_TIMING_H
+#define MOZ_EMBED_LITE_FRAME_TIMING_H
+
+#include "EmbedLiteWindow.h"
+#include "mozilla/Mutex.h"
+#include "mozilla/TimeStamp.h"
+
+namespace mozilla {
+namespace embedlite {
+
+struct EmbedLiteFrameTimingRecord
+{
+  TimeStamp mVsync;
+  TimeStamp mCompositeStart;
+  TimeStamp mCompositeEnd;
+  // Null if the frame was not presented.
+  TimeStamp mPresent;
+  TimeDuration mMutexWait;
+  // Oldest touch sample handed to APZ since the previous presented frame.
+  TimeStamp mInputSample;
+};
+
+/**
+ * Keeps timing of the last kCapacity composited frames of one window in a
+ * ring buffer and summarizes them into EmbedLiteFrameTimingStats.
+ *
+ * Frames are recorded from the compositor thread, statistics can be
+ * queried from any thread.
+ */
+class EmbedLiteFrameTiming
+{
+public:
+  static constexpr uint32_t kCapacity = 256;
+
+  explicit EmbedLiteFrameTiming(const TimeDuration& aVsyncInterval);
+
+  // Returns true when aReportInterval frames were recorded since the
+  // previous report, 0 never reports.
+  bool Record(const EmbedLiteFrameTimingRecord& aRecord, uint32_t aReportInterval);
+  bool GetStats(EmbedLiteFrameTimingStats* aStats) const;
+
+  // Called from the APZ controller thread for input that affects the next
+  // frame, the next presented frame picks up the oldest sample.
+  void NoteInputSample(const TimeStamp& aSample);
+  // Vsync of the newest frame, false before the first vsync driven frame.
+  bool GetLastVsync(TimeStamp* aVsync, TimeDuration* aInterval) const;
+
+private:
+  TimeDuration mVsyncInterval;
+  mutable Mutex mMutex;
+  EmbedLiteFrameTimingRecord mRecords[kCapacity];
+  uint32_t mNext;
+  uint32_t mCount;
+  uint32_t mSinceReport;
+  TimeStamp mPendingInput;
+  TimeStamp mLastVsync;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_FRAME_TIMING_H
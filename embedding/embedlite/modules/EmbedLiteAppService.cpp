@@ -28,11 +28,12 @@
 #include "nsIWebBrowser.h"
 #include "apz/src/AsyncPanZoomController.h" // for AsyncPanZoomController
 #include "mozilla/embedlite/EmbedLog.h"
+#include "mozilla/embedlite/EmbedLiteIPCTrace.h"
 // #include "xpcprivate.h"
 #include "nsPIDOMWindow.h"
-#include "mozilla/AutoRestore.h"
 #include "mozilla/dom/ScriptSettings.h"
 #include "mozilla/dom/EventTarget.h"
+#include "mozilla/dom/BrowsingContext.h"
 
 using namespace mozilla;
 using namespace mozilla::embedlite;
@@ -41,32 +42,7 @@ using namespace mozilla::gfx;
 using namespace mozilla::layers;
 using namespace mozilla::widget;
 
-namespace
-{
-  class AsyncArrayRemove : public mozilla::Runnable
-  {
-  protected:
-    nsCString mName;
-    RefPtr<EmbedLiteAppService> mService;
-    nsCOMPtr<nsIEmbedMessageListener> mListener;
-  public:
-    explicit AsyncArrayRemove(EmbedLiteAppService* service, const char* name, nsIEmbedMessageListener* aListener)
-      : mozilla::Runnable("EmbedLiteAppService::AsyncArrayRemove")
-      , mName(name)
-      , mService(service)
-      , mListener(aListener)
-    {
-    }
-
-    NS_IMETHOD Run()
-    {
-        return mService->RemoveMessageListener(mName.get(), mListener);
-    }
-  };
-}
-
 EmbedLiteAppService::EmbedLiteAppService()
-  : mHandlingMessages(false)
 {
 }
 
@@ -100,52 +76,39 @@ static EmbedLiteViewChildIface* sGetViewById(uint32_t aId)
   return view;
 }
 
-void EmbedLiteAppService::RegisterView(uint32_t aId)
+NS_IMETHODIMP
+EmbedLiteAppService::GetIDByWindow(mozIDOMWindowProxy* aWindow, uint32_t* aId)
 {
-  EmbedLiteViewChildIface* view = sGetViewById(aId);
-  NS_ENSURE_TRUE(view, );
-  mIDMap[view->GetOuterID()] = aId;
-}
+  nsCOMPtr<nsPIDOMWindowOuter> window = nsPIDOMWindowOuter::From(aWindow);
+  NS_ENSURE_TRUE(window, NS_ERROR_FAILURE);
+  dom::BrowsingContext* context = window->GetBrowsingContext();
+  NS_ENSURE_TRUE(context, NS_ERROR_FAILURE);
 
-void EmbedLiteAppService::UnregisterView(uint32_t aId)
-{
-  std::map<uint64_t, uint32_t>::iterator it;
-  for (it = mIDMap.begin(); it != mIDMap.end(); ++it) {
-    if (aId == it->second) {
-      mIDMap.erase(it);
-      break;
-    }
-  }
+  EmbedLiteAppChild* app = EmbedLiteAppChild::GetInstance();
+  NS_ENSURE_TRUE(app, NS_ERROR_FAILURE);
+  EmbedLiteViewChildIface* view = app->GetViewByBrowsingContext(context->Top());
+  *aId = view ? view->GetID() : 0;
+  return NS_OK;
 }
 
 NS_IMETHODIMP
-EmbedLiteAppService::GetIDByWindow(mozIDOMWindowProxy* aWindow, uint32_t* aId)
+EmbedLiteAppService::SendAsyncMessage(uint32_t aId, const char16_t* messageName, const char16_t* message)
 {
-  dom::AutoJSAPI jsapiChromeGuard;
-  nsCOMPtr<nsIWebNavigation> navNav(do_GetInterface(aWindow));
-  nsCOMPtr<nsIDocShellTreeItem> navItem(do_QueryInterface(navNav));
-  NS_ENSURE_TRUE(navItem, NS_ERROR_FAILURE);
-  nsCOMPtr<nsIDocShellTreeItem> rootItem;
-  navItem->GetInProcessRootTreeItem(getter_AddRefs(rootItem));
-  nsCOMPtr<mozIDOMWindowProxy> rootWin(do_GetInterface(rootItem));
-  NS_ENSURE_TRUE(rootWin, NS_ERROR_FAILURE);
-
-  nsCOMPtr<nsPIDOMWindowOuter> pwindow(do_QueryInterface(rootWin));
-  nsCOMPtr<nsPIDOMWindowOuter> outerWindow = pwindow->GetInProcessTop();
-  mozilla::dom::AutoNoJSAPI nojsapi;
-  nsCOMPtr<nsIDOMWindowUtils> utils = nsGlobalWindowOuter::Cast(outerWindow)->WindowUtils();
-  uint64_t OuterWindowID = 0;
-  utils->GetOuterWindowID(&OuterWindowID);
-  *aId = mIDMap[OuterWindowID];
+  EmbedLiteViewChildIface* view = sGetViewById(aId);
+  NS_ENSURE_TRUE(view, NS_ERROR_FAILURE);
+  view->DoSendAsyncMessage(messageName, message);
   return NS_OK;
 }
 
 NS_IMETHODIMP
-EmbedLiteAppService::SendAsyncMessage(uint32_t aId, const char16_t* messageName, const char16_t* message)
+EmbedLiteAppService::SendAsyncRequest(uint32_t aId, const char16_t* messageName, const char16_t* message,
+                                      uint32_t aTimeoutMs, nsIEmbedRequestCallback* callback, uint32_t* retval)
 {
+  NS_ENSURE_ARG(callback);
   EmbedLiteViewChildIface* view = sGetViewById(aId);
   NS_ENSURE_TRUE(view, NS_ERROR_FAILURE);
-  view->DoSendAsyncMessage(messageName, message);
+  *retval = view->DoSendAsyncRequest(nsDependentString(messageName), nsDependentString(message),
+                                     aTimeoutMs, callback);
   return NS_OK;
 }
 
@@ -165,63 +128,46 @@ EmbedLiteAppService::SendSyncMessage(uint32_t aId, const char16_t* messageName,
 NS_IMETHODIMP
 EmbedLiteAppService::AddMessageListener(const char* name, nsIEmbedMessageListener* listener)
 {
-  nsTArray<nsCOMPtr<nsIEmbedMessageListener> >* array;
-  nsDependentCString cstrname(name);
-  if (!mMessageListeners.Get(cstrname, &array)) {
-    array = new nsTArray<nsCOMPtr<nsIEmbedMessageListener> >();
-    mMessageListeners.Put(cstrname, array);
-  }
-
-  array->AppendElement(listener);
-
+  NS_ENSURE_ARG(listener);
+  mRouter.AddListener(NS_ConvertUTF8toUTF16(name), listener);
   return NS_OK;
 }
 
 NS_IMETHODIMP
 EmbedLiteAppService::RemoveMessageListener(const char* name, nsIEmbedMessageListener* aListener)
 {
-  if (mHandlingMessages) {
-    nsCOMPtr<nsIRunnable> event =
-      new AsyncArrayRemove(this, name, aListener);
-    NS_DispatchToMainThread(event, NS_DISPATCH_NORMAL);
-    return NS_OK;
-  }
-
-  nsTArray<nsCOMPtr<nsIEmbedMessageListener> >* array;
-  nsDependentCString cstrname(name);
-  if (!mMessageListeners.Get(cstrname, &array)) {
+  // Safe while messages are dispatched, running dispatches keep their listeners.
+  if (!mRouter.RemoveListener(NS_ConvertUTF8toUTF16(name), aListener)) {
     return NS_ERROR_FAILURE;
   }
+  return NS_OK;
+}
 
-  for (uint32_t i = 0; i < array->Length(); i++) {
-    nsCOMPtr<nsIEmbedMessageListener> listener = array->ElementAt(i);
-    if (listener == aListener) {
-      array->RemoveElementAt(i);
-      if (array->IsEmpty()) {
-        mMessageListeners.Remove(cstrname);
-      }
-      break;
-    }
-  }
-
+NS_IMETHODIMP
+EmbedLiteAppService::GetMessageStats(nsACString& aStats)
+{
+  mRouter.GetStats(aStats);
   return NS_OK;
 }
 
-void
-EmbedLiteAppService::HandleAsyncMessage(const char* aMessage, const nsString& aData)
+NS_IMETHODIMP
+EmbedLiteAppService::ResetMessageStats()
 {
-  AutoRestore<bool> setVisited(mHandlingMessages);
-  mHandlingMessages = true;
+  mRouter.ResetStats();
+  return NS_OK;
+}
 
-  nsTArray<nsCOMPtr<nsIEmbedMessageListener> >* array;
-  if (!mMessageListeners.Get(nsDependentCString(aMessage), &array)) {
-    return;
-  }
+NS_IMETHODIMP
+EmbedLiteAppService::GetIPCTraceStats(nsACString& aStats)
+{
+  EmbedLiteIPCTrace::GetStats(aStats);
+  return NS_OK;
+}
 
-  for (uint32_t i = 0; i < array->Length(); i++) {
-    nsCOMPtr<nsIEmbedMessageListener>& listener = array->ElementAt(i);
-    listener->OnMessageReceived(aMessage, aData.get());
-  }
+void
+EmbedLiteAppService::HandleAsyncMessage(const nsAString& aMessage, const nsAString& aData)
+{
+  mRouter.Dispatch(aMessage, aData);
 }
 
 NS_IMETHODIMP
@@ -303,45 +249,24 @@ EmbedLiteAppService::ChromeEventHandler(mozIDOMWindowProxy *aWindow, EventTarget
 NS_IMETHODIMP
 EmbedLiteAppService::GetAnyEmbedWindow(bool aActive, mozIDOMWindowProxy * *embedWindow)
 {
-  std::map<uint64_t, uint32_t>::iterator it;
-  for (it = mIDMap.begin(); it != mIDMap.end(); ++it) {
-    EmbedLiteViewChildIface* view = sGetViewById(it->second);
-    if (view) {
-      if (!aActive) {
-        nsresult rv;
-        nsCOMPtr<nsIWebBrowser> br;
-        rv = view->GetBrowser(getter_AddRefs(br));
-        NS_ENSURE_TRUE(br, rv);
-        nsCOMPtr<mozIDOMWindowProxy> domWindow;
-        br->GetContentDOMWindow(getter_AddRefs(domWindow));
-        if (!domWindow) {
-          return NS_ERROR_NOT_AVAILABLE;
-        }
-
-        nsCOMPtr<nsPIDOMWindowOuter> piWindow = nsPIDOMWindowOuter::From(domWindow);
-        piWindow.forget(embedWindow);
-        return NS_OK;
-      } else {
-        nsresult rv;
-        nsCOMPtr<nsIWebBrowser> br;
-        rv = view->GetBrowser(getter_AddRefs(br));
-        NS_ENSURE_TRUE(br, rv);
-        nsCOMPtr<nsIDocShell> docShell = do_GetInterface(br);
-        bool isActive;
-        docShell->GetIsActive(&isActive);
-        if (isActive) {
-          nsCOMPtr<mozIDOMWindowProxy> domWindow;
-          br->GetContentDOMWindow(getter_AddRefs(domWindow));
-          if (!domWindow) {
-            return NS_ERROR_NOT_AVAILABLE;
-          }
-          nsCOMPtr<nsPIDOMWindowOuter> piWindow = nsPIDOMWindowOuter::From(domWindow);
-          piWindow.forget(embedWindow);
-          return NS_OK;
-        }
-      }
-    }
+  EmbedLiteAppChild* app = EmbedLiteAppChild::GetInstance();
+  NS_ENSURE_TRUE(app, NS_ERROR_NOT_AVAILABLE);
+  EmbedLiteViewChildIface* view = app->GetAnyView(aActive);
+  if (!view) {
+    return NS_ERROR_NOT_AVAILABLE;
   }
 
-  return NS_ERROR_NOT_AVAILABLE;
+  nsresult rv;
+  nsCOMPtr<nsIWebBrowser> br;
+  rv = view->GetBrowser(getter_AddRefs(br));
+  NS_ENSURE_TRUE(br, rv);
+  nsCOMPtr<mozIDOMWindowProxy> domWindow;
+  br->GetContentDOMWindow(getter_AddRefs(domWindow));
+  if (!domWindow) {
+    return NS_ERROR_NOT_AVAILABLE;
+  }
+
+  nsCOMPtr<nsPIDOMWindowOuter> piWindow = nsPIDOMWindowOuter::From(domWindow);
+  piWindow.forget(embedWindow);
+  return NS_OK;
 }
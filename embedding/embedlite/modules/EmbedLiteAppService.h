@@ -10,7 +10,7 @@
 #include "nsWeakReference.h"
 #include "nsIObserver.h"
 #include "nsIEmbedAppService.h"
-#include "nsClassHashtable.h"
+#include "EmbedLiteMessageRouter.h"
 #include <string>
 #include <map>
 #include "mozilla/ModuleUtils.h"               // for NS_GENERIC_FACTORY_CONSTRUCTOR
@@ -26,9 +26,7 @@ public:
   NS_DECL_NSIOBSERVER
   NS_DECL_NSIEMBEDAPPSERVICE
 
-  void RegisterView(uint32_t aId);
-  void UnregisterView(uint32_t aId);
-  void HandleAsyncMessage(const char* aMessage, const nsString& aData);
+  void HandleAsyncMessage(const nsAString& aMessage, const nsAString& aData);
   static EmbedLiteAppService* AppService();
 
 protected:
@@ -36,10 +34,7 @@ protected:
 
 private:
   friend class EmbedLiteJSON;
-  std::map<uint64_t, uint32_t> mIDMap;
-  typedef nsClassHashtable<nsCStringHashKey, nsTArray<nsCOMPtr<nsIEmbedMessageListener> > > MsgListenersArray;
-  MsgListenersArray mMessageListeners;
-  bool mHandlingMessages;
+  mozilla::embedlite::EmbedLiteMessageRouter mRouter;
 };
 
 // 3960150c-6e89-11e2-90b3-631813f021
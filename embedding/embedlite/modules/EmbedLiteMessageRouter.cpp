@@ -0,0 +1,314 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EmbedLog.h"
+
+#include "EmbedLiteMessageRouter.h"
+#include "nsIEmbedAppService.h"
+#include "nsDataHashtable.h"
+#include "nsThreadUtils.h"
+#include "mozilla/ClearOnShutdown.h"
+#include "mozilla/JSONWriter.h"
+#include "mozilla/StaticPtr.h"
+
+namespace mozilla {
+namespace embedlite {
+
+namespace {
+
+struct NameTable {
+  nsDataHashtable<nsStringHashKey, uint32_t> mIds;
+  // Indexed by id, UTF-8 as handed to nsIEmbedMessageListener.
+  nsTArray<nsCString> mNames;
+};
+
+StaticAutoPtr<NameTable> sNames;
+
+NameTable* Names()
+{
+  MOZ_ASSERT(NS_IsMainThread());
+  if (!sNames) {
+    sNames = new NameTable();
+    sNames->mNames.AppendElement();
+    ClearOnShutdown(&sNames);
+  }
+  return sNames;
+}
+
+class StringWriteFunc final : public JSONWriteFunc
+{
+public:
+  explicit StringWriteFunc(nsACString& aBuffer) : mBuffer(aBuffer) {}
+  void Write(const char* aStr) override { mBuffer.Append(aStr); }
+
+private:
+  nsACString& mBuffer;
+};
+
+} // namespace
+
+uint32_t
+EmbedLiteMessageNames::Intern(const nsAString& aName)
+{
+  NameTable* names = Names();
+  uint32_t id = names->mIds.Get(aName);
+  if (!id) {
+    id = names->mNames.Length();
+    names->mNames.AppendElement(NS_ConvertUTF16toUTF8(aName));
+    names->mIds.Put(aName, id);
+  }
+  return id;
+}
+
+uint32_t
+EmbedLiteMessageNames::Lookup(const nsAString& aName)
+{
+  return sNames ? sNames->mIds.Get(aName) : 0;
+}
+
+const nsCString&
+EmbedLiteMessageNames::Name(uint32_t aId)
+{
+  NameTable* names = Names();
+  return aId < names->mNames.Length() ? names->mNames[aId] : names->mNames[0];
+}
+
+void
+EmbedLiteMessageFilter::Add(const nsAString& aName)
+{
+  if (EmbedLiteMessageNames::IsPrefix(aName)) {
+    nsDependentSubstring prefix(aName, 0, aName.Length() - 1);
+    if (!mPrefixes.Contains(prefix)) {
+      mPrefixes.AppendElement(prefix);
+    }
+    return;
+  }
+
+  uint32_t id = EmbedLiteMessageNames::Intern(aName);
+  if (id >= mIds.size()) {
+    mIds.resize(id + 1);
+  }
+  mIds[id] = true;
+}
+
+void
+EmbedLiteMessageFilter::Remove(const nsAString& aName)
+{
+  if (EmbedLiteMessageNames::IsPrefix(aName)) {
+    mPrefixes.RemoveElement(nsDependentSubstring(aName, 0, aName.Length() - 1));
+    return;
+  }
+
+  uint32_t id = EmbedLiteMessageNames::Lookup(aName);
+  if (id && id < mIds.size()) {
+    mIds[id] = false;
+  }
+}
+
+bool
+EmbedLiteMessageFilter::Contains(const nsAString& aName) const
+{
+  uint32_t id = EmbedLiteMessageNames::Lookup(aName);
+  if (id && id < mIds.size() && mIds[id]) {
+    return true;
+  }
+  for (const nsString& prefix : mPrefixes) {
+    if (StringBeginsWith(aName, prefix)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+EmbedLiteMessageRouter::EmbedLiteMessageRouter()
+  : mGeneration(1)
+{
+}
+
+EmbedLiteMessageRouter::~EmbedLiteMessageRouter()
+{
+}
+
+EmbedLiteMessageRouter::Entry&
+EmbedLiteMessageRouter::GetEntry(uint32_t aId)
+{
+  if (aId >= mEntries.Length()) {
+    mEntries.SetLength(aId + 1);
+  }
+  return mEntries[aId];
+}
+
+RefPtr<EmbedLiteMessageRouter::ListenerList>
+EmbedLiteMessageRouter::Add(ListenerList* aList, nsIEmbedMessageListener* aListener)
+{
+  RefPtr<ListenerList> list = new ListenerList();
+  if (aList) {
+    list->mListeners.AppendElements(aList->mListeners);
+  }
+  list->mListeners.AppendElement(aListener);
+  return list;
+}
+
+RefPtr<EmbedLiteMessageRouter::ListenerList>
+EmbedLiteMessageRouter::Remove(ListenerList* aList, nsIEmbedMessageListener* aListener, bool* aRemoved)
+{
+  *aRemoved = false;
+  if (!aList) {
+    return nullptr;
+  }
+
+  RefPtr<ListenerList> list = new ListenerList();
+  for (const nsCOMPtr<nsIEmbedMessageListener>& listener : aList->mListeners) {
+    // Only the first subscription goes, like it always did.
+    if (!*aRemoved && listener == aListener) {
+      *aRemoved = true;
+      continue;
+    }
+    list->mListeners.AppendElement(listener);
+  }
+  if (!*aRemoved) {
+    return aList;
+  }
+  return list->mListeners.IsEmpty() ? nullptr : list;
+}
+
+void
+EmbedLiteMessageRouter::AddListener(const nsAString& aName, nsIEmbedMessageListener* aListener)
+{
+  if (EmbedLiteMessageNames::IsPrefix(aName)) {
+    nsDependentSubstring prefix(aName, 0, aName.Length() - 1);
+    ++mGeneration;
+    for (Prefix& entry : mPrefixes) {
+      if (entry.mPrefix.Equals(prefix)) {
+        entry.mListeners = Add(entry.mListeners, aListener);
+        return;
+      }
+    }
+    Prefix* entry = mPrefixes.AppendElement();
+    entry->mPrefix = prefix;
+    entry->mListeners = Add(nullptr, aListener);
+    return;
+  }
+
+  Entry& entry = GetEntry(EmbedLiteMessageNames::Intern(aName));
+  entry.mListeners = Add(entry.mListeners, aListener);
+}
+
+bool
+EmbedLiteMessageRouter::RemoveListener(const nsAString& aName, nsIEmbedMessageListener* aListener)
+{
+  bool removed = false;
+  if (EmbedLiteMessageNames::IsPrefix(aName)) {
+    nsDependentSubstring prefix(aName, 0, aName.Length() - 1);
+    for (size_t i = 0; i < mPrefixes.Length(); ++i) {
+      if (mPrefixes[i].mPrefix.Equals(prefix)) {
+        mPrefixes[i].mListeners = Remove(mPrefixes[i].mListeners, aListener, &removed);
+        if (!mPrefixes[i].mListeners) {
+          mPrefixes.RemoveElementAt(i);
+        }
+        ++mGeneration;
+        break;
+      }
+    }
+    return removed;
+  }
+
+  uint32_t id = EmbedLiteMessageNames::Lookup(aName);
+  if (!id || id >= mEntries.Length()) {
+    return false;
+  }
+  Entry& entry = mEntries[id];
+  entry.mListeners = Remove(entry.mListeners, aListener, &removed);
+  return removed;
+}
+
+uint32_t
+EmbedLiteMessageRouter::Notify(ListenerList* aList, const nsCString& aName, const char16_t* aData)
+{
+  if (!aList) {
+    return 0;
+  }
+  for (const nsCOMPtr<nsIEmbedMessageListener>& listener : aList->mListeners) {
+    listener->OnMessageReceived(aName.get(), aData);
+  }
+  return aList->mListeners.Length();
+}
+
+uint32_t
+EmbedLiteMessageRouter::Dispatch(const nsAString& aName, const nsAString& aData)
+{
+  uint32_t id = EmbedLiteMessageNames::Lookup(aName);
+  if (!id) {
+    if (mPrefixes.IsEmpty()) {
+      return 0;
+    }
+    // Names only known to prefix subscriptions get an id on first use.
+    id = EmbedLiteMessageNames::Intern(aName);
+  }
+
+  Entry& entry = GetEntry(id);
+  if (entry.mGeneration != mGeneration) {
+    entry.mPrefixListeners.Clear();
+    for (const Prefix& prefix : mPrefixes) {
+      if (StringBeginsWith(aName, prefix.mPrefix)) {
+        entry.mPrefixListeners.AppendElement(prefix.mListeners);
+      }
+    }
+    entry.mGeneration = mGeneration;
+  }
+  if (!entry.mListeners && entry.mPrefixListeners.IsEmpty()) {
+    return 0;
+  }
+
+  // Listeners may change subscriptions, and with that mEntries, meanwhile.
+  RefPtr<ListenerList> listeners = entry.mListeners;
+  AutoTArray<RefPtr<ListenerList>, 2> prefixListeners;
+  prefixListeners.AppendElements(entry.mPrefixListeners);
+  const nsCString& name = EmbedLiteMessageNames::Name(id);
+  const nsString& data = PromiseFlatString(aData);
+
+  TimeStamp start = TimeStamp::Now();
+  uint32_t calls = Notify(listeners, name, data.get());
+  for (ListenerList* list : prefixListeners) {
+    calls += Notify(list, name, data.get());
+  }
+
+  Stats& stats = mEntries[id].mStats;
+  ++stats.mDispatches;
+  stats.mListenerCalls += calls;
+  stats.mTime += TimeStamp::Now() - start;
+  return calls;
+}
+
+void
+EmbedLiteMessageRouter::GetStats(nsACString& aJSON) const
+{
+  aJSON.Truncate();
+  JSONWriter writer(MakeUnique<StringWriteFunc>(aJSON));
+  writer.Start(JSONWriter::SingleLineStyle);
+  for (size_t id = 1; id < mEntries.Length(); ++id) {
+    const Stats& stats = mEntries[id].mStats;
+    if (!stats.mDispatches) {
+      continue;
+    }
+    writer.StartObjectProperty(EmbedLiteMessageNames::Name(id).get());
+    writer.IntProperty("dispatches", stats.mDispatches);
+    writer.IntProperty("calls", stats.mListenerCalls);
+    writer.DoubleProperty("time", stats.mTime.ToMilliseconds());
+    writer.EndObject();
+  }
+  writer.End();
+}
+
+void
+EmbedLiteMessageRouter::ResetStats()
+{
+  for (Entry& entry : mEntries) {
+    entry.mStats = Stats();
+  }
+}
+
+} // namespace embedlite
+} // namespace mozilla
@@ -0,0 +1,129 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOZ_EMBED_LITE_MESSAGE_ROUTER_H
+#define MOZ_EMBED_LITE_MESSAGE_ROUTER_H
+
+#include "mozilla/RefPtr.h"
+#include "mozilla/TimeStamp.h"
+#include "nsCOMPtr.h"
+#include "nsString.h"
+#include "nsTArray.h"
+
+#include <vector>
+
+class nsIEmbedMessageListener;
+
+namespace mozilla {
+namespace embedlite {
+
+/*
+ * Message names interned to small integer ids, main thread only. Ids start
+ * at 1 and stay valid until shutdown.
+ *
+ * Subscriptions whose name ends with '*' match every message name starting
+ * with the rest of it, "*" alone matches all of them.
+ */
+class EmbedLiteMessageNames
+{
+public:
+  static uint32_t Intern(const nsAString& aName);
+  // 0 if aName was never interned.
+  static uint32_t Lookup(const nsAString& aName);
+  static const nsCString& Name(uint32_t aId);
+
+  static bool IsPrefix(const nsAString& aName)
+  {
+    return !aName.IsEmpty() && aName.Last() == '*';
+  }
+};
+
+// Set of message names and name prefixes, e.g. the messages a view has
+// listeners for on the UI side.
+class EmbedLiteMessageFilter
+{
+public:
+  void Add(const nsAString& aName);
+  void Remove(const nsAString& aName);
+  bool Contains(const nsAString& aName) const;
+
+private:
+  std::vector<bool> mIds;
+  // Without the trailing '*'.
+  nsTArray<nsString> mPrefixes;
+};
+
+/*
+ * Delivers content side messages to nsIEmbedMessageListeners.
+ *
+ * Listener lists are immutable once published, subscribing or unsubscribing
+ * replaces them. A dispatch holds on to the lists it started with, so
+ * listeners can (un)subscribe while being called without anything being
+ * copied per message. Prefix subscriptions matching a name are resolved
+ * once and cached until the set of prefixes changes.
+ *
+ * Dispatch counts and time spent in listeners are kept per message name.
+ */
+class EmbedLiteMessageRouter
+{
+public:
+  EmbedLiteMessageRouter();
+  ~EmbedLiteMessageRouter();
+
+  void AddListener(const nsAString& aName, nsIEmbedMessageListener* aListener);
+  // False if aListener was not subscribed to aName.
+  bool RemoveListener(const nsAString& aName, nsIEmbedMessageListener* aListener);
+  // Returns the number of listeners called.
+  uint32_t Dispatch(const nsAString& aName, const nsAString& aData);
+
+  struct Stats {
+    uint64_t mDispatches = 0;
+    uint64_t mListenerCalls = 0;
+    TimeDuration mTime;
+  };
+  // Stats of every message that reached at least one listener, as
+  // {"name": {"dispatches": n, "calls": n, "time": ms}, ...}.
+  void GetStats(nsACString& aJSON) const;
+  void ResetStats();
+
+private:
+  class ListenerList final
+  {
+  public:
+    NS_INLINE_DECL_REFCOUNTING(ListenerList)
+    nsTArray<nsCOMPtr<nsIEmbedMessageListener>> mListeners;
+
+  private:
+    ~ListenerList() {}
+  };
+
+  struct Entry {
+    RefPtr<ListenerList> mListeners;
+    // Lists of the prefixes matching this name, valid for mGeneration.
+    nsTArray<RefPtr<ListenerList>> mPrefixListeners;
+    uint32_t mGeneration = 0;
+    Stats mStats;
+  };
+
+  struct Prefix {
+    nsString mPrefix;
+    RefPtr<ListenerList> mListeners;
+  };
+
+  Entry& GetEntry(uint32_t aId);
+  static RefPtr<ListenerList> Add(ListenerList* aList, nsIEmbedMessageListener* aListener);
+  static RefPtr<ListenerList> Remove(ListenerList* aList, nsIEmbedMessageListener* aListener, bool* aRemoved);
+  static uint32_t Notify(ListenerList* aList, const nsCString& aName, const char16_t* aData);
+
+  nsTArray<Entry> mEntries;
+  nsTArray<Prefix> mPrefixes;
+  // Bumped whenever mPrefixes changes.
+  uint32_t mGeneration;
+};
+
+} // namespace embedlite
+} // namespace mozilla
+
+#endif // MOZ_EMBED_LITE_MESSAGE_ROUTER_H
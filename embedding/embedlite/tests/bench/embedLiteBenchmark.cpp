@@ -0,0 +1,450 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Headless end to end benchmark of the embedding. Boots EmbedLiteApp in
+// EMBED_THREAD mode on a LocalMessagePump with software compositing, then
+// for every iteration creates a view, loads htmltests/heater.html, drags it
+// to scroll, loads htmltests/touch.html and draws on it.
+//
+// Reported, as median/p95/min/max over the measured iterations:
+//   startup_ms            StartWithCustomPump -> Initialized (once)
+//   view_create_ms        CreateView -> ViewInitialized
+//   first_paint_ms        LoadURL -> OnFirstPaint
+//   page_load_ms          LoadURL -> OnLoadFinished
+//   scroll_fps            frames published during the drag
+//   scroll_composite_p95  p95 composite time of the recent frames
+//   scroll_jank_frames    late frames among them
+//   scroll_distance_px    content scroll offset after the drag
+//   input_to_present_p50  touch sample -> frame presenting it, from
+//   input_to_present_p95  the compositor's frame timing
+//   touch_to_paint_p50    touchmove dispatched in content -> MozAfterPaint
+//   touch_to_paint_p95
+//
+// Input is synthesized at fixed times and positions and the drags end with
+// the finger held still, so runs do not depend on fling physics.
+//
+// Usage: GRE_HOME=<dist/bin> embedLiteBenchmark [--iterations=N] [--warmup=N]
+//                                              [--pages=DIR] [--json=FILE]
+//                                              [--suite=pages|messages|headless|registry]
+// The messages suite measures view message round trips instead, see
+// messagebenchmark.h, the headless suite checks the pixels of a software
+// composited frame, see headlesscheck.h, and the registry suite times view
+// lookups in sessions with many tabs without starting the app, see
+// registrybenchmark.h. Returns 0 when every phase completed.
+
+#include "mozilla/embedlite/EmbedLiteApp.h"
+#include "mozilla/embedlite/EmbedLiteView.h"
+#include "mozilla/embedlite/EmbedLiteWindow.h"
+#include "mozilla/embedlite/EmbedInputData.h"
+#include "headlesscheck.h"
+#include "localmessagepump.h"
+#include "messagebenchmark.h"
+#include "registrybenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace mozilla::embedlite;
+
+static const int sWindowWidth = 480;
+static const int sWindowHeight = 800;
+// Time given to the page to settle before and after input.
+static const int sSettleMs = 500;
+static const int sTouchIntervalMs = 8;
+static const int sDragSteps = 40;
+static const int sDragStepPx = 12;
+// Finger held still before lifting, longer than APZ's velocity window.
+static const int sHoldMs = 200;
+static const int sWatchdogMs = 120000;
+
+static const char sPaintProbeScript[] =
+    "data:,var touchTime = 0;"
+    "addEventListener('touchmove', function() { if (!touchTime) touchTime = content.performance.now(); }, true);"
+    "addEventListener('MozAfterPaint', function() {"
+    "  if (touchTime) { sendAsyncMessage('Bench:Paint', { ms: content.performance.now() - touchTime }); touchTime = 0; }"
+    "}, true);";
+
+typedef std::chrono::steady_clock Clock;
+
+static double
+MsSince(const Clock::time_point& aStart)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - aStart).count();
+}
+
+// Nearest rank, aValues must not be empty.
+static double
+Percentile(std::vector<double> aValues, int aPercent)
+{
+    std::sort(aValues.begin(), aValues.end());
+    size_t rank = (aPercent * aValues.size() + 99) / 100;
+    return aValues[std::max<size_t>(rank, 1) - 1];
+}
+
+class BenchmarkListener : public EmbedLiteAppListener, public EmbedLiteViewListener
+{
+public:
+    BenchmarkListener(EmbedLiteApp* aApp, LocalMessagePump* aPump, const std::string& aPages,
+                      int aIterations, int aWarmup)
+      : mApp(aApp)
+      , mPump(aPump)
+      , mPages(aPages)
+      , mIterations(aIterations)
+      , mWarmup(aWarmup)
+      , mIteration(0)
+      , mWindow(nullptr)
+      , mView(nullptr)
+      , mPhase(kStarting)
+      , mFirstPainted(false)
+      , mScrollY(0)
+      , mDragDone(nullptr)
+      , mDragDuration(0)
+      , mDragStep(0)
+      , mPublishedFrames(0)
+      , mCompleted(false)
+    {
+        mStartTime = Clock::now();
+    }
+    virtual ~BenchmarkListener() {}
+
+    bool Completed() const { return mCompleted; }
+
+    void Report(FILE* aJSON) const
+    {
+        printf("%-22s %10s %10s %10s %10s\n", "metric", "median", "p95", "min", "max");
+        if (aJSON) {
+            fprintf(aJSON, "{\"iterations\": %d, \"warmup\": %d", mIterations, mWarmup);
+        }
+        for (const auto& metric : mMetrics) {
+            const std::vector<double>& values = metric.second;
+            if (values.empty()) {
+                continue;
+            }
+            double median = Percentile(values, 50);
+            double p95 = Percentile(values, 95);
+            double min = *std::min_element(values.begin(), values.end());
+            double max = *std::max_element(values.begin(), values.end());
+            printf("%-22s %10.2f %10.2f %10.2f %10.2f\n", metric.first.c_str(), median, p95, min, max);
+            if (aJSON) {
+                fprintf(aJSON, ", \"%s\": {\"median\": %.3f, \"p95\": %.3f, \"min\": %.3f, \"max\": %.3f, \"samples\": [",
+                        metric.first.c_str(), median, p95, min, max);
+                for (size_t i = 0; i < values.size(); ++i) {
+                    fprintf(aJSON, "%s%.3f", i ? ", " : "", values[i]);
+                }
+                fprintf(aJSON, "]}");
+            }
+        }
+        if (aJSON) {
+            fprintf(aJSON, "}\n");
+        }
+    }
+
+    // EmbedLiteAppListener
+    virtual void Initialized()
+    {
+        Record("startup_ms", MsSince(mStartTime), true);
+
+        mApp->SetBoolPref("embedlite.compositor.software", true);
+        mApp->SetIntPref("embedlite.compositor.frame_timing_report_interval", 0);
+        // Keep the network and caches out of the numbers.
+        mApp->SetBoolPref("browser.cache.disk.enable", false);
+        mApp->SetBoolPref("network.prefetch-next", false);
+
+        mWindow = mApp->CreateWindow(sWindowWidth, sWindowHeight);
+        mApp->PostTask(&BenchmarkListener::Watchdog, this, sWatchdogMs);
+        CreateView();
+    }
+    virtual void Destroyed()
+    {
+        mPump->Exit();
+    }
+
+    // EmbedLiteViewListener
+    virtual void ViewInitialized()
+    {
+        Record("view_create_ms", MsSince(mPhaseStart));
+        mView->LoadFrameScript(sPaintProbeScript);
+        mView->AddMessageListener("Bench:Paint");
+        LoadPage(kLoadScrollPage, "heater.html");
+    }
+    virtual void ViewDestroyed()
+    {
+        mView = nullptr;
+        if (++mIteration < mIterations + mWarmup) {
+            CreateView();
+            return;
+        }
+        mCompleted = true;
+        mApp->Stop();
+    }
+    virtual void OnFirstPaint(int32_t aX, int32_t aY)
+    {
+        // May come after OnLoadFinished.
+        if ((mPhase == kLoadScrollPage || mPhase == kScroll) && !mFirstPainted) {
+            mFirstPainted = true;
+            Record("first_paint_ms", MsSince(mPhaseStart));
+        }
+    }
+    virtual void OnLoadFinished()
+    {
+        if (mPhase == kLoadScrollPage) {
+            Record("page_load_ms", MsSince(mPhaseStart));
+            mPhase = kScroll;
+            mApp->PostTask(&BenchmarkListener::StartScroll, this, sSettleMs);
+        } else if (mPhase == kLoadInputPage) {
+            mPhase = kInput;
+            mApp->PostTask(&BenchmarkListener::StartInput, this, sSettleMs);
+        }
+    }
+    virtual void OnScrollChanged(int32_t aOffsetX, int32_t aOffsetY)
+    {
+        mScrollY = aOffsetY;
+    }
+    virtual void RecvAsyncMessage(const char16_t* aMessage, const char16_t* aData)
+    {
+        if (mPhase != kInput || std::u16string(aMessage) != u"Bench:Paint") {
+            return;
+        }
+        // {"ms":12.5}
+        std::u16string data(aData);
+        size_t colon = data.find(u':');
+        if (colon != std::u16string::npos) {
+            std::string number(data.begin() + colon + 1, data.end());
+            mTouchToPaint.push_back(atof(number.c_str()));
+        }
+    }
+
+private:
+    enum Phase {
+        kStarting,
+        kCreateView,
+        kLoadScrollPage,
+        kScroll,
+        kLoadInputPage,
+        kInput,
+    };
+
+    void Record(const char* aMetric, double aValue, bool aAlways = false)
+    {
+        if (aAlways || mIteration >= mWarmup) {
+            mMetrics[aMetric].push_back(aValue);
+        }
+    }
+
+    void CreateView()
+    {
+        mPhase = kCreateView;
+        mFirstPainted = false;
+        mScrollY = 0;
+        mTouchToPaint.clear();
+        mPhaseStart = Clock::now();
+        mView = mApp->CreateView(mWindow);
+        mView->SetListener(this);
+    }
+
+    void LoadPage(Phase aPhase, const char* aPage)
+    {
+        mPhase = aPhase;
+        mPhaseStart = Clock::now();
+        std::string url = "file://" + mPages + "/" + aPage;
+        mView->LoadURL(url.c_str());
+    }
+
+    void SendTouch(EmbedTouchInput::EmbedTouchType aType, float aX, float aY)
+    {
+        EmbedTouchInput touch(aType, uint32_t(MsSince(mStartTime)));
+        touch.touches.push_back(TouchData(0, TouchPointF(aX, aY), 1.0f));
+        mView->ReceiveInputEvent(touch);
+    }
+
+    // Upward drag from the lower part of the window, aDone is called once
+    // the page had time to settle after the finger was lifted.
+    void StartDrag(EMBEDTaskCallback aDone)
+    {
+        mDragDone = aDone;
+        mDragStep = 0;
+        mDragStart = Clock::now();
+        SendTouch(EmbedTouchInput::MULTITOUCH_START, sWindowWidth / 2, sWindowHeight * 3 / 4);
+        mApp->PostTask(&BenchmarkListener::DragStep, this, sTouchIntervalMs);
+    }
+
+    static void DragStep(void* aData)
+    {
+        BenchmarkListener* self = static_cast<BenchmarkListener*>(aData);
+        if (!self->mView) {
+            return;
+        }
+        float y = sWindowHeight * 3 / 4 - ++self->mDragStep * sDragStepPx;
+        if (self->mDragStep <= sDragSteps) {
+            self->SendTouch(EmbedTouchInput::MULTITOUCH_MOVE, sWindowWidth / 2, y);
+            self->mApp->PostTask(&BenchmarkListener::DragStep, self, sTouchIntervalMs);
+            return;
+        }
+        if (self->mDragStep == sDragSteps + 1) {
+            self->mDragDuration = MsSince(self->mDragStart);
+            self->mApp->PostTask(&BenchmarkListener::DragStep, self, sHoldMs);
+            return;
+        }
+        self->SendTouch(EmbedTouchInput::MULTITOUCH_END, sWindowWidth / 2, sWindowHeight * 3 / 4 - sDragSteps * sDragStepPx);
+        self->mApp->PostTask(self->mDragDone, self, sSettleMs);
+    }
+
+    static void StartScroll(void* aData)
+    {
+        BenchmarkListener* self = static_cast<BenchmarkListener*>(aData);
+        uint64_t dropped, contention;
+        self->mWindow->GetFrameStatistics(&self->mPublishedFrames, &dropped, &contention);
+        self->StartDrag(&BenchmarkListener::FinishScroll);
+    }
+
+    static void FinishScroll(void* aData)
+    {
+        BenchmarkListener* self = static_cast<BenchmarkListener*>(aData);
+        uint64_t published, dropped, contention;
+        self->mWindow->GetFrameStatistics(&published, &dropped, &contention);
+        self->Record("scroll_fps", (published - self->mPublishedFrames) * 1000.0 / (self->mDragDuration + sHoldMs));
+        EmbedLiteFrameTimingStats stats;
+        if (self->mWindow->GetFrameTimingStats(&stats)) {
+            self->Record("scroll_composite_p95", stats.composite.p95);
+            self->Record("scroll_jank_frames", stats.jankFrames);
+        }
+        self->Record("scroll_distance_px", self->mScrollY);
+        self->LoadPage(kLoadInputPage, "touch.html");
+    }
+
+    static void StartInput(void* aData)
+    {
+        BenchmarkListener* self = static_cast<BenchmarkListener*>(aData);
+        self->StartDrag(&BenchmarkListener::FinishInput);
+    }
+
+    static void FinishInput(void* aData)
+    {
+        BenchmarkListener* self = static_cast<BenchmarkListener*>(aData);
+        EmbedLiteFrameTimingStats stats;
+        if (self->mWindow->GetFrameTimingStats(&stats) && stats.inputFrames) {
+            self->Record("input_to_present_p50", stats.inputToPresent.p50);
+            self->Record("input_to_present_p95", stats.inputToPresent.p95);
+        }
+        if (!self->mTouchToPaint.empty()) {
+            self->Record("touch_to_paint_p50", Percentile(self->mTouchToPaint, 50));
+            self->Record("touch_to_paint_p95", Percentile(self->mTouchToPaint, 95));
+        }
+        self->mApp->DestroyView(self->mView);
+    }
+
+    static void Watchdog(void* aData)
+    {
+        BenchmarkListener* self = static_cast<BenchmarkListener*>(aData);
+        if (self->mCompleted) {
+            return;
+        }
+        printf("Timed out in phase %d of iteration %d\n", self->mPhase, self->mIteration);
+        self->mApp->Stop();
+    }
+
+    EmbedLiteApp* mApp;
+    LocalMessagePump* mPump;
+    std::string mPages;
+    int mIterations;
+    int mWarmup;
+    int mIteration;
+    EmbedLiteWindow* mWindow;
+    EmbedLiteView* mView;
+
+    Phase mPhase;
+    Clock::time_point mStartTime;
+    Clock::time_point mPhaseStart;
+    bool mFirstPainted;
+    int32_t mScrollY;
+
+    EMBEDTaskCallback mDragDone;
+    Clock::time_point mDragStart;
+    double mDragDuration;
+    int mDragStep;
+    uint64_t mPublishedFrames;
+    std::vector<double> mTouchToPaint;
+
+    std::map<std::string, std::vector<double>> mMetrics;
+    bool mCompleted;
+};
+
+static const char*
+GetArgument(int argc, char** argv, const char* aName, const char* aDefault)
+{
+    size_t length = strlen(aName);
+    for (int i = 1; i < argc; ++i) {
+        if (!strncmp(argv[i], aName, length) && argv[i][length] == '=') {
+            return argv[i] + length + 1;
+        }
+    }
+    return aDefault;
+}
+
+static int
+RunPageBenchmark(EmbedLiteApp* mapp, LocalMessagePump* pump, int argc, char** argv)
+{
+    int iterations = std::max(atoi(GetArgument(argc, argv, "--iterations", "5")), 1);
+    int warmup = std::max(atoi(GetArgument(argc, argv, "--warmup", "1")), 0);
+    const char* pages = GetArgument(argc, argv, "--pages", EMBEDLITE_TEST_PAGES);
+    const char* json = GetArgument(argc, argv, "--json", nullptr);
+
+    BenchmarkListener* listener = new BenchmarkListener(mapp, pump, pages, iterations, warmup);
+    mapp->SetListener(listener);
+    mapp->StartWithCustomPump(EmbedLiteApp::EMBED_THREAD, pump->EmbedLoop());
+    pump->Exec();
+
+    bool completed = listener->Completed();
+    FILE* file = json ? fopen(json, "w") : nullptr;
+    if (json && !file) {
+        printf("Cannot write %s\n", json);
+    }
+    listener->Report(file);
+    if (file) {
+        fclose(file);
+    }
+    printf("result:%s\n", completed ? "PASS" : "FAIL");
+
+    delete listener;
+    return completed ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    std::string suite = GetArgument(argc, argv, "--suite", "pages");
+    if (suite == "registry") {
+        return RunRegistryBenchmark();
+    }
+
+    if (!getenv("GRE_HOME")) {
+        printf("GRE_HOME must point to the directory containing libxul\n");
+        return 1;
+    }
+
+    if (suite != "pages" && suite != "messages" && suite != "headless") {
+        printf("Unknown suite %s\n", suite.c_str());
+        return 1;
+    }
+
+    EmbedLiteApp* mapp = XRE_GetEmbedLite();
+    LocalMessagePump* pump = new LocalMessagePump(mapp);
+    int result;
+    if (suite == "messages") {
+        result = RunMessageBenchmark(mapp, pump);
+    } else if (suite == "headless") {
+        result = RunHeadlessCheck(mapp, pump);
+    } else {
+        result = RunPageBenchmark(mapp, pump, argc, argv);
+    }
+    delete pump;
+    delete mapp;
+    return result;
+}
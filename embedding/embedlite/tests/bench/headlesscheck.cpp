@@ -0,0 +1,125 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "headlesscheck.h"
+
+#include "mozilla/embedlite/EmbedLiteApp.h"
+#include "mozilla/embedlite/EmbedLiteView.h"
+#include "mozilla/embedlite/EmbedLiteWindow.h"
+#include "localmessagepump.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace mozilla::embedlite;
+
+static const int sWatchdogMs = 60000;
+
+class HeadlessListener : public EmbedLiteAppListener, public EmbedLiteViewListener
+{
+public:
+    HeadlessListener(EmbedLiteApp* aApp, LocalMessagePump* aPump)
+      : mApp(aApp)
+      , mPump(aPump)
+      , mWindow(nullptr)
+      , mView(nullptr)
+      , mChecked(false)
+      , mPassed(false)
+    {
+    }
+    virtual ~HeadlessListener() {}
+
+    bool Passed() const { return mPassed; }
+
+    // EmbedLiteAppListener
+    virtual void Initialized()
+    {
+        mApp->SetBoolPref("embedlite.compositor.software", true);
+        mWindow = mApp->CreateWindow(320, 240);
+        mView = mApp->CreateView(mWindow);
+        mView->SetListener(this);
+        mApp->PostTask(&HeadlessListener::Watchdog, this, sWatchdogMs);
+    }
+    virtual void Destroyed()
+    {
+        mPump->Exit();
+    }
+
+    // EmbedLiteViewListener
+    virtual void ViewInitialized()
+    {
+        mView->LoadURL("data:text/html,<body style='margin:0;background:%23ff0000'></body>");
+    }
+    virtual void ViewDestroyed()
+    {
+        mView = nullptr;
+        mApp->Stop();
+    }
+    virtual void OnFirstPaint(int32_t aX, int32_t aY)
+    {
+        // Give the compositor time to composite the painted content.
+        mApp->PostTask(&HeadlessListener::CheckFrame, this, 500);
+    }
+
+private:
+    static void CheckFrame(void* aData)
+    {
+        HeadlessListener* self = static_cast<HeadlessListener*>(aData);
+        if (self->mChecked || !self->mView) {
+            return;
+        }
+        self->mChecked = true;
+
+        bool hasFrame = self->mWindow->GetSoftwareFrame([self](const uint8_t* data, int width, int height, int stride) {
+            const uint8_t* center = data + (height / 2) * stride + (width / 2) * 4;
+            printf("Frame %ix%i center BGRA:%u,%u,%u,%u\n", width, height, center[0], center[1], center[2], center[3]);
+            self->mPassed = center[0] == 0 && center[1] == 0 && center[2] == 255 && center[3] == 255;
+
+            const char* output = getenv("HEADLESS_OUTPUT");
+            FILE* file = output ? fopen(output, "wb") : nullptr;
+            if (file) {
+                fprintf(file, "P6\n%i %i\n255\n", width, height);
+                for (int y = 0; y < height; ++y) {
+                    for (int x = 0; x < width; ++x) {
+                        const uint8_t* pixel = data + y * stride + x * 4;
+                        uint8_t rgb[3] = { pixel[2], pixel[1], pixel[0] };
+                        fwrite(rgb, 1, 3, file);
+                    }
+                }
+                fclose(file);
+            }
+        });
+        printf("Software frame:%i\n", hasFrame);
+        self->mApp->DestroyView(self->mView);
+    }
+
+    static void Watchdog(void* aData)
+    {
+        HeadlessListener* self = static_cast<HeadlessListener*>(aData);
+        if (self->mChecked) {
+            return;
+        }
+        printf("Timed out waiting for the first paint\n");
+        self->mApp->Stop();
+    }
+
+    EmbedLiteApp* mApp;
+    LocalMessagePump* mPump;
+    EmbedLiteWindow* mWindow;
+    EmbedLiteView* mView;
+    bool mChecked;
+    bool mPassed;
+};
+
+int
+RunHeadlessCheck(EmbedLiteApp* aApp, LocalMessagePump* aPump)
+{
+    HeadlessListener listener(aApp, aPump);
+    aApp->SetListener(&listener);
+    aApp->StartWithCustomPump(EmbedLiteApp::EMBED_THREAD, aPump->EmbedLoop());
+    aPump->Exec();
+    printf("result:%s\n", listener.Passed() ? "PASS" : "FAIL");
+    return listener.Passed() ? 0 : 1;
+}
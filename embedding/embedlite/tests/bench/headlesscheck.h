@@ -0,0 +1,21 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef headlesscheck_h
+#define headlesscheck_h
+
+namespace mozilla {
+namespace embedlite {
+class EmbedLiteApp;
+}}
+
+class LocalMessagePump;
+
+// Renders a solid red page with software compositing (no GL context) and
+// checks the composited pixels. Set HEADLESS_OUTPUT=file.ppm to dump the
+// frame. Runs the app on aPump until done, 0 when the frame was red.
+int RunHeadlessCheck(mozilla::embedlite::EmbedLiteApp* aApp, LocalMessagePump* aPump);
+
+#endif /* headlesscheck_h */
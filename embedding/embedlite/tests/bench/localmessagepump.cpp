@@ -0,0 +1,147 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*-*/
+/* vim: set ts=2 sw=2 et tw=79: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "localmessagepump.h"
+
+#include "mozilla/embedlite/EmbedLiteApp.h"
+
+#include <algorithm>
+
+using namespace mozilla::embedlite;
+
+LocalMessagePump::LocalMessagePump(EmbedLiteApp* aApp)
+  : mDelegate(nullptr)
+  , mWorkScheduled(false)
+  , mHasDelayedWork(false)
+  , mExit(false)
+{
+  mEventLoopPrivate = aApp->CreateEmbedLiteMessagePump(this);
+}
+
+LocalMessagePump::~LocalMessagePump()
+{
+  delete mEventLoopPrivate;
+}
+
+void
+LocalMessagePump::Exec()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (!mExit) {
+    if (!mWorkScheduled) {
+      auto wakeUp = [this] { return mWorkScheduled || mExit; };
+      if (mHasDelayedWork) {
+        mCondVar.wait_until(lock, mDelayedWorkTime, wakeUp);
+      } else {
+        mCondVar.wait(lock, wakeUp);
+      }
+    }
+    if (mExit) {
+      break;
+    }
+
+    bool delayedWorkDue = mHasDelayedWork && std::chrono::steady_clock::now() >= mDelayedWorkTime;
+    if (!mWorkScheduled && !delayedWorkDue) {
+      continue;
+    }
+    mWorkScheduled = false;
+    if (delayedWorkDue) {
+      mHasDelayedWork = false;
+    }
+
+    lock.unlock();
+    HandleDispatch();
+    lock.lock();
+  }
+}
+
+void
+LocalMessagePump::Exit()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mExit = true;
+  mCondVar.notify_one();
+}
+
+void
+LocalMessagePump::HandleDispatch()
+{
+  // Any of the calls below may end up in Quit() when the app shuts down.
+  if (!mDelegate) {
+    return;
+  }
+
+  if (mEventLoopPrivate->DoWork(mDelegate)) {
+    ScheduleWork();
+  }
+
+  if (!mDelegate) {
+    return;
+  }
+
+  // Reschedules itself through ScheduleDelayedWork.
+  bool doIdleWork = !mEventLoopPrivate->DoDelayedWork(mDelegate);
+
+  if (doIdleWork && mDelegate) {
+    if (mEventLoopPrivate->DoIdleWork(mDelegate)) {
+      ScheduleWork();
+      return;
+    }
+    // Delayed work is due within the millisecond and wakes the loop, an
+    // empty period would only spin until then.
+    int budget = IdleBudget();
+    if (budget > 0 && mDelegate && mEventLoopPrivate->DoIdlePeriod(budget)) {
+      ScheduleWork();
+    }
+  }
+}
+
+int
+LocalMessagePump::IdleBudget()
+{
+  // Nothing draws here, the budget only stops short of delayed work.
+  static const std::chrono::milliseconds kMaxIdleBudget(50);
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::chrono::milliseconds budget = kMaxIdleBudget;
+  if (mHasDelayedWork) {
+    budget = std::min(budget, std::chrono::duration_cast<std::chrono::milliseconds>(
+        mDelayedWorkTime - std::chrono::steady_clock::now()));
+  }
+  return std::max(int(budget.count()), 0);
+}
+
+void
+LocalMessagePump::Run(void* aDelegate)
+{
+  mDelegate = aDelegate;
+  ScheduleWork();
+}
+
+void
+LocalMessagePump::Quit()
+{
+  mDelegate = nullptr;
+}
+
+void
+LocalMessagePump::ScheduleWork()
+{
+  // Called from any thread posting to the UI loop.
+  std::lock_guard<std::mutex> lock(mMutex);
+  mWorkScheduled = true;
+  mCondVar.notify_one();
+}
+
+void
+LocalMessagePump::ScheduleDelayedWork(const int aDelay)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mHasDelayedWork = aDelay >= 0;
+  if (mHasDelayedWork) {
+    mDelayedWorkTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(aDelay);
+  }
+  mCondVar.notify_one();
+}
@@ -0,0 +1,57 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*-*/
+/* vim: set ts=2 sw=2 et tw=79: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef localmessagepump_h
+#define localmessagepump_h
+
+#include "mozilla/embedlite/EmbedLiteMessagePump.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace mozilla {
+namespace embedlite {
+class EmbedLiteApp;
+}}
+
+// Toolkit free counterpart of MessagePumpQt, for programs that have no
+// event loop of their own. Exec() plays the part of QGuiApplication::exec.
+class LocalMessagePump : public mozilla::embedlite::EmbedLiteMessagePumpListener
+{
+public:
+  explicit LocalMessagePump(mozilla::embedlite::EmbedLiteApp* aApp);
+  virtual ~LocalMessagePump();
+
+  mozilla::embedlite::EmbedLiteMessagePump* EmbedLoop() { return mEventLoopPrivate; }
+
+  // Dispatches work on the calling thread until Exit() is called.
+  void Exec();
+  void Exit();
+
+  virtual void Run(void* aDelegate);
+  virtual void Quit();
+  virtual void ScheduleWork();
+  virtual void ScheduleDelayedWork(const int aDelay);
+
+private:
+  void HandleDispatch();
+  // Time until delayed work is due, for EmbedLiteMessagePump::DoIdlePeriod.
+  int IdleBudget();
+
+  mozilla::embedlite::EmbedLiteMessagePump* mEventLoopPrivate;
+  // Null while the loop is not running.
+  void* mDelegate;
+
+  std::mutex mMutex;
+  std::condition_variable mCondVar;
+  bool mWorkScheduled;
+  bool mHasDelayedWork;
+  std::chrono::steady_clock::time_point mDelayedWorkTime;
+  bool mExit;
+};
+
+#endif /* localmessagepump_h */
@@ -0,0 +1,164 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "messagebenchmark.h"
+
+#include "mozilla/embedlite/EmbedLiteApp.h"
+#include "mozilla/embedlite/EmbedLiteView.h"
+#include "mozilla/embedlite/EmbedLiteWindow.h"
+#include "localmessagepump.h"
+
+#include <chrono>
+#include <limits.h>
+#include <stdio.h>
+#include <string>
+
+using namespace mozilla::embedlite;
+
+static const size_t sPayloadSizes[] = { 1024, 16 * 1024, 256 * 1024, 1024 * 1024 };
+static const int sIterations = 50;
+static const int sWatchdogMs = 60000;
+
+class MessageBenchmarkListener : public EmbedLiteAppListener, public EmbedLiteViewListener
+{
+public:
+    MessageBenchmarkListener(EmbedLiteApp* aApp, LocalMessagePump* aPump)
+      : mApp(aApp)
+      , mPump(aPump)
+      , mWindow(nullptr)
+      , mView(nullptr)
+      , mSizeIndex(0)
+      , mUseShmem(false)
+      , mIteration(0)
+      , mTotalUs(0)
+      , mCopies(0)
+      , mShmemAllocations(0)
+      , mShmemReuses(0)
+      , mCompleted(false)
+    {
+    }
+    virtual ~MessageBenchmarkListener() {}
+
+    bool Completed() const { return mCompleted; }
+
+    // EmbedLiteAppListener
+    virtual void Initialized()
+    {
+        mApp->SetBoolPref("embedlite.compositor.software", true);
+        mWindow = mApp->CreateWindow(320, 240);
+        mView = mApp->CreateView(mWindow);
+        mView->SetListener(this);
+        mApp->PostTask(&MessageBenchmarkListener::Watchdog, this, sWatchdogMs);
+    }
+    virtual void Destroyed()
+    {
+        mPump->Exit();
+    }
+
+    // EmbedLiteViewListener
+    virtual void ViewInitialized()
+    {
+        mView->LoadFrameScript("data:,addMessageListener('Bench:Ping', function(m) { sendAsyncMessage('Bench:Pong', m.data); });");
+        mView->AddMessageListener("Bench:Pong");
+        printf("%-12s %14s %22s %16s %13s %13s\n", "path", "payload_bytes", "avg_round_trip_us",
+               "copies_per_trip", "shmem_allocs", "shmem_reuses");
+        StartRun();
+    }
+    virtual void ViewDestroyed()
+    {
+        mView = nullptr;
+        mApp->Stop();
+    }
+    virtual void RecvAsyncMessage(const char16_t* aMessage, const char16_t* aData)
+    {
+        if (std::u16string(aMessage) != u"Bench:Pong") {
+            return;
+        }
+
+        mTotalUs += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - mSendTime).count();
+        if (++mIteration < sIterations) {
+            SendPing();
+            return;
+        }
+
+        uint64_t copies;
+        uint32_t allocations, reuses;
+        mView->GetMessageStatistics(&copies, &allocations, &reuses);
+        printf("%-12s %14zu %22.1f %16.1f %13u %13u\n", mUseShmem ? "shmem" : "AsyncMessage",
+               sPayloadSizes[mSizeIndex], double(mTotalUs) / sIterations,
+               double(copies - mCopies) / sIterations, allocations - mShmemAllocations,
+               reuses - mShmemReuses);
+
+        if (!mUseShmem) {
+            mUseShmem = true;
+        } else {
+            mUseShmem = false;
+            if (++mSizeIndex == sizeof(sPayloadSizes) / sizeof(sPayloadSizes[0])) {
+                mCompleted = true;
+                mApp->DestroyView(mView);
+                return;
+            }
+        }
+        StartRun();
+    }
+
+private:
+    void StartRun()
+    {
+        uint32_t threshold = mUseShmem ? 0 : INT_MAX;
+        mApp->SetIntPref("embedlite.ipc.shmem_message_threshold", threshold);
+        mView->SetShmemMessageThreshold(threshold);
+
+        mPayload = u"{\"p\":\"" + std::u16string(sPayloadSizes[mSizeIndex] / sizeof(char16_t), u'a') + u"\"}";
+        mIteration = 0;
+        mTotalUs = 0;
+        mView->GetMessageStatistics(&mCopies, &mShmemAllocations, &mShmemReuses);
+        SendPing();
+    }
+
+    void SendPing()
+    {
+        mSendTime = std::chrono::steady_clock::now();
+        mView->SendAsyncMessage(u"Bench:Ping", mPayload.c_str());
+    }
+
+    static void Watchdog(void* aData)
+    {
+        MessageBenchmarkListener* self = static_cast<MessageBenchmarkListener*>(aData);
+        if (self->mCompleted) {
+            return;
+        }
+        printf("Timed out at payload %zu\n", sPayloadSizes[self->mSizeIndex]);
+        self->mApp->Stop();
+    }
+
+    EmbedLiteApp* mApp;
+    LocalMessagePump* mPump;
+    EmbedLiteWindow* mWindow;
+    EmbedLiteView* mView;
+    size_t mSizeIndex;
+    bool mUseShmem;
+    int mIteration;
+    int64_t mTotalUs;
+    // Message statistics of the view when the run started.
+    uint64_t mCopies;
+    uint32_t mShmemAllocations;
+    uint32_t mShmemReuses;
+    std::u16string mPayload;
+    std::chrono::steady_clock::time_point mSendTime;
+    bool mCompleted;
+};
+
+int
+RunMessageBenchmark(EmbedLiteApp* aApp, LocalMessagePump* aPump)
+{
+    MessageBenchmarkListener listener(aApp, aPump);
+    aApp->SetListener(&listener);
+    aApp->StartWithCustomPump(EmbedLiteApp::EMBED_THREAD, aPump->EmbedLoop());
+    aPump->Exec();
+    printf("result:%s\n", listener.Completed() ? "PASS" : "FAIL");
+    return listener.Completed() ? 0 : 1;
+}
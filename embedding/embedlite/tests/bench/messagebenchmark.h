@@ -0,0 +1,24 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef messagebenchmark_h
+#define messagebenchmark_h
+
+namespace mozilla {
+namespace embedlite {
+class EmbedLiteApp;
+}}
+
+class LocalMessagePump;
+
+// Round trip latency of view messages through the plain AsyncMessage path
+// and through shared memory (AsyncShmemMessage), across payload sizes. A
+// frame script echoes every Bench:Ping back as Bench:Pong. Next to the
+// latency, the payload copies the UI side made per round trip and the
+// shared memory segments it mapped or reused are reported. Runs the app on
+// aPump until done, 0 when every size completed on both paths.
+int RunMessageBenchmark(mozilla::embedlite::EmbedLiteApp* aApp, LocalMessagePump* aPump);
+
+#endif /* messagebenchmark_h */
@@ -0,0 +1,94 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "registrybenchmark.h"
+
+#include "mozilla/embedlite/EmbedLiteRegistry.h"
+
+#include <chrono>
+#include <map>
+#include <stdio.h>
+#include <vector>
+
+using namespace mozilla::embedlite;
+
+static const uint32_t sTabCounts[] = { 50, 200, 500 };
+static const int sRounds = 200;
+
+struct FakeView
+{
+    uint32_t mId;
+    uint64_t mOuterId;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double
+NsPerLookup(const Clock::duration& aDuration, uint32_t aTabs)
+{
+    return std::chrono::duration<double, std::nano>(aDuration).count() / (double(sRounds) * aTabs);
+}
+
+// Sum of the ids found, so neither loop can be optimized away.
+static uint64_t
+ScanLookups(const std::map<uint32_t, FakeView*>& aViews, uint32_t aTabs)
+{
+    uint64_t found = 0;
+    for (int round = 0; round < sRounds; ++round) {
+        for (uint32_t i = 0; i < aTabs; ++i) {
+            for (const auto& pair : aViews) {
+                if (pair.second->mOuterId == 1000 + i) {
+                    found += pair.first;
+                    break;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+static uint64_t
+RegistryLookups(const EmbedLiteRegistry<FakeView>& aRegistry, uint32_t aTabs)
+{
+    uint64_t found = 0;
+    for (int round = 0; round < sRounds; ++round) {
+        for (uint32_t i = 0; i < aTabs; ++i) {
+            found += aRegistry.GetId(EmbedLiteRegistryKey::OuterWindowID, 1000 + i);
+        }
+    }
+    return found;
+}
+
+int
+RunRegistryBenchmark()
+{
+    bool passed = true;
+    printf("%-6s %18s %22s\n", "tabs", "scan_ns_per_lookup", "registry_ns_per_lookup");
+    for (uint32_t tabs : sTabCounts) {
+        std::vector<FakeView> views(tabs);
+        std::map<uint32_t, FakeView*> scan;
+        EmbedLiteRegistry<FakeView> registry;
+        for (uint32_t i = 0; i < tabs; ++i) {
+            views[i] = { i + 1, 1000 + i };
+            scan[views[i].mId] = &views[i];
+            registry.Add(views[i].mId, &views[i]);
+            registry.SetKey(views[i].mId, EmbedLiteRegistryKey::OuterWindowID, views[i].mOuterId);
+        }
+
+        Clock::time_point start = Clock::now();
+        uint64_t scanned = ScanLookups(scan, tabs);
+        Clock::duration scanTime = Clock::now() - start;
+
+        start = Clock::now();
+        uint64_t indexed = RegistryLookups(registry, tabs);
+        Clock::duration registryTime = Clock::now() - start;
+
+        uint64_t expected = uint64_t(sRounds) * tabs * (tabs + 1) / 2;
+        passed &= scanned == expected && indexed == expected;
+        printf("%-6u %18.1f %22.1f\n", tabs, NsPerLookup(scanTime, tabs), NsPerLookup(registryTime, tabs));
+    }
+    printf("result:%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef registrybenchmark_h
+#define registrybenchmark_h
+
+// Lookups of views by outer window id in sessions with hundreds of tabs,
+// through EmbedLiteRegistry against the linear scan over a view map it
+// replaced. Needs no running app, 0 when both found every tab.
+int RunRegistryBenchmark();
+
+#endif /* registrybenchmark_h */
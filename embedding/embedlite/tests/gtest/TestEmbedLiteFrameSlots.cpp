@@ -0,0 +1,111 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "embedthread/EmbedLiteFrameSlots.h"
+
+#include <memory>
+#include <thread>
+
+using namespace mozilla::embedlite;
+
+TEST(EmbedLiteFrameSlotsTest, NewestFrameWins)
+{
+  EmbedLiteFrameSlots<int> slots;
+  ASSERT_EQ(slots.Acquire(), nullptr);
+
+  slots.Publish(1);
+  ASSERT_NE(slots.Acquire(), nullptr);
+  ASSERT_EQ(*slots.Acquire(), 1);
+
+  slots.Publish(2);
+  slots.Publish(3);
+  ASSERT_EQ(*slots.Acquire(), 3);
+  // Without a new frame the consumer keeps the one it has.
+  ASSERT_EQ(*slots.Acquire(), 3);
+
+  ASSERT_EQ(slots.PublishedFrames(), 3u);
+  ASSERT_EQ(slots.DroppedFrames(), 1u);
+
+  slots.Clear();
+  ASSERT_EQ(slots.Acquire(), nullptr);
+}
+
+TEST(EmbedLiteFrameSlotsTest, RecyclesReplacedFrames)
+{
+  EmbedLiteFrameSlots<int> slots;
+  ASSERT_EQ(slots.TakeRecycled(), 0);
+
+  slots.Publish(1);
+  slots.Publish(2);
+  // Replaced before the consumer saw it.
+  ASSERT_EQ(slots.TakeRecycled(), 1);
+
+  ASSERT_EQ(*slots.Acquire(), 2);
+  slots.Publish(3);
+  ASSERT_EQ(*slots.Acquire(), 3);
+  slots.Publish(4);
+  // The consumer moved from 2 to 3.
+  ASSERT_EQ(slots.TakeRecycled(), 2);
+}
+
+TEST(EmbedLiteFrameSlotsTest, ConcurrentHandOff)
+{
+  static const int kFrames = 100000;
+  EmbedLiteFrameSlots<int> slots;
+
+  std::thread producer([&slots] {
+    for (int i = 1; i <= kFrames; ++i) {
+      slots.Publish(int(i));
+    }
+  });
+
+  int last = 0;
+  while (last < kFrames) {
+    int* frame = slots.Acquire();
+    if (frame) {
+      // Frames never go backwards and are never torn.
+      ASSERT_GE(*frame, last);
+      last = *frame;
+    }
+  }
+  producer.join();
+
+  ASSERT_EQ(slots.PublishedFrames(), uint64_t(kFrames));
+  ASSERT_LT(slots.DroppedFrames(), uint64_t(kFrames));
+}
+
+TEST(EmbedLiteFrameSlotsTest, RetireKeepsConsumerFrame)
+{
+  EmbedLiteFrameSlots<std::shared_ptr<int>> slots;
+  std::weak_ptr<int> held;
+  {
+    std::shared_ptr<int> frame = std::make_shared<int>(1);
+    held = frame;
+    slots.Publish(std::move(frame));
+  }
+  ASSERT_EQ(**slots.Acquire(), 1);
+
+  std::weak_ptr<int> pending;
+  {
+    std::shared_ptr<int> frame = std::make_shared<int>(2);
+    pending = frame;
+    slots.Publish(std::move(frame));
+  }
+
+  slots.Retire();
+  // The unread frame goes, the one the consumer holds stays.
+  ASSERT_TRUE(pending.expired());
+  ASSERT_FALSE(held.expired());
+  ASSERT_EQ(slots.Acquire(), nullptr);
+  ASSERT_FALSE(held.expired());
+
+  // Back with the producer after that Acquire, replaced by later frames.
+  slots.Publish(std::make_shared<int>(3));
+  slots.Publish(std::make_shared<int>(4));
+  ASSERT_TRUE(held.expired());
+  ASSERT_EQ(**slots.Acquire(), 4);
+  ASSERT_EQ(slots.DroppedFrames(), 2u);
+}
@@ -0,0 +1,86 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "embedthread/EmbedLiteFrameTiming.h"
+
+using namespace mozilla;
+using namespace mozilla::embedlite;
+
+TEST(EmbedLiteFrameTimingTest, Percentiles)
+{
+  EmbedLiteFrameTiming timing(TimeDuration::FromMilliseconds(16));
+  EmbedLiteFrameTimingStats stats;
+  ASSERT_FALSE(timing.GetStats(&stats));
+
+  TimeStamp vsync = TimeStamp::Now();
+  uint32_t reports = 0;
+  // Composites taking 1..100 ms, presented right after compositing.
+  for (int i = 1; i <= 100; ++i) {
+    EmbedLiteFrameTimingRecord record;
+    record.mVsync = vsync;
+    record.mCompositeStart = vsync;
+    record.mCompositeEnd = vsync + TimeDuration::FromMilliseconds(i);
+    record.mPresent = record.mCompositeEnd;
+    reports += timing.Record(record, 10);
+  }
+  ASSERT_EQ(reports, 10u);
+
+  ASSERT_TRUE(timing.GetStats(&stats));
+  ASSERT_EQ(stats.frames, 100u);
+  ASSERT_NEAR(stats.composite.p50, 50, 0.01);
+  ASSERT_NEAR(stats.composite.p95, 95, 0.01);
+  ASSERT_NEAR(stats.composite.p99, 99, 0.01);
+  ASSERT_NEAR(stats.vsyncToPresent.p50, 50, 0.01);
+  ASSERT_NEAR(stats.mutexWait.p99, 0, 0.01);
+  // Frames presented after 17..100 ms are late.
+  ASSERT_EQ(stats.jankFrames, 84u);
+}
+
+TEST(EmbedLiteFrameTimingTest, RingBufferKeepsRecentFrames)
+{
+  EmbedLiteFrameTiming timing(TimeDuration::FromMilliseconds(16));
+  TimeStamp start = TimeStamp::Now();
+  for (uint32_t i = 0; i < EmbedLiteFrameTiming::kCapacity * 2; ++i) {
+    EmbedLiteFrameTimingRecord record;
+    record.mCompositeStart = start;
+    record.mCompositeEnd = start + TimeDuration::FromMilliseconds(i < EmbedLiteFrameTiming::kCapacity ? 100 : 1);
+    ASSERT_FALSE(timing.Record(record, 0));
+  }
+
+  EmbedLiteFrameTimingStats stats;
+  ASSERT_TRUE(timing.GetStats(&stats));
+  ASSERT_EQ(stats.frames, EmbedLiteFrameTiming::kCapacity);
+  ASSERT_NEAR(stats.composite.p99, 1, 0.01);
+  // Not presented frames do not count as jank.
+  ASSERT_EQ(stats.jankFrames, 0u);
+}
+
+TEST(EmbedLiteFrameTimingTest, InputToPresent)
+{
+  EmbedLiteFrameTiming timing(TimeDuration::FromMilliseconds(16));
+  TimeStamp vsync = TimeStamp::Now();
+  // The oldest sample is charged to the next presented frame only.
+  timing.NoteInputSample(vsync - TimeDuration::FromMilliseconds(10));
+  timing.NoteInputSample(vsync - TimeDuration::FromMilliseconds(5));
+  for (int i = 0; i < 2; ++i) {
+    EmbedLiteFrameTimingRecord record;
+    record.mVsync = vsync;
+    record.mCompositeStart = vsync;
+    record.mCompositeEnd = vsync + TimeDuration::FromMilliseconds(2);
+    record.mPresent = record.mCompositeEnd;
+    timing.Record(record, 0);
+  }
+
+  EmbedLiteFrameTimingStats stats;
+  ASSERT_TRUE(timing.GetStats(&stats));
+  ASSERT_EQ(stats.inputFrames, 1u);
+  ASSERT_NEAR(stats.inputToPresent.p50, 12, 0.01);
+
+  TimeStamp lastVsync;
+  TimeDuration interval;
+  ASSERT_TRUE(timing.GetLastVsync(&lastVsync, &interval));
+  ASSERT_TRUE(lastVsync == vsync);
+}
@@ -0,0 +1,114 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "embedshared/EmbedLiteInputResampler.h"
+
+using namespace mozilla;
+using namespace mozilla::embedlite;
+
+static MultiTouchInput
+Move(const TimeStamp& aStart, uint32_t aTime, int32_t aX)
+{
+  MultiTouchInput move(MultiTouchInput::MULTITOUCH_MOVE, aTime,
+                       aStart + TimeDuration::FromMilliseconds(aTime), 0);
+  move.mTouches.AppendElement(SingleTouchData(0, ScreenIntPoint(aX, 0), ScreenSize(1, 1), 0, 0));
+  return move;
+}
+
+static TimeStamp
+At(const TimeStamp& aStart, double aMs)
+{
+  return aStart + TimeDuration::FromMilliseconds(aMs);
+}
+
+TEST(EmbedLiteInputResamplerTest, Interpolates)
+{
+  EmbedLiteInputResampler resampler;
+  TimeStamp start = TimeStamp::Now();
+  // 1px per ms.
+  resampler.AddMove(Move(start, 0, 0));
+  resampler.AddMove(Move(start, 8, 8));
+  resampler.AddMove(Move(start, 16, 16));
+  ASSERT_TRUE(resampler.OldestMoveTime() == start);
+
+  nsTArray<MultiTouchInput> history;
+  MultiTouchInput move = resampler.Resample(At(start, 12), &history);
+  ASSERT_EQ(move.mTouches[0].mScreenPoint.x, 12);
+  ASSERT_TRUE(move.mTimeStamp == At(start, 12));
+  ASSERT_EQ(move.mTime, 12u);
+  ASSERT_EQ(history.Length(), 3u);
+  ASSERT_FALSE(resampler.HasMoves());
+
+  // Sample times before the first pending move use the previous batch.
+  resampler.AddMove(Move(start, 24, 24));
+  move = resampler.Resample(At(start, 20));
+  ASSERT_EQ(move.mTouches[0].mScreenPoint.x, 20);
+}
+
+TEST(EmbedLiteInputResamplerTest, LimitsPrediction)
+{
+  EmbedLiteInputResampler resampler;
+  TimeStamp start = TimeStamp::Now();
+  resampler.AddMove(Move(start, 0, 0));
+  resampler.AddMove(Move(start, 8, 8));
+
+  // Half the sample interval at most.
+  MultiTouchInput move = resampler.Resample(At(start, 20));
+  ASSERT_EQ(move.mTouches[0].mScreenPoint.x, 12);
+  ASSERT_TRUE(move.mTimeStamp == At(start, 12));
+
+  // And never more than kMaxPredictionMs.
+  resampler.AddMove(Move(start, 40, 40));
+  move = resampler.Resample(At(start, 100));
+  ASSERT_EQ(move.mTouches[0].mScreenPoint.x, 40 + int32_t(EmbedLiteInputResampler::kMaxPredictionMs));
+
+  // Samples too close together are not extrapolated from.
+  resampler.AddMove(Move(start, 41, 100));
+  move = resampler.Resample(At(start, 50));
+  ASSERT_EQ(move.mTouches[0].mScreenPoint.x, 100);
+}
+
+TEST(EmbedLiteInputResamplerTest, ResetForgetsPreviousMoves)
+{
+  EmbedLiteInputResampler resampler;
+  TimeStamp start = TimeStamp::Now();
+  resampler.AddMove(Move(start, 0, 0));
+  resampler.Resample(At(start, 0));
+  resampler.Reset();
+
+  // A single move without a predecessor is delivered as it is.
+  resampler.AddMove(Move(start, 16, 16));
+  MultiTouchInput move = resampler.Resample(At(start, 32));
+  ASSERT_EQ(move.mTouches[0].mScreenPoint.x, 16);
+  // Null sample time takes the newest move.
+  resampler.AddMove(Move(start, 32, 32));
+  move = resampler.Resample(TimeStamp());
+  ASSERT_EQ(move.mTouches[0].mScreenPoint.x, 32);
+}
+
+TEST(EmbedLiteInputResamplerTest, HistoryFollowsAsyncScroll)
+{
+  EmbedLiteInputResampler resampler;
+  TimeStamp start = TimeStamp::Now();
+  resampler.AddMove(Move(start, 0, 0));
+  resampler.AddMove(Move(start, 8, 8));
+  resampler.AddMove(Move(start, 16, 16));
+
+  nsTArray<MultiTouchInput> history;
+  MultiTouchInput raw = resampler.Resample(At(start, 12), &history);
+  // What APZ leaves of the resampled move while scrolled by 30px.
+  MultiTouchInput untransformed(raw);
+  untransformed.mTouches[0].mScreenPoint.x += 30;
+  untransformed.mTouches[0].mLocalScreenPoint.x += 30;
+
+  EmbedLiteInputResampler::Untransform(raw, untransformed, history);
+  ASSERT_EQ(history.Length(), 3u);
+  ASSERT_EQ(history[0].mTouches[0].mScreenPoint.x, 30);
+  ASSERT_EQ(history[1].mTouches[0].mScreenPoint.x, 38);
+  ASSERT_EQ(history[2].mTouches[0].mScreenPoint.x, 46);
+  ASSERT_EQ(history[2].mTouches[0].mLocalScreenPoint.x, 30.0f);
+  ASSERT_EQ(history[2].mTouches[0].mScreenPoint.y, 0);
+}
@@ -0,0 +1,117 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "modules/EmbedLiteMessageRouter.h"
+#include "nsIEmbedAppService.h"
+
+using namespace mozilla::embedlite;
+
+namespace {
+
+class FakeListener final : public nsIEmbedMessageListener
+{
+public:
+  NS_DECL_ISUPPORTS
+
+  NS_IMETHOD OnMessageReceived(const char* aName, const char16_t* aData) override
+  {
+    mLastName = aName;
+    mLastData = aData;
+    ++mCalls;
+    if (mRouter) {
+      // Unsubscribe from within the dispatch.
+      mRouter->RemoveListener(mUnsubscribe, this);
+      mRouter = nullptr;
+    }
+    return NS_OK;
+  }
+
+  nsCString mLastName;
+  nsString mLastData;
+  uint32_t mCalls = 0;
+  EmbedLiteMessageRouter* mRouter = nullptr;
+  nsString mUnsubscribe;
+
+private:
+  ~FakeListener() {}
+};
+
+NS_IMPL_ISUPPORTS(FakeListener, nsIEmbedMessageListener)
+
+} // namespace
+
+TEST(EmbedLiteMessageRouterTest, Dispatch)
+{
+  EmbedLiteMessageRouter router;
+  RefPtr<FakeListener> listener = new FakeListener();
+
+  ASSERT_EQ(router.Dispatch(NS_LITERAL_STRING("embed:test"), EmptyString()), 0u);
+  router.AddListener(NS_LITERAL_STRING("embed:test"), listener);
+  ASSERT_EQ(router.Dispatch(NS_LITERAL_STRING("embed:test"), NS_LITERAL_STRING("{}")), 1u);
+  ASSERT_TRUE(listener->mLastName.EqualsLiteral("embed:test"));
+  ASSERT_TRUE(listener->mLastData.EqualsLiteral("{}"));
+  ASSERT_EQ(router.Dispatch(NS_LITERAL_STRING("embed:other"), EmptyString()), 0u);
+
+  ASSERT_TRUE(router.RemoveListener(NS_LITERAL_STRING("embed:test"), listener));
+  ASSERT_FALSE(router.RemoveListener(NS_LITERAL_STRING("embed:test"), listener));
+  ASSERT_EQ(router.Dispatch(NS_LITERAL_STRING("embed:test"), EmptyString()), 0u);
+  ASSERT_EQ(listener->mCalls, 1u);
+}
+
+TEST(EmbedLiteMessageRouterTest, Prefixes)
+{
+  EmbedLiteMessageRouter router;
+  RefPtr<FakeListener> exact = new FakeListener();
+  RefPtr<FakeListener> prefix = new FakeListener();
+
+  router.AddListener(NS_LITERAL_STRING("embed:find"), exact);
+  router.AddListener(NS_LITERAL_STRING("embed:*"), prefix);
+  ASSERT_EQ(router.Dispatch(NS_LITERAL_STRING("embed:find"), EmptyString()), 2u);
+  ASSERT_EQ(router.Dispatch(NS_LITERAL_STRING("embed:never-subscribed"), EmptyString()), 1u);
+  ASSERT_TRUE(prefix->mLastName.EqualsLiteral("embed:never-subscribed"));
+  ASSERT_EQ(router.Dispatch(NS_LITERAL_STRING("other:find"), EmptyString()), 0u);
+
+  // Cached prefix matches are dropped with the subscription.
+  ASSERT_TRUE(router.RemoveListener(NS_LITERAL_STRING("embed:*"), prefix));
+  ASSERT_EQ(router.Dispatch(NS_LITERAL_STRING("embed:find"), EmptyString()), 1u);
+  ASSERT_EQ(prefix->mCalls, 2u);
+
+  EmbedLiteMessageFilter filter;
+  filter.Add(NS_LITERAL_STRING("embed:find"));
+  filter.Add(NS_LITERAL_STRING("embed:select*"));
+  ASSERT_TRUE(filter.Contains(NS_LITERAL_STRING("embed:find")));
+  ASSERT_TRUE(filter.Contains(NS_LITERAL_STRING("embed:selectall")));
+  ASSERT_FALSE(filter.Contains(NS_LITERAL_STRING("embed:findnext")));
+  filter.Remove(NS_LITERAL_STRING("embed:find"));
+  ASSERT_FALSE(filter.Contains(NS_LITERAL_STRING("embed:find")));
+}
+
+TEST(EmbedLiteMessageRouterTest, RemoveWhileDispatching)
+{
+  EmbedLiteMessageRouter router;
+  RefPtr<FakeListener> first = new FakeListener();
+  RefPtr<FakeListener> second = new FakeListener();
+
+  router.AddListener(NS_LITERAL_STRING("embed:once"), first);
+  router.AddListener(NS_LITERAL_STRING("embed:once"), second);
+  first->mRouter = &router;
+  first->mUnsubscribe = NS_LITERAL_STRING("embed:once");
+
+  // The running dispatch still reaches everyone it started with.
+  ASSERT_EQ(router.Dispatch(NS_LITERAL_STRING("embed:once"), EmptyString()), 2u);
+  ASSERT_EQ(router.Dispatch(NS_LITERAL_STRING("embed:once"), EmptyString()), 1u);
+  ASSERT_EQ(first->mCalls, 1u);
+  ASSERT_EQ(second->mCalls, 2u);
+
+  nsCString stats;
+  router.GetStats(stats);
+  ASSERT_TRUE(stats.Find("\"embed:once\"") != kNotFound);
+  ASSERT_TRUE(stats.Find("\"dispatches\": 2") != kNotFound);
+  ASSERT_TRUE(stats.Find("\"calls\": 3") != kNotFound);
+  router.ResetStats();
+  router.GetStats(stats);
+  ASSERT_TRUE(stats.Find("embed:once") == kNotFound);
+}
@@ -0,0 +1,65 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "embedhelpers/EmbedLitePooledViews.h"
+
+using namespace mozilla::embedlite;
+
+TEST(EmbedLitePooledViewsTest, TrimThenDestroy)
+{
+  EmbedLitePooledViews pooled;
+  pooled.Add(1);
+  pooled.Add(2);
+
+  // Trimmed, the view stays pooled until its destruction completed.
+  pooled.StartDestroy(2);
+  ASSERT_TRUE(pooled.IsDestroying(2));
+  ASSERT_EQ(pooled.Count(), 2u);
+  ASSERT_FALSE(pooled.Claim(2));
+
+  ASSERT_TRUE(pooled.Destroyed(2));
+  ASSERT_EQ(pooled.Count(), 1u);
+  // Only reported once.
+  ASSERT_FALSE(pooled.Destroyed(2));
+}
+
+TEST(EmbedLitePooledViewsTest, DestroyThenCrash)
+{
+  EmbedLitePooledViews pooled;
+  pooled.Add(1);
+  pooled.Add(2);
+
+  pooled.StartDestroy(1);
+  // Content crashed before confirming, EmbedLiteApp::NotifyViewCrashed
+  // completes the destruction itself and must still find it pooled.
+  ASSERT_TRUE(pooled.IsDestroying(1));
+  ASSERT_FALSE(pooled.Claim(1));
+  ASSERT_EQ(pooled.Count(), 2u);
+
+  ASSERT_TRUE(pooled.Destroyed(1));
+  ASSERT_FALSE(pooled.IsDestroying(1));
+  ASSERT_EQ(pooled.Count(), 1u);
+  ASSERT_TRUE(pooled.Claim(2));
+}
+
+TEST(EmbedLitePooledViewsTest, ClaimedViewsAreNotPooled)
+{
+  EmbedLitePooledViews pooled;
+  pooled.Add(1);
+  ASSERT_TRUE(pooled.Claim(1));
+  ASSERT_EQ(pooled.Count(), 0u);
+  ASSERT_FALSE(pooled.Destroyed(1));
+}
+
+TEST(EmbedLitePooledViewsTest, DestroyedWhileWaiting)
+{
+  EmbedLitePooledViews pooled;
+  pooled.Add(1);
+  ASSERT_FALSE(pooled.IsDestroying(1));
+  // Taken down by content without being trimmed first.
+  ASSERT_TRUE(pooled.Destroyed(1));
+  ASSERT_EQ(pooled.Count(), 0u);
+}
@@ -0,0 +1,97 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "embedhelpers/EmbedLiteRegistry.h"
+
+#include <vector>
+
+using namespace mozilla::embedlite;
+
+namespace {
+
+struct FakeView {
+  uint32_t mId;
+  uint64_t mOuterId;
+};
+
+} // namespace
+
+TEST(EmbedLiteRegistryTest, SecondaryKeys)
+{
+  EmbedLiteRegistry<FakeView> registry;
+  FakeView first = { 1, 101 };
+  FakeView second = { 2, 102 };
+
+  ASSERT_TRUE(registry.Add(1, &first));
+  ASSERT_TRUE(registry.Add(2, &second));
+  ASSERT_EQ(registry.Count(), 2u);
+  ASSERT_EQ(registry.Get(1), &first);
+  ASSERT_EQ(registry.Get(3), nullptr);
+
+  registry.SetKey(1, EmbedLiteRegistryKey::OuterWindowID, first.mOuterId);
+  registry.SetKey(2, EmbedLiteRegistryKey::OuterWindowID, second.mOuterId);
+  ASSERT_EQ(registry.GetBy(EmbedLiteRegistryKey::OuterWindowID, 102), &second);
+  ASSERT_EQ(registry.GetId(EmbedLiteRegistryKey::OuterWindowID, 101), 1u);
+  // Keys of different kinds do not mix.
+  ASSERT_EQ(registry.GetBy(EmbedLiteRegistryKey::Chrome, 101), nullptr);
+
+  // Moving a key drops the old value.
+  registry.SetKey(1, EmbedLiteRegistryKey::OuterWindowID, 201);
+  ASSERT_EQ(registry.GetBy(EmbedLiteRegistryKey::OuterWindowID, 101), nullptr);
+  ASSERT_EQ(registry.GetBy(EmbedLiteRegistryKey::OuterWindowID, 201), &first);
+
+  // So does clearing it.
+  registry.SetKey(2, EmbedLiteRegistryKey::OuterWindowID, 0);
+  ASSERT_EQ(registry.GetBy(EmbedLiteRegistryKey::OuterWindowID, 102), nullptr);
+  ASSERT_EQ(registry.Get(2), &second);
+
+  // Keys only exist for registered items.
+  registry.SetKey(3, EmbedLiteRegistryKey::Chrome, 42);
+  ASSERT_EQ(registry.GetId(EmbedLiteRegistryKey::Chrome, 42), 0u);
+}
+
+TEST(EmbedLiteRegistryTest, RemoveDropsKeys)
+{
+  EmbedLiteRegistry<FakeView> registry;
+  FakeView view = { 7, 700 };
+
+  registry.Add(7, &view);
+  registry.SetKey(7, EmbedLiteRegistryKey::Chrome, 0x1000);
+  registry.SetKey(7, EmbedLiteRegistryKey::BrowsingContext, 0x2000);
+  ASSERT_EQ(registry.Remove(7), &view);
+  ASSERT_EQ(registry.Remove(7), nullptr);
+  ASSERT_TRUE(registry.IsEmpty());
+  ASSERT_EQ(registry.GetBy(EmbedLiteRegistryKey::Chrome, 0x1000), nullptr);
+  ASSERT_EQ(registry.GetBy(EmbedLiteRegistryKey::BrowsingContext, 0x2000), nullptr);
+
+  // Re-adding an id replaces the item along with its keys.
+  FakeView other = { 7, 701 };
+  registry.Add(7, &view);
+  registry.SetKey(7, EmbedLiteRegistryKey::Chrome, 0x1000);
+  ASSERT_FALSE(registry.Add(7, &other));
+  ASSERT_EQ(registry.Get(7), &other);
+  ASSERT_EQ(registry.GetBy(EmbedLiteRegistryKey::Chrome, 0x1000), nullptr);
+}
+
+// Every tab of a large session is found by its secondary key.
+TEST(EmbedLiteRegistryTest, ManyTabs)
+{
+  static const uint32_t kTabs = 500;
+
+  std::vector<FakeView> views(kTabs);
+  EmbedLiteRegistry<FakeView> registry;
+  for (uint32_t i = 0; i < kTabs; ++i) {
+    views[i] = { i + 1, 1000 + i };
+    registry.Add(views[i].mId, &views[i]);
+    registry.SetKey(views[i].mId, EmbedLiteRegistryKey::OuterWindowID, views[i].mOuterId);
+  }
+
+  for (uint32_t i = 0; i < kTabs; ++i) {
+    ASSERT_EQ(registry.GetId(EmbedLiteRegistryKey::OuterWindowID, 1000 + i), i + 1);
+    ASSERT_EQ(registry.GetBy(EmbedLiteRegistryKey::OuterWindowID, 1000 + i), &views[i]);
+  }
+  ASSERT_EQ(registry.GetId(EmbedLiteRegistryKey::OuterWindowID, 1000 + kTabs), 0u);
+}
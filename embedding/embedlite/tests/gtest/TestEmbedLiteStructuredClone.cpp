@@ -0,0 +1,70 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "EmbedLiteStructuredClone.h"
+
+using namespace mozilla::embedlite;
+
+TEST(EmbedLiteStructuredCloneTest, RoundTrip)
+{
+  EmbedLiteStructuredCloneWriter writer;
+  writer.BeginObject();
+  writer.WriteKey(u"name");
+  writer.WriteString(u"héllo 世界");
+  writer.WriteKey(u"count");
+  writer.WriteInt32(-42);
+  writer.WriteKey(u"ratio");
+  writer.WriteDouble(0.5);
+  writer.WriteKey(u"list");
+  writer.BeginArray(2);
+  writer.WriteIndex(0);
+  writer.WriteBoolean(true);
+  writer.WriteIndex(1);
+  writer.WriteNull();
+  writer.End();
+  writer.End();
+
+  EmbedLiteStructuredCloneReader reader(writer.Data(), writer.Length());
+  ASSERT_EQ(reader.Peek(), EmbedLiteCloneType::Object);
+  ASSERT_TRUE(reader.BeginObject());
+
+  std::u16string key;
+  ASSERT_TRUE(reader.NextKey(key));
+  EXPECT_EQ(key, u"name");
+  std::u16string name;
+  ASSERT_TRUE(reader.ReadString(name));
+  EXPECT_EQ(name, u"héllo 世界");
+
+  ASSERT_TRUE(reader.NextKey(key));
+  EXPECT_EQ(key, u"count");
+  double count = 0;
+  ASSERT_TRUE(reader.ReadDouble(&count));
+  EXPECT_EQ(count, -42);
+
+  ASSERT_TRUE(reader.NextKey(key));
+  EXPECT_EQ(key, u"ratio");
+  double ratio = 0;
+  ASSERT_TRUE(reader.ReadDouble(&ratio));
+  EXPECT_EQ(ratio, 0.5);
+
+  ASSERT_TRUE(reader.NextKey(key));
+  EXPECT_EQ(key, u"list");
+  EXPECT_TRUE(reader.Skip());
+
+  EXPECT_FALSE(reader.NextKey(key));
+  EXPECT_FALSE(reader.HasError());
+}
+
+TEST(EmbedLiteStructuredCloneTest, Truncated)
+{
+  EmbedLiteStructuredCloneWriter writer;
+  writer.WriteString(u"truncated");
+
+  EmbedLiteStructuredCloneReader reader(writer.Data(), writer.Length() - 8);
+  std::u16string value;
+  EXPECT_FALSE(reader.ReadString(value));
+  EXPECT_TRUE(reader.HasError());
+}
@@ -0,0 +1,51 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "EmbedLiteTabManager.h"
+
+using namespace mozilla::embedlite;
+
+typedef EmbedLiteTabState State;
+typedef EmbedLiteTabStep Step;
+
+TEST(EmbedLiteTabManagerTest, GoesToBackground)
+{
+  ASSERT_EQ(EmbedLiteTabManager::GetSteps(State::Active, State::Throttled),
+            Step::Deactivate | Step::Throttle);
+  ASSERT_EQ(EmbedLiteTabManager::GetSteps(State::Active, State::Frozen),
+            Step::Deactivate | Step::Throttle | Step::SuspendTimeouts);
+  ASSERT_EQ(EmbedLiteTabManager::GetSteps(State::Throttled, State::Frozen),
+            Step::SuspendTimeouts);
+  ASSERT_EQ(EmbedLiteTabManager::GetSteps(State::Throttled, State::Discarded),
+            Step::Discard);
+  // Timeouts are resumed before the page is unloaded.
+  ASSERT_EQ(EmbedLiteTabManager::GetSteps(State::Frozen, State::Discarded),
+            Step::ResumeTimeouts | Step::Discard);
+  ASSERT_EQ(EmbedLiteTabManager::GetSteps(State::Frozen, State::Throttled),
+            Step::ResumeTimeouts);
+  ASSERT_EQ(EmbedLiteTabManager::GetSteps(State::Frozen, State::Frozen), Step::None);
+}
+
+TEST(EmbedLiteTabManagerTest, ComesToForeground)
+{
+  ASSERT_EQ(EmbedLiteTabManager::GetSteps(State::Throttled, State::Active),
+            Step::Unthrottle | Step::Activate);
+  ASSERT_EQ(EmbedLiteTabManager::GetSteps(State::Frozen, State::Active),
+            Step::ResumeTimeouts | Step::Unthrottle | Step::Activate);
+  ASSERT_EQ(EmbedLiteTabManager::GetSteps(State::Discarded, State::Active),
+            Step::Restore | Step::Unthrottle | Step::Activate);
+  ASSERT_EQ(EmbedLiteTabManager::GetSteps(State::Active, State::Active), Step::None);
+}
+
+TEST(EmbedLiteTabManagerTest, ReleaseLeavesActivityAlone)
+{
+  ASSERT_EQ(EmbedLiteTabManager::GetReleaseSteps(State::Active), Step::None);
+  ASSERT_EQ(EmbedLiteTabManager::GetReleaseSteps(State::Throttled), Step::Unthrottle);
+  ASSERT_EQ(EmbedLiteTabManager::GetReleaseSteps(State::Frozen),
+            Step::ResumeTimeouts | Step::Unthrottle);
+  ASSERT_EQ(EmbedLiteTabManager::GetReleaseSteps(State::Discarded),
+            Step::Restore | Step::Unthrottle);
+}
@@ -0,0 +1,142 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "embedhelpers/EmbedLiteTaskQueue.h"
+
+#include <string>
+#include <vector>
+
+using namespace mozilla;
+using namespace mozilla::embedlite;
+
+static TimeStamp
+At(const TimeStamp& aStart, double aMs)
+{
+  return aStart + TimeDuration::FromMilliseconds(aMs);
+}
+
+static TimeDuration
+Ms(double aMs)
+{
+  return TimeDuration::FromMilliseconds(aMs);
+}
+
+TEST(EmbedLiteTaskQueueTest, RunsByPriority)
+{
+  std::vector<TimeDuration> wakeUps;
+  EmbedLiteTaskQueue queue([&wakeUps](TimeDuration aDelay) { wakeUps.push_back(aDelay); });
+  TimeStamp start = TimeStamp::Now();
+  std::string order;
+  queue.Schedule(EmbedLiteTaskPriority::Idle, [&order]() { order += "i"; }, Ms(0), Ms(0), start);
+  queue.Schedule(EmbedLiteTaskPriority::Normal, [&order]() { order += "n1"; }, Ms(0), Ms(0), start);
+  queue.Schedule(EmbedLiteTaskPriority::Input, [&order]() { order += "I"; }, Ms(0), Ms(0), start);
+  queue.Schedule(EmbedLiteTaskPriority::Normal, [&order]() { order += "n2"; }, Ms(0), Ms(0), start);
+  // One wake up is enough until it came.
+  ASSERT_EQ(wakeUps.size(), 1u);
+
+  while (queue.RunNext(start)) {
+  }
+  ASSERT_EQ(order, "In1n2i");
+
+  EmbedLiteTaskStats stats = queue.GetStats(EmbedLiteTaskPriority::Normal);
+  ASSERT_EQ(stats.run, 2u);
+  ASSERT_EQ(stats.pending, 0u);
+}
+
+TEST(EmbedLiteTaskQueueTest, DelayedAndRepeating)
+{
+  std::vector<TimeDuration> wakeUps;
+  EmbedLiteTaskQueue queue([&wakeUps](TimeDuration aDelay) { wakeUps.push_back(aDelay); });
+  TimeStamp start = TimeStamp::Now();
+  int runs = 0;
+  EmbedLiteTaskId id = queue.Schedule(EmbedLiteTaskPriority::Render, [&runs]() { runs++; },
+                                      Ms(10), Ms(10), start);
+  ASSERT_EQ(wakeUps.size(), 1u);
+  ASSERT_TRUE(wakeUps[0] == Ms(10));
+
+  ASSERT_FALSE(queue.RunNext(At(start, 5)));
+  ASSERT_TRUE(queue.RunNext(At(start, 12)));
+  ASSERT_EQ(runs, 1);
+  // Due at 20 again, 8 ms from the run.
+  ASSERT_TRUE(wakeUps.back() == Ms(8));
+
+  // Late by 15 ms, the missed run at 30 is skipped.
+  ASSERT_TRUE(queue.RunNext(At(start, 35)));
+  ASSERT_FALSE(queue.RunNext(At(start, 36)));
+  ASSERT_EQ(runs, 2);
+
+  EmbedLiteTaskStats stats = queue.GetStats(EmbedLiteTaskPriority::Render);
+  ASSERT_NEAR(stats.meanLatencyMs, 8.5, 0.01);
+  ASSERT_NEAR(stats.maxLatencyMs, 15, 0.01);
+  ASSERT_EQ(stats.pending, 1u);
+
+  ASSERT_TRUE(queue.Cancel(id));
+  ASSERT_FALSE(queue.RunNext(At(start, 100)));
+  ASSERT_EQ(runs, 2);
+  ASSERT_EQ(queue.GetStats(EmbedLiteTaskPriority::Render).cancelled, 1u);
+}
+
+TEST(EmbedLiteTaskQueueTest, CancelIsSafe)
+{
+  EmbedLiteTaskQueue queue([](TimeDuration) {});
+  TimeStamp start = TimeStamp::Now();
+  bool ran = false;
+  EmbedLiteTaskId id = 0;
+  id = queue.Schedule(EmbedLiteTaskPriority::Normal, [&]() {
+    ran = true;
+    // Already running.
+    ASSERT_FALSE(queue.Cancel(id));
+  }, Ms(0), Ms(0), start);
+  ASSERT_TRUE(queue.RunNext(start));
+  ASSERT_TRUE(ran);
+  ASSERT_FALSE(queue.Cancel(id));
+  ASSERT_FALSE(queue.Cancel(id + 1));
+
+  // A repeating task stopping itself.
+  int runs = 0;
+  id = queue.Schedule(EmbedLiteTaskPriority::Normal, [&]() {
+    if (++runs == 2) {
+      queue.Cancel(id);
+    }
+  }, Ms(0), Ms(1), start);
+  for (int i = 0; i < 5; ++i) {
+    queue.RunNext(At(start, i));
+  }
+  ASSERT_EQ(runs, 2);
+}
+
+TEST(EmbedLiteTaskQueueTest, IdlePeriods)
+{
+  std::vector<TimeDuration> wakeUps;
+  EmbedLiteTaskQueue queue([&wakeUps](TimeDuration aDelay) { wakeUps.push_back(aDelay); });
+  TimeStamp start = TimeStamp::Now();
+  std::string order;
+  queue.EnableIdlePeriods();
+  queue.Schedule(EmbedLiteTaskPriority::Idle, [&order]() { order += "i"; }, Ms(0), Ms(0), start);
+  // Nothing to wake up for until an idle period comes.
+  ASSERT_TRUE(wakeUps.empty());
+  ASSERT_FALSE(queue.RunNext(start));
+  ASSERT_TRUE(queue.IdleTaskDue(start));
+
+  // More urgent tasks go first, through their own wake up.
+  queue.Schedule(EmbedLiteTaskPriority::Normal, [&order]() { order += "n"; }, Ms(0), Ms(0), start);
+  ASSERT_EQ(wakeUps.size(), 1u);
+  ASSERT_FALSE(queue.RunIdle(start));
+  ASSERT_TRUE(queue.RunNext(start));
+  ASSERT_FALSE(queue.RunNext(start));
+
+  ASSERT_TRUE(queue.RunIdle(start));
+  ASSERT_FALSE(queue.RunIdle(start));
+  ASSERT_FALSE(queue.IdleTaskDue(start));
+  ASSERT_EQ(order, "ni");
+
+  // Delayed ones become due for later periods.
+  queue.Schedule(EmbedLiteTaskPriority::Idle, [&order]() { order += "d"; }, Ms(10), Ms(0), start);
+  ASSERT_FALSE(queue.IdleTaskDue(At(start, 5)));
+  ASSERT_FALSE(queue.RunNext(At(start, 12)));
+  ASSERT_TRUE(queue.RunIdle(At(start, 12)));
+  ASSERT_EQ(order, "nid");
+}
@@ -210,11 +210,16 @@ void BrowserChildHelper::DispatchMessageManagerMessage(const nsAString& aMessage
     }
   }
 
+  DispatchMessageManagerMessage(aMessageName, data);
+}
+
+void BrowserChildHelper::DispatchMessageManagerMessage(const nsAString& aMessageName,
+                                                       dom::ipc::StructuredCloneData& aData) {
   RefPtr<BrowserChildHelperMessageManager> kungFuDeathGrip(
       mBrowserChildMessageManager);
   RefPtr<nsFrameMessageManager> mm = kungFuDeathGrip->GetMessageManager();
   mm->ReceiveMessage(static_cast<EventTarget*>(kungFuDeathGrip), nullptr,
-                     aMessageName, false, &data, nullptr, IgnoreErrors());
+                     aMessageName, false, &aData, nullptr, IgnoreErrors());
 }
 
 NS_IMPL_CYCLE_COLLECTION_CLASS(BrowserChildHelper)
@@ -510,6 +515,11 @@ nsresult BrowserChildHelper::DoSendAsyncMessage(const nsAString& aMessage,
   mm->ReceiveMessage(static_cast<EventTarget *>(embedFrame),
                      nullptr, aMessage, false, &aData, nullptr, IgnoreErrors());
 
+  // Binary listeners get the clone buffer as is, skipping JSON conversion.
+  if (mView->HasBinaryMessageListener(aMessage)) {
+    return mView->DoSendAsyncBinaryMessage(aMessage, aData) ? NS_OK : NS_ERROR_UNEXPECTED;
+  }
+
   if (!mView->HasMessageListener(aMessage)) {
     LOGW("Message not registered msg:%s\n", NS_ConvertUTF16toUTF8(aMessage).get());
     return NS_OK;
@@ -164,6 +164,8 @@ private:
   // so we don't need things like this.
   void DispatchMessageManagerMessage(const nsAString& aMessageName,
                                      const nsAString& aJSONData);
+  void DispatchMessageManagerMessage(const nsAString& aMessageName,
+                                     mozilla::dom::ipc::StructuredCloneData& aData);
 
   CSSPoint GetVisualToLayoutTransformedPoint(const CSSPoint &aInput,
                                              const mozilla::layers::ScrollableLayerGuid::ViewID &aScrollId);
@@ -4,26 +4,343 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "EmbedLog.h"
-#include <string>
-#include <map>
 
 #ifdef MOZ_LOGGING
 
+#include "mozilla/ArrayUtils.h"
+#include "mozilla/StaticMutex.h"
+#include "mozilla/ThreadLocal.h"
+#include "prthread.h"
+#include "prtime.h"
+
+#include <algorithm>
+#include <atomic>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
 using namespace mozilla;
 
 LogModule*
 GetEmbedCommonLog(const char* aModule)
 {
-  static std::map<std::string, LogModule*> sLogMap;
-  std::map<std::string, LogModule*>::iterator it = sLogMap.find(aModule);
-  LogModule* retVal;
-  if (sLogMap.end() == it) {
-    printf("Created LOG for %s\n", aModule);
-    sLogMap[aModule] = retVal = LazyLogModule(aModule);
-  } else {
-    retVal = it->second;
+  return LogModule::Get(aModule);
+}
+
+namespace mozilla {
+namespace embedlite {
+
+LazyLogModule gEmbedLiteLog("EmbedLite");
+LazyLogModule gEmbedLiteTraceLog("EmbedLiteTrace");
+
+namespace {
+
+static const uint32_t kRingEntries = 256;
+static const size_t kEntryTextSize = 240;
+static const size_t kThreadNameSize = 32;
+static const uint32_t kFlushIntervalMs = 50;
+
+/*
+ * Entries are guarded by a sequence number, so the flush thread and crash
+ * dumps can tell torn or overwritten entries from complete ones without
+ * ever making the logging thread wait.
+ */
+struct LogEntry {
+  // 2 * index + 1 while being written, 2 * index + 2 once complete.
+  std::atomic<uint32_t> mSeq;
+  // When EmbedLogWrite was called, the flush prints it in place of its own.
+  PRTime mTime;
+  const LogModule* mModule;
+  LogLevel mLevel;
+  char mText[kEntryTextSize];
+};
+
+// A complete entry copied out of its ring.
+struct FlushEntry {
+  PRTime mTime;
+  const char* mThread;
+  const LogModule* mModule;
+  LogLevel mLevel;
+  char mText[kEntryTextSize];
+};
+
+// Single producer ring of one thread, reused once the thread is gone.
+struct ThreadRing {
+  ThreadRing* mNext = nullptr;
+  std::atomic<bool> mInUse { true };
+  std::atomic<uint32_t> mHead { 0 };
+  // Only touched by flushes, under sFlushMutex.
+  uint32_t mTail = 0;
+  char mName[kThreadNameSize];
+  LogEntry mEntries[kRingEntries];
+};
+
+std::atomic<ThreadRing*> sRings { nullptr };
+std::atomic<bool> sStarted { false };
+bool sSync = false;
+MOZ_THREAD_LOCAL(ThreadRing*) sThreadRing;
+pthread_key_t sThreadExitKey;
+StaticMutex sStartMutex;
+StaticMutex sFlushMutex;
+
+const int kCrashSignals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+struct sigaction sPreviousActions[MOZ_ARRAY_LENGTH(kCrashSignals)];
+
+void
+ThreadExited(void* aRing)
+{
+  static_cast<ThreadRing*>(aRing)->mInUse = false;
+}
+
+void
+WriteString(int aFd, const char* aStr)
+{
+  size_t length = strlen(aStr);
+  while (length) {
+    ssize_t written = write(aFd, aStr, length);
+    if (written <= 0) {
+      return;
+    }
+    aStr += written;
+    length -= written;
   }
-  return retVal;
 }
 
+void
+CrashHandler(int aSignal, siginfo_t* aInfo, void* aContext)
+{
+  EmbedLogDumpLast(STDERR_FILENO, kRingEntries);
+
+  // Called directly with the original signal info and context, so the
+  // crash reporter installed before us dumps the faulting thread and not
+  // this handler. Reinstalled first, so a fault that happens again on
+  // return does not come back here.
+  for (size_t i = 0; i < MOZ_ARRAY_LENGTH(kCrashSignals); ++i) {
+    if (kCrashSignals[i] != aSignal) {
+      continue;
+    }
+    const struct sigaction& previous = sPreviousActions[i];
+    sigaction(aSignal, &previous, nullptr);
+    if (previous.sa_flags & SA_SIGINFO) {
+      if (previous.sa_sigaction) {
+        previous.sa_sigaction(aSignal, aInfo, aContext);
+        return;
+      }
+    } else if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN) {
+      previous.sa_handler(aSignal);
+      return;
+    }
+  }
+
+  // Default action. A fault happens again on return, at its origin, a
+  // signal that was sent has to be sent again.
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = SIG_DFL;
+  sigemptyset(&action.sa_mask);
+  sigaction(aSignal, &action, nullptr);
+  if (aInfo->si_code <= 0) {
+    raise(aSignal);
+  }
+}
+
+void
+FlushThread(void*)
+{
+  PR_SetCurrentThreadName("EmbedLogFlush");
+  for (;;) {
+    PR_Sleep(PR_MillisecondsToInterval(kFlushIntervalMs));
+    EmbedLogFlush();
+  }
+}
+
+void
+Start()
+{
+  StaticMutexAutoLock lock(sStartMutex);
+  if (sStarted) {
+    return;
+  }
+
+  const char* sync = getenv("EMBED_LOG_SYNC");
+  sSync = sync && *sync && *sync != '0';
+  if (!sSync) {
+    sThreadRing.infallibleInit();
+    pthread_key_create(&sThreadExitKey, ThreadExited);
+    PR_CreateThread(PR_SYSTEM_THREAD, FlushThread, nullptr, PR_PRIORITY_LOW,
+                    PR_GLOBAL_THREAD, PR_UNJOINABLE_THREAD, 0);
+    atexit(EmbedLogFlush);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = CrashHandler;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < MOZ_ARRAY_LENGTH(kCrashSignals); ++i) {
+      sigaction(kCrashSignals[i], &action, &sPreviousActions[i]);
+    }
+  }
+  sStarted = true;
+}
+
+// The only allocation is a thread's first ring, rings of finished threads
+// are taken over by new ones.
+ThreadRing*
+GetThreadRing()
+{
+  ThreadRing* ring = sThreadRing.get();
+  if (ring) {
+    return ring;
+  }
+
+  for (ring = sRings; ring; ring = ring->mNext) {
+    bool inUse = false;
+    if (ring->mInUse.compare_exchange_strong(inUse, true)) {
+      break;
+    }
+  }
+  if (!ring) {
+    ring = new ThreadRing();
+    ring->mNext = sRings;
+    while (!sRings.compare_exchange_weak(ring->mNext, ring)) {
+    }
+  }
+
+  {
+    StaticMutexAutoLock lock(sFlushMutex);
+    const char* name = PR_GetThreadName(PR_GetCurrentThread());
+    if (name) {
+      strncpy(ring->mName, name, kThreadNameSize - 1);
+      ring->mName[kThreadNameSize - 1] = '\0';
+    } else {
+      snprintf(ring->mName, kThreadNameSize, "%lu", (unsigned long)pthread_self());
+    }
+  }
+  sThreadRing.set(ring);
+  pthread_setspecific(sThreadExitKey, ring);
+  return ring;
+}
+
+// Copies the entry with the given index, false if it was overwritten or
+// is still being written.
+bool
+ReadEntry(const ThreadRing* aRing, uint32_t aIndex, PRTime* aTime, const LogModule** aModule,
+          LogLevel* aLevel, char* aText)
+{
+  const LogEntry& entry = aRing->mEntries[aIndex % kRingEntries];
+  uint32_t seq = entry.mSeq.load(std::memory_order_acquire);
+  if (seq != 2 * aIndex + 2) {
+    return false;
+  }
+  *aTime = entry.mTime;
+  *aModule = entry.mModule;
+  *aLevel = entry.mLevel;
+  memcpy(aText, entry.mText, kEntryTextSize);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return entry.mSeq.load(std::memory_order_relaxed) == seq;
+}
+
+} // namespace
+
+void
+EmbedLogWrite(const LogModule* aModule, LogLevel aLevel, const char* aFmt, ...)
+{
+  if (!sStarted) {
+    Start();
+  }
+
+  va_list args;
+  va_start(args, aFmt);
+  if (sSync) {
+    aModule->Printv(aLevel, aFmt, args);
+    va_end(args);
+    return;
+  }
+
+  ThreadRing* ring = GetThreadRing();
+  uint32_t index = ring->mHead.load(std::memory_order_relaxed);
+  LogEntry& entry = ring->mEntries[index % kRingEntries];
+  entry.mSeq.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  entry.mTime = PR_Now();
+  entry.mModule = aModule;
+  entry.mLevel = aLevel;
+  vsnprintf(entry.mText, kEntryTextSize, aFmt, args);
+  entry.mSeq.store(2 * index + 2, std::memory_order_release);
+  ring->mHead.store(index + 1, std::memory_order_release);
+  va_end(args);
+}
+
+void
+EmbedLogFlush()
+{
+  StaticMutexAutoLock lock(sFlushMutex);
+  std::vector<FlushEntry> entries;
+  for (ThreadRing* ring = sRings; ring; ring = ring->mNext) {
+    uint32_t head = ring->mHead.load(std::memory_order_acquire);
+    uint32_t dropped = 0;
+    if (head - ring->mTail > kRingEntries) {
+      dropped = head - ring->mTail - kRingEntries;
+      ring->mTail = head - kRingEntries;
+    }
+    for (; ring->mTail != head; ++ring->mTail) {
+      entries.emplace_back();
+      FlushEntry& entry = entries.back();
+      entry.mThread = ring->mName;
+      if (!ReadEntry(ring, ring->mTail, &entry.mTime, &entry.mModule, &entry.mLevel, entry.mText)) {
+        entries.pop_back();
+        ++dropped;
+      }
+    }
+    if (dropped) {
+      detail::log_print(gEmbedLiteLog, LogLevel::Warning,
+                        "[%s] %u log entries dropped", ring->mName, dropped);
+    }
+  }
+
+  // Interleaved as the threads logged, not ring by ring.
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const FlushEntry& aA, const FlushEntry& aB) { return aA.mTime < aB.mTime; });
+  for (const FlushEntry& entry : entries) {
+    PRExplodedTime time;
+    PR_ExplodeTime(entry.mTime, PR_GMTParameters, &time);
+    detail::log_print(entry.mModule, entry.mLevel, "%02d:%02d:%02d.%06d [%s] %s",
+                      time.tm_hour, time.tm_min, time.tm_sec, time.tm_usec,
+                      entry.mThread, entry.mText);
+  }
+}
+
+void
+EmbedLogDumpLast(int aFd, uint32_t aCount)
+{
+  char text[kEntryTextSize];
+  for (ThreadRing* ring = sRings; ring; ring = ring->mNext) {
+    uint32_t head = ring->mHead.load(std::memory_order_acquire);
+    uint32_t count = std::min(std::min(aCount, kRingEntries), head);
+    if (!count) {
+      continue;
+    }
+    WriteString(aFd, "--- Last EmbedLite log entries of ");
+    WriteString(aFd, ring->mName);
+    WriteString(aFd, " ---\n");
+    for (uint32_t index = head - count; index != head; ++index) {
+      PRTime time;
+      const LogModule* module;
+      LogLevel level;
+      if (ReadEntry(ring, index, &time, &module, &level, text)) {
+        text[kEntryTextSize - 1] = '\0';
+        WriteString(aFd, text);
+        WriteString(aFd, "\n");
+      }
+    }
+  }
+}
+
+} // namespace embedlite
+} // namespace mozilla
+
 #endif
@@ -13,15 +13,50 @@
 
 #ifdef EMBED_LITE_INTERNAL
 
+// Compatibility only, the macros below use statically resolved modules.
 extern mozilla::LogModule* GetEmbedCommonLog(const char* aModule);
 
-#define LOGF(FMT, ...) MOZ_LOG(GetEmbedCommonLog("EmbedLite"), mozilla::LogLevel::Error, ("FUNC::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__))
-#define LOGT(FMT, ...) MOZ_LOG(GetEmbedCommonLog("EmbedLiteTrace"), mozilla::LogLevel::Debug, ("TRACE::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__))
-#define LOGW(FMT, ...) MOZ_LOG(GetEmbedCommonLog("EmbedLite"), mozilla::LogLevel::Info, ("WARN: EmbedLite::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__))
-#define LOGE(FMT, ...) MOZ_LOG(GetEmbedCommonLog("EmbedLite"), mozilla::LogLevel::Warning, ("ERROR: EmbedLite::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__))
-#define LOGNI(FMT, ...) MOZ_LOG(GetEmbedCommonLog("EmbedLite"), mozilla::LogLevel::Error, ("NON_IMPL: EmbedLite::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__))
+namespace mozilla {
+namespace embedlite {
 
-#define LOGC(CUSTOMNAME, FMT, ...) MOZ_LOG(GetEmbedCommonLog(CUSTOMNAME), mozilla::LogLevel::Info, (CUSTOMNAME "::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__))
+extern LazyLogModule gEmbedLiteLog;
+extern LazyLogModule gEmbedLiteTraceLog;
+
+// Formats into a per thread ring buffer without locking or allocating, a
+// background thread writes the entries to the regular MOZ_LOG output in
+// the order they were logged, prefixed with the UTC time of this call.
+// EMBED_LOG_SYNC=1 in the environment logs synchronously instead.
+void EmbedLogWrite(const LogModule* aModule, LogLevel aLevel, const char* aFmt, ...) MOZ_FORMAT_PRINTF(3, 4);
+// Writes out everything buffered so far.
+void EmbedLogFlush();
+// Writes the last aCount entries of every thread to aFd, async signal
+// safe. Done on crashes once anything was logged.
+void EmbedLogDumpLast(int aFd, uint32_t aCount);
+
+} // namespace embedlite
+} // namespace mozilla
+
+// Arguments are only evaluated when the module is enabled for LEVEL.
+#define EMBED_LOG(MODULE, LEVEL, FMT, ...)                                                   \
+  do {                                                                                      \
+    const mozilla::LogModule* embedLogModule = MODULE;                                      \
+    if (MOZ_LOG_TEST(embedLogModule, LEVEL)) {                                              \
+      mozilla::embedlite::EmbedLogWrite(embedLogModule, LEVEL, FMT, ##__VA_ARGS__);         \
+    }                                                                                       \
+  } while (0)
+
+#define LOGF(FMT, ...) EMBED_LOG(mozilla::embedlite::gEmbedLiteLog, mozilla::LogLevel::Error, "FUNC::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__)
+#define LOGT(FMT, ...) EMBED_LOG(mozilla::embedlite::gEmbedLiteTraceLog, mozilla::LogLevel::Debug, "TRACE::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__)
+#define LOGW(FMT, ...) EMBED_LOG(mozilla::embedlite::gEmbedLiteLog, mozilla::LogLevel::Info, "WARN: EmbedLite::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__)
+#define LOGE(FMT, ...) EMBED_LOG(mozilla::embedlite::gEmbedLiteLog, mozilla::LogLevel::Warning, "ERROR: EmbedLite::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__)
+#define LOGNI(FMT, ...) EMBED_LOG(mozilla::embedlite::gEmbedLiteLog, mozilla::LogLevel::Error, "NON_IMPL: EmbedLite::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__)
+
+// One module handle per call site, resolved on first use.
+#define LOGC(CUSTOMNAME, FMT, ...)                                                          \
+  do {                                                                                      \
+    static mozilla::LazyLogModule embedLogCustom(CUSTOMNAME);                               \
+    EMBED_LOG(embedLogCustom, mozilla::LogLevel::Info, CUSTOMNAME "::%s:%d " FMT , __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__); \
+  } while (0)
 
 #else // EMBED_LITE_INTERNAL
 
@@ -32,6 +32,11 @@
 #include "mozilla/dom/Document.h"
 #include "mozilla/dom/Event.h"
 #include "mozilla/dom/EventTarget.h"
+#include "mozilla/PresShell.h"
+#include "mozilla/Preferences.h"
+#include "nsRefreshDriver.h"
+
+#include <algorithm>
 
 // Duplicated from EventNameList.h
 #define MOZ_MozAfterPaint "MozAfterPaint"
@@ -39,8 +44,33 @@
 #define MOZ_pagehide "pagehide"
 #define MOZ_MozScrolledAreaChanged "MozScrolledAreaChanged"
 
+using namespace mozilla;
 using namespace mozilla::dom;
 
+// Minimum time in ms between two scroll state updates of an inactive view.
+static uint32_t sBackgroundScrollStateInterval = 1000;
+// Minimum time in ms between two load progress updates.
+static uint32_t sLoadProgressInterval = 100;
+
+class WebBrowserChrome::ScrollStateObserver final : public nsARefreshObserver
+{
+public:
+  NS_INLINE_DECL_REFCOUNTING(WebBrowserChrome::ScrollStateObserver, override)
+
+  explicit ScrollStateObserver(WebBrowserChrome* aChrome) : mChrome(aChrome) {}
+
+  void WillRefresh(TimeStamp aTime) override
+  {
+    mChrome->FlushScrollState(aTime);
+  }
+
+private:
+  ~ScrollStateObserver() {}
+
+  // Owns us and unregisters us before going away.
+  WebBrowserChrome* mChrome;
+};
+
 static nsresult GetHttpChannelHelper(nsIChannel* aChannel,
                                      nsIHttpChannel** aHttpChannel) {
   nsCOMPtr<nsIHttpChannel> httpChannel = do_QueryInterface(aChannel);
@@ -76,15 +106,34 @@ WebBrowserChrome::WebBrowserChrome(nsIEmbedBrowserChromeListener* aListener)
   , mLocationHasChanged(false)
   , mFirstPaint(false)
   , mScrollOffset(0,0)
+  , mPendingScrollState(0)
+  , mLoadProgress(0)
+  , mPendingProgress(0)
+  , mPendingCurTotal(0)
+  , mPendingMaxTotal(0)
+  , mLoadBytes(0)
   , mListener(aListener)
   , mRequest(nullptr)
+  , mMediaPlaying(false)
 {
   LOGT();
+  static bool prefsInitialized = false;
+  if (!prefsInitialized) {
+    Preferences::AddUintVarCache(&sBackgroundScrollStateInterval,
+        "embedlite.scroll_state.background_interval", 1000);
+    Preferences::AddUintVarCache(&sLoadProgressInterval,
+        "embedlite.load_progress.interval", 100);
+    prefsInitialized = true;
+  }
 }
 
 WebBrowserChrome::~WebBrowserChrome()
 {
   LOGT();
+  StopScrollState();
+  if (mProgressTimer) {
+    mProgressTimer->Cancel();
+  }
 }
 
 NS_IMPL_ISUPPORTS(WebBrowserChrome,
@@ -206,6 +255,11 @@ WebBrowserChrome::OnProgressChange(nsIWebProgress* progress, nsIRequest* request
                                    int32_t curTotalProgress, int32_t maxTotalProgress)
 {
   NS_ENSURE_TRUE(mListener, NS_ERROR_FAILURE);
+  // Byte counts of the whole load, request completions come without a request.
+  if (request && curTotalProgress > 0) {
+    mLoadBytes = std::max<uint64_t>(mLoadBytes, curTotalProgress);
+  }
+
   // Filter optimization: Don't send garbage
   if (curTotalProgress > maxTotalProgress || maxTotalProgress <= 0) {
     return NS_OK;
@@ -218,7 +272,7 @@ WebBrowserChrome::OnProgressChange(nsIWebProgress* progress, nsIRequest* request
 
   float progFrac = (float)maxTotalProgress / 100.0f;
   int sprogress = progFrac ? (float)curTotalProgress / progFrac : 0;
-  mListener->OnLoadProgress(sprogress, curTotalProgress, maxTotalProgress);
+  ReportProgress(sprogress, curTotalProgress, maxTotalProgress);
 
   return NS_OK;
 }
@@ -237,8 +291,7 @@ WebBrowserChrome::OnStateChange(nsIWebProgress* progress, nsIRequest* request,
 
   if (progressStateFlags & nsIWebProgressListener::STATE_START) {
     if (progressStateFlags & nsIWebProgressListener::STATE_IS_NETWORK) {
-      // Reset filter members
-      mTotalRequests = mFinishedRequests = 0;
+      StartLoad();
     }
     if (progressStateFlags & nsIWebProgressListener::STATE_IS_REQUEST)
       // Filter optimization: If we have more than one request, show progress
@@ -261,7 +314,7 @@ WebBrowserChrome::OnStateChange(nsIWebProgress* progress, nsIRequest* request,
   }
   if (progressStateFlags & nsIWebProgressListener::STATE_STOP && progressStateFlags & nsIWebProgressListener::STATE_IS_DOCUMENT) {
     Unused << RemoveUserAgentObserver(request);
-    mListener->OnLoadFinished();
+    FinishLoad();
   }
   if (progressStateFlags & nsIWebProgressListener::STATE_REDIRECTING) {
     mListener->OnLoadRedirect();
@@ -408,38 +461,24 @@ WebBrowserChrome::HandleEvent(Event *aEvent)
       return NS_OK; // We are only interested in root scroll pane changes
     }
 
-    // Adjust width and height from the incoming event properties so that we
-    // ignore changes to width and height contributed by growth in page
-    // quadrants other than x > 0 && y > 0.
-    nsIntPoint scrollOffset = GetScrollOffset(docWin);
-
-    if (aEvent) {
-      InternalScrollAreaEvent *internalEvent = aEvent->WidgetEventPtr()->AsScrollAreaEvent();
-      RefPtr<DOMRect> mClientArea = new DOMRect(nullptr);
-      mClientArea->SetLayoutRect(internalEvent->mArea);
-
-      const float x = mClientArea->Left() + scrollOffset.x;
-      const float y = mClientArea->Top() + scrollOffset.y;
-      const uint32_t width = mClientArea->Width() + (x < 0 ? x : 0);
-      const uint32_t height = mClientArea->Height() + (y < 0 ? y : 0);
-      mListener->OnScrolledAreaChanged(width, height);
-    }
-
-    RefPtr<EventTarget> target(window->GetChromeEventHandler());
-    target->AddEventListener(NS_LITERAL_STRING(MOZ_MozAfterPaint), this, PR_FALSE);
+    // The area is adjusted with the scroll offset sampled on the next tick.
+    InternalScrollAreaEvent *internalEvent = aEvent->WidgetEventPtr()->AsScrollAreaEvent();
+    mScrolledArea = CSSRect::FromAppUnits(internalEvent->mArea);
+    ScheduleScrollState(nsIEmbedBrowserChromeListener::SCROLLED_AREA_CHANGED);
   } else if (type.EqualsLiteral(MOZ_pagehide)) {
     mScrollOffset = nsIntPoint();
   } else if (type.EqualsLiteral(MOZ_MozAfterPaint)) {
+    // Only the first paint after a location change is reported.
     nsCOMPtr<nsPIDOMWindowOuter> pidomWindow = do_QueryInterface(docWin);
     RefPtr<EventTarget> target(pidomWindow->GetChromeEventHandler());
     target->RemoveEventListener(NS_LITERAL_STRING(MOZ_MozAfterPaint), this, PR_FALSE);
-    if (mFirstPaint) {
-      mListener->OnUpdateDisplayPort();
-      return NS_OK;
+    if (!mFirstPaint) {
+      mFirstPaint = true;
+      if (!mLoadStart.IsNull() && mLoadFirstPaint.IsNull()) {
+        mLoadFirstPaint = TimeStamp::Now();
+      }
+      ScheduleScrollState(nsIEmbedBrowserChromeListener::SCROLL_FIRST_PAINT);
     }
-    mFirstPaint = true;
-    nsIntPoint offset = GetScrollOffset(docWin);
-    mListener->OnFirstPaint(offset.x, offset.y);
   } else if (type.EqualsLiteral(MOZ_scroll)) {
     EventTarget *target = aEvent->GetTarget();
     nsCOMPtr<Document> eventDoc = do_QueryInterface(target);
@@ -447,7 +486,7 @@ WebBrowserChrome::HandleEvent(Event *aEvent)
     if (eventDoc != ctDoc) {
       return NS_OK;
     }
-    SendScroll();
+    ScheduleScrollState(nsIEmbedBrowserChromeListener::SCROLL_OFFSET_CHANGED);
   }
 
   return NS_OK;
@@ -509,16 +548,180 @@ nsresult WebBrowserChrome::GetDocumentPtr(Document **aDocument)
 }
 
 void
-WebBrowserChrome::SendScroll()
+WebBrowserChrome::StartLoad()
+{
+  // Reset filter members
+  mTotalRequests = mFinishedRequests = 0;
+  mLoadProgress = mPendingProgress = 0;
+  mLastProgress = TimeStamp();
+  if (mProgressTimer) {
+    mProgressTimer->Cancel();
+    mProgressTimer = nullptr;
+  }
+  mLoadStart = TimeStamp::Now();
+  mLoadFirstPaint = TimeStamp();
+  mLoadBytes = 0;
+}
+
+void
+WebBrowserChrome::ReportProgress(int32_t aProgress, int32_t aCurTotal, int32_t aMaxTotal)
+{
+  // More requests may start at any time, 100 waits for the document to finish.
+  int32_t progress = std::min(aProgress, 99);
+  if (progress <= std::max(mLoadProgress, mPendingProgress)) {
+    return;
+  }
+  mPendingProgress = progress;
+  mPendingCurTotal = aCurTotal;
+  mPendingMaxTotal = aMaxTotal;
+
+  if (mProgressTimer) {
+    return;
+  }
+
+  double elapsed = mLastProgress.IsNull() ? sLoadProgressInterval
+                                          : (TimeStamp::Now() - mLastProgress).ToMilliseconds();
+  if (elapsed >= sLoadProgressInterval) {
+    FlushProgress();
+    return;
+  }
+
+  RefPtr<WebBrowserChrome> self = this;
+  NS_NewTimerWithCallback(getter_AddRefs(mProgressTimer),
+                          [self](nsITimer*) {
+                            self->mProgressTimer = nullptr;
+                            self->FlushProgress();
+                          },
+                          uint32_t(sLoadProgressInterval - elapsed), nsITimer::TYPE_ONE_SHOT,
+                          "WebBrowserChrome::FlushProgress");
+}
+
+void
+WebBrowserChrome::FlushProgress()
+{
+  if (mProgressTimer) {
+    mProgressTimer->Cancel();
+    mProgressTimer = nullptr;
+  }
+  if (!mListener || mPendingProgress <= mLoadProgress) {
+    return;
+  }
+
+  mLoadProgress = mPendingProgress;
+  mLastProgress = TimeStamp::Now();
+  mListener->OnLoadProgress(mLoadProgress, mPendingCurTotal, mPendingMaxTotal);
+}
+
+void
+WebBrowserChrome::FinishLoad()
+{
+  mPendingProgress = 100;
+  mPendingCurTotal = mPendingMaxTotal = std::max(mTotalRequests, 1);
+  FlushProgress();
+  mListener->OnLoadFinished();
+
+  if (mLoadStart.IsNull()) {
+    return;
+  }
+
+  TimeStamp now = TimeStamp::Now();
+  uint32_t timeToFirstPaint = mLoadFirstPaint.IsNull() ? 0 :
+      uint32_t(std::max((mLoadFirstPaint - mLoadStart).ToMilliseconds(), 1.0));
+  uint32_t timeToLoad = uint32_t((now - mLoadStart).ToMilliseconds());
+  mLoadStart = TimeStamp();
+  mListener->OnLoadSummary(mTotalRequests, mLoadBytes, timeToFirstPaint, timeToLoad);
+}
+
+nsRefreshDriver*
+WebBrowserChrome::GetRefreshDriver()
+{
+  nsCOMPtr<nsIDocShell> docShell = do_GetInterface(mWebBrowser);
+  PresShell* presShell = docShell ? docShell->GetPresShell() : nullptr;
+  nsPresContext* presContext = presShell ? presShell->GetPresContext() : nullptr;
+  return presContext ? presContext->RefreshDriver() : nullptr;
+}
+
+void
+WebBrowserChrome::ScheduleScrollState(uint32_t aChanges)
+{
+  mPendingScrollState |= aChanges;
+
+  // A navigation may have brought a new refresh driver along.
+  RefPtr<nsRefreshDriver> driver = GetRefreshDriver();
+  if (driver == mRefreshDriver) {
+    return;
+  }
+
+  StopScrollState();
+  if (!driver) {
+    return;
+  }
+
+  if (!mScrollStateObserver) {
+    mScrollStateObserver = new ScrollStateObserver(this);
+  }
+  driver->AddRefreshObserver(mScrollStateObserver, FlushType::Display);
+  mRefreshDriver = driver.forget();
+}
+
+void
+WebBrowserChrome::StopScrollState()
 {
-  NS_ENSURE_TRUE(mListener, );
+  if (mRefreshDriver) {
+    mRefreshDriver->RemoveRefreshObserver(mScrollStateObserver, FlushType::Display);
+    mRefreshDriver = nullptr;
+  }
+}
+
+void
+WebBrowserChrome::FlushScrollState(TimeStamp aNow)
+{
+  if (!mListener || !mPendingScrollState) {
+    StopScrollState();
+    return;
+  }
+
+  // Background views keep collecting until their interval has passed.
+  bool isActive = true;
+  nsCOMPtr<nsIDocShell> docShell = do_GetInterface(mWebBrowser);
+  if (docShell) {
+    docShell->GetIsActive(&isActive);
+  }
+  if (!isActive && !mLastScrollState.IsNull() &&
+      (aNow - mLastScrollState).ToMilliseconds() < sBackgroundScrollStateInterval) {
+    return;
+  }
+
+  StopScrollState();
+  uint32_t changes = mPendingScrollState;
+  mPendingScrollState = 0;
+
   nsCOMPtr<mozIDOMWindowProxy> window = do_GetInterface(mWebBrowser);
   nsIntPoint offset = GetScrollOffset(window);
-  if (mScrollOffset.x == offset.x && mScrollOffset.y == offset.y) {
+  if (offset != mScrollOffset) {
+    mScrollOffset = offset;
+    changes |= nsIEmbedBrowserChromeListener::SCROLL_OFFSET_CHANGED;
+  } else {
+    changes &= ~nsIEmbedBrowserChromeListener::SCROLL_OFFSET_CHANGED;
+  }
+
+  // Ignore changes to width and height contributed by growth in page
+  // quadrants other than x > 0 && y > 0.
+  uint32_t width = 0;
+  uint32_t height = 0;
+  if (changes & nsIEmbedBrowserChromeListener::SCROLLED_AREA_CHANGED) {
+    const float x = mScrolledArea.X() + offset.x;
+    const float y = mScrolledArea.Y() + offset.y;
+    width = mScrolledArea.Width() + (x < 0 ? x : 0);
+    height = mScrolledArea.Height() + (y < 0 ? y : 0);
+  }
+
+  if (!changes) {
     return;
   }
-  mScrollOffset = offset;
-  mListener->OnScrollChanged(offset.x, offset.y);
+
+  mLastScrollState = aNow;
+  mListener->OnScrollStateChanged(changes, offset.x, offset.y, width, height);
 }
 
 
@@ -650,6 +853,11 @@ void WebBrowserChrome::SetEventHandler()
   target->AddEventListener(NS_LITERAL_STRING(MOZ_MozScrolledAreaChanged), this, PR_FALSE);
   target->AddEventListener(NS_LITERAL_STRING(MOZ_scroll), this, PR_FALSE);
   target->AddEventListener(NS_LITERAL_STRING(MOZ_pagehide), this, PR_FALSE);
+
+  nsCOMPtr<nsIObserverService> os = mozilla::services::GetObserverService();
+  if (os) {
+    os->AddObserver(this, "audio-playback", true);
+  }
 }
 
 void WebBrowserChrome::RemoveEventHandler()
@@ -661,6 +869,17 @@ void WebBrowserChrome::RemoveEventHandler()
 
   mListener = nullptr;
   mHandlerAdded = false;
+  mMediaPlaying = false;
+  nsCOMPtr<nsIObserverService> os = mozilla::services::GetObserverService();
+  if (os) {
+    os->RemoveObserver(this, "audio-playback");
+  }
+  StopScrollState();
+  mPendingScrollState = 0;
+  if (mProgressTimer) {
+    mProgressTimer->Cancel();
+    mProgressTimer = nullptr;
+  }
   nsCOMPtr<nsPIDOMWindowOuter> pidomWindow = do_QueryInterface(mWebBrowser);
   NS_ENSURE_TRUE(pidomWindow, );
   RefPtr<EventTarget> target(pidomWindow->GetChromeEventHandler());
@@ -737,6 +956,23 @@ nsresult WebBrowserChrome::RemoveUserAgentObserver(nsIRequest* request)
   return NS_OK;
 }
 
+void WebBrowserChrome::MediaPlaybackChanged(nsISupports* aWindow, const char16_t* aState)
+{
+  // AudioChannelService reports the audible state of a whole tab on its
+  // top level window: "active", "inactive-pause" or "inactive-nonaudible".
+  nsCOMPtr<nsPIDOMWindowOuter> window = do_QueryInterface(aWindow);
+  nsCOMPtr<mozIDOMWindowProxy> docWin = do_GetInterface(mWebBrowser);
+  if (!window || !docWin || window->GetInProcessTop() != nsPIDOMWindowOuter::From(docWin)) {
+    return;
+  }
+
+  bool playing = aState && NS_LITERAL_STRING("active").Equals(aState);
+  if (playing != mMediaPlaying && mListener) {
+    mMediaPlaying = playing;
+    mListener->OnMediaPlaybackChanged(playing);
+  }
+}
+
 NS_IMETHODIMP
 WebBrowserChrome::Observe(nsISupports* aSubject, const char* aTopic,
                           const char16_t* aData) {
@@ -756,6 +992,8 @@ WebBrowserChrome::Observe(nsISupports* aSubject, const char* aTopic,
     }
     // Notify listeners about the user agent string in use
     mListener->OnHttpUserAgentUsed(httpUserAgent.get());
+  } else if (strcmp(aTopic, "audio-playback") == 0) {
+    MediaPlaybackChanged(aSubject, aData);
   }
 
   return NS_OK;
@@ -17,7 +17,10 @@
 #include "nsIObserver.h"
 #include "nsString.h"
 #include "nsIObserverService.h"
+#include "nsITimer.h"
 #include "nsWeakReference.h"
+#include "mozilla/TimeStamp.h"
+#include "Units.h"
 
 #include "nsPoint.h"
 
@@ -30,6 +33,7 @@ namespace embedlite {
 }
 
 class nsIEmbedBrowserChromeListener;
+class nsRefreshDriver;
 class WebBrowserChrome : public nsIWebBrowserChrome,
                          public nsIWebProgressListener,
                          public nsIWebBrowserChromeFocus,
@@ -63,14 +67,29 @@ protected:
   virtual ~WebBrowserChrome();
 
 private:
+  class ScrollStateObserver;
+
   nsIntPoint GetScrollOffset(mozIDOMWindowProxy *aWindow);
   nsresult GetDocShellPtr(nsIDocShell **aDocShell);
   nsresult GetDocumentPtr(mozilla::dom::Document **aDocument);
   nsresult GetHttpUserAgent(nsIRequest* request, nsAString& aHttpUserAgent);
   nsresult AddUserAgentObserver(nsIRequest* request);
   nsresult RemoveUserAgentObserver(nsIRequest* request);
-
-  void SendScroll();
+  void MediaPlaybackChanged(nsISupports* aWindow, const char16_t* aState);
+
+  // Scroll state is sampled once per refresh driver tick and sent as one
+  // onScrollStateChanged, aChanges are nsIEmbedBrowserChromeListener flags.
+  void ScheduleScrollState(uint32_t aChanges);
+  void FlushScrollState(mozilla::TimeStamp aNow);
+  void StopScrollState();
+  nsRefreshDriver* GetRefreshDriver();
+
+  // Load progress is monotonic during a load and sent at most once per
+  // embedlite.load_progress.interval ms.
+  void StartLoad();
+  void ReportProgress(int32_t aProgress, int32_t aCurTotal, int32_t aMaxTotal);
+  void FlushProgress();
+  void FinishLoad();
 
   /* additional members */
   nsCOMPtr<nsIWebBrowser> mWebBrowser;
@@ -83,11 +102,27 @@ private:
   nsCString mLastLocation;
   bool mFirstPaint;
   nsIntPoint mScrollOffset;
+  RefPtr<ScrollStateObserver> mScrollStateObserver;
+  RefPtr<nsRefreshDriver> mRefreshDriver;
+  uint32_t mPendingScrollState;
+  mozilla::CSSRect mScrolledArea;
+  mozilla::TimeStamp mLastScrollState;
+  int32_t mLoadProgress;
+  int32_t mPendingProgress;
+  int32_t mPendingCurTotal;
+  int32_t mPendingMaxTotal;
+  mozilla::TimeStamp mLastProgress;
+  nsCOMPtr<nsITimer> mProgressTimer;
+  // Null while no top level load is in progress.
+  mozilla::TimeStamp mLoadStart;
+  mozilla::TimeStamp mLoadFirstPaint;
+  uint64_t mLoadBytes;
   nsCOMPtr<nsIObserverService> mObserverService;
   nsIEmbedBrowserChromeListener* mListener;
   nsString mTitle;
   RefPtr<mozilla::embedlite::BrowserChildHelper> mHelper;
   RefPtr<nsIRequest> mRequest;
+  bool mMediaPlaying;
 };
 
 #endif /* Header guard */
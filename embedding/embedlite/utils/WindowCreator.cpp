@@ -14,8 +14,6 @@
 #include "EmbedLiteAppChildIface.h"
 #include "nsCOMPtr.h"
 #include "nsIOpenWindowInfo.h"
-#include "nsIThread.h"
-#include "nsThreadUtils.h"           // for NS_GetCurrentThread
 #include <sys/syscall.h>
 
 using namespace mozilla::embedlite;
@@ -52,40 +50,25 @@ WindowCreator::CreateChromeWindow(nsIWebBrowserChrome *aParent,
 
 
   EmbedLiteViewChildIface* parent = mChild->GetViewByChromeParent(aParent);
-  uint32_t createdID = 0;
   uint32_t parentID = parent ? parent->GetID() : 0;
 
   RefPtr<BrowsingContext> parentBrowsingContext = aOpenWindowInfo->GetParent();
 
   LOGT("parent: %p, chrome flags: %u, thread id: %ld parent opener id: %" PRId64 "", aParent, aChromeFlags, syscall(SYS_gettid), parentBrowsingContext->Id());
 
-  mChild->CreateWindow(parentID, reinterpret_cast<uintptr_t>(parentBrowsingContext.get()), aChromeFlags, &createdID, aCancel);
-
-  if (*aCancel) {
+  // The view is built right here and handed to the embedder asynchronously,
+  // content never waits for the UI. If the embedder declines the window or
+  // does not adopt it in time the view gets destroyed, which content sees
+  // as the window being closed.
+  EmbedLiteViewChildIface* view = mChild->CreateWindow(parentID, reinterpret_cast<uintptr_t>(parentBrowsingContext.get()), aChromeFlags);
+  if (!view) {
+    *aCancel = true;
     return NS_OK;
   }
 
-  nsresult rv(NS_OK);
   nsCOMPtr<nsIWebBrowserChrome> browser;
-  nsCOMPtr<nsIThread> thread;
-  NS_GetCurrentThread(getter_AddRefs(thread));
-  while (!browser && NS_SUCCEEDED(rv)) {
-    bool processedEvent;
-    rv = thread->ProcessNextEvent(true, &processedEvent);
-    if (NS_SUCCEEDED(rv) && !processedEvent) {
-      rv = NS_ERROR_UNEXPECTED;
-    }
-    EmbedLiteViewChildIface* view = mChild->GetViewByID(createdID);
-    if (view) {
-      view->GetBrowserChrome(getter_AddRefs(browser));
-    }
-  }
-
-  // check to make sure that we made a new window
-  if (_retval) {
-      NS_ADDREF(*_retval = browser);
-      return NS_OK;
-  }
-
-  return NS_ERROR_UNEXPECTED;
+  nsresult rv = view->GetBrowserChrome(getter_AddRefs(browser));
+  NS_ENSURE_SUCCESS(rv, rv);
+  browser.forget(_retval);
+  return NS_OK;
 }
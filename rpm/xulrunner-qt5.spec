@@ -140,6 +140,7 @@ Patch82:    0082-sailfishos-gecko-Allow-LoginManagerPrompter-to-find-.patch
 Patch83:    0083-sailfishos-gecko-dev-Disallow-page-zooming-if-the-me.patch
 Patch84:    0084-sailfishos-gecko-Fix-audio-underruns-for-fullduplex-.patch
 Patch85:    0085-sailfishos-gecko-dev-Fix-video-hardware-accelaration.patch
+Patch86:    0086-sailfishos-gecko-Create-EmbedLiteCompositorProcessParent-for-EmbedLite-content.patch
 #Patch20:    0020-sailfishos-loginmanager-Adapt-LoginManager-to-EmbedL.patch
 #Patch51:    0051-sailfishos-gecko-Remove-android-define-from-logging.patch
 #Patch59:    0059-sailfishos-gecko-Ignore-safemode-in-gfxPlatform.-Fix.patch